@@ -373,6 +373,24 @@ Response: {
         <div class="example">Example: /note_off?note=60</div>
     </div>
 
+    <div class="endpoint">
+        <span class="method get">GET</span>
+        <span class="path">/ws</span>
+        <div class="description">WebSocket for playing with low latency (used by the keyboard and player pages). Binary messages both ways are MUDP packets (docs/MIDIUDP.md): packets sent are played like UDP ones, and every chime strike comes back as a note-on and every release as a note-off, whatever played them. Two connections at a time.</div>
+        <div class="example">Example: new WebSocket('ws://' + location.host + '/ws')</div>
+    </div>
+
+    <div class="endpoint">
+        <span class="method post">POST</span>
+        <span class="path">/mudp/delay</span>
+        <div class="description">Set the MUDP-v2 playout delay: how long after its sender time a timed UDP message is played (docs/MIDIUDP.md). Longer rides out worse WiFi at the cost of latency. Saved to NVS; loss, reordering and late messages are on /status under midiUdp.</div>
+        <div class="params">
+            <strong>Parameters:</strong><br>
+            <span class="param">ms</span> - Delay in milliseconds (0-500, default 30)
+        </div>
+        <div class="example">Example: /mudp/delay?ms=40</div>
+    </div>
+
     <div class="endpoint">
         <span class="method get">GET</span>
         <span class="path">/all_off</span>
@@ -397,9 +415,13 @@ Response: {
         <div class="description">Ring a specific channel</div>
         <div class="params">
             <strong>Path Parameter:</strong><br>
-            <span class="param">channel_number</span> - Channel number (1-16)
+            <span class="param">channel_number</span> - Channel number (1-16)<br>
+            <strong>Query Parameters:</strong><br>
+            <span class="param">duty</span> - Kick duty percentage, 1-100 (default 100)<br>
+            <span class="param">hold</span> - Kick hold time in ms, 0-1000 (default 35)<br>
+            <span class="param">hold_us</span> - Kick hold time in microseconds (overrides hold)
         </div>
-        <div class="example">Example: /ringchannel/8</div>
+        <div class="example">Example: /ringchannel/8?duty=80&amp;hold_us=37500</div>
     </div>
 
     <h2 id="sequencer">MIDI Sequencer</h2>
@@ -425,6 +447,17 @@ Response: {
         <div class="example">Example: /seq_resume</div>
     </div>
 
+    <div class="endpoint">
+        <span class="method get">GET</span>
+        <span class="path">/seq_mode</span>
+        <div class="description">Select sequencer scheduling and reset the jitter histogram shown in /status</div>
+        <div class="params">
+            <strong>Parameters:</strong><br>
+            <span class="param">mode</span> - "timer" (hardware timer, default) or "loop" (polled from main loop), optional
+        </div>
+        <div class="example">Example: /seq_mode?mode=loop</div>
+    </div>
+
     <h2 id="repeater">Note Repeater</h2>
 
     <div class="endpoint">
@@ -506,7 +539,7 @@ Response: {
         <div class="description">Upload a MIDI file to SPIFFS storage (multipart/form-data)</div>
         <div class="params">
             <strong>Form Data:</strong><br>
-            <span class="param">file</span> - MIDI file to upload (must have valid MThd header)<br>
+            <span class="param">file</span> - MIDI file to upload (must have valid MThd header), or an image precompiled by utilities/midi2bc (MBC1 header)<br>
             Maximum filename length: 31 characters<br>
             Files stored in /midi directory
         </div>
@@ -596,8 +629,37 @@ Response: {"success":true,"message":"Playback started"}
     <div class="endpoint">
         <span class="method get">GET</span>
         <span class="path">/logs/poll</span>
-        <div class="description">Poll for new log entries (used by /logs page)</div>
-        <div class="example">Example: /logs/poll</div>
+        <div class="description">New log lines as JSON; pass the returned index as since on the next poll</div>
+        <div class="example">Example: /logs/poll?since=0</div>
+    </div>
+
+    <div class="endpoint">
+        <span class="method get">GET</span>
+        <span class="path">/logs/stream</span>
+        <div class="description">Server-Sent Events stream of the log (used by /logs page): the lines still buffered, then new lines as they are logged. Reconnect with since set to the last event id.</div>
+        <div class="example">Example: curl -N /logs/stream?since=0</div>
+    </div>
+
+    <div class="endpoint">
+        <span class="method post">POST</span>
+        <span class="path">/bench</span>
+        <div class="description">Run the note-path microbenchmarks and return a plain-text table of cycles per call, per MIDI message and per input byte. Stops any song that is playing; no chime rings. Run with the organ idle.</div>
+        <div class="params">
+            <strong>Parameters:</strong><br>
+            <span class="param">budget</span> - (optional) CPU cycles per timed run, 10000-240000000 (default 2400000 = 10 ms)
+        </div>
+        <div class="example">Example: /bench?budget=2400000</div>
+    </div>
+
+    <div class="endpoint">
+        <span class="method get">GET</span>
+        <span class="path">/trace</span>
+        <div class="description">Note latency trace as Chrome trace JSON (open in chrome://tracing or ui.perfetto.dev): one mark per pipeline stage (rx, parse, handler, mapping, output, latch) on a track per core, and one span per note from input to actuator edge. Only in builds with -DNOTE_TRACE, which also adds p50/p99/max latency per stage to /status as "trace".</div>
+        <div class="params">
+            <strong>Parameters:</strong><br>
+            <span class="param">clear</span> - (optional) 1 = empty the trace after sending it
+        </div>
+        <div class="example">Example: /trace?clear=1</div>
     </div>
 
     <hr>
@@ -0,0 +1,67 @@
+#include "bench_notepath.h"
+#include "midihandler.h"
+#include "midiseq.h"
+#include "chimes.h"
+
+// Format 0, 96 ticks per quarter: four notes below the chime range, so
+// even if the sequencer timer fires before the stop nothing rings
+static const uint8_t BENCH_SMF[] = {
+  'M', 'T', 'h', 'd', 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x01, 0x00, 0x60,
+  'M', 'T', 'r', 'k', 0x00, 0x00, 0x00, 0x24,
+  0x00, 0x90, 0x3C, 0x64,  0x60, 0x80, 0x3C, 0x00,
+  0x00, 0x90, 0x3E, 0x64,  0x60, 0x80, 0x3E, 0x00,
+  0x00, 0x90, 0x40, 0x64,  0x60, 0x80, 0x40, 0x00,
+  0x00, 0x90, 0x41, 0x64,  0x60, 0x80, 0x41, 0x00,
+  0x00, 0xFF, 0x2F, 0x00,
+};
+#define BENCH_SMF_EVENTS 8
+
+// Note on then note off across the chimes (MIDI 68-88): dispatch, note
+// mapping, the strike and its power budget, with the drivers muted
+static void bench_handle_on_off(uint32_t iters) {
+  for (uint32_t i = 0; i < iters; i++) {
+    uint8_t note = 68 + i % 21;
+    handle_midi_message(0x90, note, 100);
+    handle_midi_message(0x80, note, 0);
+  }
+}
+
+// Header and track parse, first lookahead refill, then stop
+static void bench_load_from_buffer(uint32_t iters) {
+  for (uint32_t i = 0; i < iters; i++) {
+    midiseq_load_from_buffer(BENCH_SMF, sizeof(BENCH_SMF));
+    midiseq_stop();
+  }
+}
+
+const BenchCase BENCH_NOTEPATH_CASES[] = {
+  { "handle_midi_message/on_off",     bench_handle_on_off,    2, 6 },
+  { "midiseq_load_from_buffer/smf58", bench_load_from_buffer, BENCH_SMF_EVENTS, sizeof(BENCH_SMF) },
+};
+static_assert(sizeof(BENCH_NOTEPATH_CASES) / sizeof(BENCH_NOTEPATH_CASES[0]) == BENCH_NOTEPATH_COUNT,
+              "BENCH_NOTEPATH_COUNT does not match the cases");
+
+void bench_notepath_begin() {
+  midiseq_stop();
+  chimes_set_muted(true);
+}
+
+void bench_notepath_end() {
+  midiseq_unload();
+  // Drop the bench strikes before the drivers follow the note path again
+  chimes_all_off();
+  chimes_set_muted(false);
+}
+
+void bench_notepath_measure(BenchResult* res, uint32_t budgetCycles) {
+  bench_notepath_begin();
+  for (int i = 0; i < BENCH_NOTEPATH_COUNT; i++) {
+    res[i] = bench_run(BENCH_NOTEPATH_CASES[i], budgetCycles);
+  }
+  bench_notepath_end();
+}
+
+void bench_notepath_print(Print& out, const BenchResult* res) {
+  bench_print_header(out);
+  for (int i = 0; i < BENCH_NOTEPATH_COUNT; i++) bench_print(out, res[i]);
+}
@@ -0,0 +1,24 @@
+// bench_notepath.h - Microbenchmarks for the chimes note path
+#ifndef BENCH_NOTEPATH_H
+#define BENCH_NOTEPATH_H
+
+#include <Arduino.h>
+#include "bench.h"
+
+// Cases that are safe to run on a live chimes controller: the drivers are
+// muted while they run (chimes_set_muted), so nothing rings
+#define BENCH_NOTEPATH_COUNT 2
+extern const BenchCase BENCH_NOTEPATH_CASES[];
+
+// Stop the sequencer and mute the drivers before the cases run;
+// bench_notepath_end() unloads the bench sequence, clears the bench
+// strikes and unmutes
+void bench_notepath_begin();
+void bench_notepath_end();
+
+// Run every case with the given per-run budget into res[BENCH_NOTEPATH_COUNT]
+// (loop task), then print the results table from any task
+void bench_notepath_measure(BenchResult* res, uint32_t budgetCycles);
+void bench_notepath_print(Print& out, const BenchResult* res);
+
+#endif // BENCH_NOTEPATH_H
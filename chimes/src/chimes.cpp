@@ -2,13 +2,15 @@
 #include <Arduino.h>
 #include "driver/mcpwm.h"
 #include "driver/sigmadelta.h"
+#include "esp_timer.h"
 #include "logger.h"
+#include "notetrace.h"
 
 // #define MAKE_NO_SOUND 1
 
 // ---------- User-tweakable envelope ----------
 static const uint16_t KICK_DUTY = 100;      // % duty during lift
-static const uint32_t KICK_MS   = 35;       // ms
+static const uint32_t KICK_US   = 35000;    // us
 static const uint32_t PWM_FREQ  = 4000;     // Hz (>=2 kHz to avoid whine)
 static const uint8_t  LEDC_RES_BITS = 12;   // 12-bit resolution
 
@@ -100,46 +102,67 @@ static const int NOTE_TO_CHANNEL[21] = {
 
 // ---------- Calibration Data ----------
 // Per-channel calibration: min and max duty percentage for velocity scaling
+// Kick hold times are in microseconds so they can be tuned below 1 ms.
 struct ChimeCalibration {
   uint8_t min_duty_pct;  // Minimum duty % (for velocity=1)
   uint8_t max_duty_pct;  // Maximum duty % (for velocity=127)
-  uint16_t kick_ms_min;   // Kick hold time at max duty (shorter)
-  uint16_t kick_ms_max;   // Kick hold time at min duty (longer)
+  uint32_t kick_us_min;   // Kick hold time at max duty (shorter)
+  uint32_t kick_us_max;   // Kick hold time at min duty (longer)
 };
 
 static ChimeCalibration CALIBRATION[21] = {
-  {60, 100, 35, 70}, // channel 0
-  {60, 100, 35, 90}, // channel 1
-  {60, 100, 35, 75}, // channel 2
-  {65, 100, 35, 80}, // channel 3
-  {73, 100, 35, 80}, // channel 4
-  {70, 100, 35, 100}, // channel 5
-  {60, 98, 35, 90}, // channel 6
-  {60, 100, 35, 90}, // channel 7
-  {55, 100, 35, 80}, // channel 8
-  {60, 100, 35, 90}, // channel 9
-  {65, 100, 35, 100}, // channel 10
-  {72, 100, 35, 80}, // channel 11
-  {65, 100, 35, 100}, // channel 12
-  {60, 100, 35, 80}, // channel 13
-  {70, 100, 35, 50}, // channel 14
-  {78, 100, 35, 90}, // channel 15
-  {58, 100, 35, 95}, // channel 16
-  {65, 100, 35, 80}, // channel 17
-  {60, 100, 35, 80}, // channel 18
-  {57, 100, 35, 80}, // channel 19
-  {60, 100, 35, 100}  // channel 20
+  {60, 100, 35000, 70000}, // channel 0
+  {60, 100, 35000, 90000}, // channel 1
+  {60, 100, 35000, 75000}, // channel 2
+  {65, 100, 35000, 80000}, // channel 3
+  {73, 100, 35000, 80000}, // channel 4
+  {70, 100, 35000, 100000}, // channel 5
+  {60, 98, 35000, 90000}, // channel 6
+  {60, 100, 35000, 90000}, // channel 7
+  {55, 100, 35000, 80000}, // channel 8
+  {60, 100, 35000, 90000}, // channel 9
+  {65, 100, 35000, 100000}, // channel 10
+  {72, 100, 35000, 80000}, // channel 11
+  {65, 100, 35000, 100000}, // channel 12
+  {60, 100, 35000, 80000}, // channel 13
+  {70, 100, 35000, 50000}, // channel 14
+  {78, 100, 35000, 90000}, // channel 15
+  {58, 100, 35000, 95000}, // channel 16
+  {65, 100, 35000, 80000}, // channel 17
+  {60, 100, 35000, 80000}, // channel 18
+  {57, 100, 35000, 80000}, // channel 19
+  {60, 100, 35000, 100000}  // channel 20
 };
 
 // ---------- Simple strike state machine ----------
+// Each channel owns a one-shot esp_timer that drops the duty at exactly
+// t0 + kick_hold_us, independent of how often chimes_loop() runs.
+//
+// Strikes are started from the note path and ended from the timer, the
+// power budget and chimes_loop(). Each of them decides the new state under
+// strike_mux and bumps the channel's gen, then calls apply_duty() after
+// leaving it: driver calls never run inside the spinlock, and whichever
+// write lands last is always the newest decision.
 enum class StrikeState : uint8_t { IDLE, KICK };
 struct Strike {
   StrikeState st = StrikeState::IDLE;
-  uint32_t t0 = 0; // ms start time
+  uint32_t t0 = 0; // us start time (micros())
   uint8_t duty_pct = 100; // Initial duty for this strike
-  uint16_t kick_hold_ms = KICK_MS;  // Kick hold time in ms (uint16_t supports up to 65535ms)
+  uint32_t kick_hold_us = KICK_US;  // Kick hold time in us
+  uint32_t gen = 0;  // Bumped on every state change, under strike_mux
+  esp_timer_handle_t timer = nullptr;
 };
 static Strike S[21];
+static portMUX_TYPE strike_mux = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool muted = false;  // chimes_set_muted()
+
+// Release early by at most this much if the timer fires a touch ahead of
+// micros(); anything earlier is a stale callback from a restarted strike.
+static const uint32_t RELEASE_SLACK_US = 20;
+
+// Strikes still in KICK this long after their release time are released
+// by chimes_loop() as a safety net (e.g. timer could not be created).
+static const uint32_t RELEASE_OVERDUE_US = 5000;
 
 // ---------- Power Budget System ----------
 // At 13V and 8 ohms, each chime draws 1.625A when active
@@ -234,6 +257,48 @@ static void initSIGMA() {
 }
 
 
+// Duty for the channel's current state; call under strike_mux
+static inline uint16_t state_duty(const Strike &st) {
+  return st.st == StrikeState::KICK ? st.duty_pct : 0;
+}
+
+// Write the duty decided at gen, outside strike_mux. If a newer decision
+// was made meanwhile, its own writer may already have run, so write the
+// newest duty again until no decision lands during the write.
+static void apply_duty(int ch, uint32_t gen, uint16_t duty) {
+  for (;;) {
+    setDutyPct(ch, muted ? 0 : duty);
+    portENTER_CRITICAL(&strike_mux);
+    bool current = S[ch].gen == gen;
+    gen = S[ch].gen;
+    duty = state_duty(S[ch]);
+    portEXIT_CRITICAL(&strike_mux);
+    if (current) return;
+  }
+}
+
+// Drop the duty if the strike on this channel is due. Returns true if released.
+static bool release_if_due(int ch, uint32_t now, uint32_t slack_us) {
+  bool release = false;
+  uint32_t gen = 0;
+  portENTER_CRITICAL(&strike_mux);
+  Strike &st = S[ch];
+  if (st.st == StrikeState::KICK && now - st.t0 + slack_us >= st.kick_hold_us) {
+    st.st = StrikeState::IDLE;
+    gen = ++st.gen;
+    release = true;
+  }
+  portEXIT_CRITICAL(&strike_mux);
+  if (release) apply_duty(ch, gen, 0);
+  return release;
+}
+
+// esp_timer callback (runs in the esp_timer task): end of kick for one channel
+static void strike_timer_cb(void* arg) {
+  int ch = (int)(intptr_t)arg;
+  release_if_due(ch, micros(), RELEASE_SLACK_US);
+}
+
 // ---------- Public API ----------
 extern "C" {
 
@@ -241,6 +306,19 @@ void chimes_begin() {
   // Zero states
   for (auto &s : S) { s.st = StrikeState::IDLE; s.t0 = 0; }
 
+  for (int ch = 0; ch < 21; ++ch) {
+    if (S[ch].timer) continue;
+    esp_timer_create_args_t args = {};
+    args.callback = strike_timer_cb;
+    args.arg = (void*)(intptr_t)ch;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "chime";
+    if (esp_timer_create(&args, &S[ch].timer) != ESP_OK) {
+      Log.printf("Chime %d: no release timer, falling back to loop polling\n", ch);
+      S[ch].timer = nullptr;
+    }
+  }
+
   initMCPWM();
   initLEDC();
   initSIGMA();
@@ -252,36 +330,45 @@ void chimes_begin() {
 // Find oldest active chime and kill it
 static void enforce_power_budget(int max_allowed) {
   int oldest_ch = -1;
-  uint32_t oldest_t0 = UINT32_MAX;
+  uint32_t oldest_age = 0;
   int active_count = 0;
+  uint32_t gen = 0;
   
   do {
     active_count = 0;
     oldest_ch = -1;
-    oldest_t0 = UINT32_MAX;
+    oldest_age = 0;
+    const uint32_t now = micros();
 
+    portENTER_CRITICAL(&strike_mux);
     for (int ch = 0; ch < 21; ++ch) {
       if (S[ch].st == StrikeState::KICK) {
         active_count++;
-        if (S[ch].t0 < oldest_t0) {
-          oldest_t0 = S[ch].t0;
+        uint32_t age = now - S[ch].t0;
+        if (oldest_ch < 0 || age > oldest_age) {
+          oldest_age = age;
           oldest_ch = ch;
         }
       }
     }
     if (active_count > max_allowed && oldest_ch >= 0) {
-      Log.printf("Power budget: Killing oldest chime %d (active=%d/%d)\n", 
-                oldest_ch, active_count, MAX_CONCURRENT_CHIMES);
-      
       // Force it to IDLE
       S[oldest_ch].st = StrikeState::IDLE;
-      setDutyPct(oldest_ch, 0);
+      gen = ++S[oldest_ch].gen;
+    }
+    portEXIT_CRITICAL(&strike_mux);
+
+    if (active_count > max_allowed && oldest_ch >= 0) {
+      LOG_WARN("Power budget: Killing oldest chime %d (active=%d/%d)\n", 
+                oldest_ch, active_count, MAX_CONCURRENT_CHIMES);
+      if (S[oldest_ch].timer) esp_timer_stop(S[oldest_ch].timer);
+      apply_duty(oldest_ch, gen, 0);
       active_count--;
     }
   } while (active_count > max_allowed);
 }
 
-void ring_chime_raw(int ch, int dutyPct, int kickHoldTimeMs) {
+void ring_chime_raw_us(int ch, int dutyPct, uint32_t kickHoldTimeUs) {
   if (ch < 0 || ch >= 21) return;
   
   // Check power budget - if at limit and this is a new strike, kill oldest chime
@@ -290,15 +377,32 @@ void ring_chime_raw(int ch, int dutyPct, int kickHoldTimeMs) {
     enforce_power_budget(MAX_CONCURRENT_CHIMES - 1);
   }
   
-  // Start a new strike if idle (or restart current one)
+  // Start a new strike if idle (or restart current one). A release callback
+  // from the previous strike that is already running sees the new t0 and
+  // backs off.
+  if (S[ch].timer) esp_timer_stop(S[ch].timer);
+
+  if (dutyPct < 0) dutyPct = 0;
+  if (dutyPct > 100) dutyPct = 100;
+  portENTER_CRITICAL(&strike_mux);
   S[ch].st = StrikeState::KICK;
-  S[ch].t0 = millis();
+  S[ch].t0 = micros();
   S[ch].duty_pct = dutyPct;
-  S[ch].kick_hold_ms = kickHoldTimeMs;
+  S[ch].kick_hold_us = kickHoldTimeUs;
+  uint32_t gen = ++S[ch].gen;
+  portEXIT_CRITICAL(&strike_mux);
+  apply_duty(ch, gen, dutyPct);
+  NOTE_MARK(NT_LATCH, NT_NO_NOTE);
+
+  if (S[ch].timer) esp_timer_start_once(S[ch].timer, kickHoldTimeUs);
 
-  Log.printf("%d ring_chime_raw: ch=%d duty=%d hold=%d\n", 
-             S[ch].t0, ch, dutyPct, kickHoldTimeMs);
-  setDutyPct(ch, dutyPct);
+  LOG_DEBUG("%u ring_chime_raw: ch=%d duty=%d hold=%uus\n", 
+            (unsigned)S[ch].t0, ch, dutyPct, (unsigned)kickHoldTimeUs);
+}
+
+void ring_chime_raw(int ch, int dutyPct, int kickHoldTimeMs) {
+  if (kickHoldTimeMs < 0) kickHoldTimeMs = 0;
+  ring_chime_raw_us(ch, dutyPct, (uint32_t)kickHoldTimeMs * 1000u);
 }
 
 void ring_chime_by_channel(int ch, int velocity) {
@@ -326,13 +430,15 @@ void ring_chime_by_channel(int ch, int velocity) {
   float inv_min_duty = 10000.0f / cal.min_duty_pct;
   
   // Linear interpolation in reciprocal space
-  float kick_ms_f = cal.kick_ms_min + 
-                    (cal.kick_ms_max - cal.kick_ms_min) * 
-                    (inv_duty - inv_max_duty) / (inv_min_duty - inv_max_duty);
+  float kick_us_f = (float)cal.kick_us_min;
+  if (cal.max_duty_pct != cal.min_duty_pct) {
+    kick_us_f += ((float)cal.kick_us_max - (float)cal.kick_us_min) *
+                 (inv_duty - inv_max_duty) / (inv_min_duty - inv_max_duty);
+  }
   
-  uint16_t kick_ms = (uint16_t)(kick_ms_f + 0.5f); // Round to nearest integer
+  uint32_t kick_us = (uint32_t)(kick_us_f + 0.5f); // Round to nearest microsecond
   
-  ring_chime_raw(ch, scaled_duty, kick_ms);
+  ring_chime_raw_us(ch, scaled_duty, kick_us);
 }
 
 void ring_chime(int note, int velocity) {
@@ -346,28 +452,30 @@ void ring_chime(int note, int velocity) {
 void chimes_all_off() {
   // Reset all chime plungers to idle state
   for (int ch = 0; ch < 21; ++ch) {
+    if (S[ch].timer) esp_timer_stop(S[ch].timer);
+    portENTER_CRITICAL(&strike_mux);
     S[ch].st = StrikeState::IDLE;
     S[ch].t0 = 0;
-    setDutyPct(ch, 0);
+    uint32_t gen = ++S[ch].gen;
+    portEXIT_CRITICAL(&strike_mux);
+    apply_duty(ch, gen, 0);
   }
 }
 
+void chimes_set_muted(bool m) {
+  muted = m;
+}
+
 void chimes_loop() {
-  const uint32_t now = millis();
+  // Releases normally come from each strike's esp_timer. This only catches
+  // strikes the timer missed, so a stuck solenoid cannot overheat the coil.
+  const uint32_t now = micros();
   for (int ch = 0; ch < 21; ++ch) {
-    Strike &st = S[ch];
-    switch (st.st) {
-      case StrikeState::IDLE:
-        break;
-
-      case StrikeState::KICK: {
-        if (now - st.t0 >= st.kick_hold_ms) {
-          // release (off)
-          setDutyPct(ch, 0);
-          st.st = StrikeState::IDLE;
-          Log.printf("%d Chime %d: IDLE\n", now, ch);
-        }
-      } break;
+    if (S[ch].st != StrikeState::KICK) continue;
+    uint32_t slack = S[ch].timer ? 0 : RELEASE_SLACK_US;
+    if (S[ch].timer && now - S[ch].t0 < S[ch].kick_hold_us + RELEASE_OVERDUE_US) continue;
+    if (release_if_due(ch, now, slack) && S[ch].timer) {
+      LOG_WARN("Chime %d: release timer overdue, released from loop\n", ch);
     }
   }
 }
@@ -1,6 +1,8 @@
 #ifndef CHIMES_H
 #define CHIMES_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -8,14 +10,17 @@ extern "C" {
 // Initialize the chimes system
 void chimes_begin(void);
 
-// Update chimes state machine (call frequently in main loop)
+// Safety net for missed release timers (call from main loop)
 void chimes_loop(void);
 
 // Ring a chime by note number (0-20)
 // Note number is mapped to physical channel via NOTE_TO_CHANNEL array
 void ring_chime(int note, int velocity);
 
+// Ring a physical channel with an explicit duty and kick hold time.
+// The kick is released by a one-shot timer, independent of chimes_loop().
 void ring_chime_raw(int ch, int dutyPct, int kickHoldTimeMs);
+void ring_chime_raw_us(int ch, int dutyPct, uint32_t kickHoldTimeUs);
 
 // Ring a chime by physical channel number (0-20), bypassing note mapping
 void ring_chime_by_channel(int ch, int velocity);
@@ -23,6 +28,10 @@ void ring_chime_by_channel(int ch, int velocity);
 // Reset all chime plungers to idle state
 void chimes_all_off(void);
 
+// While muted every driver write is 0% duty: strikes, timers and the power
+// budget run as usual but no plunger moves. For the note-path bench.
+void chimes_set_muted(bool muted);
+
 #ifdef __cplusplus
 }
 #endif
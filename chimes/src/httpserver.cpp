@@ -4,7 +4,6 @@
 #include <WebServer.h>
 #include "chimes.h"
 #include "midinote.h"
-#include "keyboard.h"
 #include "midiseq.h"
 #include "noterepeater.h"
 #include "songs.h"
@@ -12,158 +11,194 @@
 #include "clockchimes.h"
 #include "midiudp.h"
 #include "midifiles.h"
-#include "api_docs.h"
-#include "settings_page.h"
+#include "web_assets.h"
+#include "bench_notepath.h"
+#include "notetrace.h"
+#include "httpstream.h"
+#include "logstream.h"
+#include "websocket.h"
 
 static WebServer server(80);
 
-// ---------- Simple Circular Log Buffer ----------
-#define LOG_BUFFER_SIZE 100
-static String logBuffer[LOG_BUFFER_SIZE];
-static int logIndex = 0;
-static int logCount = 0;
-static int logTotalCount = 0; // Monotonically increasing counter
-static bool httpLoggingEnabled = false; // Only enable when logs requested
-static String pendingLogLine = ""; // Accumulator for incomplete lines
+// ---------- Log ring ----------
+// Everything logged, in a fixed-size ring streamed to /logs (logstream.h)
+static LogStream logStream;
 
 void httpserver_log(const uint8_t* buffer, size_t size) {
-  if (!httpLoggingEnabled) return; // Skip all String building if disabled
-  
-  // Build String from buffer, accumulating partial lines
-  for (size_t i = 0; i < size; i++) {
-    char c = buffer[i];
-    if (c == '\n') {
-      if (pendingLogLine.length() > 0) {
-        // Store complete line in buffer
-        logBuffer[logIndex] = pendingLogLine;
-        logIndex = (logIndex + 1) % LOG_BUFFER_SIZE;
-        if (logCount < LOG_BUFFER_SIZE) logCount++;
-        logTotalCount++;
-        pendingLogLine = "";
-      }
-    } else if (c != '\r') {
-      pendingLogLine += c;
-    }
-  }
+  logStream.write(buffer, size);
 }
 
 // Legacy C-string interface (for compatibility)
 void httpserver_log(const char* message) {
-  if (!httpLoggingEnabled) return;
-  
-  logBuffer[logIndex] = String(message);
-  logIndex = (logIndex + 1) % LOG_BUFFER_SIZE;
-  if (logCount < LOG_BUFFER_SIZE) logCount++;
-  logTotalCount++;
+  logStream.write((const uint8_t*)message, strlen(message));
+  logStream.write((const uint8_t*)"\n", 1);
 }
 
-String httpserver_get_logs() {
-  String result = "";
-  int start = (logCount < LOG_BUFFER_SIZE) ? 0 : logIndex;
-  for (int i = 0; i < logCount; i++) {
-    int idx = (start + i) % LOG_BUFFER_SIZE;
-    result += logBuffer[idx] + "\n";
-  }
-  return result;
+// ---------- Server task and loop calls ----------
+// The server runs in its own task on core 0, so a slow client or a long
+// upload never holds up MIDI input, the sequencer or the chimes on the loop
+// task. Pages, status and settings are handled in the server task. Anything
+// that plays, rings or drives the sequencer goes through runOnLoop(): the
+// call is queued, httpserver_loop() runs it on the loop task between
+// updates, and the handler waits for it before answering.
+#define HTTP_TASK_STACK    8192
+#define HTTP_TASK_PRIORITY 1
+#define HTTP_TASK_CORE     0
+#define LOOP_QUEUE_LEN     4
+
+// Arguments and result of one loop call, on the handler's stack
+struct LoopCall {
+  int32_t a, b, c, d;
+  const void* p;
+  bool ok;
+};
+
+struct LoopCmd {
+  void (*fn)(LoopCall& call);
+  LoopCall* call;
+};
+
+static QueueHandle_t loopQueue = nullptr;
+static SemaphoreHandle_t loopDone = nullptr;   // Only the server task waits on it
+
+static bool runOnLoop(void (*fn)(LoopCall& call), LoopCall& call) {
+  LoopCmd cmd = { fn, &call };
+  xQueueSend(loopQueue, &cmd, portMAX_DELAY);
+  xSemaphoreTake(loopDone, portMAX_DELAY);
+  return call.ok;
 }
 
-String httpserver_get_logs_since(int sinceTotal) {
-  String result = "";
-  
-  // If asking for logs before our buffer, or invalid, return all
-  if (sinceTotal < 0) {
-    return httpserver_get_logs();
-  }
-  
-  // Calculate how many new logs since the requested point
-  int newCount = logTotalCount - sinceTotal;
-  
-  // If no new logs, return empty
-  if (newCount <= 0) {
-    return "";
-  }
-  
-  // If asking for more logs than we have buffered, return all
-  if (newCount > logCount) {
-    return httpserver_get_logs();
+static bool runOnLoop(void (*fn)(LoopCall& call), int32_t a = 0, int32_t b = 0, int32_t c = 0) {
+  LoopCall call = { a, b, c, 0, nullptr, false };
+  return runOnLoop(fn, call);
+}
+
+// ---------- WebSocket note channel ----------
+// /ws carries MUDP packets (docs/MIDIUDP.md) both ways on one connection,
+// so a key press costs a few bytes instead of an HTTP request. What a page
+// sends is played as if it had come in over UDP. What it gets back is a
+// note-on for every chime struck and a note-off for every note released,
+// whoever played them, so pages can show the live state and time their
+// own notes from key to chime and back.
+#define WS_FEED_NOTES 16   // Note messages per packet sent to the pages
+
+static WebSocketServer ws;
+static NoteState wsSent[128];   // Server task only; the state the pages were last sent
+static bool wsSynced = false;   // wsSent is current; false while no page is connected
+
+static void handleWebSocket() {
+  ws.accept(server);
+}
+
+static void wsReceive(int client, const uint8_t* data, size_t size) {
+  LoopCall call = { (int32_t)size, 0, 0, 0, data, false };
+  runOnLoop([](LoopCall& c) { midiUDP.receive((const uint8_t*)c.p, (size_t)c.a); }, call);
+}
+
+// Send the pages what changed since the last call
+static void wsFeed() {
+  if (!ws.connected()) {
+    wsSynced = false;
+    return;
   }
-  
-  // Calculate starting position in circular buffer
-  int start = (logIndex - newCount + LOG_BUFFER_SIZE) % LOG_BUFFER_SIZE;
-  for (int i = 0; i < newCount; i++) {
-    int idx = (start + i) % LOG_BUFFER_SIZE;
-    result += logBuffer[idx] + "\n";
+  uint8_t pkt[4 + 3 * WS_FEED_NOTES] = { 0x4D, 0x55, 0x01, 0 };
+  uint8_t count = 0;
+  for (int n = 0; n < 128; n++) {
+    NoteState s;
+    note_get_state(n, &s);
+    if (wsSynced && s.strikes != wsSent[n].strikes) {
+      uint8_t* m = pkt + 4 + 3 * count++;
+      m[0] = 0x90;
+      m[1] = n;
+      m[2] = s.velocity ? s.velocity : 1;
+    } else if (wsSynced && !s.on && wsSent[n].on) {
+      uint8_t* m = pkt + 4 + 3 * count++;
+      m[0] = 0x80;
+      m[1] = n;
+      m[2] = 0;
+    }
+    wsSent[n] = s;
+    if (count == WS_FEED_NOTES || (n == 127 && count > 0)) {
+      pkt[3] = count;
+      ws.sendAll(pkt, 4 + 3 * count);
+      count = 0;
+    }
   }
-  return result;
+  wsSynced = true;
 }
 
-int httpserver_get_log_index() {
-  return logTotalCount;
+static void httpTask(void* arg) {
+  for (;;) {
+    server.handleClient();
+    logStream.pump();
+    ws.poll(wsReceive);
+    wsFeed();
+    vTaskDelay(1);
+  }
 }
 
 // Handler for GET /channels
 static void handleChannels() {
-  String html = "<!DOCTYPE html><html><head>";
-  html += "<meta name='viewport' content='width=device-width, initial-scale=1'>";
-  html += "<style>";
-  html += "body { font-family: Arial, sans-serif; margin: 20px; background: #f0f0f0; }";
-  html += "h1 { color: #333; }";
-  html += ".container { max-width: 600px; margin: 0 auto; background: white; padding: 20px; border-radius: 10px; box-shadow: 0 2px 5px rgba(0,0,0,0.1); }";
-  html += ".controls { display: flex; gap: 15px; margin: 15px 0; flex-wrap: wrap; align-items: center; }";
-  html += ".control-group { display: flex; gap: 5px; align-items: center; }";
-  html += ".control-group label { font-weight: bold; }";
-  html += ".control-group input { width: 80px; padding: 5px; font-size: 14px; border: 2px solid #ccc; border-radius: 4px; }";
-  html += ".button-grid { display: grid; grid-template-columns: repeat(auto-fill, minmax(80px, 1fr)); gap: 10px; margin-top: 20px; }";
-  html += "button { padding: 15px; font-size: 16px; border: 2px solid #4CAF50; background: #4CAF50; color: white; border-radius: 5px; cursor: pointer; transition: all 0.3s; }";
-  html += "button:hover { background: #45a049; transform: scale(1.05); }";
-  html += "button:active { transform: scale(0.95); }";
-  html += ".status { margin-top: 15px; padding: 10px; background: #e8f5e9; border-radius: 5px; display: none; }";
-  html += "</style></head><body>";
-  html += "<div class='container'>";
-  html += "<h1>Chime Controller</h1>";
-  html += "<p>Click a button to ring a chime by channel (0-20)</p>";
-  html += "<div class='controls'>";
-  html += "<div class='control-group'>";
-  html += "<label for='kickDuty'>Kick Duty:</label>";
-  html += "<input type='number' id='kickDuty' value='100' min='1' max='100' />";
-  html += "<span>%</span>";
-  html += "</div>";
-  html += "<div class='control-group'>";
-  html += "<label for='kickHold'>Kick Hold:</label>";
-  html += "<input type='number' id='kickHold' value='35' min='0' max='1000' />";
-  html += "<span>ms</span>";
-  html += "</div>";
-  html += "</div>";
-  html += "<div class='button-grid'>";
+  HttpStream out(server, 200, "text/html");
+  out.print("<!DOCTYPE html><html><head>");
+  out.print("<meta name='viewport' content='width=device-width, initial-scale=1'>");
+  out.print("<style>");
+  out.print("body { font-family: Arial, sans-serif; margin: 20px; background: #f0f0f0; }");
+  out.print("h1 { color: #333; }");
+  out.print(".container { max-width: 600px; margin: 0 auto; background: white; padding: 20px; border-radius: 10px; box-shadow: 0 2px 5px rgba(0,0,0,0.1); }");
+  out.print(".controls { display: flex; gap: 15px; margin: 15px 0; flex-wrap: wrap; align-items: center; }");
+  out.print(".control-group { display: flex; gap: 5px; align-items: center; }");
+  out.print(".control-group label { font-weight: bold; }");
+  out.print(".control-group input { width: 80px; padding: 5px; font-size: 14px; border: 2px solid #ccc; border-radius: 4px; }");
+  out.print(".button-grid { display: grid; grid-template-columns: repeat(auto-fill, minmax(80px, 1fr)); gap: 10px; margin-top: 20px; }");
+  out.print("button { padding: 15px; font-size: 16px; border: 2px solid #4CAF50; background: #4CAF50; color: white; border-radius: 5px; cursor: pointer; transition: all 0.3s; }");
+  out.print("button:hover { background: #45a049; transform: scale(1.05); }");
+  out.print("button:active { transform: scale(0.95); }");
+  out.print(".status { margin-top: 15px; padding: 10px; background: #e8f5e9; border-radius: 5px; display: none; }");
+  out.print("</style></head><body>");
+  out.print("<div class='container'>");
+  out.print("<h1>Chime Controller</h1>");
+  out.print("<p>Click a button to ring a chime by channel (0-20)</p>");
+  out.print("<div class='controls'>");
+  out.print("<div class='control-group'>");
+  out.print("<label for='kickDuty'>Kick Duty:</label>");
+  out.print("<input type='number' id='kickDuty' value='100' min='1' max='100' />");
+  out.print("<span>%</span>");
+  out.print("</div>");
+  out.print("<div class='control-group'>");
+  out.print("<label for='kickHold'>Kick Hold:</label>");
+  out.print("<input type='number' id='kickHold' value='35' min='0' max='1000' />");
+  out.print("<span>ms</span>");
+  out.print("</div>");
+  out.print("</div>");
+  out.print("<div class='button-grid'>");
   
   // Create 21 buttons (notes 0-20)
   for (int i = 0; i < 21; i++) {
-    html += "<button onclick='ring(" + String(i) + ")'>Ch " + String(i) + "</button>";
+    out.printf("<button onclick='ring(%d)'>Ch %d</button>", i, i);
   }
   
-  html += "</div>";
-  html += "<div class='status' id='status'></div>";
-  html += "</div>";
+  out.print("</div>");
+  out.print("<div class='status' id='status'></div>");
+  out.print("</div>");
   
   // JavaScript to handle button clicks
-  html += "<script>";
-  html += "function ring(note) {";
-  html += "  const duty = document.getElementById('kickDuty').value;";
-  html += "  const hold = document.getElementById('kickHold').value;";
-  html += "  fetch('/ringchannel/' + note + '?duty=' + duty + '&hold=' + hold)";
-  html += "    .then(r => r.text())";
-  html += "    .then(msg => {";
-  html += "      const s = document.getElementById('status');";
-  html += "      s.textContent = msg;";
-  html += "      s.style.display = 'block';";
-  html += "      setTimeout(() => s.style.display = 'none', 2000);";
-  html += "    })";
-  html += "    .catch(e => console.error('Error:', e));";
-  html += "}";
-  html += "</script>";
-  html += "</body></html>";
-  
-  server.send(200, "text/html", html);
+  out.print("<script>");
+  out.print("function ring(note) {");
+  out.print("  const duty = document.getElementById('kickDuty').value;");
+  out.print("  const hold = document.getElementById('kickHold').value;");
+  out.print("  fetch('/ringchannel/' + note + '?duty=' + duty + '&hold=' + hold)");
+  out.print("    .then(r => r.text())");
+  out.print("    .then(msg => {");
+  out.print("      const s = document.getElementById('status');");
+  out.print("      s.textContent = msg;");
+  out.print("      s.style.display = 'block';");
+  out.print("      setTimeout(() => s.style.display = 'none', 2000);");
+  out.print("    })");
+  out.print("    .catch(e => console.error('Error:', e));");
+  out.print("}");
+  out.print("</script>");
+  out.print("</body></html>");
 }
 
 // Handler for GET /ring/<note>
@@ -184,7 +219,7 @@ static void handleRing() {
     return;
   }
   
-  ring_chime(note, 127);
+  runOnLoop([](LoopCall& c) { ring_chime(c.a, 127); }, note);
   
   String response = "Rang note " + String(note);
   server.send(200, "text/plain", response);
@@ -224,116 +259,99 @@ static void handleRingChannel() {
     if (hold > 1000) hold = 1000;
   }
   
+  // hold_us overrides hold for sub-millisecond calibration
+  long hold_us = (long)hold * 1000;
+  if (server.hasArg("hold_us")) {
+    hold_us = server.arg("hold_us").toInt();
+    if (hold_us < 0) hold_us = 0;
+    if (hold_us > 1000000) hold_us = 1000000;
+  }
+  
   // Ring the physical channel with custom parameters
-  ring_chime_raw(channel, duty, hold);
+  runOnLoop([](LoopCall& c) { ring_chime_raw_us(c.a, c.b, (uint32_t)c.c); }, channel, duty, hold_us);
   
-  String response = "Rang channel " + String(channel) + " (duty=" + String(duty) + "%, hold=" + String(hold) + "ms)";
+  String response = "Rang channel " + String(channel) + " (duty=" + String(duty) + "%, hold=" + String(hold_us) + "us)";
   server.send(200, "text/plain", response);
 }
 
 // Handler for GET /logs - Log viewer page
 static void handleLogsPage() {
-  httpLoggingEnabled = true; // Enable logging on first access
-  
-  String html = "<!DOCTYPE html><html><head>";
-  html += "<meta name='viewport' content='width=device-width, initial-scale=1'>";
-  html += "<title>Chime Logs</title>";
-  html += "<style>";
-  html += "body { font-family: monospace; margin: 0; padding: 20px; background: #1e1e1e; color: #d4d4d4; }";
-  html += "h1 { color: #4ec9b0; margin-bottom: 10px; }";
-  html += "#log { background: #252526; border: 1px solid #3e3e42; padding: 15px; ";
-  html += "height: 70vh; overflow-y: auto; white-space: pre-wrap; word-wrap: break-word; }";
-  html += ".controls { margin-bottom: 15px; }";
-  html += "button { padding: 8px 16px; background: #0e639c; color: white; border: none; ";
-  html += "border-radius: 4px; cursor: pointer; margin-right: 10px; }";
-  html += "button:hover { background: #1177bb; }";
-  html += ".status { color: #4ec9b0; margin-left: 10px; }";
-  html += "</style></head><body>";
-  html += "<h1>Chime Controller Logs</h1>";
-  html += "<div class='controls'>";
-  html += "<button onclick='clearLog()'>Clear</button>";
-  html += "<button onclick='toggleAutoScroll()' id='scrollBtn'>Auto-scroll: ON</button>";
-  html += "<span class='status' id='status'>Connected</span>";
-  html += "</div>";
-  html += "<div id='log'></div>";
-  html += "<script>";
-  html += "let autoScroll = true;";
-  html += "let lastIndex = -1;";
-  html += "const logDiv = document.getElementById('log');";
-  html += "const statusDiv = document.getElementById('status');";
-  html += "function fetchLogs() {";
-  html += "  fetch('/logs/poll?since=' + lastIndex)";
-  html += "    .then(r => r.json())";
-  html += "    .then(data => {";
-  html += "      if (data.logs) {";
-  html += "        logDiv.textContent += data.logs;";
-  html += "        if (autoScroll) logDiv.scrollTop = logDiv.scrollHeight;";
-  html += "      }";
-  html += "      lastIndex = data.index;";
-  html += "      statusDiv.textContent = 'Connected';";
-  html += "      statusDiv.style.color = '#4ec9b0';";
-  html += "    })";
-  html += "    .catch(() => {";
-  html += "      statusDiv.textContent = 'Error';";
-  html += "      statusDiv.style.color = '#f48771';";
-  html += "    });";
-  html += "}";
-  html += "fetchLogs();";
-  html += "setInterval(fetchLogs, 1000);";
-  html += "function clearLog() { logDiv.textContent = ''; }";
-  html += "function toggleAutoScroll() {";
-  html += "  autoScroll = !autoScroll;";
-  html += "  document.getElementById('scrollBtn').textContent = 'Auto-scroll: ' + (autoScroll ? 'ON' : 'OFF');";
-  html += "}";
-  html += "</script></body></html>";
-  
-  server.send(200, "text/html", html);
+  HttpStream out(server, 200, "text/html");
+  out.print("<!DOCTYPE html><html><head>");
+  out.print("<meta name='viewport' content='width=device-width, initial-scale=1'>");
+  out.print("<title>Chime Logs</title>");
+  out.print("<style>");
+  out.print("body { font-family: monospace; margin: 0; padding: 20px; background: #1e1e1e; color: #d4d4d4; }");
+  out.print("h1 { color: #4ec9b0; margin-bottom: 10px; }");
+  out.print("#log { background: #252526; border: 1px solid #3e3e42; padding: 15px; ");
+  out.print("height: 70vh; overflow-y: auto; white-space: pre-wrap; word-wrap: break-word; }");
+  out.print(".controls { margin-bottom: 15px; }");
+  out.print("button { padding: 8px 16px; background: #0e639c; color: white; border: none; ");
+  out.print("border-radius: 4px; cursor: pointer; margin-right: 10px; }");
+  out.print("button:hover { background: #1177bb; }");
+  out.print(".status { color: #4ec9b0; margin-left: 10px; }");
+  out.print("</style></head><body>");
+  out.print("<h1>Chime Controller Logs</h1>");
+  out.print("<div class='controls'>");
+  out.print("<button onclick='clearLog()'>Clear</button>");
+  out.print("<button onclick='toggleAutoScroll()' id='scrollBtn'>Auto-scroll: ON</button>");
+  out.print("<span class='status' id='status'>Connected</span>");
+  out.print("</div>");
+  out.print("<div id='log'></div>");
+  out.print("<script>");
+  out.print("let autoScroll = true;");
+  out.print("let lastId = -1;");
+  out.print("const logDiv = document.getElementById('log');");
+  out.print("const statusDiv = document.getElementById('status');");
+  out.print("function connect() {");
+  out.print("  const es = new EventSource('/logs/stream?since=' + lastId);");
+  out.print("  es.onopen = () => {");
+  out.print("    statusDiv.textContent = 'Connected';");
+  out.print("    statusDiv.style.color = '#4ec9b0';");
+  out.print("  };");
+  out.print("  es.onmessage = e => {");
+  out.print("    logDiv.textContent += e.data + '\\n';");
+  out.print("    lastId = e.lastEventId;");
+  out.print("    if (autoScroll) logDiv.scrollTop = logDiv.scrollHeight;");
+  out.print("  };");
+  out.print("  es.onerror = () => {");
+  out.print("    es.close();");
+  out.print("    statusDiv.textContent = 'Reconnecting';");
+  out.print("    statusDiv.style.color = '#f48771';");
+  out.print("    setTimeout(connect, 2000);");
+  out.print("  };");
+  out.print("}");
+  out.print("connect();");
+  out.print("function clearLog() { logDiv.textContent = ''; }");
+  out.print("function toggleAutoScroll() {");
+  out.print("  autoScroll = !autoScroll;");
+  out.print("  document.getElementById('scrollBtn').textContent = 'Auto-scroll: ' + (autoScroll ? 'ON' : 'OFF');");
+  out.print("}");
+  out.print("</script></body></html>");
 }
 
 // Handler for GET /logs/poll?since=X - Polling endpoint
 static void handleLogsPoll() {
-  httpLoggingEnabled = true; // Enable logging if not already
-  
-  int sinceIndex = -1;
-  if (server.hasArg("since")) {
-    sinceIndex = server.arg("since").toInt();
-  }
-  
-  String logs = httpserver_get_logs_since(sinceIndex);
-  int currentIndex = httpserver_get_log_index();
-  
-  // Early return for no new logs
-  if (logs.length() == 0) {
-    String json = "{\"index\":" + String(currentIndex) + ",\"logs\":\"\"}";
-    server.send(200, "application/json", json);
-    return;
-  }
-  
-  // Reserve capacity to minimize reallocations (rough estimate: logs.length() * 1.2 + 50)
-  String json;
-  json.reserve(logs.length() + logs.length() / 5 + 50);
-  
-  json = "{\"index\":" + String(currentIndex) + ",\"logs\":\"";
-  
-  // Escape the logs for JSON
-  for (unsigned int i = 0; i < logs.length(); i++) {
-    char c = logs[i];
-    if (c == '"') json += "\\\"";
-    else if (c == '\\') json += "\\\\";
-    else if (c == '\n') json += "\\n";
-    else if (c == '\r') json += "\\r";
-    else if (c == '\t') json += "\\t";
-    else json += c;
-  }
-  json += "\"}";
-  
-  server.send(200, "application/json", json);
+  long since = server.hasArg("since") ? server.arg("since").toInt() : -1;
+  
+  HttpStream out(server, 200, "application/json");
+  out.beginObject();
+  out.beginString("logs");
+  uint32_t index = logStream.writeSince(out, since < 0 ? UINT32_MAX : (uint32_t)since);
+  out.endString();
+  out.kv("index", (unsigned long)index);
+  out.endObject();
+}
+
+// Handler for GET /logs/stream?since=X - Server-Sent Events, stays open
+static void handleLogsStream() {
+  logStream.subscribe(server);
 }
 
 // Handler for GET /keyboard
 // Handler for GET /
 static void handleRoot() {
-  server.send(200, "text/html", get_keyboard_html());
+  webasset_send(server, KEYBOARD_HTML_GZ);
 }
 
 // Handler for GET /note_on?note=X&velocity=Y
@@ -356,7 +374,7 @@ static void handleNoteOn() {
     return;
   }
   
-  note_on((uint8_t)note, (uint8_t)velocity);
+  runOnLoop([](LoopCall& c) { note_on((uint8_t)c.a, (uint8_t)c.b); }, note, velocity);
   
   String response = "Note On: " + String(note) + " velocity: " + String(velocity);
   server.send(200, "text/plain", response);
@@ -382,7 +400,7 @@ static void handleNoteOff() {
     return;
   }
   
-  note_off((uint8_t)note, (uint8_t)velocity);
+  runOnLoop([](LoopCall& c) { note_off((uint8_t)c.a, (uint8_t)c.b); }, note, velocity);
   
   String response = "Note Off: " + String(note) + " velocity: " + String(velocity);
   server.send(200, "text/plain", response);
@@ -390,8 +408,10 @@ static void handleNoteOff() {
 
 // Handle /all_off endpoint - panic button
 void handleAllOff() {
-  midiseq_stop();
-  all_off();
+  runOnLoop([](LoopCall&) {
+    midiseq_stop();
+    all_off();
+  });
   // Serial.println("All notes off (panic)");
   server.send(200, "text/plain", "All notes off");
 }
@@ -433,7 +453,10 @@ static void handleRepeatStart() {
     return;
   }
   
-  start_repeated_note((uint8_t)note, (uint8_t)velocity, (uint32_t)period_ms, (uint16_t)count);
+  LoopCall call = { note, velocity, period_ms, count, nullptr, false };
+  runOnLoop([](LoopCall& c) {
+    start_repeated_note((uint8_t)c.a, (uint8_t)c.b, (uint32_t)c.c, (uint16_t)c.d);
+  }, call);
   
   String response = "Started repeating note " + String(note) + 
                     " velocity=" + String(velocity) + 
@@ -457,7 +480,7 @@ static void handleRepeatStop() {
     return;
   }
   
-  stop_repeated_note((uint8_t)note);
+  runOnLoop([](LoopCall& c) { stop_repeated_note((uint8_t)c.a); }, note);
   
   String response = "Stopped repeating note " + String(note);
   server.send(200, "text/plain", response);
@@ -466,7 +489,7 @@ static void handleRepeatStop() {
 // Handler for GET /repeat/stop_all
 // Stop all repeated notes
 static void handleRepeatStopAll() {
-  stop_all_repeated_notes();
+  runOnLoop([](LoopCall&) { stop_all_repeated_notes(); });
   server.send(200, "text/plain", "Stopped all repeating notes");
 }
 
@@ -503,110 +526,202 @@ static void handlePlaySong() {
     if (tempo > 300) tempo = 300;
   }
   
-  midiseq_load(song->events, song->num_events, song->ticks_per_quarter, tempo, transpose);
-  midiseq_play();
+  LoopCall call = { tempo, transpose, 0, 0, song, false };
+  runOnLoop([](LoopCall& c) {
+    const Song* s = (const Song*)c.p;
+    midiseq_load(s->events, s->num_events, s->ticks_per_quarter, (uint16_t)c.a, (int8_t)c.b);
+    midiseq_play();
+  }, call);
   
-  String response = "Playing: " + String(song->name);
+  HttpStream out(server, 200, "text/plain");
+  out.print("Playing: ");
+  out.print(song->name);
   if (transpose != 0) {
-    response += " (transpose " + String(transpose) + " semitones)";
-  }
-  if (tempo != song->default_tempo_bpm) {
-    response += " (" + String(tempo) + " BPM)";
-  } else {
-    response += " (" + String(tempo) + " BPM)";
+    out.printf(" (transpose %d semitones)", transpose);
   }
-  server.send(200, "text/plain", response);
+  out.printf(" (%u BPM)", (unsigned)tempo);
   // Serial.println(response);
 }
 
 // Handle /songs endpoint - list all available songs
 static void handleListSongs() {
-  String response = "Available songs:\n\n";
+  HttpStream out(server, 200, "text/plain");
+  out.print("Available songs:\n\n");
   
   for (int i = 0; i < NUM_SONGS; i++) {
-    response += String(i) + ": " + String(SONGS[i].name);
-    response += " (" + String(SONGS[i].num_events) + " events, ";
-    response += String(SONGS[i].default_tempo_bpm) + " BPM)\n";
-    response += "   Play: /play/" + String(i) + "\n\n";
+    out.printf("%d: %s (%u events, %u BPM)\n", i, SONGS[i].name,
+               (unsigned)SONGS[i].num_events, (unsigned)SONGS[i].default_tempo_bpm);
+    out.printf("   Play: /play/%d\n\n", i);
   }
-  
-  server.send(200, "text/plain", response);
 }
 
 // Handle /seq_stop endpoint
 static void handleSeqStop() {
-  midiseq_stop();
+  runOnLoop([](LoopCall&) { midiseq_stop(); });
   server.send(200, "text/plain", "Sequence stopped");
   // Serial.println("Sequence stopped");
 }
 
 // Handle /seq_pause endpoint
 static void handleSeqPause() {
-  midiseq_pause();
+  runOnLoop([](LoopCall&) { midiseq_pause(); });
   server.send(200, "text/plain", "Sequence paused");
 }
 
 // Handle /seq_resume endpoint
 static void handleSeqResume() {
-  midiseq_resume();
+  runOnLoop([](LoopCall&) { midiseq_resume(); });
   server.send(200, "text/plain", "Sequence resumed");
 }
 
+// Handle /seq_mode?mode=timer|loop endpoint - select sequencer scheduling
+// Also resets the jitter histogram so before/after runs can be compared
+static void handleSeqMode() {
+  int timer = -1;   // Leave the mode as it is
+  if (server.hasArg("mode")) {
+    String mode = server.arg("mode");
+    if (mode == "timer") {
+      timer = 1;
+    } else if (mode == "loop") {
+      timer = 0;
+    } else {
+      server.send(400, "text/plain", "Bad Request: mode must be 'timer' or 'loop'");
+      return;
+    }
+  }
+  runOnLoop([](LoopCall& c) {
+    if (c.a >= 0) midiseq_set_timer_mode(c.a != 0);
+    midiseq_reset_jitter_stats();
+  }, timer);
+  server.send(200, "text/plain", "Sequencer mode: " + String(midiseq_get_timer_mode() ? "timer" : "loop"));
+}
+
 // Handler for 404 Not Found
 static void handleNotFound() {
-  String message = "Not Found\n\n";
-  message += "URI: " + server.uri() + "\n";
-  message += "Method: " + String((server.method() == HTTP_GET) ? "GET" : "POST") + "\n";
-  server.send(404, "text/plain", message);
+  HttpStream out(server, 404, "text/plain");
+  out.print("Not Found\n\n");
+  out.print("URI: ");
+  out.print(server.uri());
+  out.print("\nMethod: ");
+  out.print((server.method() == HTTP_GET) ? "GET" : "POST");
+  out.print("\n");
 }
 
 // Handler for GET /clock
 static void handleClockStatus() {
-  String json = "{";
-  json += "\"enabled\":" + String(clockChimes.isEnabled() ? "true" : "false") + ",";
-  json += "\"tune\":" + String(clockChimes.getTune()) + ",";
-  json += "\"tuneName\":\"" + String(clockChimes.getTuneName(clockChimes.getTune())) + "\",";
-  json += "\"tuneTempo\":" + String(clockChimes.getTuneTempo()) + ",";
-  json += "\"tuneVelocity\":" + String(clockChimes.getTuneVelocity()) + ",";
-  json += "\"hourStrike\":" + String(clockChimes.isHourStrikeEnabled() ? "true" : "false") + ",";
-  json += "\"hourNote1\":" + String(clockChimes.getHourNote(0)) + ",";
-  json += "\"hourNote2\":" + String(clockChimes.getHourNote(1)) + ",";
-  json += "\"hourNote3\":" + String(clockChimes.getHourNote(2)) + ",";
-  json += "\"hourStrikeInterval\":" + String(clockChimes.getHourStrikeInterval()) + ",";
-  json += "\"hourVelocity\":" + String(clockChimes.getHourVelocity()) + ",";
-  json += "\"quietModeScale\":" + String(clockChimes.getQuietModeScale()) + ",";
-  json += "\"quietModeStartHour\":" + String(clockChimes.getQuietModeStartHour()) + ",";
-  json += "\"quietModeEndHour\":" + String(clockChimes.getQuietModeEndHour()) + ",";
-  json += "\"silenceStartHour\":" + String(clockChimes.getSilenceStartHour()) + ",";
-  json += "\"silenceEndHour\":" + String(clockChimes.getSilenceEndHour());
-  json += "}";
-  
-  server.send(200, "application/json", json);
+  HttpStream out(server, 200, "application/json");
+  out.beginObject();
+  out.kv("enabled", clockChimes.isEnabled());
+  out.kv("tune", clockChimes.getTune());
+  out.kv("tuneName", clockChimes.getTuneName(clockChimes.getTune()));
+  out.kv("tuneTempo", clockChimes.getTuneTempo());
+  out.kv("tuneVelocity", clockChimes.getTuneVelocity());
+  out.kv("hourStrike", clockChimes.isHourStrikeEnabled());
+  out.kv("hourNote1", clockChimes.getHourNote(0));
+  out.kv("hourNote2", clockChimes.getHourNote(1));
+  out.kv("hourNote3", clockChimes.getHourNote(2));
+  out.kv("hourStrikeInterval", clockChimes.getHourStrikeInterval());
+  out.kv("hourVelocity", clockChimes.getHourVelocity());
+  out.kv("quietModeScale", clockChimes.getQuietModeScale());
+  out.kv("quietModeStartHour", clockChimes.getQuietModeStartHour());
+  out.kv("quietModeEndHour", clockChimes.getQuietModeEndHour());
+  out.kv("silenceStartHour", clockChimes.getSilenceStartHour());
+  out.kv("silenceEndHour", clockChimes.getSilenceEndHour());
+  out.endObject();
 }
 
+#ifdef NOTE_TRACE
+// Handler for GET /trace - note latency marks as Chrome trace JSON
+// (NOTE_TRACE builds only). ?clear=1 empties the rings afterwards.
+static void handleTrace() {
+  server.sendHeader("Content-Disposition", "attachment; filename=\"notetrace.json\"");
+  {
+    HttpStream out(server, 200, "application/json");
+    notetrace_write_json(out);
+  }
+  if (server.hasArg("clear")) notetrace_clear();
+}
+
+// "trace" object for /status: RX-to-stage latency per pipeline stage
+static void writeTraceStats(HttpStream& out) {
+  NoteTraceStats st;
+  notetrace_get_stats(&st);
+  out.beginObject("trace");
+  out.kv("records", st.records);
+  out.kv("chains", st.chains);
+  out.beginObject("latency");
+  for (int s = NT_PARSE; s < NT_STAGES; s++) {
+    const NoteTraceStageStats& l = st.stage[s];
+    out.beginObject(notetrace_stage_name(s));
+    out.kv("samples", l.samples);
+    out.kv("p50Us", l.p50Us, 1);
+    out.kv("p99Us", l.p99Us, 1);
+    out.kv("maxUs", l.maxUs, 1);
+    out.endObject();
+  }
+  out.endObject();
+  out.endObject();
+}
+#endif
+
 // Handler for GET /status - system status including MIDI/UDP
 static void handleStatus() {
-  String json = "{";
-  json += "\"uptime\":" + String(millis()) + ",";
-  json += "\"wifi\":{";
-  json += "\"connected\":" + String(WiFi.status() == WL_CONNECTED ? "true" : "false") + ",";
-  json += "\"ip\":\"" + WiFi.localIP().toString() + "\",";
-  json += "\"rssi\":" + String(WiFi.RSSI());
-  json += "},";
-  json += "\"midiUdp\":{";
-  json += "\"listening\":" + String(midiUDP.isListening() ? "true" : "false") + ",";
-  json += "\"port\":" + String(midiUDP.getPort()) + ",";
-  json += "\"packetsReceived\":" + String(midiUDP.getPacketsReceived()) + ",";
-  json += "\"messagesReceived\":" + String(midiUDP.getMessagesReceived()) + ",";
-  json += "\"packetsDropped\":" + String(midiUDP.getPacketsDropped());
-  json += "},";
-  json += "\"time\":{";
-  json += "\"synced\":" + String(timekeeping.isSynced() ? "true" : "false") + ",";
-  json += "\"timestamp\":" + String(timekeeping.getTimestamp());
-  json += "}";
-  json += "}";
-  
-  server.send(200, "application/json", json);
+  HttpStream out(server, 200, "application/json");
+  out.beginObject();
+  out.kv("uptime", millis());
+  out.kv("telnetDropped", Log.telnetDropped());
+  out.beginObject("wifi");
+  out.kv("connected", WiFi.status() == WL_CONNECTED);
+  out.kv("ip", WiFi.localIP());
+  out.kv("rssi", WiFi.RSSI());
+  out.endObject();
+  out.beginObject("midiUdp");
+  out.kv("listening", midiUDP.isListening());
+  out.kv("port", midiUDP.getPort());
+  out.kv("packetsReceived", midiUDP.getPacketsReceived());
+  out.kv("messagesReceived", midiUDP.getMessagesReceived());
+  out.kv("packetsDropped", midiUDP.getPacketsDropped());
+  out.kv("packetsLost", midiUDP.getPacketsLost());
+  out.kv("packetsReordered", midiUDP.getPacketsReordered());
+  out.kv("packetsDuplicate", midiUDP.getPacketsDuplicate());
+  out.kv("messagesLate", midiUDP.getMessagesLate());
+  out.kv("bufferOverflows", midiUDP.getBufferOverflows());
+  out.kv("messagesQueued", (int)midiUDP.getMessagesQueued());
+  out.kv("playoutDelayMs", (int)midiUDP.getPlayoutDelayMs());
+  out.endObject();
+  out.beginObject("time");
+  out.kv("synced", timekeeping.isSynced());
+  out.kv("timestamp", timekeeping.getTimestamp());
+  out.endObject();
+  
+  // Sequencer dispatch jitter histogram
+  MidiSeqJitterStats jit;
+  midiseq_get_jitter_stats(&jit);
+  out.beginObject("sequencer");
+  out.kv("playing", midiseq_is_playing());
+  out.kv("mode", midiseq_get_timer_mode() ? "timer" : "loop");
+  out.beginObject("jitter");
+  out.kv("events", jit.events);
+  out.kv("meanUs", jit.events ? (uint32_t)(jit.total_us / jit.events) : 0);
+  out.kv("maxUs", jit.max_us);
+  out.kv("overflows", jit.overflows);
+  out.kv("underruns", jit.underruns);
+  out.beginArray("boundsUs");
+  for (int i = 0; i < MIDISEQ_JITTER_BUCKETS - 1; i++) {
+    out.value(MIDISEQ_JITTER_BOUNDS_US[i]);
+  }
+  out.endArray();
+  out.beginArray("counts");
+  for (int i = 0; i < MIDISEQ_JITTER_BUCKETS; i++) {
+    out.value(jit.counts[i]);
+  }
+  out.endArray();
+  out.endObject();
+  out.endObject();
+#ifdef NOTE_TRACE
+  writeTraceStats(out);
+#endif
+  out.endObject();
 }
 
 // Handler for POST /clock/enable
@@ -670,6 +785,23 @@ static void handleClockTempo() {
   server.send(200, "application/json", "{\"success\":true}");
 }
 
+// Handler for POST /mudp/delay?ms=N - MUDP-v2 playout delay
+static void handleMudpDelay() {
+  if (!server.hasArg("ms")) {
+    server.send(400, "text/plain", "Missing ms parameter (playout delay, milliseconds)");
+    return;
+  }
+  
+  int ms = server.arg("ms").toInt();
+  if (ms < 0 || ms > MIDIoverUDP::MAX_PLAYOUT_DELAY_MS) {
+    server.send(400, "text/plain", "ms must be 0-" + String(MIDIoverUDP::MAX_PLAYOUT_DELAY_MS));
+    return;
+  }
+  runOnLoop([](LoopCall& c) { midiUDP.setPlayoutDelayMs((uint16_t)c.a); }, ms);
+  midiUDP.savePlayoutDelay();
+  server.send(200, "application/json", "{\"success\":true}");
+}
+
 // Handler for POST /clock/velocity
 static void handleClockVelocity() {
   if (!server.hasArg("velocity")) {
@@ -754,7 +886,7 @@ static void handleClockTest() {
   }
   
   uint8_t quarter = server.arg("quarter").toInt();
-  clockChimes.manualChime(quarter);
+  runOnLoop([](LoopCall& c) { clockChimes.manualChime((uint8_t)c.a); }, quarter);
   server.send(200, "application/json", "{\"success\":true}");
 }
 
@@ -763,15 +895,14 @@ static void handleTime() {
   char timeStr[64];
   timekeeping.getTimeString(timeStr, sizeof(timeStr));
   
-  String json = "{";
-  json += "\"timestamp\":" + String(timekeeping.getTimestamp()) + ",";
-  json += "\"localTime\":\"" + String(timeStr) + "\",";
-  json += "\"synced\":" + String(timekeeping.isSynced() ? "true" : "false") + ",";
-  json += "\"lastSync\":" + String(timekeeping.getLastSyncTime()) + ",";
-  json += "\"timezoneOffset\":" + String(timekeeping.getTimezoneOffset());
-  json += "}";
-  
-  server.send(200, "application/json", json);
+  HttpStream out(server, 200, "application/json");
+  out.beginObject();
+  out.kv("timestamp", timekeeping.getTimestamp());
+  out.kv("localTime", timeStr);
+  out.kv("synced", timekeeping.isSynced());
+  out.kv("lastSync", timekeeping.getLastSyncTime());
+  out.kv("timezoneOffset", timekeeping.getTimezoneOffset());
+  out.endObject();
 }
 
 // Handler for GET /time/sync
@@ -819,104 +950,124 @@ static void handleTimeNTPServer() {
 
 // Handler for GET /api
 static void handleAPIDocumentation() {
-  server.send(200, "text/html", API_DOCS_HTML);
+  webasset_send(server, API_DOCS_HTML_GZ);
 }
 
 // Handler for GET /settings
 static void handleSettings() {
-  server.send(200, "text/html", SETTINGS_PAGE_HTML);
+  webasset_send(server, SETTINGS_PAGE_HTML_GZ);
 }
 
 // Handler for GET /player - MIDI file player UI
 static void handlePlayer() {
-  String html = "<!DOCTYPE html><html><head>";
-  html += "<meta name='viewport' content='width=device-width, initial-scale=1'>";
-  html += "<title>MIDI Player</title>";
-  html += "<style>";
-  html += "body { font-family: Arial, sans-serif; margin: 20px; background: #f0f0f0; }";
-  html += "h1 { color: #333; }";
-  html += ".container { max-width: 800px; margin: 0 auto; background: white; padding: 20px; border-radius: 10px; box-shadow: 0 2px 5px rgba(0,0,0,0.1); }";
-  html += ".file { display: flex; justify-content: space-between; align-items: center; padding: 15px; margin: 10px 0; background: #f9f9f9; border-radius: 5px; border-left: 4px solid #4CAF50; }";
-  html += ".file-info { flex-grow: 1; }";
-  html += ".file-name { font-weight: bold; font-size: 16px; }";
-  html += ".file-size { color: #666; font-size: 14px; }";
-  html += ".controls { display: flex; gap: 10px; align-items: center; }";
-  html += "button { padding: 8px 16px; font-size: 14px; border: none; background: #4CAF50; color: white; border-radius: 4px; cursor: pointer; }";
-  html += "button:hover { background: #45a049; }";
-  html += "button.delete { background: #f44336; }";
-  html += "button.delete:hover { background: #da190b; }";
-  html += "input[type=number] { width: 60px; padding: 5px; border: 2px solid #ddd; border-radius: 4px; }";
-  html += ".upload { margin-bottom: 20px; padding: 15px; background: #e3f2fd; border-radius: 5px; }";
-  html += ".status { margin-top: 15px; padding: 10px; background: #e8f5e9; border-radius: 5px; display: none; }";
-  html += ".error { background: #ffebee !important; color: #c62828; }";
-  html += ".storage { margin-top: 15px; padding: 10px; background: #fff3e0; border-radius: 5px; font-size: 14px; }";
-  html += "</style></head><body>";
-  html += "<div class='container'>";
-  html += "<h1>MIDI File Player</h1>";
-  html += "<div class='upload'>";
-  html += "<input type='file' id='fileInput' accept='.mid,.midi' />";
-  html += "<button onclick='uploadFile()'>Upload</button>";
-  html += "</div>";
-  html += "<div id='storage' class='storage'>Loading storage info...</div>";
-  html += "<div id='fileList'>Loading files...</div>";
-  html += "<div id='status' class='status'></div>";
-  html += "</div>";
-  html += "<script>";
-  html += "function loadFiles() {";
-  html += "  fetch('/files').then(r => r.json()).then(data => {";
-  html += "    let html = '';";
-  html += "    if (data.files.length === 0) {";
-  html += "      html = '<p>No MIDI files uploaded yet.</p>';";
-  html += "    } else {";
-  html += "      data.files.forEach(f => {";
-  html += "        html += '<div class=\"file\">';";
-  html += "        html += '<div class=\"file-info\"><div class=\"file-name\">' + f.name + '</div>';";
-  html += "        html += '<div class=\"file-size\">' + f.size + ' bytes</div></div>';";
-  html += "        html += '<div class=\"controls\">';";
-  html += "        html += '<label>Vel:</label><input type=\"number\" id=\"vel_' + f.name + '\" value=\"1.0\" min=\"0\" max=\"2\" step=\"0.1\" />';";
-  html += "        html += '<label>Tempo:</label><input type=\"number\" id=\"tempo_' + f.name + '\" value=\"1.0\" min=\"0.1\" max=\"4\" step=\"0.1\" />';";
-  html += "        html += '<label>Transpose:</label><input type=\"number\" id=\"trans_' + f.name + '\" value=\"0\" min=\"-12\" max=\"12\" />';";
-  html += "        html += '<button onclick=\"playFile(\\'' + f.name + '\\');\">Play</button>';";
-  html += "        html += '<button class=\"delete\" onclick=\"deleteFile(\\'' + f.name + '\\');\">Delete</button>';";
-  html += "        html += '</div></div>';";
-  html += "      });";
-  html += "    }";
-  html += "    document.getElementById('fileList').innerHTML = html;";
-  html += "    const st = data.storage;";
-  html += "    document.getElementById('storage').textContent = 'Storage: ' + (st.used/1024).toFixed(1) + ' KB used / ' + (st.total/1024).toFixed(1) + ' KB total (' + (st.free/1024).toFixed(1) + ' KB free)';";
-  html += "  });";
-  html += "}";
-  html += "function playFile(name) {";
-  html += "  const vel = document.getElementById('vel_' + name).value;";
-  html += "  const tempo = document.getElementById('tempo_' + name).value;";
-  html += "  const trans = document.getElementById('trans_' + name).value;";
-  html += "  fetch('/files/play?name=' + encodeURIComponent(name) + '&velocity=' + vel + '&tempo=' + tempo + '&transpose=' + trans, {method: 'POST'})";
-  html += "    .then(r => r.json()).then(d => showStatus(d.message, d.success));";
-  html += "}";
-  html += "function deleteFile(name) {";
-  html += "  if (!confirm('Delete ' + name + '?')) return;";
-  html += "  fetch('/files/' + encodeURIComponent(name), {method: 'DELETE'})";
-  html += "    .then(r => r.json()).then(d => { showStatus(d.message, d.success); loadFiles(); });";
-  html += "}";
-  html += "function uploadFile() {";
-  html += "  const input = document.getElementById('fileInput');";
-  html += "  if (!input.files[0]) { alert('Select a file first'); return; }";
-  html += "  const formData = new FormData();";
-  html += "  formData.append('file', input.files[0]);";
-  html += "  fetch('/files/upload', {method: 'POST', body: formData})";
-  html += "    .then(r => r.json()).then(d => { showStatus(d.message, d.success); if(d.success) loadFiles(); });";
-  html += "}";
-  html += "function showStatus(msg, ok) {";
-  html += "  const s = document.getElementById('status');";
-  html += "  s.textContent = msg;";
-  html += "  s.className = ok ? 'status' : 'status error';";
-  html += "  s.style.display = 'block';";
-  html += "  setTimeout(() => s.style.display = 'none', 3000);";
-  html += "}";
-  html += "loadFiles();";
-  html += "</script></body></html>";
-  
-  server.send(200, "text/html", html);
+  HttpStream out(server, 200, "text/html");
+  out.print("<!DOCTYPE html><html><head>");
+  out.print("<meta name='viewport' content='width=device-width, initial-scale=1'>");
+  out.print("<title>MIDI Player</title>");
+  out.print("<style>");
+  out.print("body { font-family: Arial, sans-serif; margin: 20px; background: #f0f0f0; }");
+  out.print("h1 { color: #333; }");
+  out.print(".container { max-width: 800px; margin: 0 auto; background: white; padding: 20px; border-radius: 10px; box-shadow: 0 2px 5px rgba(0,0,0,0.1); }");
+  out.print(".file { display: flex; justify-content: space-between; align-items: center; padding: 15px; margin: 10px 0; background: #f9f9f9; border-radius: 5px; border-left: 4px solid #4CAF50; }");
+  out.print(".file-info { flex-grow: 1; }");
+  out.print(".file-name { font-weight: bold; font-size: 16px; }");
+  out.print(".file-size { color: #666; font-size: 14px; }");
+  out.print(".controls { display: flex; gap: 10px; align-items: center; }");
+  out.print("button { padding: 8px 16px; font-size: 14px; border: none; background: #4CAF50; color: white; border-radius: 4px; cursor: pointer; }");
+  out.print("button:hover { background: #45a049; }");
+  out.print("button.delete { background: #f44336; }");
+  out.print("button.delete:hover { background: #da190b; }");
+  out.print("input[type=number] { width: 60px; padding: 5px; border: 2px solid #ddd; border-radius: 4px; }");
+  out.print(".upload { margin-bottom: 20px; padding: 15px; background: #e3f2fd; border-radius: 5px; }");
+  out.print(".status { margin-top: 15px; padding: 10px; background: #e8f5e9; border-radius: 5px; display: none; }");
+  out.print(".error { background: #ffebee !important; color: #c62828; }");
+  out.print(".storage { margin-top: 15px; padding: 10px; background: #fff3e0; border-radius: 5px; font-size: 14px; }");
+  out.print(".live { margin-bottom: 20px; padding: 10px; background: #f9f9f9; border-radius: 5px; font-size: 14px; color: #666; }");
+  out.print("#live { color: #4CAF50; font-weight: bold; }");
+  out.print("</style></head><body>");
+  out.print("<div class='container'>");
+  out.print("<h1>MIDI File Player</h1>");
+  out.print("<div class='live'>Now ringing: <span id='live'>-</span></div>");
+  out.print("<div class='upload'>");
+  out.print("<input type='file' id='fileInput' accept='.mid,.midi,.mbc' />");
+  out.print("<button onclick='uploadFile()'>Upload</button>");
+  out.print("</div>");
+  out.print("<div id='storage' class='storage'>Loading storage info...</div>");
+  out.print("<div id='fileList'>Loading files...</div>");
+  out.print("<div id='status' class='status'></div>");
+  out.print("</div>");
+  out.print("<script>");
+  out.print("function loadFiles() {");
+  out.print("  fetch('/files').then(r => r.json()).then(data => {");
+  out.print("    let html = '';");
+  out.print("    if (data.files.length === 0) {");
+  out.print("      html = '<p>No MIDI files uploaded yet.</p>';");
+  out.print("    } else {");
+  out.print("      data.files.forEach(f => {");
+  out.print("        html += '<div class=\"file\">';");
+  out.print("        html += '<div class=\"file-info\"><div class=\"file-name\">' + f.name + '</div>';");
+  out.print("        html += '<div class=\"file-size\">' + f.size + ' bytes</div></div>';");
+  out.print("        html += '<div class=\"controls\">';");
+  out.print("        html += '<label>Vel:</label><input type=\"number\" id=\"vel_' + f.name + '\" value=\"1.0\" min=\"0\" max=\"2\" step=\"0.1\" />';");
+  out.print("        html += '<label>Tempo:</label><input type=\"number\" id=\"tempo_' + f.name + '\" value=\"1.0\" min=\"0.1\" max=\"4\" step=\"0.1\" />';");
+  out.print("        html += '<label>Transpose:</label><input type=\"number\" id=\"trans_' + f.name + '\" value=\"0\" min=\"-12\" max=\"12\" />';");
+  out.print("        html += '<button onclick=\"playFile(\\'' + f.name + '\\');\">Play</button>';");
+  out.print("        html += '<button class=\"delete\" onclick=\"deleteFile(\\'' + f.name + '\\');\">Delete</button>';");
+  out.print("        html += '</div></div>';");
+  out.print("      });");
+  out.print("    }");
+  out.print("    document.getElementById('fileList').innerHTML = html;");
+  out.print("    const st = data.storage;");
+  out.print("    document.getElementById('storage').textContent = 'Storage: ' + (st.used/1024).toFixed(1) + ' KB used / ' + (st.total/1024).toFixed(1) + ' KB total (' + (st.free/1024).toFixed(1) + ' KB free)';");
+  out.print("  });");
+  out.print("}");
+  out.print("function playFile(name) {");
+  out.print("  const vel = document.getElementById('vel_' + name).value;");
+  out.print("  const tempo = document.getElementById('tempo_' + name).value;");
+  out.print("  const trans = document.getElementById('trans_' + name).value;");
+  out.print("  fetch('/files/play?name=' + encodeURIComponent(name) + '&velocity=' + vel + '&tempo=' + tempo + '&transpose=' + trans, {method: 'POST'})");
+  out.print("    .then(r => r.json()).then(d => showStatus(d.message, d.success));");
+  out.print("}");
+  out.print("function deleteFile(name) {");
+  out.print("  if (!confirm('Delete ' + name + '?')) return;");
+  out.print("  fetch('/files/' + encodeURIComponent(name), {method: 'DELETE'})");
+  out.print("    .then(r => r.json()).then(d => { showStatus(d.message, d.success); loadFiles(); });");
+  out.print("}");
+  out.print("function uploadFile() {");
+  out.print("  const input = document.getElementById('fileInput');");
+  out.print("  if (!input.files[0]) { alert('Select a file first'); return; }");
+  out.print("  const formData = new FormData();");
+  out.print("  formData.append('file', input.files[0]);");
+  out.print("  fetch('/files/upload', {method: 'POST', body: formData})");
+  out.print("    .then(r => r.json()).then(d => { showStatus(d.message, d.success); if(d.success) loadFiles(); });");
+  out.print("}");
+  out.print("function showStatus(msg, ok) {");
+  out.print("  const s = document.getElementById('status');");
+  out.print("  s.textContent = msg;");
+  out.print("  s.className = ok ? 'status' : 'status error';");
+  out.print("  s.style.display = 'block';");
+  out.print("  setTimeout(() => s.style.display = 'none', 3000);");
+  out.print("}");
+  out.print("const names = ['C','C#','D','D#','E','F','F#','G','G#','A','A#','B'];");
+  out.print("const ringing = new Set();");
+  out.print("function liveConnect() {");
+  out.print("  const ws = new WebSocket('ws://' + location.host + '/ws');");
+  out.print("  ws.binaryType = 'arraybuffer';");
+  out.print("  ws.onclose = () => setTimeout(liveConnect, 2000);");
+  out.print("  ws.onmessage = e => {");
+  out.print("    const b = new Uint8Array(e.data);");
+  out.print("    if (b.length < 4 || b[0] !== 0x4D || b[1] !== 0x55) return;");
+  out.print("    for (let i = 0, p = 4; i < b[3] && p + 2 < b.length; i++, p += 3) {");
+  out.print("      if ((b[p] & 0xF0) === 0x90 && b[p + 2] > 0) ringing.add(b[p + 1]);");
+  out.print("      else ringing.delete(b[p + 1]);");
+  out.print("    }");
+  out.print("    const notes = [...ringing].sort((x, y) => x - y).map(n => names[n % 12] + (Math.floor(n / 12) - 1));");
+  out.print("    document.getElementById('live').textContent = notes.length ? notes.join(' ') : '-';");
+  out.print("  };");
+  out.print("}");
+  out.print("loadFiles();");
+  out.print("liveConnect();");
+  out.print("</script></body></html>");
 }
 
 // ============================================================================
@@ -927,41 +1078,45 @@ static void handlePlayer() {
 static void handleFilesList() {
   auto files = midiFiles.listFiles();
   
-  String json = "{\"files\":[";
+  HttpStream out(server, 200, "application/json");
+  out.beginObject();
+  out.beginArray("files");
   for (size_t i = 0; i < files.size(); i++) {
-    if (i > 0) json += ",";
-    json += "{\"name\":\"" + files[i].name + "\",\"size\":" + String(files[i].size) + "}";
+    out.beginObject();
+    out.kv("name", files[i].name);
+    out.kv("size", files[i].size);
+    out.endObject();
   }
-  json += "],\"storage\":{";
-  json += "\"total\":" + String(midiFiles.getTotalBytes()) + ",";
-  json += "\"used\":" + String(midiFiles.getUsedBytes()) + ",";
-  json += "\"free\":" + String(midiFiles.getFreeBytes());
-  json += "}}";
-  
-  server.send(200, "application/json", json);
+  out.endArray();
+  out.beginObject("storage");
+  out.kv("total", midiFiles.getTotalBytes());
+  out.kv("used", midiFiles.getUsedBytes());
+  out.kv("free", midiFiles.getFreeBytes());
+  out.endObject();
+  out.endObject();
 }
 
 // Handler for POST /files/upload - Upload a MIDI file
 static void handleFilesUpload() {
   HTTPUpload& upload = server.upload();
-  static String uploadFilename;
-  static std::vector<uint8_t> uploadBuffer;
+  // Chunks go straight to a temp file; only one chunk is ever held in RAM
+  static bool uploadOk = false;
   
   if (upload.status == UPLOAD_FILE_START) {
-    uploadFilename = upload.filename;
-    uploadBuffer.clear();
-    uploadBuffer.reserve(32768);  // Pre-allocate 32KB
+    uploadOk = midiFiles.beginUpload(upload.filename);
     
   } else if (upload.status == UPLOAD_FILE_WRITE) {
-    // Append data to buffer
-    uploadBuffer.insert(uploadBuffer.end(), upload.buf, upload.buf + upload.currentSize);
+    // Once a chunk fails the upload is aborted; ignore the rest of the body
+    if (uploadOk) {
+      uploadOk = midiFiles.writeUpload(upload.buf, upload.currentSize);
+    }
     
   } else if (upload.status == UPLOAD_FILE_END) {
-    // Upload complete, save file
-    bool success = midiFiles.uploadFile(uploadFilename, uploadBuffer.data(), uploadBuffer.size());
-    
-    uploadBuffer.clear();
-    uploadBuffer.shrink_to_fit();
+    // Upload complete: move the file into place and compile it into the
+    // library here, off the loop task. A library rebuild unloads the
+    // sequencer through the release hook set in httpserver_begin().
+    bool success = uploadOk && midiFiles.endUpload();
+    uploadOk = false;
     
     if (success) {
       server.send(200, "application/json", "{\"success\":true,\"message\":\"File uploaded\"}");
@@ -970,8 +1125,8 @@ static void handleFilesUpload() {
     }
     
   } else if (upload.status == UPLOAD_FILE_ABORTED) {
-    uploadBuffer.clear();
-    uploadBuffer.shrink_to_fit();
+    midiFiles.abortUpload();
+    uploadOk = false;
     server.send(500, "application/json", "{\"success\":false,\"message\":\"Upload aborted\"}");
   }
 }
@@ -986,6 +1141,8 @@ static void handleFilesDelete() {
     return;
   }
   
+  // Only marks the library entry dead, so a song playing from it keeps
+  // playing; no need to involve the loop task
   bool success = midiFiles.deleteFile(filename);
   
   if (success) {
@@ -1034,18 +1191,56 @@ static void handleFilesPlay() {
   params.tempoScale = server.hasArg("tempo") ? server.arg("tempo").toFloat() : 1.0f;
   params.transpose = server.hasArg("transpose") ? server.arg("transpose").toInt() : 0;
   
-  bool success = midiFiles.playFile(filename, params);
-  
-  if (success) {
+  // Opening can compile the file into the library, so it happens here; only
+  // swapping the source into the sequencer runs on the loop task
+  MidiEventSource* events = midiFiles.openFile(filename);
+  
+  if (events) {
+    const void* args[] = { &filename, events, &params };
+    LoopCall call = { 0, 0, 0, 0, args, false };
+    runOnLoop([](LoopCall& c) {
+      const void* const* args = (const void* const*)c.p;
+      midiFiles.playSource(*(const String*)args[0], (MidiEventSource*)args[1],
+                           *(const MIDIFileManager::PlaybackParams*)args[2]);
+    }, call);
     server.send(200, "application/json", "{\"success\":true,\"message\":\"Playback started\"}");
   } else {
     server.send(404, "application/json", "{\"success\":false,\"message\":\"File not found or invalid\"}");
   }
 }
 
+// Handler for POST /bench - note-path microbenchmarks (see bench_notepath.h)
+// Optional budget=<cycles> per timed run (default 10 ms at 240 MHz). The
+// cases run on the loop task, so they stop the sequencer and hold up the
+// loop while they run; the table is written from this task afterwards.
+static void handleBench() {
+  uint32_t budget = 2400000;
+  if (server.hasArg("budget")) {
+    long b = server.arg("budget").toInt();
+    if (b < 10000 || b > 240000000) {
+      server.send(400, "text/plain", "budget must be 10000-240000000 cycles");
+      return;
+    }
+    budget = (uint32_t)b;
+  }
+  BenchResult res[BENCH_NOTEPATH_COUNT];
+  LoopCall call = { (int32_t)budget, 0, 0, 0, res, false };
+  runOnLoop([](LoopCall& c) { bench_notepath_measure((BenchResult*)c.p, (uint32_t)c.a); }, call);
+  
+  HttpStream out(server, 200, "text/plain");
+  bench_notepath_print(out, res);
+}
+
 extern "C" {
 
 void httpserver_begin() {
+  loopQueue = xQueueCreate(LOOP_QUEUE_LEN, sizeof(LoopCmd));
+  loopDone = xSemaphoreCreateBinary();
+  
+  // Library rebuilds run on this server task; the sequencer they release
+  // belongs to the loop
+  midiFiles.setReleaseHook([] { runOnLoop([](LoopCall&) { midiseq_unload(); }); });
+  
   // Register route handlers - use onNotFound pattern matching
   server.on("/", HTTP_GET, handleRoot);
   server.on("/api", HTTP_GET, handleAPIDocumentation);
@@ -1055,6 +1250,8 @@ void httpserver_begin() {
   server.on("/channels", HTTP_GET, handleChannels);
   server.on("/logs", HTTP_GET, handleLogsPage);
   server.on("/logs/poll", HTTP_GET, handleLogsPoll);
+  server.on("/logs/stream", HTTP_GET, handleLogsStream);
+  server.on("/ws", HTTP_GET, handleWebSocket);
   server.on("/note_on", HTTP_GET, handleNoteOn);
   server.on("/note_off", HTTP_GET, handleNoteOff);
   server.on("/all_off", HTTP_GET, handleAllOff);
@@ -1065,6 +1262,7 @@ void httpserver_begin() {
   server.on("/seq_stop", HTTP_GET, handleSeqStop);
   server.on("/seq_pause", HTTP_GET, handleSeqPause);
   server.on("/seq_resume", HTTP_GET, handleSeqResume);
+  server.on("/seq_mode", HTTP_GET, handleSeqMode);
   server.on("/clock", HTTP_GET, handleClockStatus);
   server.on("/clock/enable", HTTP_POST, handleClockEnable);
   server.on("/clock/tune", HTTP_POST, handleClockTune);
@@ -1072,6 +1270,7 @@ void httpserver_begin() {
   server.on("/clock/hournote", HTTP_POST, handleClockHourNote);
   server.on("/clock/tempo", HTTP_POST, handleClockTempo);
   server.on("/clock/velocity", HTTP_POST, handleClockVelocity);
+  server.on("/mudp/delay", HTTP_POST, handleMudpDelay);
   server.on("/clock/strikeinterval", HTTP_POST, handleClockStrikeInterval);
   server.on("/clock/hourvelocity", HTTP_POST, handleHourVelocity);
   server.on("/clock/quietscale", HTTP_POST, handleQuietScale);
@@ -1090,6 +1289,10 @@ void httpserver_begin() {
     server.send(200);
   }, handleFilesUpload);
   server.on("/files/play", HTTP_POST, handleFilesPlay);
+  server.on("/bench", HTTP_POST, handleBench);
+#ifdef NOTE_TRACE
+  server.on("/trace", HTTP_GET, handleTrace);
+#endif
   
   // For parameterized routes, we'll handle them in onNotFound
   // and check the path prefix there
@@ -1117,12 +1320,19 @@ void httpserver_begin() {
   });
   
   // Start server
+  websocket_begin(server);
   server.begin();
+  xTaskCreatePinnedToCore(httpTask, "http", HTTP_TASK_STACK, nullptr, HTTP_TASK_PRIORITY, nullptr, HTTP_TASK_CORE);
   // Serial.println("HTTP server started on port 80");
 }
 
 void httpserver_loop() {
-  server.handleClient();
+  if (!loopQueue) return;   // Server never started
+  LoopCmd cmd;
+  while (xQueueReceive(loopQueue, &cmd, 0) == pdTRUE) {
+    cmd.fn(*cmd.call);
+    xSemaphoreGive(loopDone);
+  }
 }
 
 } // extern "C"
@@ -8,10 +8,11 @@
 extern "C" {
 #endif
 
-// Initialize the HTTP server on port 80
+// Start the HTTP server on port 80 in its own task
 void httpserver_begin(void);
 
-// Handle HTTP client requests (call frequently in main loop)
+// Run the calls HTTP handlers have queued for the loop task (call
+// frequently in the main loop; the handlers wait for them)
 void httpserver_loop(void);
 
 #ifdef __cplusplus
@@ -0,0 +1,159 @@
+// httpstream.h - Chunked HTTP responses streamed from a stack buffer
+//
+// A handler writes its JSON, HTML or text into an HttpStream instead of
+// growing a String. The stream fills a fixed buffer on the handler's stack
+// and hands each full buffer to WebServer::sendContent() as one HTTP chunk,
+// so a response of any length costs HTTPSTREAM_BUF bytes of stack and no
+// heap, and the main loop never waits on a String reallocation.
+//
+//   HttpStream out(server, 200, "application/json");
+//   out.beginObject();
+//   out.kv("uptime", millis());
+//   out.beginObject("wifi");
+//   out.kv("connected", WiFi.status() == WL_CONNECTED);
+//   out.kv("ip", WiFi.localIP());
+//   out.endObject();
+//   out.endObject();
+//
+// The JSON calls write the commas between members and elements and escape
+// strings; print() and printf() carry HTML and plain text. Send any extra
+// headers (server.sendHeader) before constructing the stream. The last
+// chunk goes out when the stream is destroyed.
+#ifndef HTTPSTREAM_H
+#define HTTPSTREAM_H
+
+#include <Arduino.h>
+#include <WebServer.h>
+
+#define HTTPSTREAM_BUF   1024   // Bytes per chunk, on the handler's stack
+#define HTTPSTREAM_DEPTH 16     // Deepest JSON nesting
+
+class HttpStream : public Print {
+public:
+  HttpStream(WebServer& server, int code, const char* contentType) : server(server) {
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(code, contentType, "");
+  }
+
+  ~HttpStream() {
+    flush();
+    server.sendContent("", 0);   // Zero-length chunk ends the body
+  }
+
+  HttpStream(const HttpStream&) = delete;
+  HttpStream& operator=(const HttpStream&) = delete;
+
+  size_t write(uint8_t c) override {
+    buf[len++] = c;
+    if (len == sizeof(buf)) flush();
+    return 1;
+  }
+
+  size_t write(const uint8_t* data, size_t size) override {
+    size_t left = size;
+    while (left) {
+      size_t n = sizeof(buf) - len;
+      if (n > left) n = left;
+      memcpy(buf + len, data, n);
+      len += n;
+      data += n;
+      left -= n;
+      if (len == sizeof(buf)) flush();
+    }
+    return size;
+  }
+
+  void flush() override {
+    if (len) server.sendContent((const char*)buf, len);
+    len = 0;
+  }
+
+  using Print::write;
+
+  // ---------- JSON ----------
+  // key is the member name inside an object, nullptr inside an array or
+  // at the top level
+
+  void beginObject(const char* key = nullptr) { open(key, '{'); }
+  void endObject() { close('}'); }
+  void beginArray(const char* key = nullptr) { open(key, '['); }
+  void endArray() { close(']'); }
+
+  void kv(const char* key, bool v)               { member(key); print(v ? "true" : "false"); }
+  void kv(const char* key, int v)                { member(key); print(v); }
+  void kv(const char* key, unsigned int v)       { member(key); print(v); }
+  void kv(const char* key, long v)               { member(key); print(v); }
+  void kv(const char* key, unsigned long v)      { member(key); print(v); }
+  void kv(const char* key, long long v)          { member(key); print(v); }
+  void kv(const char* key, unsigned long long v) { member(key); print(v); }
+  void kv(const char* key, double v, int decimals = 2) { member(key); print(v, decimals); }
+  void kv(const char* key, const char* v)        { member(key); quoted(v); }
+  void kv(const char* key, const String& v)      { member(key); quoted(v.c_str()); }
+  void kv(const char* key, const IPAddress& v)   { member(key); write('"'); print(v); write('"'); }
+
+  // Array elements
+  template <typename T>
+  void value(T v) { kv(nullptr, v); }
+  void value(double v, int decimals) { kv(nullptr, v, decimals); }
+
+  // A string value written in pieces: beginString(), any number of
+  // escaped() calls, endString()
+  void beginString(const char* key = nullptr) { member(key); write('"'); }
+  void endString() { write('"'); }
+
+  void escaped(const char* s, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      char c = s[i];
+      switch (c) {
+        case '"':  print("\\\""); break;
+        case '\\': print("\\\\"); break;
+        case '\n': print("\\n"); break;
+        case '\r': print("\\r"); break;
+        case '\t': print("\\t"); break;
+        default:
+          if ((uint8_t)c < 0x20) printf("\\u%04x", (uint8_t)c);
+          else write((uint8_t)c);
+      }
+    }
+  }
+  void escaped(const char* s) { escaped(s, strlen(s)); }
+
+private:
+  // Comma before every member or element but the first of its container
+  void member(const char* key) {
+    if (depth > 0) {
+      if (nonEmpty & (1u << depth)) write(',');
+      nonEmpty |= 1u << depth;
+    }
+    if (key) {
+      quoted(key);
+      write(':');
+    }
+  }
+
+  void open(const char* key, char bracket) {
+    member(key);
+    write(bracket);
+    if (depth < HTTPSTREAM_DEPTH) depth++;
+    nonEmpty &= ~(1u << depth);
+  }
+
+  void close(char bracket) {
+    write(bracket);
+    if (depth > 0) depth--;
+  }
+
+  void quoted(const char* s) {
+    write('"');
+    escaped(s);
+    write('"');
+  }
+
+  WebServer& server;
+  uint8_t buf[HTTPSTREAM_BUF];
+  size_t len = 0;
+  uint8_t depth = 0;
+  uint32_t nonEmpty = 0;   // Bit n: the container at depth n has a member
+};
+
+#endif // HTTPSTREAM_H
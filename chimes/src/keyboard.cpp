@@ -71,6 +71,15 @@ static const char keyboard_html[] = R"rawliteral(
       background: #4CAF50;
       color: white;
     }
+    .key.struck {
+      background: #2196F3;
+      color: white;
+    }
+    .link {
+      margin-bottom: 15px;
+      color: #888;
+      font-size: 14px;
+    }
     .info {
       margin-top: 20px;
       text-align: center;
@@ -153,6 +162,7 @@ static const char keyboard_html[] = R"rawliteral(
 </head>
 <body>
   <h1>MIDI Keyboard</h1>
+  <div class='link'><span id='link'>Connecting...</span> &middot; <span id='latency'>Latency: -</span></div>
   <div class='keyboard' id='keyboard'></div>
   
   <div class='song-controls'>
@@ -392,12 +402,73 @@ static const char keyboard_html[] = R"rawliteral(
       return Math.max(10, Math.min(127, velocity));
     }
     
+    // Notes go to /ws as MUDP packets (docs/MIDIUDP.md), falling back to
+    // /note_on and /note_off while it is down. The chimes answer with a
+    // note-on for every strike, ours or not: it lights the key, and for our
+    // own notes times the round trip from key to chime and back.
+    let ws = null;
+    const sentAt = new Map();   // note -> performance.now() of its note-on, until the strike comes back
+    const latencies = [];
+    const linkSpan = document.getElementById('link');
+    const latencySpan = document.getElementById('latency');
+    
+    function wsConnect() {
+      ws = new WebSocket('ws://' + location.host + '/ws');
+      ws.binaryType = 'arraybuffer';
+      ws.onopen = () => {
+        linkSpan.textContent = 'Connected';
+        linkSpan.style.color = '#4CAF50';
+      };
+      ws.onclose = () => {
+        ws = null;
+        linkSpan.textContent = 'Reconnecting (notes over HTTP)';
+        linkSpan.style.color = '#dc3545';
+        setTimeout(wsConnect, 2000);
+      };
+      ws.onmessage = (e) => {
+        const b = new Uint8Array(e.data);
+        if (b.length < 4 || b[0] !== 0x4D || b[1] !== 0x55) return;
+        for (let i = 0, p = 4; i < b[3] && p + 2 < b.length; i++, p += 3) {
+          const type = b[p] & 0xF0;
+          const key = keyboard.querySelector(`[data-note="${b[p + 1]}"]`);
+          if (type === 0x90 && b[p + 2] > 0) {
+            struck(b[p + 1]);
+            if (key) key.classList.add('struck');
+          } else if (key) {
+            key.classList.remove('struck');
+          }
+        }
+      };
+    }
+    
+    function struck(note) {
+      const t = sentAt.get(note);
+      if (t === undefined) return;
+      sentAt.delete(note);
+      latencies.push(performance.now() - t);
+      if (latencies.length > 20) latencies.shift();
+      const last = latencies[latencies.length - 1];
+      const avg = latencies.reduce((a, b) => a + b, 0) / latencies.length;
+      latencySpan.textContent = 'Latency: ' + last.toFixed(0) + ' ms round trip (avg ' + avg.toFixed(0) + ' ms)';
+    }
+    
+    function sendNote(status, note, velocity) {
+      if (!ws || ws.readyState !== WebSocket.OPEN) return false;
+      ws.send(new Uint8Array([0x4D, 0x55, 0x01, 0x01, status, note, velocity]));
+      return true;
+    }
+    
+    wsConnect();
+    
     function noteOn(note, element, velocity) {
       if (activeNotes.has(note)) return;
       activeNotes.add(note);
       element.classList.add('pressed');
       
       // Use calculated velocity from click position
+      sentAt.set(note, performance.now());
+      if (sendNote(0x90, note, velocity)) return;
+      sentAt.delete(note);
       fetch('/note_on?note=' + note + '&velocity=' + velocity)
         .catch(e => console.error('Error:', e));
     }
@@ -407,6 +478,7 @@ static const char keyboard_html[] = R"rawliteral(
       activeNotes.delete(note);
       element.classList.remove('pressed');
       
+      if (sendNote(0x80, note, 64)) return;
       fetch('/note_off?note=' + note + '&velocity=64')
         .catch(e => console.error('Error:', e));
     }
@@ -33,7 +33,6 @@ static const char* WIFI_PASS = "murphalurf18";
 
 // Telnet server for remote logging
 WiFiServer telnetServer(23);
-WiFiClient telnetClient;
 
 static void wifi_connect() {
   WiFi.mode(WIFI_STA);
@@ -85,6 +84,7 @@ static void ota_begin() {
   // Start telnet server
   telnetServer.begin();
   telnetServer.setNoDelay(true);
+  Log.serveTelnet(telnetServer);
   Log.println("Telnet server started on port 23");
 }
 
@@ -92,6 +92,7 @@ void setup() {
   
   // Serial.begin(115200);
   delay(200);
+  logger_begin();
 
   Log.println("\n\n=== Chime Ctrl ===");
   
@@ -143,28 +144,14 @@ void loop() {
     wasConnected = isConnected;
   }
   
-  // Handle telnet connections
+  // Telnet clients are taken by the logger's telnet task
   if (WiFi.status() == WL_CONNECTED) {
-    // Check for new telnet clients (only when a NEW client connects)
-    if (telnetServer.hasClient()) {
-      WiFiClient newClient = telnetServer.available();
-      if (newClient) {
-        // Disconnect old client if exists
-        if (telnetClient && telnetClient.connected()) {
-          telnetClient.stop();
-        }
-        telnetClient = newClient;
-        Log.setTelnetClient(&telnetClient);
-        Log.println("\nTelnet client connected");
-      }
-    }
-    
     // Handle OTA
     ArduinoOTA.handle();
-    
-    // Handle HTTP requests
-    httpserver_loop();
   }
+  
+  // Run the note and sequencer calls queued by HTTP handlers
+  httpserver_loop();
 
 
   // // Ring chimes sequentially every 0.5 seconds
@@ -0,0 +1,121 @@
+// midibc.cpp - Precompiled MIDI event format ("MIDI bytecode")
+#include "midibc.h"
+#include "smfstream.h"
+#include <string.h>
+
+static void put16(uint8_t* p, uint16_t v) {
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+  p[0] = v & 0xFF;
+  p[1] = (v >> 8) & 0xFF;
+  p[2] = (v >> 16) & 0xFF;
+  p[3] = v >> 24;
+}
+
+static uint16_t get16(const uint8_t* p) {
+  return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool midibc_is_image(const uint8_t* data, size_t size) {
+  if (!data || size < MIDIBC_HEADER_SIZE) return false;
+  return memcmp(data, "MBC1", 4) == 0 && data[4] == MIDIBC_VERSION;
+}
+
+int32_t midibc_compile(MidiEventSource& src, uint16_t tpq, uint16_t tracks,
+                       MidiBcWriteFn write, void* ctx) {
+  if (!src.rewind()) return -1;
+
+  uint8_t hdr[MIDIBC_HEADER_SIZE] = { 'M', 'B', 'C', '1', MIDIBC_VERSION, 0 };
+  put16(hdr + 6, tpq);
+  put16(hdr + 8, tracks);
+  put32(hdr + 12, 0xFFFFFFFF);  // Count implied by image size
+  if (!write(ctx, hdr, sizeof(hdr))) return -1;
+
+  int32_t count = 0;
+  uint32_t last_us = 0;
+  SmfEvent ev;
+  while (src.next(ev)) {
+    uint8_t rec[MIDIBC_RECORD_SIZE];
+    put32(rec, ev.time_us - last_us);
+    rec[4] = ev.status;
+    rec[5] = ev.data1;
+    rec[6] = ev.data2;
+    if (!write(ctx, rec, sizeof(rec))) return -1;
+    last_us = ev.time_us;
+    count++;
+  }
+  return count;
+}
+
+MidiBcReader::~MidiBcReader() {
+  close();
+}
+
+void MidiBcReader::close() {
+  delete src;
+  src = nullptr;
+  count = 0;
+}
+
+bool MidiBcReader::open(SmfSource* source) {
+  close();
+  src = source;
+  if (!src) return false;
+
+  uint8_t hdr[MIDIBC_HEADER_SIZE];
+  if (src->read(0, hdr, sizeof(hdr)) != sizeof(hdr) || !midibc_is_image(hdr, sizeof(hdr))) {
+    close();
+    return false;
+  }
+
+  tpq = get16(hdr + 6);
+  tracks = get16(hdr + 8);
+  uint32_t available = (src->size() - MIDIBC_HEADER_SIZE) / MIDIBC_RECORD_SIZE;
+  count = get32(hdr + 12);
+  if (count > available) count = available;
+
+  return rewind();
+}
+
+bool MidiBcReader::rewind() {
+  if (!src) return false;
+  index = 0;
+  time_us = 0;
+  buf_len = 0;
+  buf_pos = 0;
+  return true;
+}
+
+bool MidiBcReader::next(SmfEvent& out) {
+  if (index >= count) return false;
+
+  if (buf_pos >= buf_len) {
+    uint32_t n = count - index;
+    if (n > BATCH) n = BATCH;
+    uint32_t offset = MIDIBC_HEADER_SIZE + index * MIDIBC_RECORD_SIZE;
+    size_t got = src->read(offset, buf, n * MIDIBC_RECORD_SIZE);
+    buf_len = got / MIDIBC_RECORD_SIZE;
+    buf_pos = 0;
+    if (buf_len == 0) {
+      count = index;  // Source shorter than expected
+      return false;
+    }
+  }
+
+  const uint8_t* rec = buf + buf_pos * MIDIBC_RECORD_SIZE;
+  time_us += get32(rec);
+  out.time_us = time_us;
+  out.status = rec[4];
+  out.data1 = rec[5];
+  out.data2 = rec[6];
+  buf_pos++;
+  index++;
+  return true;
+}
@@ -0,0 +1,83 @@
+// midibc.h - Precompiled MIDI event format ("MIDI bytecode")
+//
+// A compiled image is a 16-byte header followed by fixed 7-byte records:
+//   uint32_t delta_us   Microseconds since the previous event (little endian)
+//   uint8_t  status, data1, data2
+// Tracks are already merged and the tempo map already applied, so playback
+// is a sequential read with no VLQ, running status or meta handling.
+//
+// This file has no Arduino dependencies so the host-side converter
+// (utilities/midi2bc.cpp) can share it with the firmware.
+#ifndef MIDIBC_H
+#define MIDIBC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "midiseq.h"
+
+class SmfSource;
+
+#define MIDIBC_HEADER_SIZE 16
+#define MIDIBC_RECORD_SIZE 7
+#define MIDIBC_VERSION 1
+
+// Header layout (little endian):
+//   0  "MBC1"
+//   4  uint8_t  version
+//   5  uint8_t  reserved (0)
+//   6  uint16_t ticks per quarter of the source file (informational)
+//   8  uint16_t track count of the source file (informational)
+//  10  uint16_t reserved (0)
+//  12  uint32_t event count
+// A count of 0xFFFFFFFF means "up to the end of the image"; writers that
+// cannot seek back (append-only flash) leave it unprogrammed.
+
+// Sink for compiled bytes; return false to abort
+typedef bool (*MidiBcWriteFn)(void* ctx, const uint8_t* data, size_t len);
+
+// True if data starts with a compiled image header
+bool midibc_is_image(const uint8_t* data, size_t size);
+
+// Compile every event from src (rewound first) into write().
+// Returns the number of events written, or -1 if write() failed.
+int32_t midibc_compile(MidiEventSource& src, uint16_t tpq, uint16_t tracks,
+                       MidiBcWriteFn write, void* ctx);
+
+/**
+ * Plays a compiled image from any byte source (mapped flash, file, RAM).
+ */
+class MidiBcReader : public MidiEventSource {
+public:
+  MidiBcReader() {}
+  ~MidiBcReader() override;
+
+  /**
+   * Validate the header. Takes ownership of src (deleted on close or destruction).
+   * @return false if src does not hold a compiled image
+   */
+  bool open(SmfSource* src);
+  void close();
+
+  // MidiEventSource
+  bool next(SmfEvent& out) override;
+  bool rewind() override;
+
+  uint32_t getEventCount() const { return count; }
+  uint16_t getTicksPerQuarter() const { return tpq; }
+  uint16_t getTrackCount() const { return tracks; }
+
+private:
+  static const uint8_t BATCH = 16;  // Records fetched per source read
+
+  SmfSource* src = nullptr;
+  uint32_t count = 0;
+  uint32_t index = 0;
+  uint32_t time_us = 0;
+  uint16_t tpq = 0;
+  uint16_t tracks = 0;
+  uint8_t buf_len = 0;    // Records in buf
+  uint8_t buf_pos = 0;    // Next record in buf
+  uint8_t buf[BATCH * MIDIBC_RECORD_SIZE];
+};
+
+#endif // MIDIBC_H
@@ -1,13 +1,40 @@
 #include "midifiles.h"
 #include "midiseq.h"
+#include "smfstream.h"
+#include "midilib.h"
+#include "midibc.h"
 #include "logger.h"
 #include <SPIFFS.h>
 #include <FS.h>
+#include <new>
 
 // Global instance
 MIDIFileManager midiFiles;
 
 static const char* MIDI_DIR = "/midi";
+static const char* UPLOAD_TEMP = "/upload.tmp";
+
+/**
+ * SmfSource reading straight from an open SPIFFS file.
+ * Only the per-track read windows live in RAM, so file size is not
+ * limited by free heap.
+ */
+class SpiffsSmfSource : public SmfSource {
+public:
+    explicit SpiffsSmfSource(File f) : file(f), len(f.size()) {}
+    ~SpiffsSmfSource() override { file.close(); }
+
+    size_t read(uint32_t offset, uint8_t* dst, size_t n) override {
+        if (offset >= len) return 0;
+        if (!file.seek(offset)) return 0;
+        return file.read(dst, n);
+    }
+    uint32_t size() const override { return len; }
+
+private:
+    File file;
+    uint32_t len;
+};
 
 bool MIDIFileManager::begin() {
     if (initialized) {
@@ -22,6 +49,11 @@ bool MIDIFileManager::begin() {
         return false;
     }
     
+    // Discard any upload interrupted by a reset
+    if (SPIFFS.exists(UPLOAD_TEMP)) {
+        SPIFFS.remove(UPLOAD_TEMP);
+    }
+    
     // Create MIDI directory if it doesn't exist
     if (!SPIFFS.exists(MIDI_DIR)) {
         SPIFFS.mkdir(MIDI_DIR);
@@ -30,6 +62,9 @@ bool MIDIFileManager::begin() {
     
     initialized = true;
     
+    // Flash-mapped copies for zero-copy playback (optional partition)
+    midiLib.begin();
+    
     size_t total = SPIFFS.totalBytes();
     size_t used = SPIFFS.usedBytes();
     Log.printf("SPIFFS: %d KB total, %d KB used, %d KB free\n", 
@@ -60,13 +95,20 @@ bool MIDIFileManager::validateFilename(const String& name) {
     return true;
 }
 
-bool MIDIFileManager::isMidiFile(const uint8_t* data, size_t size) {
-    // Check for MThd header (MIDI file signature)
-    if (size < 14) return false;
-    return (data[0] == 'M' && data[1] == 'T' && data[2] == 'h' && data[3] == 'd');
+bool MIDIFileManager::uploadFile(const String& name, const uint8_t* data, size_t size) {
+    if (!beginUpload(name)) {
+        return false;
+    }
+    if (!writeUpload(data, size)) {
+        abortUpload();
+        return false;
+    }
+    return endUpload();
 }
 
-bool MIDIFileManager::uploadFile(const String& name, const uint8_t* data, size_t size) {
+bool MIDIFileManager::beginUpload(const String& name) {
+    abortUpload();
+    
     if (!initialized) {
         Log.println("File manager not initialized");
         return false;
@@ -77,41 +119,87 @@ bool MIDIFileManager::uploadFile(const String& name, const uint8_t* data, size_t
         return false;
     }
     
-    // Validate MIDI file format
-    if (!isMidiFile(data, size)) {
-        Log.println("Not a valid MIDI file (missing MThd header)");
+    // Write to a temp file outside MIDI_DIR so a partial upload is never listed
+    uploadTemp = SPIFFS.open(UPLOAD_TEMP, FILE_WRITE);
+    if (!uploadTemp) {
+        Log.printf("Failed to open file for writing: %s\n", UPLOAD_TEMP);
         return false;
     }
     
-    // Check if we have enough space
-    size_t freeSpace = getFreeBytes();
-    if (size > freeSpace) {
-        Log.printf("Insufficient space: need %d bytes, have %d bytes\n", size, freeSpace);
+    uploadName = name;
+    uploadBytes = 0;
+    uploadActive = true;
+    return true;
+}
+
+bool MIDIFileManager::writeUpload(const uint8_t* data, size_t len) {
+    if (!uploadActive) {
         return false;
     }
     
-    String fullPath = makeFullPath(name);
+    // Validate the signature as soon as its bytes arrive: a MIDI file or a
+    // precompiled image
+    if (uploadBytes < 4) {
+        size_t have = uploadBytes;
+        for (size_t i = 0; have < 4 && i < len; i++) {
+            uploadMagic[have++] = data[i];
+        }
+        if (memcmp(uploadMagic, "MThd", have) != 0 && memcmp(uploadMagic, "MBC1", have) != 0) {
+            Log.println("Not a valid MIDI file (missing MThd or MBC1 header)");
+            abortUpload();
+            return false;
+        }
+    }
     
-    // Write file
-    File file = SPIFFS.open(fullPath, FILE_WRITE);
-    if (!file) {
-        Log.printf("Failed to open file for writing: %s\n", fullPath.c_str());
+    size_t written = uploadTemp.write(data, len);
+    uploadBytes += written;
+    if (written != len) {
+        Log.printf("Write error after %d bytes (SPIFFS full?)\n", uploadBytes);
+        abortUpload();
+        return false;
+    }
+    return true;
+}
+
+bool MIDIFileManager::endUpload() {
+    if (!uploadActive) {
         return false;
     }
     
-    size_t written = file.write(data, size);
-    file.close();
+    uploadTemp.close();
+    uploadActive = false;
+    
+    if (uploadBytes < 14) {
+        Log.println("Not a valid MIDI file (too short)");
+        SPIFFS.remove(UPLOAD_TEMP);
+        return false;
+    }
     
-    if (written != size) {
-        Log.printf("Write error: wrote %d of %d bytes\n", written, size);
+    // SPIFFS cannot rename over an existing file, so the old copy goes first
+    String fullPath = makeFullPath(uploadName);
+    if (SPIFFS.exists(fullPath)) {
         SPIFFS.remove(fullPath);
+    }
+    if (!SPIFFS.rename(UPLOAD_TEMP, fullPath)) {
+        Log.printf("Failed to rename upload to %s\n", fullPath.c_str());
+        SPIFFS.remove(UPLOAD_TEMP);
         return false;
     }
     
-    Log.printf("Uploaded MIDI file: %s (%d bytes)\n", name.c_str(), size);
+    Log.printf("Uploaded MIDI file: %s (%d bytes)\n", uploadName.c_str(), uploadBytes);
+    addToLibrary(uploadName);
     return true;
 }
 
+void MIDIFileManager::abortUpload() {
+    if (!uploadActive) {
+        return;
+    }
+    uploadTemp.close();
+    SPIFFS.remove(UPLOAD_TEMP);
+    uploadActive = false;
+}
+
 std::vector<MIDIFileManager::FileInfo> MIDIFileManager::listFiles() {
     std::vector<FileInfo> files;
     
@@ -157,6 +245,7 @@ bool MIDIFileManager::deleteFile(const String& name) {
         return false;
     }
     
+    midiLib.remove(name);
     bool result = SPIFFS.remove(fullPath);
     if (result) {
         Log.printf("Deleted MIDI file: %s\n", name.c_str());
@@ -209,41 +298,187 @@ bool MIDIFileManager::readFile(const String& name, uint8_t** outData, size_t* ou
     return true;
 }
 
-bool MIDIFileManager::playFile(const String& name, const PlaybackParams& params) {
+MidiEventSource* MIDIFileManager::openFile(const String& name) {
     if (!initialized) {
-        return false;
+        return nullptr;
     }
     
-    // Read file
-    uint8_t* data = nullptr;
-    size_t size = 0;
-    
-    if (!readFile(name, &data, &size)) {
-        return false;
+    if (!validateFilename(name)) {
+        return nullptr;
     }
     
-    // Stop any current playback
-    midiseq_stop();
-    
-    // Load MIDI file
-    bool success = midiseq_load_from_buffer(data, size);
+    if (!SPIFFS.exists(makeFullPath(name))) {
+        Log.printf("File not found: %s\n", name.c_str());
+        return nullptr;
+    }
     
-    free(data);
+    // Prefer the compiled, flash-mapped library image; fall back to reading
+    // the file from SPIFFS
+    MidiEventSource* events = openFromLibrary(name);
+    if (!events && addToLibrary(name)) {
+        events = openFromLibrary(name);
+    }
+    const char* from = "library";
     
-    if (!success) {
+    if (!events) {
+        events = openFromSpiffs(name);
+        from = "SPIFFS";
+    }
+    if (!events) {
         Log.printf("Failed to load MIDI file: %s\n", name.c_str());
-        return false;
+        return nullptr;
     }
     
-    // Set playback parameters AFTER loading (which calls midiseq_play internally)
+    Log.printf("Opened MIDI file: %s from %s\n", name.c_str(), from);
+    return events;
+}
+
+void MIDIFileManager::playSource(const String& name, MidiEventSource* events, const PlaybackParams& params) {
+    midiseq_load_source(events);
+    midiseq_play();
+    
+    // Set playback parameters AFTER loading (load resets them to defaults)
     midiseq_set_tempo_scale(params.tempoScale);
     midiseq_set_velocity_scale(params.velocityScale);
     midiseq_set_transpose(params.transpose);
     
     Log.printf("Playing MIDI file: %s (tempo=%.2fx, vel=%.2fx, transpose=%+d)\n",
                name.c_str(), params.tempoScale, params.velocityScale, params.transpose);
+}
+
+void MIDIFileManager::setReleaseHook(void (*hook)()) {
+    releaseHook = hook;
+}
+
+static bool libraryWrite(void* ctx, const uint8_t* data, size_t len) {
+    (void)ctx;
+    return midiLib.write(data, len);
+}
+
+MIDIFileManager::LibraryResult MIDIFileManager::compileToLibrary(const String& name) {
+    File file = SPIFFS.open(makeFullPath(name), FILE_READ);
+    if (!file) {
+        Log.printf("Cannot compile %s: file not found\n", name.c_str());
+        return LIBRARY_FAILED;
+    }
     
-    return true;
+    // A precompiled image is copied in as it is
+    uint8_t hdr[MIDIBC_HEADER_SIZE];
+    if (file.read(hdr, sizeof(hdr)) == sizeof(hdr) && midibc_is_image(hdr, sizeof(hdr))) {
+        file.seek(0);
+        if (!midiLib.beginStore(name)) {
+            if (midiLib.outOfSpace()) return LIBRARY_FULL;
+            Log.printf("Cannot store %s: MIDI library not writable\n", name.c_str());
+            return LIBRARY_FAILED;
+        }
+        uint8_t buf[512];
+        size_t n;
+        while ((n = file.read(buf, sizeof(buf))) > 0 && midiLib.write(buf, n)) {}
+        if (!midiLib.endStore()) {
+            return midiLib.outOfSpace() ? LIBRARY_FULL : LIBRARY_FAILED;
+        }
+        return LIBRARY_STORED;
+    }
+    file.seek(0);
+    
+    SmfStream stream;
+    if (!stream.open(new (std::nothrow) SpiffsSmfSource(file))) {
+        Log.printf("Cannot compile %s: not a playable MIDI file\n", name.c_str());
+        return LIBRARY_FAILED;
+    }
+    
+    if (!midiLib.beginStore(name)) {
+        if (midiLib.outOfSpace()) return LIBRARY_FULL;
+        Log.printf("Cannot compile %s: MIDI library not writable\n", name.c_str());
+        return LIBRARY_FAILED;
+    }
+    uint32_t start = millis();
+    int32_t count = midibc_compile(stream, stream.getTicksPerQuarter(),
+                                   stream.getTrackCount(), libraryWrite, nullptr);
+    if (!midiLib.endStore()) {
+        return midiLib.outOfSpace() ? LIBRARY_FULL : LIBRARY_FAILED;
+    }
+    if (count < 0) {
+        midiLib.remove(name);
+        Log.printf("Cannot compile %s: could not rewind the file\n", name.c_str());
+        return LIBRARY_FAILED;
+    }
+    
+    Log.printf("Compiled %s: %d events from %u tracks in %lu ms\n", name.c_str(),
+               (int)count, stream.getTrackCount(), (unsigned long)(millis() - start));
+    return LIBRARY_STORED;
+}
+
+bool MIDIFileManager::addToLibrary(const String& name) {
+    if (!midiLib.available()) {
+        return false;
+    }
+    
+    LibraryResult result = compileToLibrary(name);
+    if (result != LIBRARY_FULL) {
+        return result == LIBRARY_STORED;
+    }
+    
+    // Library full - reclaim dead entries by rebuilding it from SPIFFS.
+    // Playback may be reading from the partition, so release it first.
+    Log.println("MIDI library full, rebuilding...");
+    if (releaseHook) {
+        releaseHook();
+    } else {
+        midiseq_unload();
+    }
+    if (!midiLib.format()) {
+        return false;
+    }
+    
+    bool stored = false;
+    for (const FileInfo& info : listFiles()) {
+        bool ok = compileToLibrary(info.name) == LIBRARY_STORED;
+        if (info.name == name) stored = ok;
+    }
+    return stored;
+}
+
+MidiEventSource* MIDIFileManager::openFromLibrary(const String& name) {
+    SmfSource* src = midiLib.open(name);
+    if (!src) {
+        return nullptr;
+    }
+    
+    MidiBcReader* reader = new (std::nothrow) MidiBcReader();
+    if (!reader) {
+        delete src;
+        return nullptr;
+    }
+    if (!reader->open(src)) {
+        delete reader;
+        return nullptr;
+    }
+    return reader;
+}
+
+// Read a file straight from SPIFFS, as a precompiled image or by parsing it
+MidiEventSource* MIDIFileManager::openFromSpiffs(const String& name) {
+    String fullPath = makeFullPath(name);
+    
+    MidiBcReader* reader = new (std::nothrow) MidiBcReader();
+    if (!reader) {
+        return nullptr;
+    }
+    if (reader->open(new (std::nothrow) SpiffsSmfSource(SPIFFS.open(fullPath, FILE_READ)))) {
+        return reader;
+    }
+    delete reader;
+    
+    SmfStream* stream = new (std::nothrow) SmfStream();
+    if (!stream) {
+        return nullptr;
+    }
+    if (!stream->open(new (std::nothrow) SpiffsSmfSource(SPIFFS.open(fullPath, FILE_READ)))) {
+        delete stream;
+        return nullptr;
+    }
+    return stream;
 }
 
 size_t MIDIFileManager::getTotalBytes() {
@@ -3,6 +3,9 @@
 
 #include <Arduino.h>
 #include <vector>
+#include <FS.h>
+
+class MidiEventSource;
 
 /**
  * MIDI File Manager
@@ -36,13 +39,28 @@ public:
      */
     bool uploadFile(const String& name, const uint8_t* data, size_t size);
     
+    /**
+     * Streamed upload: data is written to a temp file as it arrives and
+     * renamed into place by endUpload(), so RAM use is one chunk.
+     * writeUpload() rejects the upload as soon as the first bytes are neither
+     * "MThd" nor "MBC1" (an image compiled offline by utilities/midi2bc).
+     * endUpload() also compiles the file into the library, which can take
+     * seconds; call it from the web server task, not the loop.
+     * @return false on error (the upload is aborted and the temp file removed)
+     */
+    bool beginUpload(const String& name);
+    bool writeUpload(const uint8_t* data, size_t len);
+    bool endUpload();
+    void abortUpload();
+    
     /**
      * List all MIDI files
      */
     std::vector<FileInfo> listFiles();
     
     /**
-     * Delete a file by name
+     * Delete a file by name and retire its library copy. The library entry
+     * is only marked dead, so a source already open on it stays valid.
      */
     bool deleteFile(const String& name);
     
@@ -56,12 +74,32 @@ public:
     bool readFile(const String& name, uint8_t** outData, size_t* outSize);
     
     /**
-     * Play a MIDI file
+     * Open a MIDI file for playback: its flash-mapped library image, compiled
+     * now if it is missing, or else the file on SPIFFS. Compiling can take
+     * seconds, so call this from the web server task and hand the source to
+     * the loop task with playSource().
      * @param name Filename
+     * @return the event source (caller owns it), or nullptr if the file is
+     *         missing or not playable
+     */
+    MidiEventSource* openFile(const String& name);
+    
+    /**
+     * Replace the sequencer's source with one from openFile() and start it
+     * (loop task; takes ownership)
+     * @param name Filename, for the log
+     * @param events Source from openFile()
      * @param params Playback parameters
-     * @return true if playback started successfully
      */
-    bool playFile(const String& name, const PlaybackParams& params);
+    void playSource(const String& name, MidiEventSource* events, const PlaybackParams& params);
+    
+    /**
+     * Called before a library rebuild erases the partition, to stop
+     * playback reading from it. The default, midiseq_unload(), is only
+     * safe on the loop task; a caller that compiles on another task sets a
+     * hook that runs it there.
+     */
+    void setReleaseHook(void (*hook)());
     
     /**
      * Get filesystem usage info
@@ -72,9 +110,29 @@ public:
     
 private:
     bool initialized;
+    
+    // Streamed upload in progress
+    File uploadTemp;
+    String uploadName;
+    size_t uploadBytes = 0;
+    bool uploadActive = false;
+    uint8_t uploadMagic[4];
+    
+    void (*releaseHook)() = nullptr;
+    
+    // Outcome of compiling one file into the library
+    enum LibraryResult {
+        LIBRARY_STORED,
+        LIBRARY_FULL,      // Out of space; a rebuild may make room
+        LIBRARY_FAILED     // Unplayable file or flash error; a rebuild would not help
+    };
+    
     String makeFullPath(const String& name);
     bool validateFilename(const String& name);
-    bool isMidiFile(const uint8_t* data, size_t size);
+    LibraryResult compileToLibrary(const String& name);
+    bool addToLibrary(const String& name);
+    MidiEventSource* openFromLibrary(const String& name);
+    MidiEventSource* openFromSpiffs(const String& name);
 };
 
 // Global instance
@@ -1,11 +1,13 @@
 #include "midihandler.h"
 #include "midinote.h"
+#include "notetrace.h"
 
 extern "C" {
 
 void handle_midi_message(uint8_t status, uint8_t data1, uint8_t data2) {
     uint8_t type = status & 0xF0;
     uint8_t channel = status & 0x0F;
+    NOTE_MARK(NT_HANDLER, (type & 0xE0) == 0x80 ? data1 : NT_NO_NOTE);
     
     (void)channel;  // Not used yet, but available for future channel filtering
     
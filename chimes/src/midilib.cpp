@@ -0,0 +1,216 @@
+#include "midilib.h"
+#include "smfstream.h"
+#include "logger.h"
+#include <new>
+#include <stddef.h>
+
+// Global instance
+MidiLibrary midiLib;
+
+static const char* PARTITION_LABEL = "midilib";
+
+/**
+ * SmfSource over a memory-mapped library entry.
+ * The mapping is released when the source is deleted.
+ */
+class MappedSmfSource : public SmfMemorySource {
+public:
+    MappedSmfSource(const uint8_t* data, size_t size, esp_partition_mmap_handle_t handle)
+        : SmfMemorySource(data, size), handle(handle) {}
+    ~MappedSmfSource() override { esp_partition_munmap(handle); }
+
+private:
+    esp_partition_mmap_handle_t handle;
+};
+
+bool MidiLibrary::begin() {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                         ESP_PARTITION_SUBTYPE_ANY, PARTITION_LABEL);
+    if (!partition) {
+        Log.println("No midilib partition - playing MIDI files from SPIFFS");
+        return false;
+    }
+
+    if (!scan()) {
+        Log.println("MIDI library not formatted, erasing...");
+        if (!format()) {
+            partition = nullptr;
+            return false;
+        }
+    }
+
+    Log.printf("MIDI library: %u entries, %u KB used of %u KB\n",
+               (unsigned)nextEntry, (unsigned)(dataEnd / 1024),
+               (unsigned)(getTotalBytes() / 1024));
+    return true;
+}
+
+size_t MidiLibrary::getTotalBytes() const {
+    return partition ? partition->size - DIR_SIZE : 0;
+}
+
+bool MidiLibrary::format() {
+    if (!partition) return false;
+
+    if (esp_partition_erase_range(partition, 0, partition->size) != ESP_OK) {
+        Log.println("MIDI library erase failed");
+        return false;
+    }
+
+    uint32_t header[HEADER_SIZE / 4] = { MAGIC, VERSION, 0, 0 };
+    if (esp_partition_write(partition, 0, header, sizeof(header)) != ESP_OK) {
+        return false;
+    }
+
+    nextEntry = 0;
+    dataEnd = 0;
+    storeIndex = -1;
+    return true;
+}
+
+bool MidiLibrary::readEntry(uint32_t index, Entry& e) {
+    return esp_partition_read(partition, HEADER_SIZE + index * sizeof(Entry),
+                              &e, sizeof(Entry)) == ESP_OK;
+}
+
+bool MidiLibrary::setState(uint32_t index, uint8_t state) {
+    return esp_partition_write(partition, HEADER_SIZE + index * sizeof(Entry),
+                               &state, 1) == ESP_OK;
+}
+
+bool MidiLibrary::scan() {
+    uint32_t header[HEADER_SIZE / 4];
+    if (esp_partition_read(partition, 0, header, sizeof(header)) != ESP_OK) return false;
+    if (header[0] != MAGIC || header[1] != VERSION) return false;
+
+    nextEntry = 0;
+    dataEnd = 0;
+    Entry e;
+    while (nextEntry < MAX_ENTRIES && readEntry(nextEntry, e) && e.state != STATE_FREE) {
+        // An entry interrupted mid-write may have programmed any amount of
+        // the remaining space, so treat the library as full until reformatted
+        if (e.size == 0xFFFFFFFF) {
+            dataEnd = getTotalBytes();
+        } else {
+            uint32_t end = e.offset + ((e.size + 3) & ~3u) - DIR_SIZE;
+            if (e.offset >= DIR_SIZE && end > dataEnd && end <= getTotalBytes()) {
+                dataEnd = end;
+            }
+        }
+        nextEntry++;
+    }
+    return true;
+}
+
+int MidiLibrary::findLive(const String& name, Entry& e) {
+    for (uint32_t i = 0; i < nextEntry; i++) {
+        if (!readEntry(i, e)) break;
+        if (e.state == STATE_LIVE && strncmp(e.name, name.c_str(), sizeof(e.name)) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+bool MidiLibrary::beginStore(const String& name) {
+    storeIndex = -1;
+    storeFull = false;
+    if (!partition) {
+        return false;
+    }
+    if (nextEntry >= MAX_ENTRIES || dataEnd >= getTotalBytes()) {
+        storeFull = true;
+        return false;
+    }
+
+    // Reserve the directory slot first so an interrupted write is never
+    // mistaken for free space
+    Entry e;
+    memset(&e, 0xFF, sizeof(e));
+    e.state = STATE_WRITING;
+    e.offset = DIR_SIZE + dataEnd;
+    strncpy(e.name, name.c_str(), sizeof(e.name) - 1);
+    e.name[sizeof(e.name) - 1] = '\0';
+    if (esp_partition_write(partition, HEADER_SIZE + nextEntry * sizeof(Entry),
+                            &e, sizeof(e)) != ESP_OK) {
+        return false;
+    }
+
+    storeIndex = nextEntry++;
+    storeSize = 0;
+    storeOk = true;
+    storeName = name;
+    return true;
+}
+
+bool MidiLibrary::write(const uint8_t* data, size_t len) {
+    if (storeIndex < 0 || !storeOk) return false;
+
+    // Data is appended into already-erased space, so no erase is needed here
+    if (dataEnd + storeSize + len > getTotalBytes()) {
+        storeOk = false;
+        storeFull = true;
+        return false;
+    }
+    if (esp_partition_write(partition, DIR_SIZE + dataEnd + storeSize, data, len) != ESP_OK) {
+        storeOk = false;
+        return false;
+    }
+    storeSize += len;
+    return true;
+}
+
+bool MidiLibrary::endStore() {
+    if (storeIndex < 0) return false;
+    uint32_t index = storeIndex;
+    storeIndex = -1;
+
+    if (!storeOk) {
+        // Leave the entry WRITING with no size; the space is lost until format()
+        dataEnd = getTotalBytes();
+        Log.printf("MIDI library write failed: %s\n", storeName.c_str());
+        return false;
+    }
+
+    uint32_t offset = DIR_SIZE + dataEnd;
+    esp_partition_write(partition, HEADER_SIZE + index * sizeof(Entry) + offsetof(Entry, size),
+                        &storeSize, sizeof(storeSize));
+    dataEnd += (storeSize + 3) & ~3u;
+
+    // Retire the old copy before publishing the new one
+    remove(storeName);
+    setState(index, STATE_LIVE);
+
+    Log.printf("Stored %s in MIDI library (%u bytes at 0x%06x)\n",
+               storeName.c_str(), (unsigned)storeSize, (unsigned)offset);
+    return true;
+}
+
+void MidiLibrary::remove(const String& name) {
+    if (!partition) return;
+
+    Entry e;
+    int index;
+    while ((index = findLive(name, e)) >= 0) {
+        setState(index, STATE_DEAD);
+    }
+}
+
+SmfSource* MidiLibrary::open(const String& name) {
+    if (!partition) return nullptr;
+
+    Entry e;
+    if (findLive(name, e) < 0) return nullptr;
+
+    const void* ptr = nullptr;
+    esp_partition_mmap_handle_t handle;
+    if (esp_partition_mmap(partition, e.offset, e.size, ESP_PARTITION_MMAP_DATA,
+                           &ptr, &handle) != ESP_OK) {
+        Log.printf("MIDI library mmap failed: %s\n", name.c_str());
+        return nullptr;
+    }
+
+    SmfSource* src = new (std::nothrow) MappedSmfSource((const uint8_t*)ptr, e.size, handle);
+    if (!src) esp_partition_munmap(handle);
+    return src;
+}
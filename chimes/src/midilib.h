@@ -0,0 +1,106 @@
+#ifndef MIDILIB_H
+#define MIDILIB_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "esp_partition.h"
+
+class SmfSource;
+
+/**
+ * MIDI Library
+ * Keeps a compiled image (see midibc.h) of each uploaded MIDI file in a
+ * dedicated flash partition ("midilib") so playback can read it through
+ * esp_partition_mmap with no heap copy, no filesystem calls and no parsing.
+ *
+ * Layout: sector 0 holds a header and an append-only directory, images are
+ * appended after it. Replacing or deleting a file only marks its directory
+ * entry dead; space is reclaimed by format() and re-adding the files.
+ */
+class MidiLibrary {
+public:
+    /**
+     * Locate the partition and scan the directory
+     * Returns false if the partition table has no midilib partition
+     */
+    bool begin();
+
+    bool available() const { return partition != nullptr; }
+
+    /**
+     * Start a new entry at the end of the data area
+     * Data is supplied with write() and published by endStore(), which
+     * replaces any existing entry of the same name.
+     * @return false if the partition is missing or the directory is full
+     */
+    bool beginStore(const String& name);
+    bool write(const uint8_t* data, size_t len);
+    bool endStore();
+
+    /**
+     * True when the last beginStore() or write() failed because the
+     * directory or the data area is full; only format() frees space
+     */
+    bool outOfSpace() const { return storeFull; }
+    
+    /**
+     * Forget a file (marks its directory entry dead)
+     */
+    void remove(const String& name);
+
+    /**
+     * Map a stored entry into memory
+     * @param name Filename
+     * @return SmfSource over the mapped bytes (unmapped when deleted), or nullptr
+     */
+    SmfSource* open(const String& name);
+
+    /**
+     * Erase the whole partition. Nothing may be mapped from it while this runs.
+     */
+    bool format();
+
+    size_t getTotalBytes() const;
+    size_t getUsedBytes() const { return dataEnd; }
+
+private:
+    static const uint32_t MAGIC = 0x42494C4D;  // "MLIB"
+    static const uint32_t VERSION = 2;         // 2 = entries hold compiled images
+    static const uint32_t DIR_SIZE = 0x1000;   // One flash sector
+    static const uint8_t STATE_FREE = 0xFF;
+    static const uint8_t STATE_WRITING = 0xFE;
+    static const uint8_t STATE_LIVE = 0xFC;
+    static const uint8_t STATE_DEAD = 0x00;
+
+    // Directory entries are only ever programmed (1 -> 0), never rewritten
+    struct Entry {
+        uint8_t state;
+        uint8_t reserved[3];
+        uint32_t offset;   // From start of partition
+        uint32_t size;     // Left unprogrammed (0xFFFFFFFF) until the data is complete
+        char name[36];
+    };
+    static const uint32_t HEADER_SIZE = 16;
+    static const uint32_t MAX_ENTRIES = (DIR_SIZE - HEADER_SIZE) / sizeof(Entry);
+
+    const esp_partition_t* partition = nullptr;
+    uint32_t nextEntry = 0;    // First free directory slot
+    uint32_t dataEnd = 0;      // First free data byte (from DIR_SIZE)
+    
+    // Entry being written by beginStore()/write()/endStore()
+    int32_t storeIndex = -1;
+    uint32_t storeSize = 0;
+    bool storeOk = false;
+    bool storeFull = false;
+    String storeName;
+
+    bool scan();
+    bool readEntry(uint32_t index, Entry& e);
+    bool setState(uint32_t index, uint8_t state);
+    int findLive(const String& name, Entry& e);
+};
+
+// Global instance
+extern MidiLibrary midiLib;
+
+#endif // MIDILIB_H
@@ -3,10 +3,15 @@
 #include "midinote.h"
 #include "chimes.h"
 #include "noterepeater.h"
+#include "notetrace.h"
 
 // MIDI note tracking - which notes are currently "on"
 static bool note_state[128] = {false};
 
+// Chime strikes per note and the velocity of the last one (note_get_state)
+static uint8_t note_strikes[128];
+static uint8_t note_velocity[128];
+
 // MIDI note number for A440 (MIDI note 69)
 static const uint8_t MIDI_A440 = 69;
 
@@ -49,10 +54,15 @@ void note_on(uint8_t midi_note, uint8_t velocity) {
   int chime_note = midi_to_chime(midi_note);
   
   if (chime_note >= 0) {
+    NOTE_MARK(NT_MAPPING, midi_note);
+
     // Mark note as on
     note_state[midi_note] = true;
+    note_velocity[midi_note] = velocity;
+    note_strikes[midi_note]++;
     
     // Ring the chime
+    NOTE_MARK(NT_OUTPUT, midi_note);
     ring_chime(chime_note, velocity);
     
     // Serial.printf("MIDI Note On: %d -> Chime: %d\n", midi_note, chime_note);
@@ -89,4 +99,14 @@ void all_off() {
   // Serial.println("All notes off");
 }
 
+void note_get_state(uint8_t midi_note, NoteState* out) {
+  if (midi_note >= 128) {
+    *out = NoteState{};
+    return;
+  }
+  out->on = note_state[midi_note];
+  out->strikes = note_strikes[midi_note];
+  out->velocity = note_velocity[midi_note];
+}
+
 } // extern "C"
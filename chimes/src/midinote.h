@@ -19,6 +19,16 @@ void note_off(uint8_t midi_note, uint8_t velocity);
 // Turn off all notes and reset all chimes
 void all_off(void);
 
+// Live state of one note, for the /ws note feed
+typedef struct {
+  bool on;            // Between note-on and note-off
+  uint8_t strikes;    // Note-ons that reached a chime; wraps
+  uint8_t velocity;   // Of the last of them
+} NoteState;
+
+// Safe to call from any task; the loop may change the note meanwhile
+void note_get_state(uint8_t midi_note, NoteState* out);
+
 #ifdef __cplusplus
 }
 #endif
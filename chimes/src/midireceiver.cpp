@@ -1,6 +1,7 @@
 #include "midireceiver.h"
 #include "logger.h"
 #include "midihandler.h"
+#include "notetrace.h"
 
 // MIDI uses UART at 31250 baud, 8-N-1
 #define MIDI_BAUD_RATE 31250
@@ -45,6 +46,7 @@ void MidiReceiver::update() {
     }
     // debug_sample_gpio38(); // DEBUG: sample GPIO38 as input
     // Process all available MIDI bytes
+    if (Serial.available()) NOTE_MARK(NT_RX, NT_NO_NOTE);
     while (Serial.available()) {
         uint8_t byte = Serial.read();
         lastByteTime = millis();
@@ -200,6 +202,7 @@ void MidiReceiver::handleMessage() {
     }
     
     // Delegate to common MIDI handler
+    NOTE_MARK(NT_PARSE, (status & 0xE0) == 0x80 ? data1 : NT_NO_NOTE);
     handle_midi_message(status, data1, data2);
 }
 
@@ -1,84 +1,404 @@
 // midiseq.cpp - Simple non-blocking MIDI sequencer
 #include "midiseq.h"
 #include "midinote.h"
+#include "spsc_ring.h"
+#include "smfstream.h"
+#include <new>
 #include <Arduino.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 
-static const MidiEvent* sequence = nullptr;
-static uint16_t num_events = 0;
-static uint16_t current_event = 0;
-static uint32_t ticks_per_quarter = 480;
-static uint32_t microsec_per_tick = 0;
-static uint32_t next_event_time = 0;
-static bool playing = false;
-static bool paused = false;
+static MidiEventSource* source = nullptr;  // Event stream being played
+static bool source_owned = false;          // Delete source when replaced
+static volatile bool playing = false;
+static volatile bool paused = false;
 static int8_t transpose = 0;  // Transpose in semitones (half-steps)
 static uint8_t velocity_scale = 127;  // Maximum velocity (127 = no scaling)
 
+static uint16_t nominal_tempo_bpm = 120;  // Tempo the source timestamps were computed at
 static uint16_t base_tempo_bpm = 120;
 static float tempo_scale = 1.0f;
 static float velocity_scale_factor = 1.0f;
 
-// Calculate microseconds per tick based on tempo
-static void calculate_timing(uint16_t tempo_bpm) {
-  // MIDI timing: microseconds per quarter note = 60,000,000 / BPM
-  uint32_t usec_per_quarter = 60000000UL / tempo_bpm;
-  microsec_per_tick = usec_per_quarter / ticks_per_quarter;
+// ---------- Event lookahead ----------
+// Events are pulled from the source into a bounded lookahead ring and
+// consumed by the scheduler. In timer mode seq_reader_task tops it up
+// whenever the timer finds it below LOOKAHEAD_LOW_WATER, so a loop() stall
+// longer than the lookahead no longer runs it dry; in loop mode
+// midiseq_loop() does. source_lock makes whichever task is filling it the
+// only producer, and keeps the reader off the source while loop() swaps,
+// rewinds or stops it.
+// Source timestamps are mapped to local micros() through an anchor pair:
+//   due = anchor_local + (time_us - anchor_file) * stretch_q16 / 65536
+// Tempo changes and resume re-anchor at the current position so playback
+// continues without a jump.
+static SpscRing<SmfEvent, 256> lookahead;
+static volatile bool source_done = false;  // Source returned its last event
+static uint32_t anchor_local = 0;
+static uint32_t anchor_file = 0;
+static uint32_t stretch_q16 = 65536;       // Local us per source us, 16.16
+static uint32_t pause_file_pos = 0;
+static uint8_t seq_gen = 0;                // Bumped on stop so stale queued events are dropped
+static SemaphoreHandle_t source_lock = nullptr;
+
+#define UNDERRUN_POLL_US     1000
+#define LOOKAHEAD_LOW_WATER  128   // Timer wakes the reader below this many events
+
+// Adapts a static MidiEvent array (songs, clock tunes) to MidiEventSource
+class ArrayEventSource : public MidiEventSource {
+public:
+  void load(const MidiEvent* ev, uint16_t n, uint16_t tpq, uint16_t tempo_bpm) {
+    events = ev;
+    count = n;
+    us_per_tick_q16 = ((uint64_t)(60000000UL / tempo_bpm) << 16) / (tpq ? tpq : 1);
+    rewind();
+  }
+  bool next(SmfEvent& out) override {
+    if (!events || index >= count) return false;
+    const MidiEvent* evt = &events[index++];
+    ticks += evt->delta_ticks;
+    out.time_us = (uint32_t)((ticks * us_per_tick_q16) >> 16);
+    out.status = evt->status;
+    out.data1 = evt->data1;
+    out.data2 = evt->data2;
+    return true;
+  }
+  bool rewind() override {
+    index = 0;
+    ticks = 0;
+    return events != nullptr;
+  }
+
+private:
+  const MidiEvent* events = nullptr;
+  uint16_t count = 0;
+  uint16_t index = 0;
+  uint64_t ticks = 0;
+  uint64_t us_per_tick_q16 = 0;
+};
+
+static ArrayEventSource array_source;
+
+// ---------- Timer-driven scheduling ----------
+// The esp_timer callback consumes the lookahead while playing in timer mode:
+// it moves every due event into seq_queue and re-arms itself for the next
+// due time. seq_output_task (pinned to the loop core, higher priority than
+// loop()) drains the queue and calls note_on/note_off, so note handlers
+// never run in parallel with loop() but are never delayed by it either.
+struct QueuedEvent {
+  uint8_t status;
+  uint8_t data1;
+  uint8_t data2;
+  uint8_t gen;      // seq_gen when queued
+  uint32_t due_us;  // micros() at which the event was scheduled
+};
+
+static SpscRing<QueuedEvent, 64> seq_queue;
+static esp_timer_handle_t seq_timer = nullptr;
+static TaskHandle_t seq_task = nullptr;
+static TaskHandle_t reader_task = nullptr;
+static volatile bool timer_mode = true;
+static volatile bool seq_finished = false;  // Set by the timer when the last event is queued
+static portMUX_TYPE seq_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// ---------- Jitter statistics ----------
+// Written by the output task, the timer and loop(), read from the server
+// task; jitter_mux keeps each update and copy whole.
+const uint32_t MIDISEQ_JITTER_BOUNDS_US[MIDISEQ_JITTER_BUCKETS - 1] = {
+  50, 100, 250, 500, 1000, 2000, 5000
+};
+static MidiSeqJitterStats jitter = {};
+static portMUX_TYPE jitter_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static void record_jitter(uint32_t late_us) {
+  int b = 0;
+  while (b < MIDISEQ_JITTER_BUCKETS - 1 && late_us >= MIDISEQ_JITTER_BOUNDS_US[b]) b++;
+  portENTER_CRITICAL(&jitter_mux);
+  jitter.counts[b]++;
+  jitter.events++;
+  jitter.total_us += late_us;
+  if (late_us > jitter.max_us) jitter.max_us = late_us;
+  portEXIT_CRITICAL(&jitter_mux);
+}
+
+// Local micros() at which an event from the source is due
+static uint32_t due_time(const SmfEvent& ev) {
+  int64_t d = (int32_t)(ev.time_us - anchor_file);
+  return anchor_local + (uint32_t)((d * stretch_q16) >> 16);
+}
+
+// Source position (us) corresponding to local time now
+static uint32_t file_pos_at(uint32_t now) {
+  return anchor_file + (uint32_t)(((uint64_t)(now - anchor_local) << 16) / stretch_q16);
+}
+
+// Top up the lookahead from the source. Producer side; hold source_lock.
+static void refill_lookahead() {
+  while (!source_done && !lookahead.full()) {
+    SmfEvent ev;
+    if (!source || !source->next(ev)) {
+      source_done = true;
+      break;
+    }
+    lookahead.push(ev);
+  }
+}
+
+// Apply transpose / velocity scaling and hand one event to the note layer
+static void dispatch_event(uint8_t status_byte, uint8_t data1, uint8_t data2) {
+  // Handle MIDI event
+  uint8_t status = status_byte & 0xF0;  // Upper nibble is message type
+  
+  switch (status) {
+    case 0x90: // Note On
+      if (data2 > 0) {  // Velocity > 0 means note on
+        int16_t transposed_note = (int16_t)data1 + transpose;
+        if (transposed_note >= 0 && transposed_note <= 127) {
+          // Scale velocity: first by max_velocity, then by velocity_scale_factor
+          uint16_t vel = (velocity_scale == 127) ? data2 : 
+                        ((uint16_t)data2 * velocity_scale) / 127;
+          vel = (uint16_t)(vel * velocity_scale_factor);
+          if (vel > 127) vel = 127;
+          note_on(transposed_note, (uint8_t)vel);
+        }
+      } else {  // Velocity = 0 is actually note off
+        int16_t transposed_note = (int16_t)data1 + transpose;
+        if (transposed_note >= 0 && transposed_note <= 127) {
+          note_off(transposed_note, data2);
+        }
+      }
+      break;
+      
+    case 0x80: // Note Off
+      {
+        int16_t transposed_note = (int16_t)data1 + transpose;
+        if (transposed_note >= 0 && transposed_note <= 127) {
+          note_off(transposed_note, data2);
+        }
+      }
+      break;
+      
+    // Other MIDI messages could be handled here:
+    // 0xA0 = Polyphonic aftertouch
+    // 0xB0 = Control change
+    // 0xC0 = Program change
+    // 0xD0 = Channel aftertouch
+    // 0xE0 = Pitch bend
+    
+    default:
+      // Ignore unknown messages
+      break;
+  }
+}
+
+static void arm_timer(uint32_t delay_us) {
+  if (!seq_timer) return;
+  esp_timer_stop(seq_timer);  // Harmless if not running
+  esp_timer_start_once(seq_timer, delay_us);
+}
+
+// esp_timer callback: queue every due event, then re-arm for the next one.
+// Runs in the esp_timer task, so it must not block or log.
+static void seq_timer_cb(void* arg) {
+  (void)arg;
+  bool queued = false;
+  bool low = false;
+  uint32_t overflows = 0;
+  uint32_t underruns = 0;
+  int32_t wait_us = -1;
+
+  portENTER_CRITICAL(&seq_mux);
+  if (playing && !paused) {
+    uint32_t now = micros();
+    SmfEvent ev;
+    while (lookahead.peek(ev)) {
+      uint32_t due = due_time(ev);
+      if ((int32_t)(now - due) < 0) {
+        wait_us = (int32_t)(due - now);
+        break;
+      }
+      lookahead.pop(ev);
+      QueuedEvent q = { ev.status, ev.data1, ev.data2, seq_gen, due };
+      if (seq_queue.push(q)) {
+        queued = true;
+      } else {
+        overflows++;
+      }
+    }
+    if (wait_us < 0) {
+      if (source_done) {
+        seq_finished = true;
+      } else {
+        // The reader has not refilled the lookahead yet - poll until it does
+        underruns++;
+        wait_us = UNDERRUN_POLL_US;
+      }
+    }
+    low = !source_done && lookahead.size() < LOOKAHEAD_LOW_WATER;
+  }
+  portEXIT_CRITICAL(&seq_mux);
+
+  if (overflows || underruns) {
+    portENTER_CRITICAL(&jitter_mux);
+    jitter.overflows += overflows;
+    jitter.underruns += underruns;
+    portEXIT_CRITICAL(&jitter_mux);
+  }
+  if (low && reader_task) xTaskNotifyGive(reader_task);
+  if (queued && seq_task) xTaskNotifyGive(seq_task);
+  if (wait_us >= 0) esp_timer_start_once(seq_timer, (uint64_t)wait_us);
+}
+
+// Output task: turns queued events into note_on/note_off as soon as they arrive
+static void seq_output_task(void* arg) {
+  (void)arg;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    QueuedEvent q;
+    while (seq_queue.pop(q)) {
+      if (!playing || q.gen != seq_gen) continue;  // Stopped while queued - drop
+      record_jitter(micros() - q.due_us);
+      dispatch_event(q.status, q.data1, q.data2);
+    }
+  }
+}
+
+// Reader task: refills the lookahead when the timer asks. Above loop() on
+// the same core, below the output task, so file reads wait for neither.
+static void seq_reader_task(void* arg) {
+  (void)arg;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    xSemaphoreTake(source_lock, portMAX_DELAY);
+    if (playing) refill_lookahead();
+    xSemaphoreGive(source_lock);
+  }
 }
 
 void midiseq_begin() {
-  sequence = nullptr;
-  num_events = 0;
-  current_event = 0;
   playing = false;
   paused = false;
+
+  if (!source_lock) source_lock = xSemaphoreCreateMutex();
+  if (!seq_timer) {
+    esp_timer_create_args_t args = {};
+    args.callback = seq_timer_cb;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "midiseq";
+    esp_timer_create(&args, &seq_timer);
+  }
+  if (!seq_task) {
+    xTaskCreatePinnedToCore(seq_output_task, "midiseq", 4096, nullptr,
+                            configMAX_PRIORITIES - 2, &seq_task, ARDUINO_RUNNING_CORE);
+  }
+  if (!reader_task) {
+    xTaskCreatePinnedToCore(seq_reader_task, "midiseq_rd", 4096, nullptr,
+                            2, &reader_task, ARDUINO_RUNNING_CORE);
+  }
 }
 
-void midiseq_load(const MidiEvent* events, uint16_t count, 
-                  uint16_t tpq, uint16_t tempo_bpm, int8_t transpose_semitones, uint8_t max_velocity) {
+// Swap in a new source, releasing the previous one if we own it
+static void set_source(MidiEventSource* src, bool owned, uint16_t tempo_bpm,
+                       int8_t transpose_semitones, uint8_t max_velocity) {
   // Stop current playback
   midiseq_stop();
-  
-  // Load new sequence
-  sequence = events;
-  num_events = count;
-  current_event = 0;
-  ticks_per_quarter = tpq;
+
+  xSemaphoreTake(source_lock, portMAX_DELAY);
+  if (source_owned) delete source;
+  source = src;
+  source_owned = owned;
+  xSemaphoreGive(source_lock);
+
   transpose = transpose_semitones;
   velocity_scale = max_velocity;
-  
-  calculate_timing(tempo_bpm);
+  nominal_tempo_bpm = tempo_bpm;
+  base_tempo_bpm = tempo_bpm;
+  tempo_scale = 1.0f;
+  velocity_scale_factor = 1.0f;
+  stretch_q16 = 65536;
+}
+
+void midiseq_load(const MidiEvent* events, uint16_t count, 
+                  uint16_t tpq, uint16_t tempo_bpm, int8_t transpose_semitones, uint8_t max_velocity) {
+  if (tempo_bpm == 0) tempo_bpm = 120;
+  array_source.load(events, count, tpq, tempo_bpm);
+  set_source(&array_source, false, tempo_bpm, transpose_semitones, max_velocity);
+}
+
+void midiseq_load_source(MidiEventSource* src, int8_t transpose_semitones, uint8_t max_velocity) {
+  set_source(src, true, 120, transpose_semitones, max_velocity);
 }
 
 void midiseq_play() {
-  if (!sequence || num_events == 0) return;
-  
-  current_event = 0;
-  next_event_time = micros();
+  if (!source) return;
+
+  // Restart cleanly if already playing
+  if (playing) midiseq_stop();
+
+  xSemaphoreTake(source_lock, portMAX_DELAY);
+  lookahead.reset();
+  source_done = false;
+  seq_finished = false;
+  bool ready = source->rewind();
+  if (ready) refill_lookahead();
+  xSemaphoreGive(source_lock);
+  if (!ready || lookahead.empty()) return;  // Nothing to play
+
+  portENTER_CRITICAL(&seq_mux);
+  anchor_local = micros();
+  anchor_file = 0;
   playing = true;
   paused = false;
-  
-  // Serial.printf("Starting MIDI playback: %d events, %d us/tick\n", 
-  //               num_events, microsec_per_tick);
+  portEXIT_CRITICAL(&seq_mux);
+
+  if (timer_mode) arm_timer(0);
 }
 
 void midiseq_stop() {
+  portENTER_CRITICAL(&seq_mux);
   playing = false;
   paused = false;
-  current_event = 0;
+  seq_finished = false;
+  seq_gen++;
+  portEXIT_CRITICAL(&seq_mux);
+
+  if (seq_timer) esp_timer_stop(seq_timer);
+
+  // Consumer is idle now that playing is false, and the reader once it
+  // lets go of the source
+  xSemaphoreTake(source_lock, portMAX_DELAY);
+  lookahead.reset();
+  source_done = false;
+  xSemaphoreGive(source_lock);
   
   // Send all notes off
   all_off();
 }
 
+void midiseq_unload() {
+  set_source(nullptr, false, 120, 0, 127);
+}
+
 void midiseq_pause() {
+  if (!playing || paused) return;
+  portENTER_CRITICAL(&seq_mux);
   paused = true;
+  pause_file_pos = file_pos_at(micros());
+  portEXIT_CRITICAL(&seq_mux);
+  if (seq_timer) esp_timer_stop(seq_timer);
 }
 
 void midiseq_resume() {
   if (playing && paused) {
+    portENTER_CRITICAL(&seq_mux);
     paused = false;
-    // Reset timing to avoid jump
-    next_event_time = micros();
+    // Continue from where we paused rather than catching up
+    anchor_local = micros();
+    anchor_file = pause_file_pos;
+    portEXIT_CRITICAL(&seq_mux);
+    if (timer_mode) arm_timer(0);
   }
 }
 
@@ -86,18 +406,36 @@ bool midiseq_is_playing() {
   return playing && !paused;
 }
 
+// Recompute the time stretch and re-anchor so the change takes effect
+// from the current position
+static void update_stretch() {
+  float speed = tempo_scale * base_tempo_bpm / nominal_tempo_bpm;
+  uint32_t stretch = (uint32_t)(65536.0f / speed);
+  if (stretch == 0) stretch = 1;
+
+  portENTER_CRITICAL(&seq_mux);
+  if (playing && !paused) {
+    uint32_t now = micros();
+    anchor_file = file_pos_at(now);
+    anchor_local = now;
+  }
+  stretch_q16 = stretch;
+  portEXIT_CRITICAL(&seq_mux);
+
+  if (timer_mode && playing && !paused) arm_timer(0);
+}
+
 void midiseq_set_tempo(uint16_t tempo_bpm) {
+  if (tempo_bpm == 0) return;
   base_tempo_bpm = tempo_bpm;
-  calculate_timing((uint16_t)(tempo_bpm * tempo_scale));
-  // Serial.printf("Tempo changed to %d BPM (%d us/tick)\n", 
-  //               tempo_bpm, microsec_per_tick);
+  update_stretch();
 }
 
 void midiseq_set_tempo_scale(float scale) {
   if (scale < 0.1f) scale = 0.1f;
   if (scale > 4.0f) scale = 4.0f;
   tempo_scale = scale;
-  calculate_timing((uint16_t)(base_tempo_bpm * tempo_scale));
+  update_stretch();
 }
 
 void midiseq_set_velocity_scale(float scale) {
@@ -112,218 +450,78 @@ void midiseq_set_transpose(int8_t semitones) {
   transpose = semitones;
 }
 
+void midiseq_set_timer_mode(bool enabled) {
+  if (enabled == timer_mode) return;
+
+  if (seq_timer) esp_timer_stop(seq_timer);
+  timer_mode = enabled;
+  midiseq_reset_jitter_stats();
+
+  // Hand the running sequence over to the new scheduler without a time jump
+  if (enabled && playing && !paused) arm_timer(0);
+}
+
+bool midiseq_get_timer_mode() {
+  return timer_mode;
+}
+
+void midiseq_get_jitter_stats(MidiSeqJitterStats* out) {
+  if (!out) return;
+  portENTER_CRITICAL(&jitter_mux);
+  *out = jitter;
+  portEXIT_CRITICAL(&jitter_mux);
+}
+
+void midiseq_reset_jitter_stats() {
+  portENTER_CRITICAL(&jitter_mux);
+  jitter = MidiSeqJitterStats{};
+  portEXIT_CRITICAL(&jitter_mux);
+}
+
 void midiseq_loop() {
-  if (!playing || paused || !sequence) return;
+  if (timer_mode) {
+    // Stop once the timer has queued the last event and it has been played
+    if (seq_finished && seq_queue.empty()) {
+      midiseq_stop();
+    }
+    return;
+  }
+
+  if (!playing || paused) return;
+  
+  xSemaphoreTake(source_lock, portMAX_DELAY);
+  refill_lookahead();
+  xSemaphoreGive(source_lock);
   
   uint32_t now = micros();
   
   // Process all events that are due
-  while (current_event < num_events && (int32_t)(now - next_event_time) >= 0) {
-    const MidiEvent* evt = &sequence[current_event];
-    
-    // Handle MIDI event
-    uint8_t status = evt->status & 0xF0;  // Upper nibble is message type
-    uint8_t channel = evt->status & 0x0F; // Lower nibble is channel (unused for now)
-    
-    switch (status) {
-      case 0x90: // Note On
-        if (evt->data2 > 0) {  // Velocity > 0 means note on
-          int16_t transposed_note = (int16_t)evt->data1 + transpose;
-          if (transposed_note >= 0 && transposed_note <= 127) {
-            // Scale velocity: first by max_velocity, then by velocity_scale_factor
-            uint16_t vel = (velocity_scale == 127) ? evt->data2 : 
-                          ((uint16_t)evt->data2 * velocity_scale) / 127;
-            vel = (uint16_t)(vel * velocity_scale_factor);
-            if (vel > 127) vel = 127;
-            note_on(transposed_note, (uint8_t)vel);
-          }
-          // Serial.printf("Note ON: %d vel=%d\n", evt->data1, evt->data2);
-        } else {  // Velocity = 0 is actually note off
-          int16_t transposed_note = (int16_t)evt->data1 + transpose;
-          if (transposed_note >= 0 && transposed_note <= 127) {
-            note_off(transposed_note, evt->data2);
-          }
-          // Serial.printf("Note OFF: %d\n", evt->data1);
-        }
-        break;
-        
-      case 0x80: // Note Off
-        {
-          int16_t transposed_note = (int16_t)evt->data1 + transpose;
-          if (transposed_note >= 0 && transposed_note <= 127) {
-            note_off(transposed_note, evt->data2);
-          }
-        }
-        // Serial.printf("Note OFF: %d\n", evt->data1);
-        break;
-        
-      // Other MIDI messages could be handled here:
-      // 0xA0 = Polyphonic aftertouch
-      // 0xB0 = Control change
-      // 0xC0 = Program change
-      // 0xD0 = Channel aftertouch
-      // 0xE0 = Pitch bend
-      
-      default:
-        // Ignore unknown messages
-        break;
-    }
-    
-    // Advance to next event
-    current_event++;
-    
-    // Calculate next event time
-    if (current_event < num_events) {
-      uint32_t delta_usec = sequence[current_event].delta_ticks * microsec_per_tick;
-      next_event_time += delta_usec;
-    }
+  SmfEvent ev;
+  while (lookahead.peek(ev)) {
+    uint32_t due = due_time(ev);
+    if ((int32_t)(now - due) < 0) break;
+    lookahead.pop(ev);
+    record_jitter(micros() - due);
+    dispatch_event(ev.status, ev.data1, ev.data2);
   }
   
   // Check if sequence finished
-  if (current_event >= num_events) {
-    // Serial.println("MIDI sequence finished");
+  if (lookahead.empty() && source_done) {
     midiseq_stop();
   }
 }
 
-// Simple MIDI file parser - loads track 0 only
 bool midiseq_load_from_buffer(const uint8_t* data, size_t size) {
   if (!data || size < 14) return false;
-  
-  // Check MThd header
-  if (data[0] != 'M' || data[1] != 'T' || data[2] != 'h' || data[3] != 'd') {
-    return false;
-  }
-  
-  // Parse header
-  uint16_t format = (data[8] << 8) | data[9];
-  uint16_t num_tracks = (data[10] << 8) | data[11];
-  uint16_t division = (data[12] << 8) | data[13];
-  
-  // We only support format 0 (single track) and format 1 (multiple tracks, use first)
-  if (format > 1) return false;
-  
-  // Division gives us ticks per quarter note
-  if (division & 0x8000) {
-    // SMPTE time division not supported
+
+  SmfStream* stream = new (std::nothrow) SmfStream();
+  if (!stream) return false;
+  if (!stream->open(new (std::nothrow) SmfMemorySource(data, size))) {
+    delete stream;
     return false;
   }
-  uint16_t tpq = division & 0x7FFF;
-  
-  // Find first MTrk
-  size_t pos = 14;
-  while (pos + 8 < size) {
-    if (data[pos] == 'M' && data[pos+1] == 'T' && 
-        data[pos+2] == 'r' && data[pos+3] == 'k') {
-      // Found track
-      uint32_t track_length = (data[pos+4] << 24) | (data[pos+5] << 16) |
-                              (data[pos+6] << 8) | data[pos+7];
-      pos += 8;
-      
-      if (pos + track_length > size) return false;
-      
-      // Parse track events
-      const uint8_t* track_data = data + pos;
-      size_t track_pos = 0;
-      uint8_t running_status = 0;
-      
-      // Count events first (max estimate)
-      static MidiEvent temp_events[1024];
-      uint16_t event_count = 0;
-      
-      while (track_pos < track_length && event_count < 1024) {
-        // Read variable-length delta time
-        uint32_t delta = 0;
-        uint8_t byte;
-        do {
-          if (track_pos >= track_length) break;
-          byte = track_data[track_pos++];
-          delta = (delta << 7) | (byte & 0x7F);
-        } while (byte & 0x80);
-        
-        // Read status byte
-        if (track_pos >= track_length) break;
-        uint8_t status = track_data[track_pos];
-        
-        if (status & 0x80) {
-          // New status byte
-          running_status = status;
-          track_pos++;
-        } else {
-          // Running status
-          status = running_status;
-        }
-        
-        // Skip non-MIDI events
-        if (status == 0xFF) {
-          // Meta event
-          if (track_pos >= track_length) break;
-          uint8_t meta_type = track_data[track_pos++];
-          
-          // Read length
-          uint32_t length = 0;
-          do {
-            if (track_pos >= track_length) break;
-            byte = track_data[track_pos++];
-            length = (length << 7) | (byte & 0x7F);
-          } while (byte & 0x80);
-          
-          track_pos += length;
-          continue;
-        } else if (status == 0xF0 || status == 0xF7) {
-          // SysEx - skip
-          uint32_t length = 0;
-          do {
-            if (track_pos >= track_length) break;
-            byte = track_data[track_pos++];
-            length = (length << 7) | (byte & 0x7F);
-          } while (byte & 0x80);
-          track_pos += length;
-          continue;
-        }
-        
-        // Parse MIDI event
-        uint8_t type = status & 0xF0;
-        
-        // Read data bytes
-        uint8_t data1 = 0, data2 = 0;
-        if (type != 0xC0 && type != 0xD0) {
-          // 2-byte message
-          if (track_pos >= track_length) break;
-          data1 = track_data[track_pos++];
-          if (track_pos >= track_length) break;
-          data2 = track_data[track_pos++];
-        } else {
-          // 1-byte message
-          if (track_pos >= track_length) break;
-          data1 = track_data[track_pos++];
-        }
-        
-        // Store event (only Note On/Off for now)
-        if (type == 0x90 || type == 0x80) {
-          temp_events[event_count].delta_ticks = delta;
-          temp_events[event_count].status = status;
-          temp_events[event_count].data1 = data1;
-          temp_events[event_count].data2 = data2;
-          event_count++;
-        }
-      }
-      
-      // Allocate permanent storage
-      if (event_count > 0) {
-        MidiEvent* events = (MidiEvent*)malloc(event_count * sizeof(MidiEvent));
-        if (events) {
-          memcpy(events, temp_events, event_count * sizeof(MidiEvent));
-          midiseq_load(events, event_count, tpq, 120, 0, 127);
-          midiseq_play();
-          return true;
-        }
-      }
-      
-      return false;
-    }
-    pos++;
-  }
-  
-  return false;
+
+  midiseq_load_source(stream);
+  midiseq_play();
+  return true;
 }
@@ -17,10 +17,18 @@ typedef struct {
   uint8_t data2;         // Second data byte (velocity for note on/off)
 } MidiEvent;
 
+// Event with an absolute timestamp, as produced by streaming sources
+typedef struct {
+  uint32_t time_us;      // Microseconds from sequence start at the source's own tempo
+  uint8_t status;        // MIDI status byte (0x80-0xEF)
+  uint8_t data1;
+  uint8_t data2;
+} SmfEvent;
+
 // Initialize the sequencer
 void midiseq_begin();
 
-// Load a sequence (takes ownership of the event array)
+// Load a sequence (the event array is not copied and must stay valid)
 // events: array of MIDI events
 // num_events: number of events in the array
 // ticks_per_quarter: MIDI ticks per quarter note (typically 480 or 96)
@@ -37,6 +45,9 @@ void midiseq_play();
 // Stop playback
 void midiseq_stop();
 
+// Stop playback and release the loaded sequence or source
+void midiseq_unload();
+
 // Pause/resume playback
 void midiseq_pause();
 void midiseq_resume();
@@ -45,9 +56,42 @@ void midiseq_resume();
 bool midiseq_is_playing();
 
 // Update sequencer (call from main loop)
+// In timer mode this only performs end-of-sequence cleanup; events are
+// dispatched from an esp_timer callback independent of loop() cadence.
 void midiseq_loop();
 
+// Select scheduling mode.
+// true  = timer mode: each event fires from a one-shot esp_timer at its exact
+//         due time and is handed to a high-priority output task (default)
+// false = loop mode: events fire when midiseq_loop() polls (legacy behaviour)
+// Switching modes resets the jitter statistics.
+void midiseq_set_timer_mode(bool enabled);
+bool midiseq_get_timer_mode();
+
+// Dispatch jitter histogram: lateness of each event relative to its
+// scheduled time, measured when note_on/note_off is actually called.
+// counts[i] holds events with lateness < MIDISEQ_JITTER_BOUNDS_US[i];
+// the final bucket holds everything at or above the last bound.
+#define MIDISEQ_JITTER_BUCKETS 8
+extern const uint32_t MIDISEQ_JITTER_BOUNDS_US[MIDISEQ_JITTER_BUCKETS - 1];
+
+typedef struct {
+  uint32_t counts[MIDISEQ_JITTER_BUCKETS];
+  uint32_t events;       // Total events measured
+  uint32_t max_us;       // Worst lateness seen
+  uint64_t total_us;     // Sum of lateness (for the mean)
+  uint32_t overflows;    // Events dropped because the output queue was full
+  uint32_t underruns;    // Timer found the lookahead empty before the source ended
+} MidiSeqJitterStats;
+
+// Copy the current jitter statistics
+void midiseq_get_jitter_stats(MidiSeqJitterStats* out);
+
+// Clear the jitter statistics
+void midiseq_reset_jitter_stats();
+
 // Set tempo during playback
+// For streamed sources this is relative to 120 BPM (the SMF default).
 void midiseq_set_tempo(uint16_t tempo_bpm);
 
 // Set tempo scale (0.1-4.0x)
@@ -59,12 +103,34 @@ void midiseq_set_velocity_scale(float scale);
 // Set transpose in semitones (-12 to +12)
 void midiseq_set_transpose(int8_t semitones);
 
-// Load MIDI file from buffer (parses standard MIDI file format)
+// Load MIDI file from buffer (parses standard MIDI file format) and start playback
+// All tracks are played and the tempo map is honoured. The buffer is streamed,
+// not copied, so it must stay valid until playback stops or another sequence loads.
 // Returns true if successful
 bool midiseq_load_from_buffer(const uint8_t* data, size_t size);
 
 #ifdef __cplusplus
 }
+
+/**
+ * Pull-based event source for streamed playback.
+ * The sequencer reads a bounded lookahead from the source in its reader
+ * task (loop() in loop mode), so next() may do file I/O but must not block
+ * for long.
+ */
+class MidiEventSource {
+public:
+  virtual ~MidiEventSource() {}
+  // Fetch the next event in time order; false at end of sequence
+  virtual bool next(SmfEvent& out) = 0;
+  // Restart from the first event; false if the source cannot restart
+  virtual bool rewind() = 0;
+};
+
+// Load a streaming source (takes ownership; deleted when replaced)
+// Timestamps are played as-is, scaled only by the tempo settings.
+void midiseq_load_source(MidiEventSource* source,
+                         int8_t transpose_semitones = 0, uint8_t max_velocity = 127);
 #endif
 
 #endif // MIDISEQ_H
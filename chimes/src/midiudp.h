@@ -4,13 +4,20 @@
 #include <Arduino.h>
 
 /**
- * MIDI over UDP receiver (MUDP-v1 protocol)
+ * MIDI over UDP receiver (MUDP-v1 and MUDP-v2, docs/MIDIUDP.md)
  * 
- * Implements a simple, stateless UDP-based MIDI protocol:
- * - Fixed 4-byte header: [0x4D 0x55 version count]
+ * Implements a simple UDP-based MIDI protocol:
+ * - 4-byte header: [0x4D 0x55 version count]
  * - Variable message records with full MIDI status bytes
  * - No running status, always explicit status bytes
  * - Supports batching multiple MIDI messages in one packet
+ * 
+ * v1 messages are played as soon as the packet is parsed. v2 adds a
+ * 16-bit packet sequence number, the sender's clock in microseconds and a
+ * microsecond offset per message. v2 messages wait in a playout buffer
+ * and are played at their sender time plus a fixed delay, so WiFi jitter
+ * and reordering shorter than the delay never reach the music. Lost,
+ * reordered and duplicate packets are counted from the sequence numbers.
  */
 class MIDIoverUDP {
 public:
@@ -26,6 +33,12 @@ public:
      */
     void update();
     
+    /**
+     * Handle one packet that arrived some other way than UDP (the /ws
+     * WebSocket). Counted with the UDP packets. Call from the main loop.
+     */
+    void receive(const uint8_t* data, size_t length);
+    
     /**
      * Stop UDP receiver
      */
@@ -47,10 +60,37 @@ public:
     uint32_t getPacketsReceived() const { return packetsReceived; }
     uint32_t getMessagesReceived() const { return messagesReceived; }
     uint32_t getPacketsDropped() const { return packetsDropped; }
+    
+    /**
+     * v2 statistics. Lost packets that turn up late are taken back off
+     * packetsLost and counted as reordered.
+     */
+    uint32_t getPacketsLost() const { return packetsLost; }
+    uint32_t getPacketsReordered() const { return packetsReordered; }
+    uint32_t getPacketsDuplicate() const { return packetsDuplicate; }
+    uint32_t getMessagesLate() const { return messagesLate; }          // Arrived after their playout time
+    uint32_t getBufferOverflows() const { return bufferOverflows; }    // Played early, buffer full
+    uint8_t getMessagesQueued() const { return queued; }
+    
+    /**
+     * Playout delay for v2 messages, 0-MAX_PLAYOUT_DELAY_MS; loaded from NVS
+     * by begin(). Longer rides out worse WiFi at the cost of latency. Set
+     * it from the main loop; savePlayoutDelay() may run on any task.
+     */
+    void setPlayoutDelayMs(uint16_t ms);
+    uint16_t getPlayoutDelayMs() const { return playoutDelayMs; }
+    void savePlayoutDelay();
+    
+    static const uint16_t DEFAULT_PLAYOUT_DELAY_MS = 30;
+    static const uint16_t MAX_PLAYOUT_DELAY_MS = 500;
 
 private:
-    void handlePacket(uint8_t* data, size_t length);
+    void handlePacket(const uint8_t* data, size_t length);
     void handleMIDIMessage(uint8_t status, uint8_t data1, uint8_t data2);
+    bool trackSequence(uint16_t seq, bool restart);
+    uint32_t playoutTime(uint32_t sent, uint32_t now, bool restart);
+    void schedule(uint32_t due, uint8_t status, uint8_t data1, uint8_t data2);
+    void releaseDue();
     
     uint16_t port;
     bool listening;
@@ -59,13 +99,42 @@ private:
     uint32_t packetsReceived;
     uint32_t messagesReceived;
     uint32_t packetsDropped;
+    uint32_t packetsLost;
+    uint32_t packetsReordered;
+    uint32_t packetsDuplicate;
+    uint32_t messagesLate;
+    uint32_t bufferOverflows;
+    
+    // v2 stream: sequence numbers and the sender's clock
+    bool v2Started;
+    uint16_t highSeq;          // Highest sequence number seen
+    uint32_t seqSeen;          // Bit n set: highSeq - n has arrived
+    uint32_t lastV2Us;         // Local time of the last v2 packet
+    uint32_t clockBase;        // Local minus sender time of the quickest recent packet
+    uint32_t windowMin;        // Quickest packet since windowStart
+    uint32_t windowStart;
+    uint16_t playoutDelayMs;
+    
+    // v2 messages waiting for their playout time, earliest first
+    struct Scheduled {
+        uint32_t due;
+        uint8_t status, data1, data2;
+    };
+    static const uint8_t QUEUE_LEN = 64;
+    Scheduled queue[QUEUE_LEN];
+    uint8_t queued;
     
     // Protocol constants
     static const uint8_t MAGIC_M = 0x4D;  // 'M'
     static const uint8_t MAGIC_U = 0x55;  // 'U'
     static const uint8_t VERSION = 0x01;
+    static const uint8_t VERSION_2 = 0x02;
     static const size_t MIN_PACKET_SIZE = 4;  // Header only
+    static const size_t V2_HEADER_SIZE = 10;  // + sequence number and sender time
     static const size_t MAX_PACKET_SIZE = 1024;
+    static const uint32_t RESTART_IDLE_US = 2000000;  // A quiet v2 stream starts afresh
+    static const uint16_t RESTART_SEQ_JUMP = 1000;    // As does one whose sequence jumps
+    static const uint32_t CLOCK_WINDOW_US = 2000000;  // How often clockBase follows drift
 };
 
 // Global instance
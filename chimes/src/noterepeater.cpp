@@ -36,9 +36,9 @@ void noterepeater_loop() {
       // Strike the note (note_on followed immediately by note_off)
       note_on(repeating_notes[i].note, repeating_notes[i].velocity);
       note_off(repeating_notes[i].note, 64);
-      Log.printf("Repeater: Struck note %d (vel=%d, period=%dms, count=%d)\n",
-                 repeating_notes[i].note, repeating_notes[i].velocity, 
-                 repeating_notes[i].period_ms, repeating_notes[i].repeat_count);
+      LOG_DEBUG("Repeater: Struck note %d (vel=%d, period=%dms, count=%d)\n",
+                repeating_notes[i].note, repeating_notes[i].velocity, 
+                repeating_notes[i].period_ms, repeating_notes[i].repeat_count);
       
       // Schedule next strike
       repeating_notes[i].next_strike = now + repeating_notes[i].period_ms;
@@ -49,7 +49,7 @@ void noterepeater_loop() {
         if (repeating_notes[i].repeat_count == 0) {
           // Done repeating
           repeating_notes[i].active = false;
-          Log.printf("Repeater: Note %d finished (count expired)\n", repeating_notes[i].note);
+          LOG_DEBUG("Repeater: Note %d finished (count expired)\n", repeating_notes[i].note);
         }
       }
     }
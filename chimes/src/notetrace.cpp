@@ -0,0 +1,232 @@
+// notetrace.cpp - Note latency tracing (see notetrace.h)
+#include "notetrace.h"
+
+#ifdef NOTE_TRACE
+
+#include <algorithm>
+#include "esp_ipc.h"
+#include "esp_timer.h"
+
+NoteTraceRing noteTraceRings[portNUM_PROCESSORS];
+
+// Ring position each core's records start from after notetrace_clear()
+static uint32_t clearFrom[portNUM_PROCESSORS];
+
+// A stage more than this long after the RX is not counted as that note's
+// path (the sequencer and the web UI call the handler with no RX before it)
+#define CHAIN_LIMIT_US 100000
+
+// Pending notes waiting for the next latch
+#define MAX_PENDING 16
+
+static const char* const STAGE_NAMES[NT_STAGES] = {
+  "rx", "parse", "handler", "mapping", "output", "latch"
+};
+
+const char* notetrace_stage_name(uint8_t stage) {
+  return stage < NT_STAGES ? STAGE_NAMES[stage] : "?";
+}
+
+// ---------- Snapshot ----------
+// CCOUNT is per core and the two counters are not in step, so each core's
+// marks are placed on the esp_timer time line through a (time, CCOUNT,
+// tick) triple taken on that core. The tick picks the CCOUNT wrap; the
+// cycle count keeps the resolution.
+
+struct Calibration {
+  int64_t us;
+  uint32_t cycles;
+  uint32_t tick;
+};
+
+static void calibrate(void* arg) {
+  static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+  Calibration* c = (Calibration*)arg;
+  portENTER_CRITICAL(&mux);
+  c->us = esp_timer_get_time();
+  c->cycles = esp_cpu_get_cycle_count();
+  c->tick = xTaskGetTickCount();
+  portEXIT_CRITICAL(&mux);
+}
+
+struct Mark {
+  int64_t t;        // CPU cycles on the esp_timer time line
+  uint8_t stage;
+  uint8_t note;
+  uint8_t core;
+};
+
+// Only the HTTP handler reads the rings, so one static copy will do
+static Mark marks[portNUM_PROCESSORS * NOTE_TRACE_RECORDS];
+
+static int snapshot(uint32_t mhz) {
+  int n = 0;
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    Calibration cal;
+    esp_ipc_call_blocking(core, calibrate, &cal);
+    int64_t base = cal.us * mhz;
+
+    NoteTraceRing& r = noteTraceRings[core];
+    uint32_t head = r.head.load(std::memory_order_acquire);
+    uint32_t avail = head - clearFrom[core];
+    if (avail > NOTE_TRACE_RECORDS) avail = NOTE_TRACE_RECORDS;
+
+    for (uint32_t i = head - avail; i != head; i++) {
+      const NoteTraceRecord& e = r.rec[i & (NOTE_TRACE_RECORDS - 1)];
+      uint32_t seq = __atomic_load_n(&e.seq, __ATOMIC_ACQUIRE);
+      NoteTraceRecord copy;
+      copy.cycles = e.cycles;
+      copy.tick = e.tick;
+      copy.stage = e.stage;
+      copy.note = e.note;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq != i + 1 || __atomic_load_n(&e.seq, __ATOMIC_RELAXED) != seq) continue;  // Overwritten meanwhile
+
+      int64_t expect = (int64_t)(int32_t)(copy.tick - cal.tick) * portTICK_PERIOD_MS * 1000 * mhz;
+      int64_t delta = (int64_t)(uint32_t)(copy.cycles - cal.cycles);
+      int64_t wraps = (expect - delta + (1LL << 31)) >> 32;   // Nearest whole number of wraps
+      marks[n].t = base + delta + (wraps << 32);
+      marks[n].stage = copy.stage;
+      marks[n].note = copy.note;
+      marks[n].core = (uint8_t)core;
+      n++;
+    }
+  }
+  std::sort(marks, marks + n, [](const Mark& a, const Mark& b) { return a.t < b.t; });
+  return n;
+}
+
+// ---------- Chains ----------
+// A PARSE starts a note's chain at the newest RX; HANDLER, MAPPING and
+// OUTPUT extend it, and an OUTPUT leaves it waiting for the next LATCH.
+// emit(stage, rxT, t, note) is called once for every stage a chain reaches.
+
+struct Chain {
+  int64_t rx;
+  uint8_t note;
+};
+
+template <typename Emit>
+static uint32_t follow(int n, uint32_t mhz, Emit emit) {
+  const int64_t limit = (int64_t)CHAIN_LIMIT_US * mhz;
+  int64_t rx = 0;
+  bool haveRx = false;
+  Chain cur = {};
+  bool inChain = false;
+  uint8_t seen = 0;
+  Chain pending[MAX_PENDING];
+  int numPending = 0;
+  uint32_t chains = 0;
+
+  for (int i = 0; i < n; i++) {
+    const Mark& m = marks[i];
+    switch (m.stage) {
+      case NT_RX:
+        rx = m.t;
+        haveRx = true;
+        break;
+
+      case NT_PARSE:
+        inChain = haveRx && m.t - rx <= limit;
+        if (inChain) {
+          cur.rx = rx;
+          cur.note = m.note;
+          seen = 1 << NT_PARSE;
+          chains++;
+          emit(NT_PARSE, cur, m.t);
+        }
+        break;
+
+      case NT_LATCH:
+        for (int p = 0; p < numPending; p++) {
+          if (m.t - pending[p].rx <= limit) emit(NT_LATCH, pending[p], m.t);
+        }
+        numPending = 0;
+        break;
+
+      default:
+        // A stage seen twice is a second note without an RX of its own
+        if (!inChain || (seen & (1 << m.stage)) || m.t - cur.rx > limit) {
+          inChain = false;
+          break;
+        }
+        seen |= 1 << m.stage;
+        if (cur.note == NT_NO_NOTE) cur.note = m.note;
+        emit(m.stage, cur, m.t);
+        if (m.stage == NT_OUTPUT) {
+          if (numPending < MAX_PENDING) pending[numPending++] = cur;
+          inChain = false;
+        }
+        break;
+    }
+  }
+  return chains;
+}
+
+// ---------- Public ----------
+
+#define MAX_SAMPLES (portNUM_PROCESSORS * NOTE_TRACE_RECORDS / 2)
+static uint32_t samples[NT_STAGES][MAX_SAMPLES];
+
+void notetrace_get_stats(NoteTraceStats* out) {
+  if (!out) return;
+  uint32_t mhz = getCpuFrequencyMhz();
+  int n = snapshot(mhz);
+
+  uint32_t count[NT_STAGES] = {};
+  out->records = n;
+  out->chains = follow(n, mhz, [&](uint8_t stage, const Chain& c, int64_t t) {
+    if (count[stage] < MAX_SAMPLES) samples[stage][count[stage]++] = (uint32_t)(t - c.rx);
+  });
+
+  for (int s = 0; s < NT_STAGES; s++) {
+    NoteTraceStageStats& st = out->stage[s];
+    uint32_t k = count[s];
+    std::sort(samples[s], samples[s] + k);
+    st.samples = k;
+    st.p50Us = k ? (float)samples[s][k * 50 / 100] / mhz : 0;
+    st.p99Us = k ? (float)samples[s][k * 99 / 100] / mhz : 0;
+    st.maxUs = k ? (float)samples[s][k - 1] / mhz : 0;
+  }
+}
+
+void notetrace_write_json(Print& out) {
+  uint32_t mhz = getCpuFrequencyMhz();
+  int n = snapshot(mhz);
+  int64_t t0 = n ? marks[0].t : 0;
+
+  out.print("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    out.printf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"core %d\"}},",
+               core, core);
+  }
+  out.printf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"notes\"}}",
+             portNUM_PROCESSORS);
+
+  for (int i = 0; i < n; i++) {
+    const Mark& m = marks[i];
+    out.printf(",{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"ts\":%.3f",
+               notetrace_stage_name(m.stage), m.core, (double)(m.t - t0) / mhz);
+    if (m.note != NT_NO_NOTE) out.printf(",\"args\":{\"note\":%d}", m.note);
+    out.print("}");
+  }
+
+  // One span per note from RX to the latch that made it sound
+  follow(n, mhz, [&](uint8_t stage, const Chain& c, int64_t t) {
+    if (stage != NT_LATCH) return;
+    char name[12];
+    if (c.note == NT_NO_NOTE) snprintf(name, sizeof(name), "frame");
+    else snprintf(name, sizeof(name), "note %d", c.note);
+    out.printf(",{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+               name, portNUM_PROCESSORS, (double)(c.rx - t0) / mhz, (double)(t - c.rx) / mhz);
+  });
+  out.print("]}");
+}
+
+void notetrace_clear() {
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    clearFrom[core] = noteTraceRings[core].head.load(std::memory_order_acquire);
+  }
+}
+
+#endif // NOTE_TRACE
@@ -0,0 +1,101 @@
+// notetrace.h - Note latency tracing from input to actuator edge
+//
+// Build with -DNOTE_TRACE (see platformio.ini) and every stage a note
+// passes through leaves a (stage, cycle count, note) mark in a lock-free
+// ring for the core it ran on. GET /trace returns the rings as Chrome
+// trace JSON (chrome://tracing, ui.perfetto.dev) and GET /status adds
+// p50/p99/max latency from input to each stage.
+//
+// Without NOTE_TRACE the marks compile to nothing and the rest of this
+// file is not built, so the default build carries no cost.
+#ifndef NOTETRACE_H
+#define NOTETRACE_H
+
+#include <Arduino.h>
+
+// Pipeline stages, in the order a note passes them
+enum NoteTraceStage : uint8_t {
+  NT_RX,        // Input picked up: UART bytes read, UDP packet, CAN frame
+  NT_PARSE,     // One message decoded
+  NT_HANDLER,   // handle_midi_message()
+  NT_MAPPING,   // Note resolved to an output or chime
+  NT_OUTPUT,    // Output state changed (setChannel, output_merge, ring_chime)
+  NT_LATCH,     // Actuator edge: 74HC595 latch, chime PWM duty set
+  NT_STAGES
+};
+
+#define NT_NO_NOTE 0xFF   // Mark that is not about one note (packet, frame, latch)
+
+#ifdef NOTE_TRACE
+
+#include <atomic>
+#include "esp_cpu.h"
+
+#define NOTE_TRACE_RECORDS 512   // Per core; power of two
+
+struct NoteTraceRecord {
+  uint32_t cycles;   // CCOUNT of the core that made the mark
+  uint32_t tick;     // FreeRTOS tick at the mark; unwraps cycles (CCOUNT wraps every ~18 s)
+  uint32_t seq;      // Ring position + 1, written last; 0 while the record is being written
+  uint8_t stage;
+  uint8_t note;
+};
+
+struct NoteTraceRing {
+  std::atomic<uint32_t> head;
+  NoteTraceRecord rec[NOTE_TRACE_RECORDS];
+};
+
+extern NoteTraceRing noteTraceRings[portNUM_PROCESSORS];
+
+// Only the owning core writes a ring; the slot claim is atomic so an ISR
+// can mark in the middle of a task's mark
+static inline void IRAM_ATTR notetrace_mark(uint8_t stage, uint8_t note, bool fromIsr) {
+  NoteTraceRing& r = noteTraceRings[xPortGetCoreID()];
+  uint32_t i = r.head.fetch_add(1, std::memory_order_relaxed);
+  NoteTraceRecord& e = r.rec[i & (NOTE_TRACE_RECORDS - 1)];
+  __atomic_store_n(&e.seq, 0, __ATOMIC_RELAXED);
+  std::atomic_thread_fence(std::memory_order_release);
+  e.cycles = esp_cpu_get_cycle_count();
+  e.tick = fromIsr ? xTaskGetTickCountFromISR() : xTaskGetTickCount();
+  e.stage = stage;
+  e.note = note;
+  __atomic_store_n(&e.seq, i + 1, __ATOMIC_RELEASE);
+}
+
+#define NOTE_MARK(stage, note)     notetrace_mark((stage), (note), false)
+#define NOTE_MARK_ISR(stage, note) notetrace_mark((stage), (note), true)
+
+// Latency from a note's RX to each stage over the records in the rings
+struct NoteTraceStageStats {
+  uint32_t samples;
+  float p50Us;
+  float p99Us;
+  float maxUs;
+};
+
+struct NoteTraceStats {
+  uint32_t records;   // Marks in the rings
+  uint32_t chains;    // RX-to-stage paths that were followed
+  NoteTraceStageStats stage[NT_STAGES];   // stage[NT_RX] is always empty
+};
+
+const char* notetrace_stage_name(uint8_t stage);
+
+void notetrace_get_stats(NoteTraceStats* out);
+
+// Chrome trace JSON: one instant event per mark on a track per core, and
+// one span per note from its RX to its latch on a third track
+void notetrace_write_json(Print& out);
+
+// Forget everything marked so far
+void notetrace_clear();
+
+#else
+
+#define NOTE_MARK(stage, note)     ((void)0)
+#define NOTE_MARK_ISR(stage, note) ((void)0)
+
+#endif // NOTE_TRACE
+
+#endif // NOTETRACE_H
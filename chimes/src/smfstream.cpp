@@ -0,0 +1,252 @@
+// smfstream.cpp - Streaming Standard MIDI File reader
+#include "smfstream.h"
+#include <string.h>
+#include <new>
+
+size_t SmfMemorySource::read(uint32_t offset, uint8_t* dst, size_t n) {
+  if (offset >= len) return 0;
+  if (n > len - offset) n = len - offset;
+  memcpy(dst, data + offset, n);
+  return n;
+}
+
+static uint32_t be32(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+SmfStream::~SmfStream() {
+  close();
+}
+
+void SmfStream::close() {
+  delete[] tracks;
+  tracks = nullptr;
+  numTracks = 0;
+  delete src;
+  src = nullptr;
+}
+
+bool SmfStream::open(SmfSource* source) {
+  close();
+  src = source;
+  if (!src) return false;
+
+  uint8_t hdr[14];
+  if (src->read(0, hdr, sizeof(hdr)) != sizeof(hdr)) return false;
+
+  // Check MThd header
+  if (memcmp(hdr, "MThd", 4) != 0) return false;
+  uint32_t hdr_len = be32(hdr + 4);
+  format = (hdr[8] << 8) | hdr[9];
+  uint16_t declared_tracks = (hdr[10] << 8) | hdr[11];
+  uint16_t division = (hdr[12] << 8) | hdr[13];
+
+  // Format 2 (independent sequences) has no shared timeline
+  if (format > 1) return false;
+
+  // SMPTE time division not supported
+  if (division & 0x8000) return false;
+  tpq = division & 0x7FFF;
+  if (tpq == 0) return false;
+
+  if (declared_tracks == 0) return false;
+  if (declared_tracks > MAX_TRACKS) declared_tracks = MAX_TRACKS;
+
+  tracks = new (std::nothrow) Track[declared_tracks];
+  if (!tracks) return false;
+
+  // Walk the chunk list, keeping MTrk chunks and skipping unknown ones
+  uint32_t file_size = src->size();
+  uint32_t pos = 8 + hdr_len;
+  while (numTracks < declared_tracks && pos + 8 <= file_size) {
+    uint8_t chunk[8];
+    if (src->read(pos, chunk, 8) != 8) break;
+    uint32_t len = be32(chunk + 4);
+    uint32_t body = pos + 8;
+    uint32_t end = (len > file_size - body) ? file_size : body + len;  // Tolerate truncated files
+
+    if (memcmp(chunk, "MTrk", 4) == 0) {
+      Track& t = tracks[numTracks++];
+      t.start = body;
+      t.end = end;
+    }
+    pos = end;
+  }
+
+  if (numTracks == 0) {
+    close();
+    return false;
+  }
+
+  return rewind();
+}
+
+bool SmfStream::rewind() {
+  if (!tracks) return false;
+
+  tempoTick = 0;
+  tempoMicros = 0;
+  usPerQuarter = 500000;
+
+  for (uint16_t i = 0; i < numTracks; i++) {
+    Track& t = tracks[i];
+    t.pos = t.start;
+    t.abs_tick = 0;
+    t.running_status = 0;
+    t.win_start = t.start;
+    t.win_len = 0;
+    decodeNext(t);
+  }
+  return true;
+}
+
+// Fetch one byte through the track's read window
+bool SmfStream::readByte(Track& t, uint8_t& b) {
+  if (t.pos >= t.end) return false;
+  if (t.pos < t.win_start || t.pos >= t.win_start + t.win_len) {
+    uint32_t want = t.end - t.pos;
+    if (want > WINDOW_SIZE) want = WINDOW_SIZE;
+    t.win_start = t.pos;
+    t.win_len = (uint8_t)src->read(t.pos, t.window, want);
+    if (t.win_len == 0) return false;
+  }
+  b = t.window[t.pos - t.win_start];
+  t.pos++;
+  return true;
+}
+
+bool SmfStream::readVarLen(Track& t, uint32_t& v) {
+  v = 0;
+  for (int i = 0; i < 4; i++) {
+    uint8_t b;
+    if (!readByte(t, b)) return false;
+    v = (v << 7) | (b & 0x7F);
+    if (!(b & 0x80)) return true;
+  }
+  return false;  // Malformed (more than 4 bytes)
+}
+
+// Decode events from the track until one worth merging is found
+void SmfStream::decodeNext(Track& t) {
+  for (;;) {
+    uint32_t delta;
+    uint8_t b;
+    if (!readVarLen(t, delta) || !readByte(t, b)) {
+      t.pending = Pending::END;
+      return;
+    }
+    t.abs_tick += delta;
+
+    uint8_t status;
+    bool have_data1 = false;
+    uint8_t data1 = 0;
+    if (b & 0x80) {
+      status = b;
+    } else {
+      // Running status: b is already the first data byte
+      status = t.running_status;
+      data1 = b;
+      have_data1 = true;
+      if (status == 0) {
+        t.pending = Pending::END;  // Data byte with no status - corrupt track
+        return;
+      }
+    }
+
+    if (status == 0xFF) {
+      // Meta event
+      uint8_t type;
+      uint32_t len;
+      if (!readByte(t, type) || !readVarLen(t, len)) {
+        t.pending = Pending::END;
+        return;
+      }
+      if (type == 0x2F) {
+        // End of track
+        t.pending = Pending::END;
+        return;
+      }
+      if (type == 0x51 && len == 3) {
+        uint8_t a, c, d;
+        if (!readByte(t, a) || !readByte(t, c) || !readByte(t, d)) {
+          t.pending = Pending::END;
+          return;
+        }
+        t.tempo = ((uint32_t)a << 16) | ((uint32_t)c << 8) | d;
+        t.pending = Pending::TEMPO;
+        return;
+      }
+      t.pos += len;  // Skip other meta events
+      continue;
+    }
+
+    if (status == 0xF0 || status == 0xF7) {
+      // SysEx - skip
+      uint32_t len;
+      if (!readVarLen(t, len)) {
+        t.pending = Pending::END;
+        return;
+      }
+      t.pos += len;
+      continue;
+    }
+
+    // Channel voice message
+    t.running_status = status;
+    uint8_t type = status & 0xF0;
+    if (!have_data1 && !readByte(t, data1)) {
+      t.pending = Pending::END;
+      return;
+    }
+    uint8_t data2 = 0;
+    if (type != 0xC0 && type != 0xD0) {
+      if (!readByte(t, data2)) {
+        t.pending = Pending::END;
+        return;
+      }
+    }
+    t.status = status;
+    t.data1 = data1;
+    t.data2 = data2;
+    t.pending = Pending::CHANNEL;
+    return;
+  }
+}
+
+uint64_t SmfStream::tickToMicros(uint32_t tick) const {
+  return tempoMicros + (uint64_t)(tick - tempoTick) * usPerQuarter / tpq;
+}
+
+bool SmfStream::next(SmfEvent& out) {
+  if (!tracks) return false;
+
+  for (;;) {
+    // Pick the track whose pending event is earliest. Ties go to the lower
+    // track index so tempo changes in the conductor track apply first.
+    int best = -1;
+    for (uint16_t i = 0; i < numTracks; i++) {
+      const Track& t = tracks[i];
+      if (t.pending == Pending::END || t.pending == Pending::NONE) continue;
+      if (best < 0 || t.abs_tick < tracks[best].abs_tick) best = i;
+    }
+    if (best < 0) return false;
+
+    Track& t = tracks[best];
+    uint64_t us = tickToMicros(t.abs_tick);
+
+    if (t.pending == Pending::TEMPO) {
+      tempoMicros = us;
+      tempoTick = t.abs_tick;
+      if (t.tempo > 0) usPerQuarter = t.tempo;
+      decodeNext(t);
+      continue;
+    }
+
+    out.time_us = (uint32_t)us;
+    out.status = t.status;
+    out.data1 = t.data1;
+    out.data2 = t.data2;
+    decodeNext(t);
+    return true;
+  }
+}
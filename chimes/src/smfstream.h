@@ -0,0 +1,103 @@
+// smfstream.h - Streaming Standard MIDI File reader
+#ifndef SMFSTREAM_H
+#define SMFSTREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "midiseq.h"
+
+/**
+ * Random-access byte source for an SMF (memory buffer, SPIFFS file, ...)
+ */
+class SmfSource {
+public:
+  virtual ~SmfSource() {}
+  // Copy up to len bytes starting at offset; returns bytes copied
+  virtual size_t read(uint32_t offset, uint8_t* dst, size_t len) = 0;
+  virtual uint32_t size() const = 0;
+};
+
+/**
+ * SmfSource over a buffer in memory (RAM or memory-mapped flash).
+ * The buffer is not copied and must outlive the source.
+ */
+class SmfMemorySource : public SmfSource {
+public:
+  SmfMemorySource(const uint8_t* data, size_t size) : data(data), len(size) {}
+  size_t read(uint32_t offset, uint8_t* dst, size_t n) override;
+  uint32_t size() const override { return len; }
+
+private:
+  const uint8_t* data;
+  size_t len;
+};
+
+/**
+ * Streaming SMF player front-end.
+ *
+ * Supports format 0 and 1 files. All MTrk chunks are merged by absolute
+ * tick (k-way merge, one cursor per track) and converted to absolute
+ * microseconds by following the Set Tempo (FF 51) map. Events are decoded
+ * on demand from a small per-track read window, so memory use is
+ * proportional to the number of tracks, not the number of events.
+ */
+class SmfStream : public MidiEventSource {
+public:
+  static const uint16_t MAX_TRACKS = 32;
+
+  SmfStream() {}
+  ~SmfStream() override;
+
+  /**
+   * Parse the header and locate all tracks.
+   * Takes ownership of src (deleted on close or destruction).
+   * @return false if the data is not a supported SMF
+   */
+  bool open(SmfSource* src);
+  void close();
+
+  // MidiEventSource
+  bool next(SmfEvent& out) override;
+  bool rewind() override;
+
+  uint16_t getTrackCount() const { return numTracks; }
+  uint16_t getTicksPerQuarter() const { return tpq; }
+  uint16_t getFormat() const { return format; }
+
+private:
+  static const uint8_t WINDOW_SIZE = 32;
+
+  enum class Pending : uint8_t { NONE, CHANNEL, TEMPO, END };
+
+  struct Track {
+    uint32_t start;         // Offset of first event byte
+    uint32_t end;           // Offset one past the last byte
+    uint32_t pos;           // Next byte to decode
+    uint32_t abs_tick;      // Absolute tick of the pending event
+    uint8_t running_status;
+    Pending pending;        // Decoded event waiting to be merged
+    uint8_t status, data1, data2;
+    uint32_t tempo;         // For Pending::TEMPO
+    uint32_t win_start;     // File offset of window[0]
+    uint8_t win_len;
+    uint8_t window[WINDOW_SIZE];
+  };
+
+  bool readByte(Track& t, uint8_t& b);
+  bool readVarLen(Track& t, uint32_t& v);
+  void decodeNext(Track& t);
+  uint64_t tickToMicros(uint32_t tick) const;
+
+  SmfSource* src = nullptr;
+  Track* tracks = nullptr;
+  uint16_t numTracks = 0;
+  uint16_t format = 0;
+  uint16_t tpq = 480;
+
+  // Tempo map state: time of the most recent tempo change
+  uint32_t tempoTick = 0;
+  uint64_t tempoMicros = 0;
+  uint32_t usPerQuarter = 500000;  // 120 BPM until the first FF 51
+};
+
+#endif // SMFSTREAM_H
@@ -0,0 +1,71 @@
+// spsc_ring.h - Lock-free single-producer / single-consumer ring buffer
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Fixed-capacity ring with no locks and no allocation.
+// Exactly one context may call push() and exactly one may call pop();
+// they may run on different tasks, cores, or in a timer callback.
+// N must be a power of two. Usable capacity is N - 1 entries.
+template <typename T, uint32_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+  // Producer side. Returns false (and drops the item) when full.
+  bool push(const T& item) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t next = (h + 1) & (N - 1);
+    if (next == tail.load(std::memory_order_acquire)) return false;
+    buf[h] = item;
+    head.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false when empty.
+  bool pop(T& out) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) return false;
+    out = buf[t];
+    tail.store((t + 1) & (N - 1), std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Copies the oldest item without removing it.
+  bool peek(T& out) const {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) return false;
+    out = buf[t];
+    return true;
+  }
+
+  // Producer side. True when push() would fail.
+  bool full() const {
+    uint32_t next = (head.load(std::memory_order_relaxed) + 1) & (N - 1);
+    return next == tail.load(std::memory_order_acquire);
+  }
+
+  // Discard everything. Only safe while neither side is running.
+  void reset() {
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_release);
+  }
+
+  bool empty() const {
+    return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+  }
+
+  // Approximate fill level (exact when called from either endpoint)
+  uint32_t size() const {
+    return (head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire)) & (N - 1);
+  }
+
+private:
+  T buf[N];
+  std::atomic<uint32_t> head{0};
+  std::atomic<uint32_t> tail{0};
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,47 @@
+// webasset.h - Static pages served gzip-compressed from flash
+//
+// utilities/gzip_pages.py runs before every build (extra_scripts in
+// platformio.ini) and gzips each raw-string page in src/ into web_assets.h
+// in the build directory, one WebAsset per page named after its array:
+// API_DOCS_HTML in api_docs.h is served as API_DOCS_HTML_GZ. Edit the pages
+// where they are; the compressed copies follow on the next build.
+//
+// Browsers keep a copy but revalidate it on every visit (no-cache): they ask
+// with If-None-Match and get a bodiless 304 while the page is unchanged. A
+// firmware with a different page has a different ETag, so an OTA update
+// shows up on the next visit.
+// Every browser accepts gzip; use curl --compressed to read a page by hand.
+#ifndef WEBASSET_H
+#define WEBASSET_H
+
+#include <Arduino.h>
+#include <WebServer.h>
+
+#define WEBASSET_CACHE_CONTROL "no-cache"
+
+struct WebAsset {
+  const uint8_t* gz;         // gzip stream in flash
+  size_t len;
+  const char* etag;          // Quoted, as it goes in the ETag header
+  const char* contentType;
+};
+
+// Keep the If-None-Match request header, which WebServer drops unless asked.
+// Call before server.begin().
+static inline void webasset_begin(WebServer& server) {
+  static const char* headers[] = { "If-None-Match" };
+  server.collectHeaders(headers, 1);
+}
+
+static inline void webasset_send(WebServer& server, const WebAsset& a) {
+  server.sendHeader("ETag", a.etag);
+  server.sendHeader("Cache-Control", WEBASSET_CACHE_CONTROL);
+  if (server.header("If-None-Match").indexOf(a.etag) >= 0) {
+    server.send(304);
+    return;
+  }
+  server.sendHeader("Content-Encoding", "gzip");
+  server.send_P(200, a.contentType, (const char*)a.gz, a.len);
+}
+
+#endif // WEBASSET_H
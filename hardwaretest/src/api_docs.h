@@ -102,6 +102,7 @@ const char API_DOCS_HTML[] = R"rawliteral(
         <ul>
             <li><a href="#clock">Clock Chimes</a></li>
             <li><a href="#time">Time Management</a></li>
+            <li><a href="#can">CAN Analyzer</a></li>
             <li><a href="#notes">MIDI Notes</a></li>
             <li><a href="#sequencer">MIDI Sequencer</a></li>
             <li><a href="#repeater">Note Repeater</a></li>
@@ -348,6 +349,45 @@ Response: {
         <div class="example">Example: /time/ntp?server=pool.ntp.org</div>
     </div>
 
+    <h2 id="can">CAN Analyzer</h2>
+
+    <div class="endpoint">
+        <span class="method get">GET</span>
+        <span class="path">/can/stats</span>
+        <div class="description">Bus utilisation, inter-frame gaps, per-ID rates and echo round-trip times</div>
+        <div class="example">Example: /can/stats</div>
+    </div>
+
+    <div class="endpoint">
+        <span class="method post">POST</span>
+        <span class="path">/can/stream</span>
+        <div class="description">Stream timestamped frames and a 1 s summary as binary UDP (decode with utilities/can_capture.py)</div>
+        <div class="params">
+            <strong>Parameters:</strong><br>
+            <span class="param">port</span> - UDP port on the host (0 stops streaming)<br>
+            <span class="param">host</span> - Destination IP (optional, default=requesting client)
+        </div>
+        <div class="example">Example: /can/stream?port=5555</div>
+    </div>
+
+    <div class="endpoint">
+        <span class="method post">POST</span>
+        <span class="path">/can/echo</span>
+        <div class="description">Send an ECHO_REQ periodically to measure round-trip latency to every node</div>
+        <div class="params">
+            <strong>Parameters:</strong><br>
+            <span class="param">interval_ms</span> - Interval in milliseconds (0 stops, max 60000)
+        </div>
+        <div class="example">Example: /can/echo?interval_ms=100</div>
+    </div>
+
+    <div class="endpoint">
+        <span class="method post">POST</span>
+        <span class="path">/can/reset</span>
+        <div class="description">Clear all CAN analyzer statistics</div>
+        <div class="example">Example: /can/reset</div>
+    </div>
+
     <h2 id="notes">MIDI Notes</h2>
 
     <div class="endpoint">
@@ -596,8 +636,15 @@ Response: {"success":true,"message":"Playback started"}
     <div class="endpoint">
         <span class="method get">GET</span>
         <span class="path">/logs/poll</span>
-        <div class="description">Poll for new log entries (used by /logs page)</div>
-        <div class="example">Example: /logs/poll</div>
+        <div class="description">New log lines as JSON; pass the returned index as since on the next poll</div>
+        <div class="example">Example: /logs/poll?since=0</div>
+    </div>
+
+    <div class="endpoint">
+        <span class="method get">GET</span>
+        <span class="path">/logs/stream</span>
+        <div class="description">Server-Sent Events stream of the log (used by /logs page): the lines still buffered, then new lines as they are logged. Reconnect with since set to the last event id.</div>
+        <div class="example">Example: curl -N /logs/stream?since=0</div>
     </div>
 
     <hr>
@@ -17,7 +17,8 @@ void can_bus_begin() {
     );
     // Small TX queue is enough for proof-of-concept; increase if needed.
     g_config.tx_queue_len = 8;
-    g_config.rx_queue_len = 8;
+    // Deep enough for the analyzer's capture task to ride out a busy bus
+    g_config.rx_queue_len = 64;
 
     twai_timing_config_t t_config = TWAI_TIMING_CONFIG_500KBITS();
     twai_filter_config_t f_config = TWAI_FILTER_CONFIG_ACCEPT_ALL();
@@ -50,23 +51,23 @@ static void can_send(uint32_t can_id, uint8_t note, uint8_t velocity) {
 
     esp_err_t err = twai_transmit(&msg, pdMS_TO_TICKS(10));
     if (err != ESP_OK) {
-        Log.printf("CAN: tx failed (id=0x%03" PRIX32 ", err=%d)\n", can_id, err);
+        LOG_WARN("CAN: tx failed (id=0x%03" PRIX32 ", err=%d)\n", can_id, err);
     }
 }
 
 void can_send_note_on(uint8_t channel, uint8_t note, uint8_t velocity) {
     // Note On  →  msg_type = 0b001  →  CAN_ID = (1 << 8) | channel
     uint32_t id = (0x001u << 8) | channel;
-    Log.printf("CAN tx: Note On  ch=%u note=%u vel=%u (id=0x%03" PRIX32 ")\n",
-               channel, note, velocity, id);
+    LOG_DEBUG("CAN tx: Note On  ch=%u note=%u vel=%u (id=0x%03" PRIX32 ")\n",
+              channel, note, velocity, id);
     can_send(id, note, velocity);
 }
 
 void can_send_note_off(uint8_t channel, uint8_t note, uint8_t velocity) {
     // Note Off →  msg_type = 0b000  →  CAN_ID = (0 << 8) | channel
     uint32_t id = (0x000u << 8) | channel;
-    Log.printf("CAN tx: Note Off ch=%u note=%u vel=%u (id=0x%03" PRIX32 ")\n",
-               channel, note, velocity, id);
+    LOG_DEBUG("CAN tx: Note Off ch=%u note=%u vel=%u (id=0x%03" PRIX32 ")\n",
+              channel, note, velocity, id);
     can_send(id, note, velocity);
 }
 
@@ -0,0 +1,397 @@
+#include "cananalyzer.h"
+#include "spsc_ring.h"
+#include "logger.h"
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include "driver/twai.h"
+#include "esp_timer.h"
+
+// Global instance
+CANAnalyzer canAnalyzer;
+
+#define CAN_BITRATE       500000
+#define WINDOW_US         1000000
+#define SUMMARY_MS        1000
+
+// Echo messages (type 111 = diagnostics, per can-protocol.md)
+#define ID_ECHO_REQ       0x700
+#define ID_ECHO_REPLY     0x780   // | responder node (0-127)
+#define ECHO_TARGET_ALL   0xFF
+
+#define UDP_VERSION       1
+#define UDP_TYPE_FRAMES   1
+#define UDP_TYPE_SUMMARY  2
+#define UDP_HEADER_SIZE   8
+#define FRAME_RECORD_SIZE 16
+#define FRAMES_PER_PACKET 64
+
+struct CapturedFrame {
+    uint32_t t_us;
+    uint16_t id;
+    uint8_t  dlc;
+    uint8_t  flags;
+    uint8_t  data[8];
+};
+
+// Capture task -> update() for streaming
+static SpscRing<CapturedFrame, 512> captureRing;
+
+// Guards the statistics shared between the capture task and the loop
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+
+static WiFiUDP udp;
+
+// ---------- On-wire frame length ----------
+
+// CRC-15/CAN over the first n bits of bits[]
+static uint16_t crc15(const uint8_t* bits, int n) {
+    uint16_t crc = 0;
+    for (int i = 0; i < n; i++) {
+        bool next = bits[i] ^ ((crc >> 14) & 1);
+        crc = (crc << 1) & 0x7FFF;
+        if (next) crc ^= 0x4599;
+    }
+    return crc;
+}
+
+// Exact bit count of a standard data frame as it appears on the bus:
+// SOF..CRC with stuff bits, then CRC delimiter, ACK, EOF and intermission
+static uint32_t frame_bits(uint16_t id, uint8_t dlc, const uint8_t* data) {
+    uint8_t bits[1 + 11 + 3 + 4 + 64 + 15];
+    int n = 0;
+    bits[n++] = 0;                                              // SOF
+    for (int i = 10; i >= 0; i--) bits[n++] = (id >> i) & 1;    // Identifier
+    bits[n++] = 0;                                              // RTR
+    bits[n++] = 0;                                              // IDE
+    bits[n++] = 0;                                              // r0
+    for (int i = 3; i >= 0; i--) bits[n++] = (dlc >> i) & 1;    // DLC
+    for (int b = 0; b < dlc && b < 8; b++) {
+        for (int i = 7; i >= 0; i--) bits[n++] = (data[b] >> i) & 1;
+    }
+    uint16_t crc = crc15(bits, n);
+    for (int i = 14; i >= 0; i--) bits[n++] = (crc >> i) & 1;
+
+    // A stuff bit follows every run of five equal bits (and counts toward the next run)
+    int stuffed = 0;
+    int run = 1;
+    uint8_t last = bits[0];
+    for (int i = 1; i < n; i++) {
+        if (bits[i] == last) {
+            if (++run == 5) {
+                stuffed++;
+                last = !last;   // The stuff bit
+                run = 1;
+            }
+        } else {
+            last = bits[i];
+            run = 1;
+        }
+    }
+    return n + stuffed + 1 + 2 + 7 + 3;
+}
+
+// ---------- Capture ----------
+
+void CANAnalyzer::begin() {
+    reset();
+    xTaskCreatePinnedToCore(rxTask, "can_capture", 4096, this, 10, nullptr, 1);
+    running = true;
+    Log.println("CAN analyzer: capturing");
+}
+
+void CANAnalyzer::reset() {
+    portENTER_CRITICAL(&statsMux);
+    memset(&bus, 0, sizeof(bus));
+    bus.gapMinUs = UINT32_MAX;
+    numIds = 0;
+    numNodes = 0;
+    windowStartUs = (uint32_t)esp_timer_get_time();
+    windowBits = 0;
+    lastFrameUs = 0;
+    portEXIT_CRITICAL(&statsMux);
+}
+
+void CANAnalyzer::rxTask(void* arg) {
+    CANAnalyzer* self = (CANAnalyzer*)arg;
+    twai_message_t msg;
+    for (;;) {
+        if (twai_receive(&msg, pdMS_TO_TICKS(100)) == ESP_OK) {
+            self->handleFrame(msg, (uint32_t)esp_timer_get_time());
+        }
+        portENTER_CRITICAL(&statsMux);
+        self->rollWindow((uint32_t)esp_timer_get_time());
+        portEXIT_CRITICAL(&statsMux);
+    }
+}
+
+// Close the measurement window once a second has passed (statsMux held)
+void CANAnalyzer::rollWindow(uint32_t now) {
+    uint32_t elapsed = now - windowStartUs;
+    if (elapsed < WINDOW_US) return;
+
+    uint64_t capacity = (uint64_t)CAN_BITRATE * elapsed / 1000000;
+    bus.utilX100 = capacity ? (uint32_t)(windowBits * 10000 / capacity) : 0;
+    if (bus.utilX100 > bus.peakUtilX100) bus.peakUtilX100 = bus.utilX100;
+    for (int i = 0; i < numIds; i++) {
+        ids[i].ratePerSec = (uint32_t)((uint64_t)windowFrames[i] * 1000000 / elapsed);
+        windowFrames[i] = 0;
+    }
+    windowBits = 0;
+    windowStartUs = now;
+}
+
+void CANAnalyzer::handleFrame(const twai_message_t& msg, uint32_t t) {
+    uint8_t dlc = msg.data_length_code > 8 ? 8 : msg.data_length_code;
+    uint16_t id = (uint16_t)(msg.identifier & 0x7FF);
+
+    CapturedFrame cf;
+    cf.t_us = t;
+    cf.id = msg.extd ? (uint16_t)0xFFFF : id;
+    cf.dlc = dlc;
+    cf.flags = (msg.extd ? 1 : 0) | (msg.rtr ? 2 : 0);
+    memcpy(cf.data, msg.data, 8);
+    bool streamDrop = streamPort && !captureRing.push(cf);
+
+    // Extended and remote frames are rare here; count them at nominal length
+    uint32_t bits = (msg.extd || msg.rtr) ? 67 + 8 * dlc : frame_bits(id, dlc, msg.data);
+
+    portENTER_CRITICAL(&statsMux);
+    if (streamDrop) bus.streamDropped++;
+    bus.frames++;
+    bus.bits += bits;
+    windowBits += bits;
+    if (lastFrameUs) {
+        uint32_t gap = t - lastFrameUs;
+        if (gap < bus.gapMinUs) bus.gapMinUs = gap;
+        int b = gap ? 31 - __builtin_clz(gap) : 0;
+        bus.gapHist[b < GAP_BUCKETS ? b : GAP_BUCKETS - 1]++;
+    }
+    lastFrameUs = t;
+
+    int slot = -1;
+    for (int i = 0; i < numIds; i++) {
+        if (ids[i].id == cf.id) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0 && numIds < MAX_IDS) {
+        slot = numIds++;
+        memset(&ids[slot], 0, sizeof(IdStats));
+        ids[slot].id = cf.id;
+        ids[slot].gapMinUs = UINT32_MAX;
+        windowFrames[slot] = 0;
+    }
+    if (slot >= 0) {
+        IdStats& s = ids[slot];
+        if (s.frames) {
+            uint32_t gap = t - lastIdUs[slot];
+            if (gap < s.gapMinUs) s.gapMinUs = gap;
+            if (gap > s.gapMaxUs) s.gapMaxUs = gap;
+            s.gapSumUs += gap;
+        }
+        s.frames++;
+        windowFrames[slot]++;
+        lastIdUs[slot] = t;
+    } else {
+        bus.unknownIds++;
+    }
+
+    // Echo replies carry our send timestamp back
+    if (!msg.extd && (id & 0x780) == ID_ECHO_REPLY && dlc == 8) {
+        uint8_t node = id & 0x7F;
+        uint16_t seq = msg.data[0] | (msg.data[1] << 8);
+        uint32_t sent = msg.data[2] | (msg.data[3] << 8) | ((uint32_t)msg.data[4] << 16) |
+                        ((uint32_t)msg.data[5] << 24);
+        uint32_t rtt = t - sent;
+
+        int n = -1;
+        for (int i = 0; i < numNodes; i++) {
+            if (nodes[i].node == node) {
+                n = i;
+                break;
+            }
+        }
+        if (n < 0 && numNodes < MAX_NODES) {
+            n = numNodes++;
+            memset(&nodes[n], 0, sizeof(NodeEcho));
+            nodes[n].node = node;
+            nodes[n].rttMinUs = UINT32_MAX;
+            nodes[n].lastSeq = seq - 1;
+        }
+        if (n >= 0) {
+            NodeEcho& e = nodes[n];
+            uint16_t skipped = (uint16_t)(seq - e.lastSeq - 1);
+            if (skipped < 0x8000) e.lost += skipped;   // Ignore duplicates / reordering
+            e.lastSeq = seq;
+            e.replies++;
+            if (rtt < e.rttMinUs) e.rttMinUs = rtt;
+            if (rtt > e.rttMaxUs) e.rttMaxUs = rtt;
+            e.rttSumUs += rtt;
+        }
+    }
+    portEXIT_CRITICAL(&statsMux);
+}
+
+// ---------- Loop side ----------
+
+void CANAnalyzer::setEchoInterval(uint32_t intervalMs) {
+    echoIntervalMs = intervalMs;
+}
+
+void CANAnalyzer::setStream(const IPAddress& host, uint16_t port) {
+    if (port && !streamPort) {
+        CapturedFrame stale;
+        while (captureRing.pop(stale)) {}   // Left over from an earlier session
+        udp.begin(0);
+    }
+    streamHost = host;
+    streamPort = port;
+    Log.printf("CAN analyzer: stream %s\n", port ? "on" : "off");
+}
+
+void CANAnalyzer::sendEcho() {
+    uint32_t t = (uint32_t)esp_timer_get_time();
+    twai_message_t msg = {};
+    msg.identifier = ID_ECHO_REQ;
+    msg.data_length_code = 8;
+    msg.data[0] = echoSeq & 0xFF;
+    msg.data[1] = echoSeq >> 8;
+    msg.data[2] = t & 0xFF;
+    msg.data[3] = (t >> 8) & 0xFF;
+    msg.data[4] = (t >> 16) & 0xFF;
+    msg.data[5] = t >> 24;
+    msg.data[6] = ECHO_TARGET_ALL;
+    msg.data[7] = 0;
+    if (twai_transmit(&msg, 0) != ESP_OK) return;
+    echoSeq++;
+
+    // Our own frames are not received back, so account for them here
+    uint32_t bits = frame_bits(ID_ECHO_REQ, 8, msg.data);
+    portENTER_CRITICAL(&statsMux);
+    bus.echoSent++;
+    bus.bits += bits;
+    windowBits += bits;
+    portEXIT_CRITICAL(&statsMux);
+}
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+static void put_header(uint8_t* p, uint8_t type, uint16_t seq, uint16_t count) {
+    p[0] = 'C';
+    p[1] = 'A';
+    p[2] = UDP_VERSION;
+    p[3] = type;
+    put16(p + 4, seq);
+    put16(p + 6, count);
+}
+
+void CANAnalyzer::streamFrames() {
+    static uint8_t pkt[UDP_HEADER_SIZE + FRAMES_PER_PACKET * FRAME_RECORD_SIZE];
+    for (;;) {
+        uint16_t count = 0;
+        CapturedFrame cf;
+        while (count < FRAMES_PER_PACKET && captureRing.pop(cf)) {
+            uint8_t* r = pkt + UDP_HEADER_SIZE + count * FRAME_RECORD_SIZE;
+            put32(r, cf.t_us);
+            put16(r + 4, cf.id);
+            r[6] = cf.dlc;
+            r[7] = cf.flags;
+            memcpy(r + 8, cf.data, 8);
+            count++;
+        }
+        if (!count) return;
+
+        put_header(pkt, UDP_TYPE_FRAMES, streamSeq++, count);
+        udp.beginPacket(streamHost, streamPort);
+        udp.write(pkt, UDP_HEADER_SIZE + count * FRAME_RECORD_SIZE);
+        udp.endPacket();
+        if (count < FRAMES_PER_PACKET) return;
+    }
+}
+
+void CANAnalyzer::sendSummary() {
+    static uint8_t pkt[UDP_HEADER_SIZE + 16 + MAX_IDS * 12];
+    BusStats b;
+    getBusStats(b);
+    IdStats list[MAX_IDS];
+    int n = getIdStats(list, MAX_IDS);
+
+    uint8_t* p = pkt + UDP_HEADER_SIZE;
+    put32(p, millis());
+    put32(p + 4, b.frames);
+    put16(p + 8, (uint16_t)b.utilX100);
+    put16(p + 10, (uint16_t)b.peakUtilX100);
+    put32(p + 12, b.rxMissed);
+    p += 16;
+    for (int i = 0; i < n; i++, p += 12) {
+        put16(p, list[i].id);
+        put16(p + 2, list[i].ratePerSec > 0xFFFF ? 0xFFFF : (uint16_t)list[i].ratePerSec);
+        put32(p + 4, list[i].frames);
+        put32(p + 8, list[i].gapMinUs == UINT32_MAX ? 0 : list[i].gapMinUs);
+    }
+
+    put_header(pkt, UDP_TYPE_SUMMARY, streamSeq++, (uint16_t)n);
+    udp.beginPacket(streamHost, streamPort);
+    udp.write(pkt, p - pkt);
+    udp.endPacket();
+}
+
+void CANAnalyzer::update() {
+    if (!running) return;
+    uint32_t now = millis();
+
+    if (echoIntervalMs && now - lastEchoMs >= echoIntervalMs) {
+        lastEchoMs = now;
+        sendEcho();
+    }
+
+    if (!streamPort || WiFi.status() != WL_CONNECTED) return;
+    streamFrames();
+    if (now - lastSummaryMs >= SUMMARY_MS) {
+        lastSummaryMs = now;
+        sendSummary();
+    }
+}
+
+void CANAnalyzer::getBusStats(BusStats& out) {
+    twai_status_info_t info;
+    bool haveInfo = twai_get_status_info(&info) == ESP_OK;
+
+    portENTER_CRITICAL(&statsMux);
+    out = bus;
+    portEXIT_CRITICAL(&statsMux);
+
+    if (out.gapMinUs == UINT32_MAX) out.gapMinUs = 0;
+    if (haveInfo) {
+        out.rxMissed = info.rx_missed_count;
+        out.rxOverrun = info.rx_overrun_count;
+        out.busErrors = info.bus_error_count;
+    }
+}
+
+int CANAnalyzer::getIdStats(IdStats* out, int max) {
+    portENTER_CRITICAL(&statsMux);
+    int n = numIds < max ? numIds : max;
+    memcpy(out, ids, n * sizeof(IdStats));
+    portEXIT_CRITICAL(&statsMux);
+    return n;
+}
+
+int CANAnalyzer::getNodeEcho(NodeEcho* out, int max) {
+    portENTER_CRITICAL(&statsMux);
+    int n = numNodes < max ? numNodes : max;
+    memcpy(out, nodes, n * sizeof(NodeEcho));
+    portEXIT_CRITICAL(&statsMux);
+    return n;
+}
@@ -0,0 +1,147 @@
+#ifndef CANANALYZER_H
+#define CANANALYZER_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+#include "driver/twai.h"
+
+/**
+ * CAN bus capture and analysis
+ *
+ * A receive task timestamps every TWAI frame (esp_timer, microseconds) and
+ * keeps running statistics:
+ * - per-ID frame counts, rate over the last second and inter-frame gaps
+ * - bus utilisation: exact on-wire bit count of every frame (including stuff
+ *   bits) over the last second, plus the peak seen
+ * - bus-wide gap between consecutive frames as a log2 histogram
+ * - echo round-trip time per responding node (ECHO_REQ / ECHO_REPLY,
+ *   see docs/can-protocol.md)
+ *
+ * Captured frames and a once-per-second summary can be streamed as binary
+ * UDP packets (format below; utilities/can_capture.py decodes them).
+ *
+ * UDP packet: 8-byte header, then records
+ *   0  'C' 'A'
+ *   2  uint8_t  version (1)
+ *   3  uint8_t  type: 1 = frames, 2 = summary
+ *   4  uint16_t sequence number (little endian, per packet)
+ *   6  uint16_t record count
+ * Frame record (16 bytes):
+ *   uint32_t t_us, uint16_t id, uint8_t dlc, uint8_t flags (bit0 extd, bit1 rtr), uint8_t data[8]
+ * Summary: 16-byte body then count x 12-byte ID records
+ *   uint32_t uptime_ms, uint32_t frames, uint16_t util_x100, uint16_t peak_x100, uint32_t rx_missed
+ *   per ID: uint16_t id, uint16_t frames_per_s, uint32_t frames, uint32_t min_gap_us
+ */
+class CANAnalyzer {
+public:
+    static const int MAX_IDS = 64;
+    static const int MAX_NODES = 16;
+    static const int GAP_BUCKETS = 16;   // Bucket b counts gaps in [2^b, 2^(b+1)) us
+
+    struct IdStats {
+        uint16_t id;
+        uint32_t frames;
+        uint32_t ratePerSec;   // Frames in the last complete second
+        uint32_t gapMinUs;     // Between consecutive frames with this ID
+        uint32_t gapMaxUs;
+        uint64_t gapSumUs;
+    };
+
+    struct NodeEcho {
+        uint8_t  node;
+        uint32_t replies;
+        uint32_t lost;         // Sequence numbers skipped by this node
+        uint32_t rttMinUs;
+        uint32_t rttMaxUs;
+        uint64_t rttSumUs;
+        uint16_t lastSeq;
+    };
+
+    struct BusStats {
+        uint32_t frames;
+        uint64_t bits;             // On-wire bits including stuffing and IFS
+        uint32_t utilX100;         // Utilisation over the last second, % x 100
+        uint32_t peakUtilX100;
+        uint32_t gapMinUs;         // Smallest bus-wide gap between frame starts
+        uint32_t gapHist[GAP_BUCKETS];
+        uint32_t echoSent;
+        uint32_t rxMissed;         // Driver RX queue overflows
+        uint32_t rxOverrun;        // Controller FIFO overruns
+        uint32_t busErrors;
+        uint32_t streamDropped;    // Frames not streamed (ring full)
+        uint32_t unknownIds;       // Frames whose ID did not fit the table
+    };
+
+    /**
+     * Start the capture task. Call after can_bus_begin().
+     */
+    void begin();
+
+    /**
+     * Send due echo requests and stream captured frames.
+     * Call from main loop
+     */
+    void update();
+
+    /**
+     * Clear all statistics
+     */
+    void reset();
+
+    /**
+     * Stream frames and summaries to host:port over UDP; port 0 stops
+     */
+    void setStream(const IPAddress& host, uint16_t port);
+    bool isStreaming() const { return streamPort != 0; }
+
+    /**
+     * Broadcast an ECHO_REQ every intervalMs; 0 disables
+     */
+    void setEchoInterval(uint32_t intervalMs);
+    uint32_t getEchoInterval() const { return echoIntervalMs; }
+
+    /**
+     * Consistent copies of the current statistics
+     * @return number of entries written
+     */
+    void getBusStats(BusStats& out);
+    int getIdStats(IdStats* out, int max);
+    int getNodeEcho(NodeEcho* out, int max);
+
+private:
+    static void rxTask(void* arg);
+    void handleFrame(const twai_message_t& msg, uint32_t t);
+    void rollWindow(uint32_t now);
+    void sendEcho();
+    void streamFrames();
+    void sendSummary();
+
+    BusStats bus;
+    IdStats ids[MAX_IDS];
+    int numIds = 0;
+    NodeEcho nodes[MAX_NODES];
+    int numNodes = 0;
+
+    // One-second measurement window
+    uint32_t windowStartUs = 0;
+    uint64_t windowBits = 0;
+    uint32_t windowFrames[MAX_IDS];
+    uint32_t lastFrameUs = 0;
+    uint32_t lastIdUs[MAX_IDS];
+
+    IPAddress streamHost;
+    uint16_t streamPort = 0;
+    uint16_t streamSeq = 0;
+    uint32_t lastSummaryMs = 0;
+
+    uint32_t echoIntervalMs = 0;
+    uint32_t lastEchoMs = 0;
+    uint16_t echoSeq = 0;
+
+    bool running = false;
+};
+
+// Global instance
+extern CANAnalyzer canAnalyzer;
+
+#endif // CANANALYZER_H
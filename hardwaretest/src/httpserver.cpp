@@ -5,7 +5,6 @@
 // #include "chimes.h"
 #include "output.h"
 #include "midinote.h"
-#include "keyboard.h"
 #include "midiseq.h"
 // #include "noterepeater.h"
 // #include "songs.h"
@@ -14,263 +13,169 @@
 #include "midiudp.h"
 // #include "midifiles.h"
 #include "midihandler.h"
-#include "api_docs.h"
-#include "settings_page.h"
+#include "cananalyzer.h"
+#include "web_assets.h"
+#include "httpstream.h"
+#include "logstream.h"
 
 static WebServer server(80);
 
-// ---------- Simple Circular Log Buffer ----------
-#define LOG_BUFFER_SIZE 100
-static String logBuffer[LOG_BUFFER_SIZE];
-static int logIndex = 0;
-static int logCount = 0;
-static int logTotalCount = 0; // Monotonically increasing counter
-static bool httpLoggingEnabled = true; // Only enable when logs requested
-static String pendingLogLine = ""; // Accumulator for incomplete lines
+// ---------- Log ring ----------
+// Everything logged, in a fixed-size ring streamed to /logs (logstream.h)
+static LogStream logStream;
 
 void httpserver_log(const uint8_t* buffer, size_t size) {
-  if (!httpLoggingEnabled) return; // Skip all String building if disabled
-  
-  // Build String from buffer, accumulating partial lines
-  for (size_t i = 0; i < size; i++) {
-    char c = buffer[i];
-    if (c == '\n') {
-      if (pendingLogLine.length() > 0) {
-        // Store complete line in buffer
-        logBuffer[logIndex] = pendingLogLine;
-        logIndex = (logIndex + 1) % LOG_BUFFER_SIZE;
-        if (logCount < LOG_BUFFER_SIZE) logCount++;
-        logTotalCount++;
-        pendingLogLine = "";
-      }
-    } else if (c != '\r') {
-      pendingLogLine += c;
-    }
-  }
+  logStream.write(buffer, size);
 }
 
 // Legacy C-string interface (for compatibility)
 void httpserver_log(const char* message) {
-  if (!httpLoggingEnabled) return;
-  
-  logBuffer[logIndex] = String(message);
-  logIndex = (logIndex + 1) % LOG_BUFFER_SIZE;
-  if (logCount < LOG_BUFFER_SIZE) logCount++;
-  logTotalCount++;
-}
-
-String httpserver_get_logs() {
-  String result = "";
-  int start = (logCount < LOG_BUFFER_SIZE) ? 0 : logIndex;
-  for (int i = 0; i < logCount; i++) {
-    int idx = (start + i) % LOG_BUFFER_SIZE;
-    result += logBuffer[idx] + "\n";
-  }
-  return result;
-}
-
-String httpserver_get_logs_since(int sinceTotal) {
-  String result = "";
-  
-  // If asking for logs before our buffer, or invalid, return all
-  if (sinceTotal < 0) {
-    return httpserver_get_logs();
-  }
-  
-  // Calculate how many new logs since the requested point
-  int newCount = logTotalCount - sinceTotal;
-  
-  // If no new logs, return empty
-  if (newCount <= 0) {
-    return "";
-  }
-  
-  // If asking for more logs than we have buffered, return all
-  if (newCount > logCount) {
-    return httpserver_get_logs();
-  }
-  
-  // Calculate starting position in circular buffer
-  int start = (logIndex - newCount + LOG_BUFFER_SIZE) % LOG_BUFFER_SIZE;
-  for (int i = 0; i < newCount; i++) {
-    int idx = (start + i) % LOG_BUFFER_SIZE;
-    result += logBuffer[idx] + "\n";
-  }
-  return result;
-}
-
-int httpserver_get_log_index() {
-  return logTotalCount;
+  logStream.write((const uint8_t*)message, strlen(message));
+  logStream.write((const uint8_t*)"\n", 1);
 }
 
 // Handler for GET /channels
 static void handleChannels() {
-  String html = "<!DOCTYPE html><html><head>";
-  html += "<meta name='viewport' content='width=device-width, initial-scale=1'>";
-  html += "<style>";
-  html += "body { font-family: Arial, sans-serif; margin: 20px; background: #f0f0f0; }";
-  html += "h1 { color: #333; }";
-  html += ".container { max-width: 600px; margin: 0 auto; background: white; padding: 20px; border-radius: 10px; box-shadow: 0 2px 5px rgba(0,0,0,0.1); }";
-  html += ".controls { display: flex; gap: 15px; margin: 15px 0; flex-wrap: wrap; align-items: center; }";
-  html += ".control-group { display: flex; gap: 5px; align-items: center; }";
-  html += ".control-group label { font-weight: bold; }";
-  html += ".control-group input { width: 80px; padding: 5px; font-size: 14px; border: 2px solid #ccc; border-radius: 4px; }";
-  html += ".button-grid { display: grid; grid-template-columns: repeat(auto-fill, minmax(80px, 1fr)); gap: 10px; margin-top: 20px; }";
-  html += "button { padding: 15px; font-size: 16px; border: 2px solid #4CAF50; background: #4CAF50; color: white; border-radius: 5px; cursor: pointer; transition: all 0.3s; }";
-  html += "button:hover { background: #45a049; transform: scale(1.05); }";
-  html += "button:active { transform: scale(0.95); }";
-  html += ".status { margin-top: 15px; padding: 10px; background: #e8f5e9; border-radius: 5px; display: none; }";
-  html += "</style></head><body>";
-  html += "<div class='container'>";
-  html += "<h1>Chime Controller</h1>";
-  html += "<p>Click a button to ring a chime by channel (0-20)</p>";
-  html += "<div class='controls'>";
-  html += "<div class='control-group'>";
-  html += "<label for='kickDuty'>Kick Duty:</label>";
-  html += "<input type='number' id='kickDuty' value='100' min='1' max='100' />";
-  html += "<span>%</span>";
-  html += "</div>";
-  html += "<div class='control-group'>";
-  html += "<label for='kickHold'>Kick Hold:</label>";
-  html += "<input type='number' id='kickHold' value='35' min='0' max='1000' />";
-  html += "<span>ms</span>";
-  html += "</div>";
-  html += "</div>";
-  html += "<div class='button-grid'>";
+  HttpStream out(server, 200, "text/html");
+  out.print("<!DOCTYPE html><html><head>");
+  out.print("<meta name='viewport' content='width=device-width, initial-scale=1'>");
+  out.print("<style>");
+  out.print("body { font-family: Arial, sans-serif; margin: 20px; background: #f0f0f0; }");
+  out.print("h1 { color: #333; }");
+  out.print(".container { max-width: 600px; margin: 0 auto; background: white; padding: 20px; border-radius: 10px; box-shadow: 0 2px 5px rgba(0,0,0,0.1); }");
+  out.print(".controls { display: flex; gap: 15px; margin: 15px 0; flex-wrap: wrap; align-items: center; }");
+  out.print(".control-group { display: flex; gap: 5px; align-items: center; }");
+  out.print(".control-group label { font-weight: bold; }");
+  out.print(".control-group input { width: 80px; padding: 5px; font-size: 14px; border: 2px solid #ccc; border-radius: 4px; }");
+  out.print(".button-grid { display: grid; grid-template-columns: repeat(auto-fill, minmax(80px, 1fr)); gap: 10px; margin-top: 20px; }");
+  out.print("button { padding: 15px; font-size: 16px; border: 2px solid #4CAF50; background: #4CAF50; color: white; border-radius: 5px; cursor: pointer; transition: all 0.3s; }");
+  out.print("button:hover { background: #45a049; transform: scale(1.05); }");
+  out.print("button:active { transform: scale(0.95); }");
+  out.print(".status { margin-top: 15px; padding: 10px; background: #e8f5e9; border-radius: 5px; display: none; }");
+  out.print("</style></head><body>");
+  out.print("<div class='container'>");
+  out.print("<h1>Chime Controller</h1>");
+  out.print("<p>Click a button to ring a chime by channel (0-20)</p>");
+  out.print("<div class='controls'>");
+  out.print("<div class='control-group'>");
+  out.print("<label for='kickDuty'>Kick Duty:</label>");
+  out.print("<input type='number' id='kickDuty' value='100' min='1' max='100' />");
+  out.print("<span>%</span>");
+  out.print("</div>");
+  out.print("<div class='control-group'>");
+  out.print("<label for='kickHold'>Kick Hold:</label>");
+  out.print("<input type='number' id='kickHold' value='35' min='0' max='1000' />");
+  out.print("<span>ms</span>");
+  out.print("</div>");
+  out.print("</div>");
+  out.print("<div class='button-grid'>");
   
   // Create 21 buttons (notes 0-20)
   for (int i = 0; i < 21; i++) {
-    html += "<button onclick='ring(" + String(i) + ")'>Ch " + String(i) + "</button>";
+    out.printf("<button onclick='ring(%d)'>Ch %d</button>", i, i);
   }
   
-  html += "</div>";
-  html += "<div class='status' id='status'></div>";
-  html += "</div>";
+  out.print("</div>");
+  out.print("<div class='status' id='status'></div>");
+  out.print("</div>");
   
   // JavaScript to handle button clicks
-  html += "<script>";
-  html += "function ring(note) {";
-  html += "  const duty = document.getElementById('kickDuty').value;";
-  html += "  const hold = document.getElementById('kickHold').value;";
-  html += "  fetch('/note_on_by_index' + '?note=' + note)";
-  html += "    .then(r => r.text())";
-  html += "    .then(msg => {";
-  html += "      const s = document.getElementById('status');";
-  html += "      s.textContent = msg;";
-  html += "      s.style.display = 'block';";
-  html += "      setTimeout(() => s.style.display = 'none', 2000);";
-  html += "    })";
-  html += "    .catch(e => console.error('Error:', e));";
-  html += "}";
-  html += "</script>";
-  html += "</body></html>";
-  
-  server.send(200, "text/html", html);
+  out.print("<script>");
+  out.print("function ring(note) {");
+  out.print("  const duty = document.getElementById('kickDuty').value;");
+  out.print("  const hold = document.getElementById('kickHold').value;");
+  out.print("  fetch('/note_on_by_index' + '?note=' + note)");
+  out.print("    .then(r => r.text())");
+  out.print("    .then(msg => {");
+  out.print("      const s = document.getElementById('status');");
+  out.print("      s.textContent = msg;");
+  out.print("      s.style.display = 'block';");
+  out.print("      setTimeout(() => s.style.display = 'none', 2000);");
+  out.print("    })");
+  out.print("    .catch(e => console.error('Error:', e));");
+  out.print("}");
+  out.print("</script>");
+  out.print("</body></html>");
 }
 
 // Handler for GET /logs - Log viewer page
 static void handleLogsPage() {
-  httpLoggingEnabled = true; // Enable logging on first access
-  
-  String html = "<!DOCTYPE html><html><head>";
-  html += "<meta name='viewport' content='width=device-width, initial-scale=1'>";
-  html += "<title>Chime Logs</title>";
-  html += "<style>";
-  html += "body { font-family: monospace; margin: 0; padding: 20px; background: #1e1e1e; color: #d4d4d4; }";
-  html += "h1 { color: #4ec9b0; margin-bottom: 10px; }";
-  html += "#log { background: #252526; border: 1px solid #3e3e42; padding: 15px; ";
-  html += "height: 70vh; overflow-y: auto; white-space: pre-wrap; word-wrap: break-word; }";
-  html += ".controls { margin-bottom: 15px; }";
-  html += "button { padding: 8px 16px; background: #0e639c; color: white; border: none; ";
-  html += "border-radius: 4px; cursor: pointer; margin-right: 10px; }";
-  html += "button:hover { background: #1177bb; }";
-  html += ".status { color: #4ec9b0; margin-left: 10px; }";
-  html += "</style></head><body>";
-  html += "<h1>Chime Controller Logs</h1>";
-  html += "<div class='controls'>";
-  html += "<button onclick='clearLog()'>Clear</button>";
-  html += "<button onclick='toggleAutoScroll()' id='scrollBtn'>Auto-scroll: ON</button>";
-  html += "<span class='status' id='status'>Connected</span>";
-  html += "</div>";
-  html += "<div id='log'></div>";
-  html += "<script>";
-  html += "let autoScroll = true;";
-  html += "let lastIndex = -1;";
-  html += "const logDiv = document.getElementById('log');";
-  html += "const statusDiv = document.getElementById('status');";
-  html += "function fetchLogs() {";
-  html += "  fetch('/logs/poll?since=' + lastIndex)";
-  html += "    .then(r => r.json())";
-  html += "    .then(data => {";
-  html += "      if (data.logs) {";
-  html += "        logDiv.textContent += data.logs;";
-  html += "        if (autoScroll) logDiv.scrollTop = logDiv.scrollHeight;";
-  html += "      }";
-  html += "      lastIndex = data.index;";
-  html += "      statusDiv.textContent = 'Connected';";
-  html += "      statusDiv.style.color = '#4ec9b0';";
-  html += "    })";
-  html += "    .catch(() => {";
-  html += "      statusDiv.textContent = 'Error';";
-  html += "      statusDiv.style.color = '#f48771';";
-  html += "    });";
-  html += "}";
-  html += "fetchLogs();";
-  html += "setInterval(fetchLogs, 1000);";
-  html += "function clearLog() { logDiv.textContent = ''; }";
-  html += "function toggleAutoScroll() {";
-  html += "  autoScroll = !autoScroll;";
-  html += "  document.getElementById('scrollBtn').textContent = 'Auto-scroll: ' + (autoScroll ? 'ON' : 'OFF');";
-  html += "}";
-  html += "</script></body></html>";
-  
-  server.send(200, "text/html", html);
+  HttpStream out(server, 200, "text/html");
+  out.print("<!DOCTYPE html><html><head>");
+  out.print("<meta name='viewport' content='width=device-width, initial-scale=1'>");
+  out.print("<title>Chime Logs</title>");
+  out.print("<style>");
+  out.print("body { font-family: monospace; margin: 0; padding: 20px; background: #1e1e1e; color: #d4d4d4; }");
+  out.print("h1 { color: #4ec9b0; margin-bottom: 10px; }");
+  out.print("#log { background: #252526; border: 1px solid #3e3e42; padding: 15px; ");
+  out.print("height: 70vh; overflow-y: auto; white-space: pre-wrap; word-wrap: break-word; }");
+  out.print(".controls { margin-bottom: 15px; }");
+  out.print("button { padding: 8px 16px; background: #0e639c; color: white; border: none; ");
+  out.print("border-radius: 4px; cursor: pointer; margin-right: 10px; }");
+  out.print("button:hover { background: #1177bb; }");
+  out.print(".status { color: #4ec9b0; margin-left: 10px; }");
+  out.print("</style></head><body>");
+  out.print("<h1>Chime Controller Logs</h1>");
+  out.print("<div class='controls'>");
+  out.print("<button onclick='clearLog()'>Clear</button>");
+  out.print("<button onclick='toggleAutoScroll()' id='scrollBtn'>Auto-scroll: ON</button>");
+  out.print("<span class='status' id='status'>Connected</span>");
+  out.print("</div>");
+  out.print("<div id='log'></div>");
+  out.print("<script>");
+  out.print("let autoScroll = true;");
+  out.print("let lastId = -1;");
+  out.print("const logDiv = document.getElementById('log');");
+  out.print("const statusDiv = document.getElementById('status');");
+  out.print("function connect() {");
+  out.print("  const es = new EventSource('/logs/stream?since=' + lastId);");
+  out.print("  es.onopen = () => {");
+  out.print("    statusDiv.textContent = 'Connected';");
+  out.print("    statusDiv.style.color = '#4ec9b0';");
+  out.print("  };");
+  out.print("  es.onmessage = e => {");
+  out.print("    logDiv.textContent += e.data + '\\n';");
+  out.print("    lastId = e.lastEventId;");
+  out.print("    if (autoScroll) logDiv.scrollTop = logDiv.scrollHeight;");
+  out.print("  };");
+  out.print("  es.onerror = () => {");
+  out.print("    es.close();");
+  out.print("    statusDiv.textContent = 'Reconnecting';");
+  out.print("    statusDiv.style.color = '#f48771';");
+  out.print("    setTimeout(connect, 2000);");
+  out.print("  };");
+  out.print("}");
+  out.print("connect();");
+  out.print("function clearLog() { logDiv.textContent = ''; }");
+  out.print("function toggleAutoScroll() {");
+  out.print("  autoScroll = !autoScroll;");
+  out.print("  document.getElementById('scrollBtn').textContent = 'Auto-scroll: ' + (autoScroll ? 'ON' : 'OFF');");
+  out.print("}");
+  out.print("</script></body></html>");
 }
 
 // Handler for GET /logs/poll?since=X - Polling endpoint
 static void handleLogsPoll() {
-  httpLoggingEnabled = true; // Enable logging if not already
-  
-  int sinceIndex = -1;
-  if (server.hasArg("since")) {
-    sinceIndex = server.arg("since").toInt();
-  }
-  
-  String logs = httpserver_get_logs_since(sinceIndex);
-  int currentIndex = httpserver_get_log_index();
-  
-  // Early return for no new logs
-  if (logs.length() == 0) {
-    String json = "{\"index\":" + String(currentIndex) + ",\"logs\":\"\"}";
-    server.send(200, "application/json", json);
-    return;
-  }
-  
-  // Reserve capacity to minimize reallocations (rough estimate: logs.length() * 1.2 + 50)
-  String json;
-  json.reserve(logs.length() + logs.length() / 5 + 50);
-  
-  json = "{\"index\":" + String(currentIndex) + ",\"logs\":\"";
-  
-  // Escape the logs for JSON
-  for (unsigned int i = 0; i < logs.length(); i++) {
-    char c = logs[i];
-    if (c == '"') json += "\\\"";
-    else if (c == '\\') json += "\\\\";
-    else if (c == '\n') json += "\\n";
-    else if (c == '\r') json += "\\r";
-    else if (c == '\t') json += "\\t";
-    else json += c;
-  }
-  json += "\"}";
-  
-  server.send(200, "application/json", json);
+  long since = server.hasArg("since") ? server.arg("since").toInt() : -1;
+  
+  HttpStream out(server, 200, "application/json");
+  out.beginObject();
+  out.beginString("logs");
+  uint32_t index = logStream.writeSince(out, since < 0 ? UINT32_MAX : (uint32_t)since);
+  out.endString();
+  out.kv("index", (unsigned long)index);
+  out.endObject();
+}
+
+// Handler for GET /logs/stream?since=X - Server-Sent Events, stays open
+static void handleLogsStream() {
+  logStream.subscribe(server);
 }
 
 // Handler for GET /keyboard
 // Handler for GET /
 static void handleRoot() {
-  server.send(200, "text/html", get_keyboard_html());
+  webasset_send(server, KEYBOARD_HTML_GZ);
 }
 
 // Handler for GET /note_on?note=X&velocity=Y
@@ -388,35 +293,146 @@ static void handleSeqResume() {
 
 // Handler for 404 Not Found
 static void handleNotFound() {
-  String message = "Not Found\n\n";
-  message += "URI: " + server.uri() + "\n";
-  message += "Method: " + String((server.method() == HTTP_GET) ? "GET" : "POST") + "\n";
-  server.send(404, "text/plain", message);
+  HttpStream out(server, 404, "text/plain");
+  out.print("Not Found\n\n");
+  out.print("URI: ");
+  out.print(server.uri());
+  out.print("\nMethod: ");
+  out.print((server.method() == HTTP_GET) ? "GET" : "POST");
+  out.print("\n");
 }
 
 // Handler for GET /status - system status including MIDI/UDP
 static void handleStatus() {
-  String json = "{";
-  json += "\"uptime\":" + String(millis()) + ",";
-  json += "\"wifi\":{";
-  json += "\"connected\":" + String(WiFi.status() == WL_CONNECTED ? "true" : "false") + ",";
-  json += "\"ip\":\"" + WiFi.localIP().toString() + "\",";
-  json += "\"rssi\":" + String(WiFi.RSSI());
-  json += "},";
-  json += "\"midiUdp\":{";
-  json += "\"listening\":" + String(midiUDP.isListening() ? "true" : "false") + ",";
-  json += "\"port\":" + String(midiUDP.getPort()) + ",";
-  json += "\"packetsReceived\":" + String(midiUDP.getPacketsReceived()) + ",";
-  json += "\"messagesReceived\":" + String(midiUDP.getMessagesReceived()) + ",";
-  json += "\"packetsDropped\":" + String(midiUDP.getPacketsDropped());
-  json += "},";
-  json += "\"time\":{";
-  json += "\"synced\":" + String(timekeeping.isSynced() ? "true" : "false") + ",";
-  json += "\"timestamp\":" + String(timekeeping.getTimestamp());
-  json += "}";
-  json += "}";
-  
-  server.send(200, "application/json", json);
+  HttpStream out(server, 200, "application/json");
+  out.beginObject();
+  out.kv("uptime", millis());
+  out.kv("telnetDropped", Log.telnetDropped());
+  out.beginObject("wifi");
+  out.kv("connected", WiFi.status() == WL_CONNECTED);
+  out.kv("ip", WiFi.localIP());
+  out.kv("rssi", WiFi.RSSI());
+  out.endObject();
+  out.beginObject("midiUdp");
+  out.kv("listening", midiUDP.isListening());
+  out.kv("port", midiUDP.getPort());
+  out.kv("packetsReceived", midiUDP.getPacketsReceived());
+  out.kv("messagesReceived", midiUDP.getMessagesReceived());
+  out.kv("packetsDropped", midiUDP.getPacketsDropped());
+  out.endObject();
+  out.beginObject("time");
+  out.kv("synced", timekeeping.isSynced());
+  out.kv("timestamp", timekeeping.getTimestamp());
+  out.endObject();
+  CANAnalyzer::BusStats can;
+  canAnalyzer.getBusStats(can);
+  out.beginObject("can");
+  out.kv("frames", can.frames);
+  out.kv("utilization", can.utilX100 / 100.0f);
+  out.kv("peakUtilization", can.peakUtilX100 / 100.0f);
+  out.kv("rxMissed", can.rxMissed);
+  out.kv("streaming", canAnalyzer.isStreaming());
+  out.endObject();
+  out.endObject();
+}
+
+// Handler for GET /can/stats - bus, per-ID and echo latency statistics
+static void handleCanStats() {
+  CANAnalyzer::BusStats bus;
+  canAnalyzer.getBusStats(bus);
+  static CANAnalyzer::IdStats ids[CANAnalyzer::MAX_IDS];
+  int numIds = canAnalyzer.getIdStats(ids, CANAnalyzer::MAX_IDS);
+  CANAnalyzer::NodeEcho nodes[CANAnalyzer::MAX_NODES];
+  int numNodes = canAnalyzer.getNodeEcho(nodes, CANAnalyzer::MAX_NODES);
+
+  HttpStream out(server, 200, "application/json");
+  out.beginObject();
+  out.kv("frames", bus.frames);
+  out.kv("bits", bus.bits);
+  out.kv("utilization", bus.utilX100 / 100.0f);
+  out.kv("peakUtilization", bus.peakUtilX100 / 100.0f);
+  out.kv("gapMinUs", bus.gapMinUs);
+  out.beginArray("gapHistLog2Us");
+  for (int i = 0; i < CANAnalyzer::GAP_BUCKETS; i++) {
+    out.value(bus.gapHist[i]);
+  }
+  out.endArray();
+  out.kv("rxMissed", bus.rxMissed);
+  out.kv("rxOverrun", bus.rxOverrun);
+  out.kv("busErrors", bus.busErrors);
+  out.kv("streamDropped", bus.streamDropped);
+  out.kv("unknownIds", bus.unknownIds);
+  out.beginArray("ids");
+  for (int i = 0; i < numIds; i++) {
+    const CANAnalyzer::IdStats& s = ids[i];
+    char id[8];
+    snprintf(id, sizeof(id), "0x%03X", s.id);
+    out.beginObject();
+    out.kv("id", id);
+    out.kv("frames", s.frames);
+    out.kv("rate", s.ratePerSec);
+    out.kv("gapMinUs", s.frames > 1 ? s.gapMinUs : 0);
+    out.kv("gapMaxUs", s.gapMaxUs);
+    out.kv("gapAvgUs", s.frames > 1 ? (uint32_t)(s.gapSumUs / (s.frames - 1)) : 0);
+    out.endObject();
+  }
+  out.endArray();
+  out.beginObject("echo");
+  out.kv("intervalMs", canAnalyzer.getEchoInterval());
+  out.kv("sent", bus.echoSent);
+  out.beginArray("nodes");
+  for (int i = 0; i < numNodes; i++) {
+    const CANAnalyzer::NodeEcho& e = nodes[i];
+    out.beginObject();
+    out.kv("node", e.node);
+    out.kv("replies", e.replies);
+    out.kv("lost", e.lost);
+    out.kv("rttMinUs", e.rttMinUs);
+    out.kv("rttAvgUs", e.replies ? (uint32_t)(e.rttSumUs / e.replies) : 0);
+    out.kv("rttMaxUs", e.rttMaxUs);
+    out.endObject();
+  }
+  out.endArray();
+  out.endObject();
+  out.endObject();
+}
+
+// Handler for POST /can/stream?host=&port= - binary UDP capture stream (port=0 stops)
+static void handleCanStream() {
+  if (!server.hasArg("port")) {
+    server.send(400, "text/plain", "Missing port parameter");
+    return;
+  }
+  uint16_t port = server.arg("port").toInt();
+  IPAddress host = server.client().remoteIP();
+  if (server.hasArg("host") && !host.fromString(server.arg("host"))) {
+    server.send(400, "text/plain", "Invalid host");
+    return;
+  }
+  canAnalyzer.setStream(host, port);
+  server.send(200, "application/json",
+              "{\"success\":true,\"host\":\"" + host.toString() + "\",\"port\":" + String(port) + "}");
+}
+
+// Handler for POST /can/echo?interval_ms= - periodic ECHO_REQ (0 stops)
+static void handleCanEcho() {
+  if (!server.hasArg("interval_ms")) {
+    server.send(400, "text/plain", "Missing interval_ms parameter");
+    return;
+  }
+  long interval = server.arg("interval_ms").toInt();
+  if (interval < 0 || interval > 60000) {
+    server.send(400, "text/plain", "interval_ms must be 0-60000");
+    return;
+  }
+  canAnalyzer.setEchoInterval(interval);
+  server.send(200, "application/json", "{\"success\":true}");
+}
+
+// Handler for POST /can/reset
+static void handleCanReset() {
+  canAnalyzer.reset();
+  server.send(200, "application/json", "{\"success\":true}");
 }
 
 // Handler for GET /time
@@ -424,15 +440,14 @@ static void handleTime() {
   char timeStr[64];
   timekeeping.getTimeString(timeStr, sizeof(timeStr));
   
-  String json = "{";
-  json += "\"timestamp\":" + String(timekeeping.getTimestamp()) + ",";
-  json += "\"localTime\":\"" + String(timeStr) + "\",";
-  json += "\"synced\":" + String(timekeeping.isSynced() ? "true" : "false") + ",";
-  json += "\"lastSync\":" + String(timekeeping.getLastSyncTime()) + ",";
-  json += "\"timezoneOffset\":" + String(timekeeping.getTimezoneOffset());
-  json += "}";
-  
-  server.send(200, "application/json", json);
+  HttpStream out(server, 200, "application/json");
+  out.beginObject();
+  out.kv("timestamp", timekeeping.getTimestamp());
+  out.kv("localTime", timeStr);
+  out.kv("synced", timekeeping.isSynced());
+  out.kv("lastSync", timekeeping.getLastSyncTime());
+  out.kv("timezoneOffset", timekeeping.getTimezoneOffset());
+  out.endObject();
 }
 
 // Handler for GET /time/sync
@@ -480,104 +495,103 @@ static void handleTimeNTPServer() {
 
 // Handler for GET /api
 static void handleAPIDocumentation() {
-  server.send(200, "text/html", API_DOCS_HTML);
+  webasset_send(server, API_DOCS_HTML_GZ);
 }
 
 // Handler for GET /settings
 static void handleSettings() {
-  server.send(200, "text/html", SETTINGS_PAGE_HTML);
+  webasset_send(server, SETTINGS_PAGE_HTML_GZ);
 }
 
 // Handler for GET /player - MIDI file player UI
 static void handlePlayer() {
-  String html = "<!DOCTYPE html><html><head>";
-  html += "<meta name='viewport' content='width=device-width, initial-scale=1'>";
-  html += "<title>MIDI Player</title>";
-  html += "<style>";
-  html += "body { font-family: Arial, sans-serif; margin: 20px; background: #f0f0f0; }";
-  html += "h1 { color: #333; }";
-  html += ".container { max-width: 800px; margin: 0 auto; background: white; padding: 20px; border-radius: 10px; box-shadow: 0 2px 5px rgba(0,0,0,0.1); }";
-  html += ".file { display: flex; justify-content: space-between; align-items: center; padding: 15px; margin: 10px 0; background: #f9f9f9; border-radius: 5px; border-left: 4px solid #4CAF50; }";
-  html += ".file-info { flex-grow: 1; }";
-  html += ".file-name { font-weight: bold; font-size: 16px; }";
-  html += ".file-size { color: #666; font-size: 14px; }";
-  html += ".controls { display: flex; gap: 10px; align-items: center; }";
-  html += "button { padding: 8px 16px; font-size: 14px; border: none; background: #4CAF50; color: white; border-radius: 4px; cursor: pointer; }";
-  html += "button:hover { background: #45a049; }";
-  html += "button.delete { background: #f44336; }";
-  html += "button.delete:hover { background: #da190b; }";
-  html += "input[type=number] { width: 60px; padding: 5px; border: 2px solid #ddd; border-radius: 4px; }";
-  html += ".upload { margin-bottom: 20px; padding: 15px; background: #e3f2fd; border-radius: 5px; }";
-  html += ".status { margin-top: 15px; padding: 10px; background: #e8f5e9; border-radius: 5px; display: none; }";
-  html += ".error { background: #ffebee !important; color: #c62828; }";
-  html += ".storage { margin-top: 15px; padding: 10px; background: #fff3e0; border-radius: 5px; font-size: 14px; }";
-  html += "</style></head><body>";
-  html += "<div class='container'>";
-  html += "<h1>MIDI File Player</h1>";
-  html += "<div class='upload'>";
-  html += "<input type='file' id='fileInput' accept='.mid,.midi' />";
-  html += "<button onclick='uploadFile()'>Upload</button>";
-  html += "</div>";
-  html += "<div id='storage' class='storage'>Loading storage info...</div>";
-  html += "<div id='fileList'>Loading files...</div>";
-  html += "<div id='status' class='status'></div>";
-  html += "</div>";
-  html += "<script>";
-  html += "function loadFiles() {";
-  html += "  fetch('/files').then(r => r.json()).then(data => {";
-  html += "    let html = '';";
-  html += "    if (data.files.length === 0) {";
-  html += "      html = '<p>No MIDI files uploaded yet.</p>';";
-  html += "    } else {";
-  html += "      data.files.forEach(f => {";
-  html += "        html += '<div class=\"file\">';";
-  html += "        html += '<div class=\"file-info\"><div class=\"file-name\">' + f.name + '</div>';";
-  html += "        html += '<div class=\"file-size\">' + f.size + ' bytes</div></div>';";
-  html += "        html += '<div class=\"controls\">';";
-  html += "        html += '<label>Vel:</label><input type=\"number\" id=\"vel_' + f.name + '\" value=\"1.0\" min=\"0\" max=\"2\" step=\"0.1\" />';";
-  html += "        html += '<label>Tempo:</label><input type=\"number\" id=\"tempo_' + f.name + '\" value=\"1.0\" min=\"0.1\" max=\"4\" step=\"0.1\" />';";
-  html += "        html += '<label>Transpose:</label><input type=\"number\" id=\"trans_' + f.name + '\" value=\"0\" min=\"-12\" max=\"12\" />';";
-  html += "        html += '<button onclick=\"playFile(\\'' + f.name + '\\');\">Play</button>';";
-  html += "        html += '<button class=\"delete\" onclick=\"deleteFile(\\'' + f.name + '\\');\">Delete</button>';";
-  html += "        html += '</div></div>';";
-  html += "      });";
-  html += "    }";
-  html += "    document.getElementById('fileList').innerHTML = html;";
-  html += "    const st = data.storage;";
-  html += "    document.getElementById('storage').textContent = 'Storage: ' + (st.used/1024).toFixed(1) + ' KB used / ' + (st.total/1024).toFixed(1) + ' KB total (' + (st.free/1024).toFixed(1) + ' KB free)';";
-  html += "  });";
-  html += "}";
-  html += "function playFile(name) {";
-  html += "  const vel = document.getElementById('vel_' + name).value;";
-  html += "  const tempo = document.getElementById('tempo_' + name).value;";
-  html += "  const trans = document.getElementById('trans_' + name).value;";
-  html += "  fetch('/files/play?name=' + encodeURIComponent(name) + '&velocity=' + vel + '&tempo=' + tempo + '&transpose=' + trans, {method: 'POST'})";
-  html += "    .then(r => r.json()).then(d => showStatus(d.message, d.success));";
-  html += "}";
-  html += "function deleteFile(name) {";
-  html += "  if (!confirm('Delete ' + name + '?')) return;";
-  html += "  fetch('/files/' + encodeURIComponent(name), {method: 'DELETE'})";
-  html += "    .then(r => r.json()).then(d => { showStatus(d.message, d.success); loadFiles(); });";
-  html += "}";
-  html += "function uploadFile() {";
-  html += "  const input = document.getElementById('fileInput');";
-  html += "  if (!input.files[0]) { alert('Select a file first'); return; }";
-  html += "  const formData = new FormData();";
-  html += "  formData.append('file', input.files[0]);";
-  html += "  fetch('/files/upload', {method: 'POST', body: formData})";
-  html += "    .then(r => r.json()).then(d => { showStatus(d.message, d.success); if(d.success) loadFiles(); });";
-  html += "}";
-  html += "function showStatus(msg, ok) {";
-  html += "  const s = document.getElementById('status');";
-  html += "  s.textContent = msg;";
-  html += "  s.className = ok ? 'status' : 'status error';";
-  html += "  s.style.display = 'block';";
-  html += "  setTimeout(() => s.style.display = 'none', 3000);";
-  html += "}";
-  html += "loadFiles();";
-  html += "</script></body></html>";
-  
-  server.send(200, "text/html", html);
+  HttpStream out(server, 200, "text/html");
+  out.print("<!DOCTYPE html><html><head>");
+  out.print("<meta name='viewport' content='width=device-width, initial-scale=1'>");
+  out.print("<title>MIDI Player</title>");
+  out.print("<style>");
+  out.print("body { font-family: Arial, sans-serif; margin: 20px; background: #f0f0f0; }");
+  out.print("h1 { color: #333; }");
+  out.print(".container { max-width: 800px; margin: 0 auto; background: white; padding: 20px; border-radius: 10px; box-shadow: 0 2px 5px rgba(0,0,0,0.1); }");
+  out.print(".file { display: flex; justify-content: space-between; align-items: center; padding: 15px; margin: 10px 0; background: #f9f9f9; border-radius: 5px; border-left: 4px solid #4CAF50; }");
+  out.print(".file-info { flex-grow: 1; }");
+  out.print(".file-name { font-weight: bold; font-size: 16px; }");
+  out.print(".file-size { color: #666; font-size: 14px; }");
+  out.print(".controls { display: flex; gap: 10px; align-items: center; }");
+  out.print("button { padding: 8px 16px; font-size: 14px; border: none; background: #4CAF50; color: white; border-radius: 4px; cursor: pointer; }");
+  out.print("button:hover { background: #45a049; }");
+  out.print("button.delete { background: #f44336; }");
+  out.print("button.delete:hover { background: #da190b; }");
+  out.print("input[type=number] { width: 60px; padding: 5px; border: 2px solid #ddd; border-radius: 4px; }");
+  out.print(".upload { margin-bottom: 20px; padding: 15px; background: #e3f2fd; border-radius: 5px; }");
+  out.print(".status { margin-top: 15px; padding: 10px; background: #e8f5e9; border-radius: 5px; display: none; }");
+  out.print(".error { background: #ffebee !important; color: #c62828; }");
+  out.print(".storage { margin-top: 15px; padding: 10px; background: #fff3e0; border-radius: 5px; font-size: 14px; }");
+  out.print("</style></head><body>");
+  out.print("<div class='container'>");
+  out.print("<h1>MIDI File Player</h1>");
+  out.print("<div class='upload'>");
+  out.print("<input type='file' id='fileInput' accept='.mid,.midi' />");
+  out.print("<button onclick='uploadFile()'>Upload</button>");
+  out.print("</div>");
+  out.print("<div id='storage' class='storage'>Loading storage info...</div>");
+  out.print("<div id='fileList'>Loading files...</div>");
+  out.print("<div id='status' class='status'></div>");
+  out.print("</div>");
+  out.print("<script>");
+  out.print("function loadFiles() {");
+  out.print("  fetch('/files').then(r => r.json()).then(data => {");
+  out.print("    let html = '';");
+  out.print("    if (data.files.length === 0) {");
+  out.print("      html = '<p>No MIDI files uploaded yet.</p>';");
+  out.print("    } else {");
+  out.print("      data.files.forEach(f => {");
+  out.print("        html += '<div class=\"file\">';");
+  out.print("        html += '<div class=\"file-info\"><div class=\"file-name\">' + f.name + '</div>';");
+  out.print("        html += '<div class=\"file-size\">' + f.size + ' bytes</div></div>';");
+  out.print("        html += '<div class=\"controls\">';");
+  out.print("        html += '<label>Vel:</label><input type=\"number\" id=\"vel_' + f.name + '\" value=\"1.0\" min=\"0\" max=\"2\" step=\"0.1\" />';");
+  out.print("        html += '<label>Tempo:</label><input type=\"number\" id=\"tempo_' + f.name + '\" value=\"1.0\" min=\"0.1\" max=\"4\" step=\"0.1\" />';");
+  out.print("        html += '<label>Transpose:</label><input type=\"number\" id=\"trans_' + f.name + '\" value=\"0\" min=\"-12\" max=\"12\" />';");
+  out.print("        html += '<button onclick=\"playFile(\\'' + f.name + '\\');\">Play</button>';");
+  out.print("        html += '<button class=\"delete\" onclick=\"deleteFile(\\'' + f.name + '\\');\">Delete</button>';");
+  out.print("        html += '</div></div>';");
+  out.print("      });");
+  out.print("    }");
+  out.print("    document.getElementById('fileList').innerHTML = html;");
+  out.print("    const st = data.storage;");
+  out.print("    document.getElementById('storage').textContent = 'Storage: ' + (st.used/1024).toFixed(1) + ' KB used / ' + (st.total/1024).toFixed(1) + ' KB total (' + (st.free/1024).toFixed(1) + ' KB free)';");
+  out.print("  });");
+  out.print("}");
+  out.print("function playFile(name) {");
+  out.print("  const vel = document.getElementById('vel_' + name).value;");
+  out.print("  const tempo = document.getElementById('tempo_' + name).value;");
+  out.print("  const trans = document.getElementById('trans_' + name).value;");
+  out.print("  fetch('/files/play?name=' + encodeURIComponent(name) + '&velocity=' + vel + '&tempo=' + tempo + '&transpose=' + trans, {method: 'POST'})");
+  out.print("    .then(r => r.json()).then(d => showStatus(d.message, d.success));");
+  out.print("}");
+  out.print("function deleteFile(name) {");
+  out.print("  if (!confirm('Delete ' + name + '?')) return;");
+  out.print("  fetch('/files/' + encodeURIComponent(name), {method: 'DELETE'})");
+  out.print("    .then(r => r.json()).then(d => { showStatus(d.message, d.success); loadFiles(); });");
+  out.print("}");
+  out.print("function uploadFile() {");
+  out.print("  const input = document.getElementById('fileInput');");
+  out.print("  if (!input.files[0]) { alert('Select a file first'); return; }");
+  out.print("  const formData = new FormData();");
+  out.print("  formData.append('file', input.files[0]);");
+  out.print("  fetch('/files/upload', {method: 'POST', body: formData})");
+  out.print("    .then(r => r.json()).then(d => { showStatus(d.message, d.success); if(d.success) loadFiles(); });");
+  out.print("}");
+  out.print("function showStatus(msg, ok) {");
+  out.print("  const s = document.getElementById('status');");
+  out.print("  s.textContent = msg;");
+  out.print("  s.className = ok ? 'status' : 'status error';");
+  out.print("  s.style.display = 'block';");
+  out.print("  setTimeout(() => s.style.display = 'none', 3000);");
+  out.print("}");
+  out.print("loadFiles();");
+  out.print("</script></body></html>");
 }
 
 extern "C" {
@@ -592,6 +606,7 @@ void httpserver_begin() {
   server.on("/channels", HTTP_GET, handleChannels);
   server.on("/logs", HTTP_GET, handleLogsPage);
   server.on("/logs/poll", HTTP_GET, handleLogsPoll);
+  server.on("/logs/stream", HTTP_GET, handleLogsStream);
   server.on("/note_on_by_index", HTTP_GET, handleNoteOnByIndex);
   server.on("/note_off_by_index", HTTP_GET, handleNoteOffByIndex);
   server.on("/note_on", HTTP_GET, handleNoteOn);
@@ -600,6 +615,10 @@ void httpserver_begin() {
   server.on("/seq_stop", HTTP_GET, handleSeqStop);
   server.on("/seq_pause", HTTP_GET, handleSeqPause);
   server.on("/seq_resume", HTTP_GET, handleSeqResume);
+  server.on("/can/stats", HTTP_GET, handleCanStats);
+  server.on("/can/stream", HTTP_POST, handleCanStream);
+  server.on("/can/echo", HTTP_POST, handleCanEcho);
+  server.on("/can/reset", HTTP_POST, handleCanReset);
   server.on("/time", HTTP_GET, handleTime);
   server.on("/time/sync", HTTP_GET, handleTimeSync);
   server.on("/time/set", HTTP_POST, handleTimeSet);
@@ -613,12 +632,14 @@ void httpserver_begin() {
   });
   
   // Start server
+  webasset_begin(server);
   server.begin();
   // Serial.println("HTTP server started on port 80");
 }
 
 void httpserver_loop() {
   server.handleClient();
+  logStream.pump();
 }
 
 } // extern "C"
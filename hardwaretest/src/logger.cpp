@@ -1,31 +1,224 @@
 // logger.cpp - Unified logging implementation
 #include "logger.h"
 #include "httpserver.h"
+#include <atomic>
 
 UnifiedLogger Log;
 
-size_t UnifiedLogger::write(uint8_t c) {
-  size_t n = 0;
-  // Serial.write(c);
-  if (telnetClient && telnetClient->connected()) {
-    telnetClient->write(c);
+// ---------- Telnet sink ----------
+// Writers copy into a byte ring under a short critical section; the telnet
+// task sends it to the client in large writes and is the only one to touch
+// the socket, so a stalled client holds up that task and nothing else. A
+// writer that finds the ring full drops its oldest bytes.
+
+#define TELNET_BUFFER     8192  // Power of two
+#define TELNET_CHUNK      1024  // Most bytes per socket write
+#define TELNET_PERIOD_MS  10    // How often the telnet task looks for work when idle
+#define TELNET_STACK      4096
+#define TELNET_PRIORITY   1
+#define TELNET_CORE       0
+
+static portMUX_TYPE telnetMux = portMUX_INITIALIZER_UNLOCKED;
+static char telnetRing[TELNET_BUFFER];
+static uint32_t telnetHead = 0;          // Under telnetMux
+static uint32_t telnetTail = 0;          // Under telnetMux
+static uint32_t telnetLost = 0;          // Under telnetMux; not yet reported to the client
+static uint32_t telnetLostTotal = 0;     // Under telnetMux
+static volatile bool telnetOpen = false; // A client is connected; nothing is kept otherwise
+static WiFiServer* telnetServer = nullptr;
+static WiFiClient telnetClient;          // Telnet task only
+
+static void telnet_put(const uint8_t* data, size_t size) {
+  if (!telnetOpen) return;
+  portENTER_CRITICAL(&telnetMux);
+  if (size > TELNET_BUFFER) {
+    telnetLost += size - TELNET_BUFFER;
+    telnetLostTotal += size - TELNET_BUFFER;
+    data += size - TELNET_BUFFER;
+    size = TELNET_BUFFER;
+  }
+  for (size_t i = 0; i < size; i++) telnetRing[telnetHead++ & (TELNET_BUFFER - 1)] = data[i];
+  if (telnetHead - telnetTail > TELNET_BUFFER) {
+    uint32_t over = telnetHead - telnetTail - TELNET_BUFFER;
+    telnetLost += over;
+    telnetLostTotal += over;
+    telnetTail += over;
   }
+  portEXIT_CRITICAL(&telnetMux);
+}
+
+// Move up to size bytes out of the ring; *lost gets the bytes dropped
+// since the last call
+static size_t telnet_take(char* out, size_t size, uint32_t* lost) {
+  portENTER_CRITICAL(&telnetMux);
+  size_t n = telnetHead - telnetTail;
+  if (n > size) n = size;
+  for (size_t i = 0; i < n; i++) out[i] = telnetRing[(telnetTail + i) & (TELNET_BUFFER - 1)];
+  telnetTail += n;
+  *lost = telnetLost;
+  telnetLost = 0;
+  portEXIT_CRITICAL(&telnetMux);
   return n;
 }
 
+static void telnetTask(void* arg) {
+  char buf[TELNET_CHUNK];
+  for (;;) {
+    if (telnetServer->hasClient()) {
+      WiFiClient newClient = telnetServer->available();
+      if (newClient) {
+        if (telnetClient.connected()) telnetClient.stop();
+        telnetClient = newClient;
+        // Start the new client at the present
+        portENTER_CRITICAL(&telnetMux);
+        telnetTail = telnetHead;
+        telnetLost = 0;
+        portEXIT_CRITICAL(&telnetMux);
+        telnetOpen = true;
+        Log.println("\nTelnet client connected");
+      }
+    }
+    if (telnetOpen && !telnetClient.connected()) {
+      telnetOpen = false;
+      telnetClient.stop();
+    }
+
+    uint32_t lost = 0;
+    size_t n = telnetOpen ? telnet_take(buf, sizeof(buf), &lost) : 0;
+    if (lost) telnetClient.printf("\n[%u log bytes dropped]\n", (unsigned)lost);
+    if (n && telnetClient.write((const uint8_t*)buf, n) != n) {
+      telnetOpen = false;   // Timed out or gone; the next client starts afresh
+      telnetClient.stop();
+    }
+    // Keep going while there is a backlog
+    if (n < sizeof(buf)) vTaskDelay(pdMS_TO_TICKS(TELNET_PERIOD_MS));
+  }
+}
+
+size_t UnifiedLogger::write(uint8_t c) {
+  return write(&c, 1);
+}
+
 size_t UnifiedLogger::write(const uint8_t *buffer, size_t size) {
-  size_t n = 0;
   // Serial.write(buffer, size);
-  if (telnetClient && telnetClient->connected()) {
-    n = telnetClient->write(buffer, size);
-  }
+  telnet_put(buffer, size);
   
-  // Send raw buffer to HTTP logger (it will handle String building if enabled)
+  // Send raw buffer to the HTTP log ring
   httpserver_log(buffer, size);
   
+  return size;
+}
+
+void UnifiedLogger::serveTelnet(WiFiServer& server) {
+  if (telnetServer) return;
+  telnetServer = &server;
+  xTaskCreatePinnedToCore(telnetTask, "telnet", TELNET_STACK, nullptr, TELNET_PRIORITY, nullptr, TELNET_CORE);
+}
+
+uint32_t UnifiedLogger::telnetDropped() {
+  portENTER_CRITICAL(&telnetMux);
+  uint32_t n = telnetLostTotal;
+  portEXIT_CRITICAL(&telnetMux);
   return n;
 }
 
-void UnifiedLogger::setTelnetClient(WiFiClient* client) {
-  telnetClient = client;
+// ---------- Deferred logging ----------
+// One ring per core. Any task or ISR on the core claims a slot with an
+// atomic add and publishes it by writing seq last, as in notetrace.h. The
+// logger task is the only reader; it never holds up a writer, and a writer
+// that laps it overwrites records it has not printed yet.
+
+#define LOGGER_RECORDS    128   // Per core; power of two
+#define LOGGER_PERIOD_MS  10    // How often the logger task empties the rings
+#define LOGGER_LINE       192   // Longest formatted line
+#define LOGGER_STACK      4096
+#define LOGGER_PRIORITY   1
+#define LOGGER_CORE       0
+
+struct LogRecord {
+  const char* fmt;
+  uint32_t us;       // micros() at the call; orders the two cores' records
+  uint32_t seq;      // Ring position + 1, written last; 0 while the record is being written
+  LogArgs args;
+};
+
+struct LogRing {
+  std::atomic<uint32_t> head;
+  uint32_t tail;     // Logger task only
+  LogRecord rec[LOGGER_RECORDS];
+};
+
+static LogRing logRings[portNUM_PROCESSORS];
+static uint32_t logDropped = 0;   // Logger task only
+
+void logger_push(const char* fmt, const LogArgs& args) {
+  LogRing& r = logRings[xPortGetCoreID()];
+  uint32_t i = r.head.fetch_add(1, std::memory_order_relaxed);
+  LogRecord& e = r.rec[i & (LOGGER_RECORDS - 1)];
+  __atomic_store_n(&e.seq, 0, __ATOMIC_RELAXED);
+  std::atomic_thread_fence(std::memory_order_release);
+  e.fmt = fmt;
+  e.us = micros();
+  e.args = args;
+  __atomic_store_n(&e.seq, i + 1, __ATOMIC_RELEASE);
+}
+
+// Copy the ring's oldest unprinted record; false when there is none or it
+// is still being written. Records a writer has lapped are counted as lost.
+static bool logger_peek(LogRing& r, LogRecord& out) {
+  for (;;) {
+    uint32_t head = r.head.load(std::memory_order_acquire);
+    if (r.tail == head) return false;
+    if (head - r.tail > LOGGER_RECORDS) {
+      logDropped += head - LOGGER_RECORDS - r.tail;
+      r.tail = head - LOGGER_RECORDS;
+    }
+    LogRecord& e = r.rec[r.tail & (LOGGER_RECORDS - 1)];
+    uint32_t seq = __atomic_load_n(&e.seq, __ATOMIC_ACQUIRE);
+    if (seq != r.tail + 1) {
+      if ((int32_t)(seq - (r.tail + 1)) <= 0) return false;
+      r.tail++;   // Already overwritten by a newer record
+      logDropped++;
+      continue;
+    }
+    out = e;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (__atomic_load_n(&e.seq, __ATOMIC_RELAXED) == seq) return true;
+    r.tail++;     // Overwritten while it was being copied
+    logDropped++;
+  }
+}
+
+// Print everything in the rings, the two cores' records merged by time
+static void logger_drain() {
+  char line[LOGGER_LINE];
+  LogRecord rec[portNUM_PROCESSORS];
+  bool ready[portNUM_PROCESSORS] = {};
+  for (;;) {
+    int next = -1;
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+      if (!ready[c]) ready[c] = logger_peek(logRings[c], rec[c]);
+      if (ready[c] && (next < 0 || (int32_t)(rec[c].us - rec[next].us) < 0)) next = c;
+    }
+    if (next < 0) break;
+    size_t n = logger_format(line, sizeof(line), rec[next].fmt, rec[next].args.w, rec[next].args.n);
+    Log.write((const uint8_t*)line, n);
+    logRings[next].tail++;
+    ready[next] = false;
+  }
+  if (logDropped) {
+    Log.printf("Log: %u records lost (ring full)\n", (unsigned)logDropped);
+    logDropped = 0;
+  }
+}
+
+static void loggerTask(void* arg) {
+  for (;;) {
+    logger_drain();
+    vTaskDelay(pdMS_TO_TICKS(LOGGER_PERIOD_MS));
+  }
+}
+
+void logger_begin() {
+  xTaskCreatePinnedToCore(loggerTask, "logger", LOGGER_STACK, nullptr, LOGGER_PRIORITY, nullptr, LOGGER_CORE);
 }
@@ -15,10 +15,14 @@ public:
   size_t write(uint8_t c) override;
   size_t write(const uint8_t *buffer, size_t size) override;
   
-  void setTelnetClient(WiFiClient* client);
-  
-private:
-  WiFiClient* telnetClient = nullptr;
+  // Send the log to clients of server, a begun telnet server, from the
+  // telnet task. write() only copies into that task's buffer and never
+  // waits on the socket; a client too slow to keep up misses the oldest
+  // bytes instead, with a note in its stream.
+  void serveTelnet(WiFiServer& server);
+
+  // Bytes telnet clients have missed since boot
+  uint32_t telnetDropped();
 };
 
 // Global logger instance
@@ -26,6 +30,194 @@ extern UnifiedLogger Log;
 
 #ifdef __cplusplus
 }
+
+#include <string.h>
+#include <type_traits>
+
+// ---------- Deferred logging ----------
+// LOG_DEBUG, LOG_INFO, LOG_WARN and LOG_ERROR take a printf format and its
+// arguments like Log.printf, but format nothing at the call. The format
+// pointer and the raw argument words go into a ring for the calling core,
+// and the logger task (logger_begin) formats them and writes them to Log
+// later, at low priority. Use them on the note path; Log.printf is still
+// fine for setup and for commands.
+//
+// The format must be a string literal, and a %s argument must outlive the
+// call (a literal or a static table) since only its pointer is kept. '*'
+// widths and %n are not supported. A full ring overwrites its oldest
+// records and the logger task reports how many it lost.
+//
+// Calls below LOG_LEVEL (build flag, default LOG_LEVEL_INFO) compile to
+// nothing, arguments included.
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE  4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_MAX_WORDS 8   // 32-bit argument words per call; doubles and 64-bit integers take two
+
+// Raw arguments of one call, packed in order
+struct LogArgs {
+  uint32_t w[LOG_MAX_WORDS];
+  uint8_t n = 0;
+
+  void put(uint32_t v) {
+    if (n < LOG_MAX_WORDS) w[n++] = v;
+  }
+  void put64(uint64_t v) {
+    put((uint32_t)v);
+    put((uint32_t)(v >> 32));
+  }
+
+  template <typename T>
+  static constexpr int words() {
+    return std::is_floating_point<T>::value || sizeof(T) > 4 ? 2 : 1;
+  }
+
+  template <typename T>
+  void add(T v) {
+    if constexpr (std::is_floating_point<T>::value) {
+      double d = v;
+      uint64_t bits;
+      memcpy(&bits, &d, sizeof(bits));
+      put64(bits);
+    } else if constexpr (std::is_pointer<T>::value) {
+      if constexpr (sizeof(T) > 4) put64((uint64_t)(uintptr_t)v);
+      else put((uint32_t)(uintptr_t)v);
+    } else if constexpr (sizeof(T) > 4) {
+      put64((uint64_t)v);
+    } else {
+      put((uint32_t)v);
+    }
+  }
+};
+
+// Queue one call for the logger task; never blocks
+void logger_push(const char* fmt, const LogArgs& args);
+
+// Start the logger task. Calls made before it runs wait in the rings.
+void logger_begin();
+
+template <typename... A>
+static inline void logger_defer(const char* fmt, A... args) {
+  static_assert((0 + ... + LogArgs::words<A>()) <= LOG_MAX_WORDS, "Too many arguments to log deferred");
+  LogArgs a;
+  (a.add(args), ...);
+  logger_push(fmt, a);
+}
+
+// Never called; lets the compiler check the arguments against the format
+__attribute__((format(printf, 1, 2))) static inline void logger_check(const char* fmt, ...) {}
+
+#define LOG_DEFER(fmt, ...) do { \
+    if (0) logger_check(fmt, ##__VA_ARGS__); \
+    logger_defer(fmt, ##__VA_ARGS__); \
+  } while (0)
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(fmt, ...) LOG_DEFER(fmt, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(fmt, ...) ((void)0)
+#endif
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(fmt, ...) LOG_DEFER(fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO(fmt, ...) ((void)0)
+#endif
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(fmt, ...) LOG_DEFER(fmt, ##__VA_ARGS__)
+#else
+#define LOG_WARN(fmt, ...) ((void)0)
 #endif
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(fmt, ...) LOG_DEFER(fmt, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...) ((void)0)
+#endif
+
+// Format one queued call into out, truncated to size - 1 like snprintf.
+// Each conversion takes as many words as logger_defer() packed for it.
+static inline size_t logger_format(char* out, size_t size, const char* fmt, const uint32_t* w, uint8_t n) {
+  size_t len = 0;
+  uint8_t used = 0;
+  if (size == 0) return 0;
+  while (*fmt && len + 1 < size) {
+    if (*fmt != '%') {
+      out[len++] = *fmt++;
+      continue;
+    }
+    // Copy flags, width and precision; drop the length, which is
+    // rewritten below to match how the argument was packed
+    char spec[16];
+    size_t k = 0;
+    size_t bytes = 4;   // Integer size the length asks for
+    spec[k++] = *fmt++;
+    while (*fmt && strchr("-+ #0123456789.hlLzjt", *fmt)) {
+      if (*fmt == 'l') bytes = fmt[-1] == 'l' ? 8 : sizeof(long);
+      else if (*fmt == 'j') bytes = 8;
+      else if (*fmt == 'z' || *fmt == 't') bytes = sizeof(size_t);
+      else if (*fmt != 'h' && *fmt != 'L' && k < sizeof(spec) - 4) spec[k++] = *fmt;
+      fmt++;
+    }
+    char type = *fmt;
+    if (!type) break;
+    fmt++;
+
+    int words;
+    if (type == '%') {
+      out[len++] = '%';
+      continue;
+    } else if (strchr("diouxXc", type)) {
+      words = bytes > 4 ? 2 : 1;
+    } else if (strchr("fFeEgGaA", type)) {
+      words = 2;
+    } else if (type == 's' || type == 'p') {
+      words = sizeof(void*) > 4 ? 2 : 1;
+    } else {
+      break;   // Not a conversion logger_defer() can carry
+    }
+    if (used + words > n) break;
+
+    uint64_t v = w[used];
+    if (words == 2) v |= (uint64_t)w[used + 1] << 32;
+    used += words;
+
+    int r;
+    if (strchr("fFeEgGaA", type)) {
+      spec[k++] = type;
+      spec[k] = 0;
+      double d;
+      memcpy(&d, &v, sizeof(d));
+      r = snprintf(out + len, size - len, spec, d);
+    } else if (type == 's' || type == 'p') {
+      spec[k++] = type;
+      spec[k] = 0;
+      const void* p = (const void*)(uintptr_t)v;
+      r = type == 's' ? snprintf(out + len, size - len, spec, p ? (const char*)p : "(null)")
+                      : snprintf(out + len, size - len, spec, p);
+    } else if (words == 2) {
+      spec[k++] = 'l';
+      spec[k++] = 'l';
+      spec[k++] = type;
+      spec[k] = 0;
+      r = snprintf(out + len, size - len, spec, (long long)v);
+    } else {
+      spec[k++] = type;
+      spec[k] = 0;
+      // Sign-extend so %d of a negative int prints as one
+      r = snprintf(out + len, size - len, spec, (int)(int32_t)v);
+    }
+    if (r > 0) len += (size_t)r < size - len ? (size_t)r : size - len - 1;
+  }
+  out[len] = 0;
+  return len;
+}
+
+#endif // __cplusplus
 
 #endif // LOGGER_H
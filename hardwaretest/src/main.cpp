@@ -14,6 +14,7 @@
 #include "midiudp.h"
 #include "httpserver.h"
 #include "can_bus.h"
+#include "cananalyzer.h"
 
 // ---- WiFi creds ----
 static const char* WIFI_SSID = "HAWI";
@@ -24,7 +25,6 @@ static const char* WIFI_PASS = "murphalurf18";
 
 // Telnet server for remote logging
 WiFiServer telnetServer(23);
-WiFiClient telnetClient;
 
 // // Custom print that outputs to both Serial and Telnet
 // class DualOutput : public Print {
@@ -184,6 +184,7 @@ void updatePattern() {
 // ---------- Setup / loop ----------
 void setup() {
   Serial.begin(115200);
+  logger_begin();
 
   wifi_connect();
   
@@ -217,6 +218,7 @@ void setup() {
   midiUDP.begin();  // Start MIDI/UDP receiver on port 21928
   timekeeping.begin();
   can_bus_begin();  // Start CAN bus (TWAI) for note event broadcast
+  canAnalyzer.begin();  // Capture and time every frame on the bus
 
   clearAll();
   flushOutput();
@@ -224,22 +226,15 @@ void setup() {
     // Start telnet server
   telnetServer.begin();
   telnetServer.setNoDelay(true);
+  Log.serveTelnet(telnetServer);
 }
 
 void loop() {
   handleButton();
+  canAnalyzer.update();
   // updatePattern();
+  // Telnet clients are taken by the logger's telnet task
   if (WiFi.status() == WL_CONNECTED) {
-    // Check for new telnet clients
-    if (telnetServer.hasClient()) {
-      // Disconnect old client if exists
-      if (telnetClient) {
-        telnetClient.stop();
-      }
-      telnetClient = telnetServer.available();
-      Log.println("\nTelnet client connected");
-    }
-    
     // Handle OTA
     ArduinoOTA.handle();
     
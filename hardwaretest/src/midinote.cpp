@@ -36,7 +36,7 @@ void note_on(uint8_t midi_note, uint8_t velocity) {
     // Mark note as on
     note_state[midi_note] = true;
 
-    Log.printf("MIDI Note On: %d -> index: %d\n", midi_note, output_index);
+    LOG_DEBUG("MIDI Note On: %d -> index: %d\n", midi_note, output_index);
     // Start the note
     setChannel(output_index, true);
     flushOutput();
@@ -58,7 +58,7 @@ void note_off(uint8_t midi_note, uint8_t velocity) {
   
   int output_index = midinote_to_outputindex(midi_note);
 
-  Log.printf("MIDI Note Off: %d -> index: %d\n", midi_note, output_index);
+  LOG_DEBUG("MIDI Note Off: %d -> index: %d\n", midi_note, output_index);
 
   setChannel(output_index, false);
   flushOutput();
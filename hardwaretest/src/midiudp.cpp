@@ -64,18 +64,18 @@ void MIDIoverUDP::update() {
 }
 
 void MIDIoverUDP::handlePacket(uint8_t* data, size_t length) {
-    Log.printf("MIDI/UDP: Received packet of %d bytes\r\n", length);
+    LOG_DEBUG("MIDI/UDP: Received packet of %u bytes\r\n", (unsigned)length);
     // Validate minimum packet size
     if (length < MIN_PACKET_SIZE) {
         packetsDropped++;
-        Log.printf("MIDI/UDP: Packet too small (%d bytes)\n", length);
+        LOG_WARN("MIDI/UDP: Packet too small (%u bytes)\n", (unsigned)length);
         return;
     }
     
     // Validate magic bytes
     if (data[0] != MAGIC_M || data[1] != MAGIC_U) {
         packetsDropped++;
-        Log.printf("MIDI/UDP: Invalid magic bytes: 0x%02X 0x%02X\n", data[0], data[1]);
+        LOG_WARN("MIDI/UDP: Invalid magic bytes: 0x%02X 0x%02X\n", data[0], data[1]);
         return;
     }
     
@@ -83,7 +83,7 @@ void MIDIoverUDP::handlePacket(uint8_t* data, size_t length) {
     uint8_t version = data[2];
     if (version != VERSION) {
         packetsDropped++;
-        Log.printf("MIDI/UDP: Unsupported version: %d\n", version);
+        LOG_WARN("MIDI/UDP: Unsupported version: %d\n", version);
         return;
     }
     
@@ -91,7 +91,7 @@ void MIDIoverUDP::handlePacket(uint8_t* data, size_t length) {
     uint8_t count = data[3];
     if (count == 0) {
         packetsDropped++;
-        Log.println("MIDI/UDP: Empty packet (count=0)");
+        LOG_WARN("MIDI/UDP: Empty packet (count=0)\n");
         return;
     }
     
@@ -103,7 +103,7 @@ void MIDIoverUDP::handlePacket(uint8_t* data, size_t length) {
         // Need at least status + data1
         if (remaining < 2) {
             packetsDropped++;
-            Log.printf("MIDI/UDP: Truncated packet at message %d\n", i);
+            LOG_WARN("MIDI/UDP: Truncated packet at message %d\n", i);
             return;
         }
         
@@ -113,7 +113,7 @@ void MIDIoverUDP::handlePacket(uint8_t* data, size_t length) {
         // Validate status byte (must be 0x80-0xEF)
         if (status < 0x80 || status > 0xEF) {
             packetsDropped++;
-            Log.printf("MIDI/UDP: Invalid status byte: 0x%02X\n", status);
+            LOG_WARN("MIDI/UDP: Invalid status byte: 0x%02X\n", status);
             return;
         }
         
@@ -127,7 +127,7 @@ void MIDIoverUDP::handlePacket(uint8_t* data, size_t length) {
         if (type != 0xC0 && type != 0xD0) {  // Not Program Change or Channel Pressure
             if (remaining < 1) {
                 packetsDropped++;
-                Log.printf("MIDI/UDP: Truncated packet (missing data2) at message %d\n", i);
+                LOG_WARN("MIDI/UDP: Truncated packet (missing data2) at message %d\n", i);
                 return;
             }
             d2 = *p++;
@@ -373,6 +373,13 @@ Response: {
         <div class="example">Example: /note_off?note=60</div>
     </div>
 
+    <div class="endpoint">
+        <span class="method get">GET</span>
+        <span class="path">/ws</span>
+        <div class="description">WebSocket for playing with low latency. Binary messages both ways are MUDP packets (docs/MIDIUDP.md): note-ons and note-offs sent press and release notes like /note_on and /note_off, CC 123 releases them all, and every change to the division bitmap comes back as a note-on or note-off. Two connections at a time.</div>
+        <div class="example">Example: new WebSocket('ws://' + location.host + '/ws')</div>
+    </div>
+
     <div class="endpoint">
         <span class="method get">GET</span>
         <span class="path">/all_off</span>
@@ -596,8 +603,15 @@ Response: {"success":true,"message":"Playback started"}
     <div class="endpoint">
         <span class="method get">GET</span>
         <span class="path">/logs/poll</span>
-        <div class="description">Poll for new log entries (used by /logs page)</div>
-        <div class="example">Example: /logs/poll</div>
+        <div class="description">New log lines as JSON; pass the returned index as since on the next poll</div>
+        <div class="example">Example: /logs/poll?since=0</div>
+    </div>
+
+    <div class="endpoint">
+        <span class="method get">GET</span>
+        <span class="path">/logs/stream</span>
+        <div class="description">Server-Sent Events stream of the log (used by /logs page): the lines still buffered, then new lines as they are logged. Reconnect with since set to the last event id.</div>
+        <div class="example">Example: curl -N /logs/stream?since=0</div>
     </div>
 
     <hr>
@@ -1,26 +1,304 @@
 #include "can_bus.h"
+#include "key_scanner.h"
 #include "pins.h"
 #include "logger.h"
 
+#include <Arduino.h>
 #include "driver/twai.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
 
-// CAN channel number for "Great" manual (per can-protocol.md)
-#define CAN_CHANNEL_GREAT 0
+// ---- TX scheduler ----
+// Frames wait in a small software table instead of the driver's FIFO:
+//   - a frame for the same key / division replaces the pending one, so a
+//     burst of changes costs one frame carrying the latest state
+//   - high-priority frames (stops, all-notes-off) are sent before anything else
+//   - the driver queue is kept at DRIVER_TX_DEPTH so this ordering holds
+// Nothing here blocks: callers only take the table mutex, and the driver is
+// refilled from the caller and from the alert task as frames complete.
+#define PENDING_MAX        32
+#define DRIVER_TX_DEPTH    2
+#define MAX_TRACKED_IDS    32
+#define STALL_FLUSH_MS     100    // Drop unacknowledged frames after this long error-passive
+
+// CAN channel numbers (per can-protocol.md)
+#define CAN_CHANNEL_STOPS  4
+
+// Message types (CAN ID bits 10-8)
+#define MSG_NOTE_OFF   0x0
+#define MSG_NOTE_ON    0x1
+#define MSG_DIV_STATE  0x2
+#define MSG_CONTROL    0x3
+
+// Diagnostics: ECHO_REQ / ECHO_REPLY (per can-protocol.md)
+#define ID_ECHO_REQ    0x700
+#define ID_ECHO_REPLY  0x780
+#define ECHO_TARGET_ALL 0xFF
+
+#define CC_ALL_NOTES_OFF  123
+
+struct PendingFrame {
+    uint32_t key;        // Coalescing key; 0 = free slot
+    uint32_t seq;        // Enqueue order (FIFO within a priority)
+    uint16_t id;
+    uint8_t  dlc;
+    uint8_t  high;       // Jumps the queue
+    uint8_t  data[8];
+};
+
+static PendingFrame pending[PENDING_MAX];
+static int          numPending = 0;
+static uint32_t     nextSeq = 1;
+static PendingFrame inDriver[DRIVER_TX_DEPTH];   // Last frames handed to the driver, by numHandedOver
+static uint32_t     numHandedOver = 0;
+static SemaphoreHandle_t txMutex = nullptr;
+static CanTxStats   stats = {};
+static CanIdCount   idCounts[MAX_TRACKED_IDS];
+static int          numIds = 0;
+
+static volatile bool busUp = false;          // Driver started and not bus-off
+static volatile bool errorPassive = false;
+static uint32_t      errorPassiveSinceMs = 0;
+static uint32_t      lastTxSuccessMs = 0;
+
+static void count_id(uint16_t id) {
+    for (int i = 0; i < numIds; i++) {
+        if (idCounts[i].id == id) {
+            idCounts[i].count++;
+            return;
+        }
+    }
+    if (numIds < MAX_TRACKED_IDS) {
+        idCounts[numIds].id    = id;
+        idCounts[numIds].count = 1;
+        numIds++;
+    } else {
+        stats.untrackedIds++;
+    }
+}
+
+// Move pending frames into the driver while it has room (txMutex held)
+static void pump() {
+    if (!busUp) return;
+
+    twai_status_info_t info;
+    if (twai_get_status_info(&info) != ESP_OK) return;
+    uint32_t room = info.msgs_to_tx < DRIVER_TX_DEPTH ? DRIVER_TX_DEPTH - info.msgs_to_tx : 0;
+
+    while (room > 0 && numPending > 0) {
+        // Oldest high-priority frame, else oldest frame
+        int best = -1;
+        for (int i = 0; i < PENDING_MAX; i++) {
+            if (!pending[i].key) continue;
+            if (best < 0 ||
+                pending[i].high > pending[best].high ||
+                (pending[i].high == pending[best].high && pending[i].seq < pending[best].seq)) {
+                best = i;
+            }
+        }
+
+        PendingFrame& f = pending[best];
+        twai_message_t msg = {};
+        msg.extd             = 0;   // Standard frame (11-bit ID)
+        msg.rtr              = 0;   // Data frame
+        msg.identifier       = f.id;
+        msg.data_length_code = f.dlc;
+        memcpy(msg.data, f.data, f.dlc);
+
+        if (twai_transmit(&msg, 0) != ESP_OK) break;   // Retried on the next completion
+        stats.framesQueued++;
+        count_id(f.id);
+        inDriver[numHandedOver++ % DRIVER_TX_DEPTH] = f;
+        f.key = 0;
+        numPending--;
+        room--;
+    }
+}
+
+// Add or replace a pending frame; never blocks
+static bool enqueue(uint32_t key, uint16_t id, const uint8_t* data, uint8_t dlc, bool high) {
+    if (!txMutex) return false;
+    xSemaphoreTake(txMutex, portMAX_DELAY);
+
+    int slot = -1;
+    int free = -1;
+    for (int i = 0; i < PENDING_MAX; i++) {
+        if (pending[i].key == key) {
+            slot = i;
+            break;
+        }
+        if (free < 0 && !pending[i].key) free = i;
+    }
+
+    bool ok = true;
+    if (slot >= 0) {
+        stats.coalesced++;   // Keeps its place in the queue, carries the newer state
+    } else if (free >= 0) {
+        slot = free;
+        pending[slot].key = key;
+        pending[slot].seq = nextSeq++;
+        pending[slot].high = 0;
+        numPending++;
+        if ((uint32_t)numPending > stats.queueHighWater) stats.queueHighWater = numPending;
+    } else {
+        stats.dropped++;
+        ok = false;
+    }
+
+    if (ok) {
+        PendingFrame& f = pending[slot];
+        f.id   = id;
+        f.dlc  = dlc;
+        f.high = high || f.high;
+        memcpy(f.data, data, dlc);
+        pump();
+    }
+
+    xSemaphoreGive(txMutex);
+    return ok;
+}
+
+// After the driver queue was cleared: put the count frames it still held
+// (the newest ones handed over, as it sends in order) back at the front of
+// the table, unless a newer frame for the same key is already waiting.
+// DIV_STATE frames (keys below 0x10000) are state that the next frame or
+// the keepalive repeats, and echo replies (0x3xxxx) are stale, so only
+// notes and all-notes-off (0x1xxxx, 0x2xxxx) come back. txMutex held.
+static void requeue_cleared(uint32_t count) {
+    if (count > DRIVER_TX_DEPTH) count = DRIVER_TX_DEPTH;
+    for (uint32_t n = count; n > 0; n--) {
+        const PendingFrame& f = inDriver[(numHandedOver - n) % DRIVER_TX_DEPTH];
+        if (f.key < 0x10000u || f.key >= 0x30000u) continue;
+
+        int free = -1;
+        bool newer = false;
+        for (int i = 0; i < PENDING_MAX; i++) {
+            if (pending[i].key == f.key) newer = true;
+            if (free < 0 && !pending[i].key) free = i;
+        }
+        if (newer) continue;
+        if (free < 0) {
+            stats.dropped++;
+            continue;
+        }
+        pending[free] = f;
+        pending[free].high = 1;
+        numPending++;
+        stats.stallRequeued++;
+    }
+}
+
+// Answer an ECHO_REQ through the normal queue, so the measured round trip
+// includes our own queueing delay
+static void answer_echo(const twai_message_t& req, uint32_t rxUs) {
+    if (req.data_length_code != 8) return;
+    uint8_t node = (uint8_t)(key_scanner_get_hardware_id() & 0x0F);
+    if (req.data[6] != ECHO_TARGET_ALL && req.data[6] != node) return;
+
+    uint8_t data[8];
+    memcpy(data, req.data, 6);
+    uint32_t held = (uint32_t)esp_timer_get_time() - rxUs;
+    if (held > 0xFFFF) held = 0xFFFF;
+    data[6] = held & 0xFF;
+    data[7] = held >> 8;
+    uint16_t id = ID_ECHO_REPLY | node;
+    if (enqueue(0x30000u | id, id, data, 8, false)) stats.echoReplies++;
+}
+
+// Watches controller state, recovers from bus-off, answers echo requests
+// and refills the driver as frames complete
+static void can_alert_task(void*) {
+    for (;;) {
+        uint32_t alerts = 0;
+        twai_read_alerts(&alerts, pdMS_TO_TICKS(20));
+        uint32_t now = millis();
+
+        if (alerts & TWAI_ALERT_RX_DATA) {
+            uint32_t rxUs = (uint32_t)esp_timer_get_time();
+            twai_message_t msg;
+            while (twai_receive(&msg, 0) == ESP_OK) {
+                if (!msg.extd && !msg.rtr && msg.identifier == ID_ECHO_REQ) answer_echo(msg, rxUs);
+            }
+        }
+
+        if (alerts & TWAI_ALERT_TX_SUCCESS) {
+            lastTxSuccessMs = now;
+        }
+        if (alerts & TWAI_ALERT_TX_FAILED) {
+            stats.txFailed++;
+        }
+        if (alerts & TWAI_ALERT_ERR_PASS) {
+            errorPassive = true;
+            errorPassiveSinceMs = now;
+            stats.errorPassive++;
+            Log.println("CAN: error passive");
+        }
+        if (alerts & TWAI_ALERT_ERR_ACTIVE) {
+            if (errorPassive) Log.println("CAN: error active again");
+            errorPassive = false;
+        }
+        if (alerts & TWAI_ALERT_BUS_OFF) {
+            // Pending state is kept; it goes out once the bus is back
+            busUp = false;
+            stats.busOff++;
+            Log.println("CAN: bus-off, recovering");
+            twai_initiate_recovery();
+        }
+        if (alerts & TWAI_ALERT_BUS_RECOVERED) {
+            if (twai_start() == ESP_OK) {
+                busUp = true;
+                errorPassive = false;
+                Log.println("CAN: bus recovered");
+            }
+        }
+
+        xSemaphoreTake(txMutex, portMAX_DELAY);
+
+        // Error-passive with nothing acknowledged (e.g. alone on the bus):
+        // the controller would retry the queued frames forever and hold the
+        // newer state behind them.  Clear its queue; the note frames in it
+        // go back into the table (requeue_cleared).
+        if (busUp && errorPassive &&
+            now - errorPassiveSinceMs > STALL_FLUSH_MS &&
+            now - lastTxSuccessMs > STALL_FLUSH_MS) {
+            twai_status_info_t info;
+            if (twai_get_status_info(&info) == ESP_OK && info.msgs_to_tx > 0) {
+                twai_clear_transmit_queue();
+                requeue_cleared(info.msgs_to_tx);
+                stats.stallFlushes++;
+                errorPassiveSinceMs = now;
+            }
+        }
+
+        pump();
+        xSemaphoreGive(txMutex);
+    }
+}
 
 extern "C" {
 
 void can_bus_begin() {
+    txMutex = xSemaphoreCreateMutex();
+
     twai_general_config_t g_config = TWAI_GENERAL_CONFIG_DEFAULT(
         (gpio_num_t)PIN_CAN_TX,
         (gpio_num_t)PIN_CAN_RX,
         TWAI_MODE_NORMAL
     );
-    // Small TX queue is enough for proof-of-concept; increase if needed.
-    g_config.tx_queue_len = 8;
+    // The scheduler above orders frames; the driver only holds the next few.
+    g_config.tx_queue_len = DRIVER_TX_DEPTH;
     g_config.rx_queue_len = 8;
+    g_config.alerts_enabled = TWAI_ALERT_TX_SUCCESS | TWAI_ALERT_TX_FAILED |
+                              TWAI_ALERT_TX_IDLE | TWAI_ALERT_RX_DATA | TWAI_ALERT_ERR_PASS |
+                              TWAI_ALERT_ERR_ACTIVE | TWAI_ALERT_BUS_OFF |
+                              TWAI_ALERT_BUS_RECOVERED;
 
     twai_timing_config_t t_config = TWAI_TIMING_CONFIG_500KBITS();
-    twai_filter_config_t f_config = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+    // The only frame a keyboard listens for is ECHO_REQ
+    twai_filter_config_t f_config = {};
+    f_config.acceptance_code = (uint32_t)ID_ECHO_REQ << 21;
+    f_config.acceptance_mask = ~((uint32_t)0x7FF << 21);
+    f_config.single_filter = true;
 
     esp_err_t err = twai_driver_install(&g_config, &t_config, &f_config);
     if (err != ESP_OK) {
@@ -33,41 +311,61 @@ void can_bus_begin() {
         Log.printf("CAN: start failed (%d)\n", err);
         return;
     }
+    busUp = true;
 
+    xTaskCreatePinnedToCore(can_alert_task, "can_alert", 3072, nullptr, 8, nullptr, 1);
     Log.println("CAN: started at 500 kbit/s (TX=GPIO2, RX=GPIO1)");
 }
 
-// Internal helper — builds and transmits a standard 11-bit CAN frame.
-static void can_send(uint32_t can_id, uint8_t note, uint8_t velocity) {
-    twai_message_t msg = {};
-    msg.extd            = 0;   // Standard frame (11-bit ID)
-    msg.rtr             = 0;   // Data frame
-    msg.identifier      = can_id;
-    msg.data_length_code = 3;
-    msg.data[0]         = note;
-    msg.data[1]         = velocity;
-    msg.data[2]         = 0x00;
-
-    esp_err_t err = twai_transmit(&msg, pdMS_TO_TICKS(10));
-    if (err != ESP_OK) {
-        Log.printf("CAN: tx failed (id=0x%03" PRIX32 ", err=%d)\n", can_id, err);
-    }
-}
-
 void can_send_note_on(uint8_t channel, uint8_t note, uint8_t velocity) {
     // Note On  →  msg_type = 0b001  →  CAN_ID = (1 << 8) | channel
-    uint32_t id = (0x001u << 8) | channel;
-    Log.printf("CAN tx: Note On  ch=%u note=%u vel=%u (id=0x%03" PRIX32 ")\n",
-               channel, note, velocity, id);
-    can_send(id, note, velocity);
+    uint8_t data[3] = { note, velocity, 0x00 };
+    enqueue(0x10000u | (channel << 8) | note, (MSG_NOTE_ON << 8) | channel, data, 3,
+            channel == CAN_CHANNEL_STOPS);
 }
 
 void can_send_note_off(uint8_t channel, uint8_t note, uint8_t velocity) {
     // Note Off →  msg_type = 0b000  →  CAN_ID = (0 << 8) | channel
-    uint32_t id = (0x000u << 8) | channel;
-    Log.printf("CAN tx: Note Off ch=%u note=%u vel=%u (id=0x%03" PRIX32 ")\n",
-               channel, note, velocity, id);
-    can_send(id, note, velocity);
+    uint8_t data[3] = { note, velocity, 0x00 };
+    enqueue(0x10000u | (channel << 8) | note, (MSG_NOTE_OFF << 8) | channel, data, 3,
+            channel == CAN_CHANNEL_STOPS);
+}
+
+void can_send_all_notes_off(uint8_t channel) {
+    // Control →  msg_type = 0b011  →  CAN_ID = (3 << 8) | channel, CC 123
+    uint8_t data[3] = { CC_ALL_NOTES_OFF, 0, 0x00 };
+    enqueue(0x20000u | (channel << 8) | CC_ALL_NOTES_OFF, (MSG_CONTROL << 8) | channel, data, 3,
+            true);
+}
+
+bool can_send_div_state(uint8_t division, uint8_t source, uint64_t bitmap) {
+    // DIV_STATE →  msg_type = 0b010  →  CAN_ID = (2 << 8) | (division << 4) | source
+    uint16_t id = (MSG_DIV_STATE << 8) | ((division & 0x0F) << 4) | (source & 0x0F);
+    uint8_t data[8];
+    for (int i = 0; i < 8; i++) {
+        data[i] = (uint8_t)(bitmap >> (i * 8));   // Little endian: data[0] bit 0 = base note
+    }
+
+    // Only the latest state per (division, source) is worth sending
+    return enqueue(id, id, data, 8, false);
+}
+
+void can_bus_get_stats(CanTxStats* out) {
+    if (!out || !txMutex) return;
+    xSemaphoreTake(txMutex, portMAX_DELAY);
+    *out = stats;
+    out->pending = numPending;
+    xSemaphoreGive(txMutex);
+    out->busOk = busUp && !errorPassive;
+}
+
+int can_bus_get_id_counts(CanIdCount* out, int max) {
+    if (!out || !txMutex) return 0;
+    xSemaphoreTake(txMutex, portMAX_DELAY);
+    int n = numIds < max ? numIds : max;
+    memcpy(out, idCounts, n * sizeof(CanIdCount));
+    xSemaphoreGive(txMutex);
+    return n;
 }
 
 } // extern "C"
@@ -12,6 +12,11 @@ extern "C" {
  * Call once from setup() before sending any messages.
  * Pins are taken from pins.h (PIN_CAN_TX / PIN_CAN_RX).
  * Baud rate: 500 kbit/s.
+ *
+ * All can_send_* functions are non-blocking: frames wait in a software
+ * queue where a newer frame for the same key (or division/source) replaces
+ * the pending one, and stop / all-notes-off frames go out first.  Bus-off
+ * is recovered automatically, and ECHO_REQ diagnostics are answered.
  */
 void can_bus_begin();
 
@@ -35,6 +40,59 @@ void can_send_note_on(uint8_t channel, uint8_t note, uint8_t velocity);
  */
 void can_send_note_off(uint8_t channel, uint8_t note, uint8_t velocity);
 
+/**
+ * Transmit an All Notes Off control frame (high priority).
+ * CAN ID = (0x003 << 8) | channel, data = [123, 0, 0]  (per can-protocol.md)
+ *
+ * @param channel  CAN channel (0 = Great, 1 = Swell, …)
+ */
+void can_send_all_notes_off(uint8_t channel);
+
+/**
+ * Transmit a DIV_STATE frame: the complete key state of one source feeding
+ * one division (see docs/can-protocol.md).
+ * CAN ID = (0x002 << 8) | (division << 4) | source
+ *
+ * @param division Division the keys sound on (0-15)
+ * @param source   Keyboard the state comes from (0-15); equal to division
+ *                 for physical keys, the coupled manual for coupler output
+ * @param bitmap   Bit n set = MIDI note (CAN_DIV_STATE_BASE_NOTE + n) held
+ * @return false if the frame could not be queued
+ */
+bool can_send_div_state(uint8_t division, uint8_t source, uint64_t bitmap);
+
+// Lowest MIDI note carried by a DIV_STATE bitmap (bit 0); 64 notes from here
+#define CAN_DIV_STATE_BASE_NOTE 36
+
+typedef struct {
+    uint32_t framesQueued;     // Frames handed to the controller
+    uint32_t coalesced;        // Frames replaced by a newer one before going out
+    uint32_t dropped;          // Software queue full
+    uint32_t txFailed;         // Controller reported a failed transmission
+    uint32_t busOff;           // Bus-off events (each recovered automatically)
+    uint32_t errorPassive;     // Entries into error-passive
+    uint32_t stallFlushes;     // Driver queue cleared of unacknowledged frames while error-passive
+    uint32_t stallRequeued;    // Note and all-notes-off frames put back after a flush
+    uint32_t untrackedIds;     // Frames whose ID did not fit the per-ID table
+    uint32_t echoReplies;      // ECHO_REQ frames answered
+    uint32_t pending;          // Frames waiting now
+    uint32_t queueHighWater;   // Most frames ever waiting at once
+    bool     busOk;            // Running and error-active
+} CanTxStats;
+
+typedef struct {
+    uint16_t id;
+    uint32_t count;            // Frames sent with this ID
+} CanIdCount;
+
+void can_bus_get_stats(CanTxStats* out);
+
+/**
+ * Copy the per-ID transmit counters.
+ * @return number of entries written (at most max)
+ */
+int can_bus_get_id_counts(CanIdCount* out, int max);
+
 #ifdef __cplusplus
 }
 #endif
@@ -5,181 +5,123 @@
 #include "pins.h"
 #include "can_bus.h"
 #include "key_scanner.h"
-#include "api_docs.h"
-#include "settings_page.h"
+#include "web_assets.h"
 #include "httpserver.h"
 #include "logger.h"
+#include "httpstream.h"
+#include "logstream.h"
+#include "websocket.h"
 
 static WebServer server(80);
 
-// ---------- Circular log buffer ----------
-#define LOG_BUFFER_SIZE 100
-static String logBuffer[LOG_BUFFER_SIZE];
-static int    logIndex      = 0;
-static int    logCount      = 0;
-static int    logTotalCount = 0;
-static bool   httpLoggingEnabled = true;
-static String pendingLogLine     = "";
+// ---------- Log ring ----------
+// Everything logged, in a fixed-size ring streamed to /logs (logstream.h)
+static LogStream logStream;
 
 void httpserver_log(const uint8_t* buffer, size_t size) {
-    if (!httpLoggingEnabled) return;
-    for (size_t i = 0; i < size; i++) {
-        char c = buffer[i];
-        if (c == '\n') {
-            if (pendingLogLine.length() > 0) {
-                logBuffer[logIndex] = pendingLogLine;
-                logIndex = (logIndex + 1) % LOG_BUFFER_SIZE;
-                if (logCount < LOG_BUFFER_SIZE) logCount++;
-                logTotalCount++;
-                pendingLogLine = "";
-            }
-        } else if (c != '\r') {
-            pendingLogLine += c;
-        }
-    }
+    logStream.write(buffer, size);
 }
 
 void httpserver_log(const char* message) {
-    if (!httpLoggingEnabled) return;
-    logBuffer[logIndex] = String(message);
-    logIndex = (logIndex + 1) % LOG_BUFFER_SIZE;
-    if (logCount < LOG_BUFFER_SIZE) logCount++;
-    logTotalCount++;
-}
-
-static String httpserver_get_logs() {
-    String result = "";
-    int start = (logCount < LOG_BUFFER_SIZE) ? 0 : logIndex;
-    for (int i = 0; i < logCount; i++) {
-        int idx = (start + i) % LOG_BUFFER_SIZE;
-        result += logBuffer[idx] + "\n";
-    }
-    return result;
-}
-
-static String httpserver_get_logs_since(int sinceTotal) {
-    if (sinceTotal < 0) return httpserver_get_logs();
-    int newCount = logTotalCount - sinceTotal;
-    if (newCount <= 0) return "";
-    if (newCount > logCount) return httpserver_get_logs();
-    String result = "";
-    int start = (logIndex - newCount + LOG_BUFFER_SIZE) % LOG_BUFFER_SIZE;
-    for (int i = 0; i < newCount; i++) {
-        int idx = (start + i) % LOG_BUFFER_SIZE;
-        result += logBuffer[idx] + "\n";
-    }
-    return result;
-}
-
-static int httpserver_get_log_index() {
-    return logTotalCount;
+    logStream.write((const uint8_t*)message, strlen(message));
+    logStream.write((const uint8_t*)"\n", 1);
 }
 
 // ---------- Root – scanner status page ----------
 static void handleRoot() {
-    String html = "<!DOCTYPE html><html><head>";
-    html += "<meta name='viewport' content='width=device-width, initial-scale=1'>";
-    html += "<meta http-equiv='refresh' content='5'>";
-    html += "<title>Keyboard Controller</title>";
-    html += "<style>";
-    html += "body{font-family:Arial,sans-serif;margin:20px;background:#f0f0f0;color:#333;}";
-    html += "h1{color:#333;}";
-    html += ".card{background:white;padding:15px;margin:10px 0;border-radius:8px;"
-            "box-shadow:0 2px 4px rgba(0,0,0,.1);}";
-    html += ".label{font-weight:bold;margin-right:8px;}";
-    html += ".nav{margin-top:15px;}";
-    html += ".nav a{display:inline-block;margin:4px;padding:8px 16px;"
-            "background:#4CAF50;color:white;text-decoration:none;border-radius:4px;}";
-    html += ".nav a:hover{background:#45a049;}";
-    html += "</style></head><body>";
-    html += "<h1>Keyboard Controller</h1>";
-    html += "<div class='card'>";
-    html += "<p><span class='label'>MCP23017 chips:</span>" + String(key_scanner_chip_count()) + "</p>";
-    html += "<p><span class='label'>Keys scanned:</span>"  + String(key_scanner_chip_count() * 16) + "</p>";
-    html += "<p><span class='label'>Hardware ID:</span>"   + String(key_scanner_get_hardware_id()) + "</p>";
-    html += "<p><span class='label'>CAN channel:</span>"   + String(key_scanner_get_can_channel()) + "</p>";
-    html += "<p><span class='label'>WiFi IP:</span>"       + WiFi.localIP().toString() + "</p>";
-    html += "<p><span class='label'>Uptime:</span>"        + String(millis() / 1000) + " s</p>";
-    html += "</div>";
-    html += "<div class='nav'>";
-    html += "<a href='/logs'>Logs</a>";
-    html += "<a href='/status'>Status JSON</a>";
-    html += "<a href='/api'>API Docs</a>";
-    html += "<a href='/settings'>Settings</a>";
-    html += "</div>";
-    html += "</body></html>";
-    server.send(200, "text/html", html);
+    HttpStream out(server, 200, "text/html");
+    out.print("<!DOCTYPE html><html><head>");
+    out.print("<meta name='viewport' content='width=device-width, initial-scale=1'>");
+    out.print("<meta http-equiv='refresh' content='5'>");
+    out.print("<title>Keyboard Controller</title>");
+    out.print("<style>");
+    out.print("body{font-family:Arial,sans-serif;margin:20px;background:#f0f0f0;color:#333;}");
+    out.print("h1{color:#333;}");
+    out.print(".card{background:white;padding:15px;margin:10px 0;border-radius:8px;"
+              "box-shadow:0 2px 4px rgba(0,0,0,.1);}");
+    out.print(".label{font-weight:bold;margin-right:8px;}");
+    out.print(".nav{margin-top:15px;}");
+    out.print(".nav a{display:inline-block;margin:4px;padding:8px 16px;"
+              "background:#4CAF50;color:white;text-decoration:none;border-radius:4px;}");
+    out.print(".nav a:hover{background:#45a049;}");
+    out.print("</style></head><body>");
+    out.print("<h1>Keyboard Controller</h1>");
+    out.print("<div class='card'>");
+    out.printf("<p><span class='label'>MCP23017 chips:</span>%d</p>", key_scanner_chip_count());
+    out.printf("<p><span class='label'>Keys scanned:</span>%d</p>", key_scanner_chip_count() * 16);
+    out.printf("<p><span class='label'>Hardware ID:</span>%d</p>", key_scanner_get_hardware_id());
+    out.printf("<p><span class='label'>CAN channel:</span>%d</p>", (int)key_scanner_get_can_channel());
+    out.print("<p><span class='label'>WiFi IP:</span>");
+    out.print(WiFi.localIP());
+    out.print("</p>");
+    out.printf("<p><span class='label'>Uptime:</span>%lu s</p>", millis() / 1000);
+    out.print("</div>");
+    out.print("<div class='nav'>");
+    out.print("<a href='/logs'>Logs</a>");
+    out.print("<a href='/status'>Status JSON</a>");
+    out.print("<a href='/api'>API Docs</a>");
+    out.print("<a href='/settings'>Settings</a>");
+    out.print("</div>");
+    out.print("</body></html>");
 }
 
 // ---------- Log viewer ----------
 static void handleLogsPage() {
-    httpLoggingEnabled = true;
-    String html = "<!DOCTYPE html><html><head>";
-    html += "<meta name='viewport' content='width=device-width, initial-scale=1'>";
-    html += "<title>Keyboard Controller Logs</title>";
-    html += "<style>";
-    html += "body{font-family:monospace;margin:0;padding:20px;background:#1e1e1e;color:#d4d4d4;}";
-    html += "h1{color:#4ec9b0;margin-bottom:10px;}";
-    html += "#log{background:#252526;border:1px solid #3e3e42;padding:15px;"
-            "height:70vh;overflow-y:auto;white-space:pre-wrap;word-wrap:break-word;}";
-    html += ".controls{margin-bottom:15px;}";
-    html += "button{padding:8px 16px;background:#0e639c;color:white;border:none;"
-            "border-radius:4px;cursor:pointer;margin-right:10px;}";
-    html += "button:hover{background:#1177bb;}";
-    html += ".status{color:#4ec9b0;margin-left:10px;}";
-    html += "</style></head><body>";
-    html += "<h1>Keyboard Controller Logs</h1>";
-    html += "<div class='controls'>";
-    html += "<button onclick='clearLog()'>Clear</button>";
-    html += "<button onclick='toggleAutoScroll()' id='scrollBtn'>Auto-scroll: ON</button>";
-    html += "<a href='/' style='color:#4ec9b0;margin-left:15px;'>&#8592; Home</a>";
-    html += "<span class='status' id='status'>Connected</span>";
-    html += "</div>";
-    html += "<div id='log'></div>";
-    html += "<script>";
-    html += "let autoScroll=true,lastIndex=-1;";
-    html += "const logDiv=document.getElementById('log');";
-    html += "const statusDiv=document.getElementById('status');";
-    html += "function fetchLogs(){";
-    html += "  fetch('/logs/poll?since='+lastIndex).then(r=>r.json()).then(data=>{";
-    html += "    if(data.logs){logDiv.textContent+=data.logs;";
-    html += "    if(autoScroll)logDiv.scrollTop=logDiv.scrollHeight;}";
-    html += "    lastIndex=data.index;";
-    html += "    statusDiv.textContent='Connected';statusDiv.style.color='#4ec9b0';";
-    html += "  }).catch(()=>{statusDiv.textContent='Error';statusDiv.style.color='#f48771';});";
-    html += "}";
-    html += "fetchLogs();setInterval(fetchLogs,1000);";
-    html += "function clearLog(){logDiv.textContent='';}";
-    html += "function toggleAutoScroll(){autoScroll=!autoScroll;";
-    html += "  document.getElementById('scrollBtn').textContent='Auto-scroll: '+(autoScroll?'ON':'OFF');}";
-    html += "</script></body></html>";
-    server.send(200, "text/html", html);
+    HttpStream out(server, 200, "text/html");
+    out.print("<!DOCTYPE html><html><head>");
+    out.print("<meta name='viewport' content='width=device-width, initial-scale=1'>");
+    out.print("<title>Keyboard Controller Logs</title>");
+    out.print("<style>");
+    out.print("body{font-family:monospace;margin:0;padding:20px;background:#1e1e1e;color:#d4d4d4;}");
+    out.print("h1{color:#4ec9b0;margin-bottom:10px;}");
+    out.print("#log{background:#252526;border:1px solid #3e3e42;padding:15px;"
+              "height:70vh;overflow-y:auto;white-space:pre-wrap;word-wrap:break-word;}");
+    out.print(".controls{margin-bottom:15px;}");
+    out.print("button{padding:8px 16px;background:#0e639c;color:white;border:none;"
+              "border-radius:4px;cursor:pointer;margin-right:10px;}");
+    out.print("button:hover{background:#1177bb;}");
+    out.print(".status{color:#4ec9b0;margin-left:10px;}");
+    out.print("</style></head><body>");
+    out.print("<h1>Keyboard Controller Logs</h1>");
+    out.print("<div class='controls'>");
+    out.print("<button onclick='clearLog()'>Clear</button>");
+    out.print("<button onclick='toggleAutoScroll()' id='scrollBtn'>Auto-scroll: ON</button>");
+    out.print("<a href='/' style='color:#4ec9b0;margin-left:15px;'>&#8592; Home</a>");
+    out.print("<span class='status' id='status'>Connected</span>");
+    out.print("</div>");
+    out.print("<div id='log'></div>");
+    out.print("<script>");
+    out.print("let autoScroll=true,lastId=-1;");
+    out.print("const logDiv=document.getElementById('log');");
+    out.print("const statusDiv=document.getElementById('status');");
+    out.print("function connect(){");
+    out.print("  const es=new EventSource('/logs/stream?since='+lastId);");
+    out.print("  es.onopen=()=>{statusDiv.textContent='Connected';statusDiv.style.color='#4ec9b0';};");
+    out.print("  es.onmessage=e=>{logDiv.textContent+=e.data+'\\n';lastId=e.lastEventId;");
+    out.print("    if(autoScroll)logDiv.scrollTop=logDiv.scrollHeight;};");
+    out.print("  es.onerror=()=>{es.close();statusDiv.textContent='Reconnecting';statusDiv.style.color='#f48771';");
+    out.print("    setTimeout(connect,2000);};");
+    out.print("}");
+    out.print("connect();");
+    out.print("function clearLog(){logDiv.textContent='';}");
+    out.print("function toggleAutoScroll(){autoScroll=!autoScroll;");
+    out.print("  document.getElementById('scrollBtn').textContent='Auto-scroll: '+(autoScroll?'ON':'OFF');}");
+    out.print("</script></body></html>");
 }
 
 static void handleLogsPoll() {
-    httpLoggingEnabled = true;
-    int sinceIndex = server.hasArg("since") ? server.arg("since").toInt() : -1;
-    String logs = httpserver_get_logs_since(sinceIndex);
-    int    currentIndex = httpserver_get_log_index();
-    if (logs.length() == 0) {
-        server.send(200, "application/json",
-                    "{\"index\":" + String(currentIndex) + ",\"logs\":\"\"}");
-        return;
-    }
-    String json;
-    json.reserve(logs.length() + logs.length() / 5 + 50);
-    json = "{\"index\":" + String(currentIndex) + ",\"logs\":\"";
-    for (unsigned int i = 0; i < logs.length(); i++) {
-        char c = logs[i];
-        if      (c == '"')  json += "\\\"";
-        else if (c == '\\') json += "\\\\";
-        else if (c == '\n') json += "\\n";
-        else if (c == '\r') json += "\\r";
-        else if (c == '\t') json += "\\t";
-        else                json += c;
-    }
-    json += "\"}";
-    server.send(200, "application/json", json);
+    long since = server.hasArg("since") ? server.arg("since").toInt() : -1;
+    HttpStream out(server, 200, "application/json");
+    out.beginObject();
+    out.beginString("logs");
+    uint32_t index = logStream.writeSince(out, since < 0 ? UINT32_MAX : (uint32_t)since);
+    out.endString();
+    out.kv("index", (unsigned long)index);
+    out.endObject();
+}
+
+static void handleLogsStream() {
+    logStream.subscribe(server);
 }
 
 // ---------- Manual note-on / note-off (testing) ----------
@@ -194,7 +136,7 @@ static void handleNoteOn() {
         server.send(400, "text/plain", "Bad Request: note 0-127, velocity 0-127");
         return;
     }
-    can_send_note_on(key_scanner_get_can_channel(), (uint8_t)note, (uint8_t)velocity);
+    key_scanner_inject_note((uint8_t)note, true);   // Bitmaps carry no velocity
     server.send(200, "text/plain",
                 "Note On: " + String(note) + " vel=" + String(velocity));
 }
@@ -210,35 +152,156 @@ static void handleNoteOff() {
         server.send(400, "text/plain", "Bad Request: note 0-127, velocity 0-127");
         return;
     }
-    can_send_note_off(key_scanner_get_can_channel(), (uint8_t)note, (uint8_t)velocity);
+    key_scanner_inject_note((uint8_t)note, false);
     server.send(200, "text/plain",
                 "Note Off: " + String(note) + " vel=" + String(velocity));
 }
 
+static void handleAllOff() {
+    for (int note = 0; note < 128; note++) key_scanner_inject_note((uint8_t)note, false);
+    can_send_all_notes_off(key_scanner_get_can_channel());
+    server.send(200, "text/plain", "All notes off");
+}
+
+// ---------- WebSocket note channel ----------
+// /ws carries MUDP packets (docs/MIDIUDP.md) both ways. Note-ons and
+// note-offs from a page press and release notes like /note_on and
+// /note_off, and CC 123 releases them all. Every change to the division
+// bitmap, keys and injected notes alike, goes back as a note-on (velocity
+// 127; bitmaps carry none) or note-off.
+#define WS_FEED_NOTES 16   // Note messages per packet sent to the pages
+
+static WebSocketServer ws;
+static uint64_t wsSent = 0;      // Bitmap the pages were last sent
+static bool     wsSynced = false;
+
+static void handleWebSocket() {
+    ws.accept(server);
+}
+
+static void wsReceive(int client, const uint8_t* data, size_t size) {
+    if (size < 4 || data[0] != 0x4D || data[1] != 0x55 || data[2] != 0x01) return;
+    const uint8_t* p   = data + 4;
+    const uint8_t* end = data + size;
+    for (int i = 0; i < data[3]; i++) {
+        if (end - p < 2 || p[0] < 0x80 || p[0] > 0xEF) return;
+        uint8_t type = p[0] & 0xF0;
+        size_t  len  = (type == 0xC0 || type == 0xD0) ? 2 : 3;
+        if ((size_t)(end - p) < len) return;
+        if (type == 0x90 || type == 0x80) {
+            key_scanner_inject_note(p[1] & 0x7F, type == 0x90 && p[2] > 0);
+        } else if (type == 0xB0 && p[1] == 123) {
+            for (int note = 0; note < 128; note++) key_scanner_inject_note((uint8_t)note, false);
+        }
+        p += len;
+    }
+}
+
+// Send the pages the notes that changed since the last call
+static void wsFeed() {
+    if (!ws.connected()) {
+        wsSynced = false;
+        return;
+    }
+    uint64_t bitmap  = key_scanner_get_bitmap();
+    uint64_t changed = wsSynced ? bitmap ^ wsSent : 0;
+    wsSent   = bitmap;
+    wsSynced = true;
+    uint8_t pkt[4 + 3 * WS_FEED_NOTES] = { 0x4D, 0x55, 0x01, 0 };
+    uint8_t count = 0;
+    while (changed) {
+        int bit = __builtin_ctzll(changed);
+        changed &= changed - 1;
+        bool on = bitmap & (1ULL << bit);
+        uint8_t* m = pkt + 4 + 3 * count++;
+        m[0] = on ? 0x90 : 0x80;
+        m[1] = CAN_DIV_STATE_BASE_NOTE + bit;
+        m[2] = on ? 127 : 0;
+        if (count == WS_FEED_NOTES || !changed) {
+            pkt[3] = count;
+            ws.sendAll(pkt, 4 + 3 * count);
+            count = 0;
+        }
+    }
+}
+
 // ---------- System status ----------
 static void handleStatus() {
-    String json = "{";
-    json += "\"uptime\":"      + String(millis()) + ",";
-    json += "\"version\":\""   APP_VERSION "\",";
-    json += "\"wifi\":{";
-    json += "\"connected\":"   + String(WiFi.status() == WL_CONNECTED ? "true" : "false") + ",";
-    json += "\"ip\":\""        + WiFi.localIP().toString() + "\",";
-    json += "\"rssi\":"        + String(WiFi.RSSI());
-    json += "},";
-    json += "\"keyScanner\":{";
-    json += "\"chips\":"       + String(key_scanner_chip_count()) + ",";
-    json += "\"keys\":"        + String(key_scanner_chip_count() * 16) + ",";
-    json += "\"hardwareId\":"  + String(key_scanner_get_hardware_id()) + ",";
-    json += "\"canChannel\":"  + String(key_scanner_get_can_channel());
-    json += "}";
-    json += "}";
-    server.send(200, "application/json", json);
+    HttpStream out(server, 200, "application/json");
+    out.beginObject();
+    out.kv("uptime",          millis());
+    out.kv("telnetDropped",   Log.telnetDropped());
+    out.kv("version",         APP_VERSION);
+    out.beginObject("wifi");
+    out.kv("connected",       WiFi.status() == WL_CONNECTED);
+    out.kv("ip",              WiFi.localIP());
+    out.kv("rssi",            WiFi.RSSI());
+    out.endObject();
+    out.beginObject("keyScanner");
+    out.kv("chips",           key_scanner_chip_count());
+    out.kv("keys",            key_scanner_chip_count() * 16);
+    out.kv("hardwareId",      key_scanner_get_hardware_id());
+    out.kv("canChannel",      key_scanner_get_can_channel());
+    KeyScannerStats ks;
+    key_scanner_get_stats(&ks);
+    char bitmap[17];
+    snprintf(bitmap, sizeof(bitmap), "%016llx", (unsigned long long)key_scanner_get_bitmap());
+    out.kv("bitmap",          bitmap);
+    out.kv("divStateFrames",  ks.changeFrames);
+    out.kv("keepaliveFrames", ks.keepaliveFrames);
+    out.kv("txFailed",        ks.txFailed);
+    out.kv("transitions",     ks.transitions);
+    out.kv("bouncesRejected", ks.bouncesRejected);
+    out.kv("chipReads",       ks.chipReads);
+    out.kv("eventsDropped",   ks.eventsDropped);
+    KeyLatency lat;
+    key_scanner_get_latency(&lat);
+    out.beginObject("latency");
+    out.kv("samples",         lat.samples);
+    out.kv("p50Us",           lat.p50Us);
+    out.kv("p90Us",           lat.p90Us);
+    out.kv("p99Us",           lat.p99Us);
+    out.kv("maxUs",           lat.maxUs);
+    out.endObject();
+    out.endObject();
+    CanTxStats cs;
+    can_bus_get_stats(&cs);
+    out.beginObject("canTx");
+    out.kv("busOk",           cs.busOk);
+    out.kv("framesQueued",    cs.framesQueued);
+    out.kv("coalesced",       cs.coalesced);
+    out.kv("dropped",         cs.dropped);
+    out.kv("txFailed",        cs.txFailed);
+    out.kv("busOff",          cs.busOff);
+    out.kv("errorPassive",    cs.errorPassive);
+    out.kv("stallFlushes",    cs.stallFlushes);
+    out.kv("stallRequeued",   cs.stallRequeued);
+    out.kv("echoReplies",     cs.echoReplies);
+    out.kv("pending",         cs.pending);
+    out.kv("queueHighWater",  cs.queueHighWater);
+    out.beginObject("perId");
+    CanIdCount ids[32];
+    int numIds = can_bus_get_id_counts(ids, 32);
+    for (int i = 0; i < numIds; i++) {
+        char id[8];
+        snprintf(id, sizeof(id), "0x%03X", ids[i].id);
+        out.kv(id, ids[i].count);
+    }
+    out.endObject();
+    out.endObject();
+    out.endObject();
 }
 
 // ---------- Hardware config ----------
 static void handleConfig() {
-    String json = "{\"hardwareId\":" + String(key_scanner_get_hardware_id()) + "}";
-    server.send(200, "application/json", json);
+    uint32_t pressUs, releaseUs;
+    key_scanner_get_debounce(&pressUs, &releaseUs);
+    HttpStream out(server, 200, "application/json");
+    out.beginObject();
+    out.kv("hardwareId",        key_scanner_get_hardware_id());
+    out.kv("debouncePressUs",   pressUs);
+    out.kv("debounceReleaseUs", releaseUs);
+    out.endObject();
 }
 
 static void handleConfigHardwareId() {
@@ -255,18 +318,36 @@ static void handleConfigHardwareId() {
     server.send(200, "application/json", "{\"success\":true}");
 }
 
+static void handleConfigDebounce() {
+    if (!server.hasArg("press_us") || !server.hasArg("release_us")) {
+        server.send(400, "text/plain", "Bad Request: Missing 'press_us' or 'release_us' parameter");
+        return;
+    }
+    int pressUs   = server.arg("press_us").toInt();
+    int releaseUs = server.arg("release_us").toInt();
+    if (pressUs < 0 || releaseUs < 0 ||
+        !key_scanner_set_debounce((uint32_t)pressUs, (uint32_t)releaseUs)) {
+        server.send(400, "text/plain", "Bad Request: debounce times must be 0-20000 us");
+        return;
+    }
+    server.send(200, "application/json", "{\"success\":true}");
+}
+
 static void handleAPIDocumentation() {
-    server.send(200, "text/html", API_DOCS_HTML);
+    webasset_send(server, API_DOCS_HTML_GZ);
 }
 
 static void handleSettings() {
-    server.send(200, "text/html", SETTINGS_PAGE_HTML);
+    webasset_send(server, SETTINGS_PAGE_HTML_GZ);
 }
 
 static void handleNotFound() {
-    String message = "Not Found\n\nURI: " + server.uri() + "\n";
-    message += "Method: " + String((server.method() == HTTP_GET) ? "GET" : "POST") + "\n";
-    server.send(404, "text/plain", message);
+    HttpStream out(server, 404, "text/plain");
+    out.print("Not Found\n\nURI: ");
+    out.print(server.uri());
+    out.print("\nMethod: ");
+    out.print((server.method() == HTTP_GET) ? "GET" : "POST");
+    out.print("\n");
 }
 
 // ---------- Init / loop ----------
@@ -279,16 +360,24 @@ void httpserver_begin() {
     server.on("/status",        HTTP_GET,  handleStatus);
     server.on("/logs",          HTTP_GET,  handleLogsPage);
     server.on("/logs/poll",     HTTP_GET,  handleLogsPoll);
+    server.on("/logs/stream",   HTTP_GET,  handleLogsStream);
+    server.on("/ws",            HTTP_GET,  handleWebSocket);
     server.on("/note_on",              HTTP_GET,  handleNoteOn);
     server.on("/note_off",             HTTP_GET,  handleNoteOff);
+    server.on("/all_off",              HTTP_GET,  handleAllOff);
     server.on("/config",               HTTP_GET,  handleConfig);
     server.on("/config/hardware_id",   HTTP_POST, handleConfigHardwareId);
+    server.on("/config/debounce",      HTTP_POST, handleConfigDebounce);
     server.onNotFound(handleNotFound);
+    websocket_begin(server);
     server.begin();
 }
 
 void httpserver_loop() {
     server.handleClient();
+    logStream.pump();
+    ws.poll(wsReceive);
+    wsFeed();
 }
 
 } // extern "C"
@@ -1,15 +1,32 @@
 // key_scanner.cpp
 // Scans organ keyboard keys via MCP23017 I/O expanders on the I2C bus.
-//   Key pressed  (pin LOW)  → CAN Note On
-//   Key released (pin HIGH) → CAN Note Off
+//   Key pressed  (pin LOW)  → bit set in the division bitmap
+//   Key released (pin HIGH) → bit cleared
+// The bitmap goes out as one DIV_STATE CAN frame whenever it changes and
+// again every DIV_STATE_KEEPALIVE_MS, so a lost frame heals itself.
+//
+// Only chips that report a change in INTF are read, and each key passes an
+// integrating debounce (separate press / release times) before it reaches
+// the bitmap.  Every transition is stamped with the micros() of its first
+// edge so key-to-CAN latency can be measured.
+//
+// Two tasks pinned to the app core, both above loop() so HTTP and OTA work
+// can never hold up a key:
+//   key_scan  – woken by the INT edge or the sample timer; reads the chips
+//               through the asynchronous i2c_master driver, queuing one
+//               transaction per chip and waiting once for the whole batch
+//   key_tx    – owns the CAN side; receives debounced state from key_scan
+//               through a lock-free SPSC ring and sends DIV_STATE frames
 
 #include <Arduino.h>
-#include <Wire.h>
+#include "driver/i2c_master.h"
 #include "key_scanner.h"
 #include "pins.h"
 #include "can_bus.h"
 #include "logger.h"
+#include "spsc_ring.h"
 #include <Preferences.h>
+#include <algorithm>
 
 // ---- MCP23017 I2C addressing ----
 #define MCP23017_BASE_ADDR  0x20   // Lowest address (A2=A1=A0=0)
@@ -26,6 +43,10 @@
 #define REG_IOCONA    0x0A   // I/O configuration register
 #define REG_GPPUA     0x0C   // Pull-up resistor control A
 #define REG_GPPUB     0x0D   // Pull-up resistor control B
+#define REG_INTFA     0x0E   // Interrupt flag A       (1 = pin caused the interrupt)
+#define REG_INTFB     0x0F   // Interrupt flag B
+#define REG_INTCAPA   0x10   // Port A captured at interrupt (read clears interrupt)
+#define REG_INTCAPB   0x11   // Port B captured at interrupt
 #define REG_GPIOA     0x12   // GPIO port A (read clears interrupt)
 #define REG_GPIOB     0x13   // GPIO port B
 
@@ -35,17 +56,41 @@
 //   INTPOL (bit 1) = 0 → active-low (matches the pull-up to Vcc wiring)
 #define IOCON_VALUE   0x44   // MIRROR=1, ODR=1, INTPOL=0
 
+// ---- I2C ----
+// The MCP23017 is specified for 100 kHz, 400 kHz and 1.7 MHz HS-mode; HS
+// needs a master code the ESP32 controller cannot send, and 1 MHz FM+ is
+// outside the datasheet.  Short console buses generally run fine at 1 MHz,
+// so it can be enabled with -DKEYSCAN_I2C_HZ=1000000 in build_flags.
+#ifndef KEYSCAN_I2C_HZ
+#define KEYSCAN_I2C_HZ  400000
+#endif
+#define I2C_TIMEOUT_MS  10
+
+// ---- Tasks ----
+#define SCAN_TASK_PRIORITY  10     // loopTask runs at 1 on the same core
+#define TX_TASK_PRIORITY    9
+#define KEY_TASK_CORE       1
+
+static TaskHandle_t scanTask = nullptr;
+static TaskHandle_t txTask   = nullptr;
+
 // ---- ISR flag (set on FALLING edge of shared INT line) ----
-static volatile bool intFlag = false;
+static volatile bool     intFlag   = false;
+static volatile uint32_t intTimeUs = 0;    // micros() of the latest edge
 
 static void IRAM_ATTR onInterrupt() {
-    intFlag = true;
+    intTimeUs = micros();
+    intFlag   = true;
+    BaseType_t woken = pdFALSE;
+    if (scanTask) vTaskNotifyGiveFromISR(scanTask, &woken);
+    portYIELD_FROM_ISR(woken);
 }
 
 // ---- Hardware identity ----
 // Loaded from NVS at boot.  Determines the CAN output channel and keymap.
 //   0 = Pedal   1 = Great   2 = Swell   3 = Positiv   4 = Echo   5 = Stop-board
-static int hardwareId = 0;
+// Set from HTTP; key_scan picks up a change on its next pass.
+static volatile int hardwareId = 0;
 
 // Expected MCP23017 chip count per hardware_id.
 // Checked at boot; a mismatch is logged as a warning but does not halt operation.
@@ -96,31 +141,293 @@ static const uint8_t keymaps[6][MAX_CHIPS * KEYS_PER_CHIP] = {
       0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
 };
 
-// ---- Per-chip state ----
+// ---- Per-chip state (key_scan task) ----
 static uint8_t  chipAddr[MAX_CHIPS];   // I2C addresses of discovered chips
 static int      numChips = 0;
-static uint16_t prevState[MAX_CHIPS];  // Last known GPIO state (1 = high/released)
+static uint16_t keyState[MAX_CHIPS];   // Debounced state (1 = high/released)
+
+static i2c_master_bus_handle_t i2cBus = nullptr;
+static i2c_master_dev_handle_t chipDev[MAX_CHIPS];
+static uint8_t rxBuf[MAX_CHIPS][4];    // Per-chip read buffers for queued transactions
+
+// ---- Debounce (key_scan task) ----
+// Each key integrates the time its raw level disagrees with the debounced
+// state (and bleeds it off while they agree).  The key flips once the
+// integral reaches the press or release time; shorter glitches decay back
+// to zero and are counted as rejected bounces.
+#define SAMPLE_INTERVAL_US   250    // GPIO re-read period for chips still settling
+#define MAX_DEBOUNCE_US      20000
+
+static volatile uint32_t debouncePressUs   = 1500;
+static volatile uint32_t debounceReleaseUs = 3000;
+
+static uint16_t settling[MAX_CHIPS];      // Keys with a non-zero integral
+static uint8_t  activeChips = 0;          // Bit c = chip c is sampled until it settles
+static uint32_t lastSampleUs[MAX_CHIPS];
+static int32_t  integUs[MAX_CHIPS * KEYS_PER_CHIP];
+static uint32_t edgeUs[MAX_CHIPS * KEYS_PER_CHIP];   // First sample at the new level
+static esp_timer_handle_t sampleTimer = nullptr;
+
+static int      scanHardwareId = 0;       // hardwareId the current state was scanned with
+static uint64_t scanBitmap     = 0;       // Debounced keys as a division bitmap
+static bool     resendState    = false;   // Last event was dropped; push the state again
+
+// ---- key_scan → key_tx ----
+// Every event carries the full bitmap, so a dropped event is healed by the
+// next one (key_scan also re-pushes the state as soon as there is room).
+struct KeyEvent {
+    uint64_t bitmap;     // Debounced keys after this transition
+    uint32_t edgeUs;     // First edge of the transition; 0 = state refresh
+    uint8_t  division;   // hardwareId the bitmap belongs to
+};
+
+static SpscRing<KeyEvent, 64> keyEvents;
+
+// ---- Key-to-CAN latency (key_tx task) ----
+// Edge timestamps of transitions not yet on the bus, then the latency of
+// the last LATENCY_SAMPLES transitions once their frame was queued.
+#define LATENCY_SAMPLES  256
+#define MAX_PENDING      32
+
+static uint32_t pendingEdgeUs[MAX_PENDING];
+static int      numPending = 0;
+static uint32_t latencyUs[LATENCY_SAMPLES];
+static uint32_t latencyCount = 0;
+
+// ---- Division bitmap (key_tx task) ----
+// Bit n = MIDI note CAN_DIV_STATE_BASE_NOTE + n is held.  Notes injected
+// over HTTP are kept apart so a rescan never clears them.
+#define DIV_STATE_KEEPALIVE_MS  250
+
+static uint64_t keyBitmap      = 0;
+static int      txDivision     = -1;     // Division keyBitmap is being sent on
+static uint64_t sentBitmap     = 0;
+static bool     sendPending    = true;   // Broadcast on the next pass
+static uint32_t lastSentMs     = 0;
+static KeyScannerStats stats   = {};
+
+// injectedBitmap is written from loop(); both bitmaps are read by /status
+static portMUX_TYPE injectMux = portMUX_INITIALIZER_UNLOCKED;
+static uint64_t injectedBitmap = 0;
+
+static uint64_t note_bit(uint8_t note) {
+    int n = (int)note - CAN_DIV_STATE_BASE_NOTE;
+    return (n >= 0 && n < 64) ? (1ULL << n) : 0;
+}
 
 // ---- Low-level I2C helpers ----
 
-static bool mcp_write(uint8_t addr, uint8_t reg, uint8_t val) {
-    Wire.beginTransmission(addr);
-    Wire.write(reg);
-    Wire.write(val);
-    return Wire.endTransmission() == 0;
+static bool mcp_write(int chip, uint8_t reg, uint8_t val) {
+    static uint8_t buf[2];   // Must outlive the queued transaction
+    buf[0] = reg;
+    buf[1] = val;
+    return i2c_master_transmit(chipDev[chip], buf, 2, I2C_TIMEOUT_MS) == ESP_OK &&
+           i2c_master_bus_wait_all_done(i2cBus, I2C_TIMEOUT_MS) == ESP_OK;
+}
+
+// Queue a sequential register read on every chip in mask, then wait once
+// for the whole batch.  Results land in rxBuf[chip].
+static void mcp_read_batch(uint8_t mask, uint8_t reg, uint8_t len) {
+    static uint8_t regs[MAX_CHIPS];
+    for (int c = 0; c < numChips; c++) {
+        if (!(mask & (1u << c))) continue;
+        regs[c] = reg;
+        memset(rxBuf[c], 0, len);
+        i2c_master_transmit_receive(chipDev[c], &regs[c], 1, rxBuf[c], len, I2C_TIMEOUT_MS);
+        stats.chipReads++;
+    }
+    i2c_master_bus_wait_all_done(i2cBus, I2C_TIMEOUT_MS);
+}
+
+static uint16_t rx_word(int chip, int offset) {
+    return (uint16_t)rxBuf[chip][offset] | ((uint16_t)rxBuf[chip][offset + 1] << 8);
+}
+
+// ---- key_scan task ----
+
+static void push_state(uint32_t edge) {
+    KeyEvent ev = { scanBitmap, edge, (uint8_t)scanHardwareId };
+    if (keyEvents.push(ev)) {
+        resendState = false;
+        xTaskNotifyGive(txTask);
+    } else {
+        resendState = true;
+        stats.eventsDropped++;
+    }
+}
+
+// Start over with everything released; held keys debounce in again
+static void reset_scan_state() {
+    scanHardwareId = hardwareId;
+    scanBitmap     = 0;
+    for (int c = 0; c < numChips; c++) {
+        keyState[c] = 0xFFFF;
+        settling[c] = 0;
+        lastSampleUs[c] = micros();
+    }
+    memset(integUs, 0, sizeof(integUs));
+    activeChips = (uint8_t)((1u << numChips) - 1);
+}
+
+// Fold one raw sample of chip c into the debounce integrators
+static void debounce_sample(int c, uint16_t raw, uint32_t now) {
+    uint32_t dt   = now - lastSampleUs[c];
+    lastSampleUs[c] = now;
+
+    uint16_t diff = raw ^ keyState[c];
+    uint16_t work = diff | settling[c];
+    while (work) {
+        int      pin = __builtin_ctz(work);
+        uint16_t bit = (uint16_t)(1u << pin);
+        work &= work - 1;
+        int k = c * KEYS_PER_CHIP + pin;
+
+        if (!(diff & bit)) {
+            // Back at the debounced level: bleed off, a glitch that decays away was a bounce
+            integUs[k] -= (int32_t)dt;
+            if (integUs[k] <= 0) {
+                integUs[k] = 0;
+                settling[c] &= (uint16_t)~bit;
+                stats.bouncesRejected++;
+            }
+            continue;
+        }
+
+        if (!(settling[c] & bit)) {
+            edgeUs[k] = now;
+            settling[c] |= bit;
+        }
+        integUs[k] += (int32_t)dt;
+
+        bool     pressed   = !(raw & bit);   // active-low: 0 = pressed
+        uint32_t threshold = pressed ? debouncePressUs : debounceReleaseUs;
+        if ((uint32_t)integUs[k] < threshold) continue;
+
+        integUs[k] = 0;
+        settling[c] &= (uint16_t)~bit;
+        keyState[c] ^= bit;
+        stats.transitions++;
+
+        // Map physical wiring address to the correct MIDI note number.
+        uint8_t note = keymaps[scanHardwareId][k];
+        if (pressed) scanBitmap |= note_bit(note);
+        else         scanBitmap &= ~note_bit(note);
+        push_state(edgeUs[k]);
+    }
 }
 
-// Read GPIOA and GPIOB in a single sequential transaction.
-// Returns a 16-bit word: bits [7:0] = port A, bits [15:8] = port B.
-// Reading GPIO also clears the chip's interrupt flag.
-static uint16_t mcp_read_gpio(uint8_t addr) {
-    Wire.beginTransmission(addr);
-    Wire.write(REG_GPIOA);
-    Wire.endTransmission(false);          // Repeated-start (no STOP)
-    Wire.requestFrom(addr, (uint8_t)2);
-    uint8_t a = Wire.available() ? Wire.read() : 0;
-    uint8_t b = Wire.available() ? Wire.read() : 0;
-    return (uint16_t)a | ((uint16_t)b << 8);
+// Re-sample chips that are still settling, then find the chips behind a new
+// interrupt by their INTF registers
+static void scan_pass() {
+    if (scanHardwareId != hardwareId) {
+        reset_scan_state();
+        push_state(0);
+    }
+
+    if (activeChips) {
+        mcp_read_batch(activeChips, REG_GPIOA, 2);   // clears these chips' INT
+        uint32_t now = micros();
+        for (int c = 0; c < numChips; c++) {
+            if (!(activeChips & (1u << c))) continue;
+            debounce_sample(c, rx_word(c, 0), now);
+            if (!settling[c]) activeChips &= (uint8_t)~(1u << c);   // Raw level matches again
+        }
+    }
+
+    // No new edge and INT deasserted (high) → no idle chip has anything
+    if (intFlag || digitalRead(PIN_I2C_INT) == LOW) {
+        intFlag = false;
+        uint32_t edge = intTimeUs;
+        uint8_t  idle = (uint8_t)(((1u << numChips) - 1) & ~activeChips);
+
+        // INTFA, INTFB, INTCAPA, INTCAPB in one read; INTCAP clears the interrupt
+        mcp_read_batch(idle, REG_INTFA, 4);
+        for (int c = 0; c < numChips; c++) {
+            if (!(idle & (1u << c)) || !rx_word(c, 0)) continue;
+
+            // The captured port state is the first sample, taken at the edge
+            activeChips |= (uint8_t)(1u << c);
+            lastSampleUs[c] = edge;
+            debounce_sample(c, rx_word(c, 2), edge);
+        }
+    }
+
+    if (resendState) push_state(0);
+}
+
+static void on_sample_timer(void*) {
+    xTaskNotifyGive(scanTask);
+}
+
+static void scan_task(void*) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        scan_pass();
+
+        // Keep sampling while chips settle, a chip still holds INT low, or
+        // an event is waiting for room in the ring
+        if (activeChips || resendState || digitalRead(PIN_I2C_INT) == LOW) {
+            esp_timer_start_once(sampleTimer, SAMPLE_INTERVAL_US);
+        }
+    }
+}
+
+// ---- key_tx task ----
+
+static void tx_task(void*) {
+    for (;;) {
+        // Sleep until a key event, an injected note or the keepalive is due
+        uint32_t elapsed = millis() - lastSentMs;
+        TickType_t wait  = sendPending ? 1
+                         : elapsed >= DIV_STATE_KEEPALIVE_MS ? 0
+                         : pdMS_TO_TICKS(DIV_STATE_KEEPALIVE_MS - elapsed);
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        KeyEvent ev;
+        while (keyEvents.pop(ev)) {
+            if (txDivision >= 0 && ev.division != txDivision) {
+                // The old division keeps our last state until its keepalive
+                // times out, so release everything there before moving
+                can_send_div_state((uint8_t)txDivision, (uint8_t)txDivision, 0);
+                numPending = 0;
+                sendPending = true;
+            }
+            txDivision = ev.division;
+            portENTER_CRITICAL(&injectMux);
+            keyBitmap  = ev.bitmap;
+            portEXIT_CRITICAL(&injectMux);
+            if (ev.edgeUs && numPending < MAX_PENDING) pendingEdgeUs[numPending++] = ev.edgeUs;
+        }
+        if (txDivision < 0) continue;   // key_scan has not reported yet
+
+        portENTER_CRITICAL(&injectMux);
+        uint64_t bitmap = keyBitmap | injectedBitmap;
+        portEXIT_CRITICAL(&injectMux);
+
+        uint32_t now = millis();
+        bool changed = sendPending || bitmap != sentBitmap;
+        if (!changed && now - lastSentMs < DIV_STATE_KEEPALIVE_MS) continue;
+
+        uint8_t ch = (uint8_t)txDivision;
+        if (!can_send_div_state(ch, ch, bitmap)) {
+            // TX queue full or bus down - retry on the next tick
+            sendPending = true;
+            stats.txFailed++;
+            continue;
+        }
+        sendPending = false;
+        sentBitmap  = bitmap;
+        lastSentMs  = now;
+        if (changed) stats.changeFrames++;
+        else         stats.keepaliveFrames++;
+
+        // Every transition folded into this frame is now on its way
+        uint32_t queuedUs = micros();
+        for (int i = 0; i < numPending; i++) {
+            latencyUs[latencyCount++ % LATENCY_SAMPLES] = queuedUs - pendingEdgeUs[i];
+        }
+        numPending = 0;
+    }
 }
 
 // ---- Public API ----
@@ -133,89 +440,144 @@ void key_scanner_begin() {
         Preferences prefs;
         prefs.begin("organ", true);
         hardwareId = prefs.getInt("hw_id", 0);
+        debouncePressUs   = prefs.getUInt("db_press", debouncePressUs);
+        debounceReleaseUs = prefs.getUInt("db_release", debounceReleaseUs);
         prefs.end();
     }
-    Log.printf("KeyScan: hardware_id=%d  CAN channel=%d\n", hardwareId, hardwareId);
-
-    Wire.begin(PIN_I2C_SDA, PIN_I2C_SCL);
-    Wire.setClock(400000);  // 400 kHz I2C fast-mode
+    Log.printf("KeyScan: hardware_id=%d  CAN channel=%d  debounce=%u/%u us\n",
+               hardwareId, hardwareId, (unsigned)debouncePressUs, (unsigned)debounceReleaseUs);
+
+    // A transaction queue puts the driver in asynchronous mode: reads for
+    // every chip are queued back to back and completed from the ISR
+    i2c_master_bus_config_t busConfig = {};
+    busConfig.i2c_port          = I2C_NUM_0;
+    busConfig.sda_io_num        = (gpio_num_t)PIN_I2C_SDA;
+    busConfig.scl_io_num        = (gpio_num_t)PIN_I2C_SCL;
+    busConfig.clk_source        = I2C_CLK_SRC_DEFAULT;
+    busConfig.glitch_ignore_cnt = 7;
+    busConfig.trans_queue_depth = MAX_CHIPS;
+    if (i2c_new_master_bus(&busConfig, &i2cBus) != ESP_OK) {
+        Log.println("KeyScan: I2C bus init failed");
+        return;
+    }
 
     // Shared INT line is active-low; external 4.7 kΩ pull-up is already fitted.
     pinMode(PIN_I2C_INT, INPUT);
-    attachInterrupt(digitalPinToInterrupt(PIN_I2C_INT), onInterrupt, FALLING);
 
     // Probe addresses 0x20–0x27 and configure each chip found.
     numChips = 0;
     for (int i = 0; i < MAX_CHIPS; i++) {
         uint8_t addr = MCP23017_BASE_ADDR + i;
-        Wire.beginTransmission(addr);
-        if (Wire.endTransmission() != 0) continue;   // Nothing at this address
+        if (i2c_master_probe(i2cBus, addr, I2C_TIMEOUT_MS) != ESP_OK) continue;   // Nothing at this address
+
+        i2c_device_config_t devConfig = {};
+        devConfig.dev_addr_length = I2C_ADDR_BIT_LEN_7;
+        devConfig.device_address  = addr;
+        devConfig.scl_speed_hz    = KEYSCAN_I2C_HZ;
+        if (i2c_master_bus_add_device(i2cBus, &devConfig, &chipDev[numChips]) != ESP_OK) continue;
+        int c = numChips;
 
         // All pins → inputs
-        mcp_write(addr, REG_IODIRA,   0xFF);
-        mcp_write(addr, REG_IODIRB,   0xFF);
+        mcp_write(c, REG_IODIRA,   0xFF);
+        mcp_write(c, REG_IODIRB,   0xFF);
 
         // Enable internal pull-ups on all pins
-        mcp_write(addr, REG_GPPUA,    0xFF);
-        mcp_write(addr, REG_GPPUB,    0xFF);
+        mcp_write(c, REG_GPPUA,    0xFF);
+        mcp_write(c, REG_GPPUB,    0xFF);
 
         // Interrupt on any change from previous state (captures both press & release)
-        mcp_write(addr, REG_INTCONA,  0x00);
-        mcp_write(addr, REG_INTCONB,  0x00);
+        mcp_write(c, REG_INTCONA,  0x00);
+        mcp_write(c, REG_INTCONB,  0x00);
 
         // IOCON: MIRROR + open-drain (safe to wire INT pins together)
-        mcp_write(addr, REG_IOCONA,   IOCON_VALUE);
+        mcp_write(c, REG_IOCONA,   IOCON_VALUE);
 
         // Enable interrupt on all pins
-        mcp_write(addr, REG_GPINTENA, 0xFF);
-        mcp_write(addr, REG_GPINTENB, 0xFF);
+        mcp_write(c, REG_GPINTENA, 0xFF);
+        mcp_write(c, REG_GPINTENB, 0xFF);
 
-        // Read initial state (also clears any pending interrupt on this chip)
-        chipAddr[numChips]  = addr;
-        prevState[numChips] = mcp_read_gpio(addr);
+        // Debounced state starts all-released; the first scan debounces
+        // anything already held like a normal press
+        chipAddr[numChips] = addr;
+        numChips++;
+        mcp_read_batch((uint8_t)(1u << c), REG_GPIOA, 2);   // Also clears any pending interrupt
 
         Log.printf("KeyScan: chip %d at 0x%02X  initial=0x%04X\n",
-                   numChips, addr, prevState[numChips]);
-        numChips++;
+                   c, addr, rx_word(c, 0));
     }
-    Log.printf("KeyScan: %d MCP23017 chip(s) found\n", numChips);
+    Log.printf("KeyScan: %d MCP23017 chip(s) found at %u kHz\n",
+               numChips, (unsigned)(KEYSCAN_I2C_HZ / 1000));
     if (numChips != expectedChips[hardwareId]) {
         Log.printf("KeyScan: WARNING – expected %d chip(s) for hw_id=%d, found %d\n",
                    expectedChips[hardwareId], hardwareId, numChips);
     }
 
-    // Force an immediate scan so our stored state is definitely in sync.
-    intFlag = true;
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback        = on_sample_timer;
+    timerArgs.dispatch_method = ESP_TIMER_TASK;
+    timerArgs.name            = "key_sample";
+    esp_timer_create(&timerArgs, &sampleTimer);
+
+    // Sample every chip until it settles so our state is definitely in sync.
+    reset_scan_state();
+
+    xTaskCreatePinnedToCore(tx_task,   "key_tx",   3072, nullptr, TX_TASK_PRIORITY,   &txTask,   KEY_TASK_CORE);
+    // Report the all-released state before key_scan starts, so keepalives and
+    // injected notes go out before the first key changes
+    push_state(0);
+    xTaskCreatePinnedToCore(scan_task, "key_scan", 4096, nullptr, SCAN_TASK_PRIORITY, &scanTask, KEY_TASK_CORE);
+    attachInterrupt(digitalPinToInterrupt(PIN_I2C_INT), onInterrupt, FALLING);
+    xTaskNotifyGive(scanTask);
 }
 
-void key_scanner_update() {
-    // Fast path: INT is still deasserted (high) and no ISR flag → nothing to do.
-    if (!intFlag && digitalRead(PIN_I2C_INT) == HIGH) return;
-    intFlag = false;
+void key_scanner_inject_note(uint8_t note, bool pressed) {
+    portENTER_CRITICAL(&injectMux);
+    if (pressed) injectedBitmap |= note_bit(note);
+    else         injectedBitmap &= ~note_bit(note);
+    portEXIT_CRITICAL(&injectMux);
+    if (txTask) xTaskNotifyGive(txTask);
+}
 
-    for (int c = 0; c < numChips; c++) {
-        uint16_t cur     = mcp_read_gpio(chipAddr[c]);   // clears this chip's INT
-        uint16_t changed = cur ^ prevState[c];
-        if (!changed) continue;
-
-        for (int pin = 0; pin < KEYS_PER_CHIP; pin++) {
-            if (!(changed & (1u << pin))) continue;
-
-            // Map physical wiring address to the correct MIDI note number.
-            uint8_t raw     = (uint8_t)c * (uint8_t)KEYS_PER_CHIP + (uint8_t)pin;
-            uint8_t note    = keymaps[hardwareId][raw];
-            bool    pressed = !(cur & (1u << pin));  // active-low: 0 = pressed
-
-            if (pressed) {
-                Log.printf("KeyScan: ON  chip=%d pin=%d note=%d\n", c, pin, note);
-                can_send_note_on((uint8_t)hardwareId, note, 127);
-            } else {
-                Log.printf("KeyScan: OFF chip=%d pin=%d note=%d\n", c, pin, note);
-                can_send_note_off((uint8_t)hardwareId, note, 64);
-            }
-        }
-        prevState[c] = cur;
-    }
+uint64_t key_scanner_get_bitmap() {
+    portENTER_CRITICAL(&injectMux);
+    uint64_t bitmap = keyBitmap | injectedBitmap;
+    portEXIT_CRITICAL(&injectMux);
+    return bitmap;
+}
+
+void key_scanner_get_stats(KeyScannerStats* out) {
+    if (out) *out = stats;
+}
+
+void key_scanner_get_latency(KeyLatency* out) {
+    if (!out) return;
+    uint32_t n = latencyCount < LATENCY_SAMPLES ? latencyCount : LATENCY_SAMPLES;
+    uint32_t sorted[LATENCY_SAMPLES];
+    memcpy(sorted, latencyUs, n * sizeof(uint32_t));
+    std::sort(sorted, sorted + n);
+
+    out->samples = n;
+    out->p50Us   = n ? sorted[n * 50 / 100] : 0;
+    out->p90Us   = n ? sorted[n * 90 / 100] : 0;
+    out->p99Us   = n ? sorted[n * 99 / 100] : 0;
+    out->maxUs   = n ? sorted[n - 1] : 0;
+}
+
+void key_scanner_get_debounce(uint32_t* press_us, uint32_t* release_us) {
+    if (press_us)   *press_us   = debouncePressUs;
+    if (release_us) *release_us = debounceReleaseUs;
+}
+
+bool key_scanner_set_debounce(uint32_t press_us, uint32_t release_us) {
+    if (press_us > MAX_DEBOUNCE_US || release_us > MAX_DEBOUNCE_US) return false;
+    debouncePressUs   = press_us;
+    debounceReleaseUs = release_us;
+    Preferences prefs;
+    prefs.begin("organ", false);
+    prefs.putUInt("db_press", press_us);
+    prefs.putUInt("db_release", release_us);
+    prefs.end();
+    return true;
 }
 
 int key_scanner_chip_count() {
@@ -228,7 +590,14 @@ int key_scanner_get_hardware_id() {
 
 void key_scanner_set_hardware_id(int id) {
     if (id < 0 || id > 5) return;
-    hardwareId = id;
+    if (id != hardwareId) {
+        // key_scan rescans with the new keymap; key_tx releases the old division
+        portENTER_CRITICAL(&injectMux);
+        injectedBitmap = 0;
+        portEXIT_CRITICAL(&injectMux);
+        hardwareId = id;
+        if (scanTask) xTaskNotifyGive(scanTask);
+    }
     Preferences prefs;
     prefs.begin("organ", false);
     prefs.putInt("hw_id", id);
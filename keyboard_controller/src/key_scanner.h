@@ -12,20 +12,65 @@ extern "C" {
  *
  * Probes I2C addresses 0x20–0x27, configures every found chip as
  * all-inputs with internal pull-ups and interrupt-on-change (both edges),
- * then takes an initial snapshot of key states.
+ * then starts the scan and CAN broadcast tasks.
  *
- * Call once from setup() after Wire / CAN have been initialised.
+ * When the shared INT line asserts (active-low), each chip's INTF/INTCAP
+ * registers are read; chips that fired are then re-sampled until every key
+ * has passed the debounce, and the debounced keys are folded into a 64-bit
+ * bitmap.  Keys are active-low: pin LOW = pressed → bit set, pin HIGH =
+ * released → bit clear.  One DIV_STATE CAN frame is sent when the bitmap
+ * changes (however many keys moved) and every 250 ms as a keepalive.
+ *
+ * Both tasks run independently of loop(); nothing needs to be polled.
+ * Call once from setup() after CAN has been initialised.
  */
 void key_scanner_begin();
 
 /**
- * Process any pending key events.
- *
- * Must be called from loop().  When the shared INT line asserts (active-low),
- * every chip is polled; a CAN Note-On or Note-Off is sent for each changed key.
- * Keys are active-low: pin LOW = pressed → Note On, pin HIGH = released → Note Off.
+ * Press or release a note without a physical key (HTTP testing).
+ * Merged into the broadcast bitmap until released.
+ */
+void key_scanner_inject_note(uint8_t note, bool pressed);
+
+/**
+ * Current division bitmap (physical keys | injected notes).
+ * Bit n = MIDI note CAN_DIV_STATE_BASE_NOTE + n.
+ */
+uint64_t key_scanner_get_bitmap();
+
+typedef struct {
+    uint32_t changeFrames;     // DIV_STATE frames sent because the bitmap changed
+    uint32_t keepaliveFrames;  // DIV_STATE frames sent as keepalive
+    uint32_t txFailed;         // Frames that could not be queued (retried)
+    uint32_t transitions;      // Debounced key presses + releases
+    uint32_t bouncesRejected;  // Level changes that decayed before the debounce time
+    uint32_t chipReads;        // I2C register reads (INTF/INTCAP or GPIO)
+    uint32_t eventsDropped;    // Ring to the CAN task was full (state is re-sent)
+} KeyScannerStats;
+
+void key_scanner_get_stats(KeyScannerStats* out);
+
+/**
+ * Key-to-CAN latency over the last 256 transitions: from the first edge of
+ * a key change (ISR timestamp) to its DIV_STATE frame being queued.
+ * Includes the debounce time.
+ */
+typedef struct {
+    uint32_t samples;
+    uint32_t p50Us;
+    uint32_t p90Us;
+    uint32_t p99Us;
+    uint32_t maxUs;
+} KeyLatency;
+
+void key_scanner_get_latency(KeyLatency* out);
+
+/**
+ * Get/set the debounce times: how long a key must read pressed (released)
+ * before the change is accepted.  0–20000 µs each; persisted in NVS.
  */
-void key_scanner_update();
+void key_scanner_get_debounce(uint32_t* press_us, uint32_t* release_us);
+bool key_scanner_set_debounce(uint32_t press_us, uint32_t release_us);
 
 /**
  * Returns the number of MCP23017 chips discovered during begin().
@@ -0,0 +1,187 @@
+// logstream.h - Fixed-size log ring streamed to browsers as Server-Sent Events
+//
+// Everything written to Log lands in a LOGSTREAM_SIZE byte ring. When it is
+// full the oldest bytes are overwritten, so the log costs the same memory
+// however much is logged and nothing is allocated per line. Each byte has a
+// sequence number, its position in everything logged since boot.
+//
+// GET /logs/stream answers with an event stream: the lines still in the
+// ring, then each batch of new lines as one event as soon as the server
+// task gets to it. An event's id is the sequence number just past its last
+// line; reconnecting with ?since=<id> picks up where the last stream
+// stopped. GET /logs/poll returns the same lines as JSON.
+//
+//   static LogStream logStream;
+//   logStream.write(buffer, size);   // From any task, via httpserver_log()
+//   server.on("/logs/stream", HTTP_GET, []() { logStream.subscribe(server); });
+//   logStream.pump();                // From the task that runs the server
+#ifndef LOGSTREAM_H
+#define LOGSTREAM_H
+
+#include <Arduino.h>
+#include <WebServer.h>
+#include "httpstream.h"
+
+#define LOGSTREAM_SIZE    16384   // Bytes of log kept; power of two
+#define LOGSTREAM_CLIENTS 2       // Event streams open at once
+#define LOGSTREAM_CHUNK   512     // Bytes copied out of the ring at a time, on the caller's stack
+
+class LogStream {
+public:
+  LogStream() : lock(xSemaphoreCreateMutex()) {}
+
+  LogStream(const LogStream&) = delete;
+  LogStream& operator=(const LogStream&) = delete;
+
+  // Append raw log bytes, dropping '\r'
+  void write(const uint8_t* data, size_t size) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (size_t i = 0; i < size; i++) {
+      if (data[i] != '\r') ring[head++ & (LOGSTREAM_SIZE - 1)] = data[i];
+    }
+    xSemaphoreGive(lock);
+  }
+
+  // Sequence number of the next byte to be logged
+  uint32_t end() {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    uint32_t h = head;
+    xSemaphoreGive(lock);
+    return h;
+  }
+
+  // Copy whole lines from seq up to until into out and move seq past them.
+  // A seq the ring has already overwritten, or one from before a reboot,
+  // starts again at the oldest whole line in the ring. A line longer than
+  // size comes out in pieces. Returns the bytes copied, 0 when there is no
+  // whole line yet.
+  size_t read(uint32_t& seq, char* out, size_t size, uint32_t until = UINT32_MAX) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    uint32_t h = head;
+    uint32_t oldest = h > LOGSTREAM_SIZE ? h - LOGSTREAM_SIZE : 0;
+    if (seq < oldest || seq > h) {
+      seq = oldest;
+      // The first line in the ring may have lost its start
+      if (oldest > 0) {
+        while (seq < h && ring[seq & (LOGSTREAM_SIZE - 1)] != '\n') seq++;
+        if (seq < h) seq++;
+      }
+    }
+    if (until > h) until = h;
+    size_t n = until > seq ? until - seq : 0;
+    if (n > size) n = size;
+    for (size_t i = 0; i < n; i++) out[i] = ring[(seq + i) & (LOGSTREAM_SIZE - 1)];
+    xSemaphoreGive(lock);
+
+    // Stop after the last newline unless one line fills the whole buffer
+    size_t whole = n;
+    while (whole > 0 && out[whole - 1] != '\n') whole--;
+    if (whole > 0 || n < size) n = whole;
+    seq += n;
+    return n;
+  }
+
+  // JSON-escape the lines logged from seq on into out, for /logs/poll, and
+  // return the sequence number to ask for next time
+  uint32_t writeSince(HttpStream& out, uint32_t seq) {
+    char buf[LOGSTREAM_CHUNK];
+    uint32_t until = end();
+    size_t n;
+    while ((n = read(seq, buf, sizeof(buf), until)) > 0) out.escaped(buf, n);
+    return seq;
+  }
+
+  // Handler for GET /logs/stream?since=<id>. The response stays open: the
+  // client is kept and fed by pump(). Answers 503 when all streams are in use.
+  void subscribe(WebServer& server) {
+    int slot = -1;
+    for (int i = 0; i < LOGSTREAM_CLIENTS; i++) {
+      if (!clients[i].connected()) {
+        clients[i].stop();
+        if (slot < 0) slot = i;
+      }
+    }
+    if (slot < 0) {
+      server.send(503, "text/plain", "Too many log streams open");
+      return;
+    }
+
+    // Past the ring's end starts from its oldest line, as does no since
+    long since = server.hasArg("since") ? server.arg("since").toInt() : -1;
+    seqs[slot] = since < 0 ? UINT32_MAX : (uint32_t)since;
+
+    // The server drops its copy of the client when the handler returns; this
+    // one keeps the connection open
+    clients[slot] = server.client();
+    clients[slot].print("HTTP/1.1 200 OK\r\n"
+                        "Content-Type: text/event-stream\r\n"
+                        "Cache-Control: no-cache\r\n"
+                        "Connection: keep-alive\r\n"
+                        "\r\n");
+    // Let the server go back to accepting; it would otherwise wait on this
+    // connection for a next request that never comes
+    server.client().stop();
+  }
+
+  // Send each open stream the lines logged since its last event. Call
+  // often from the task that runs the server.
+  void pump() {
+    char buf[LOGSTREAM_CHUNK];
+    for (int i = 0; i < LOGSTREAM_CLIENTS; i++) {
+      if (!clients[i].connected()) continue;
+      size_t n;
+      uint32_t until = end();
+      while ((n = read(seqs[i], buf, sizeof(buf), until)) > 0) {
+        if (!sendEvent(clients[i], buf, n, seqs[i])) {
+          clients[i].stop();   // Gone or stuck; the browser reconnects with since=
+          break;
+        }
+      }
+    }
+  }
+
+private:
+  // One event: a data: field per line and the id. The browser joins the
+  // data fields with '\n'.
+  static bool sendEvent(WiFiClient& client, const char* data, size_t n, uint32_t id) {
+    char ev[LOGSTREAM_CHUNK];
+    size_t len = 0;
+    bool ok = true;
+    auto put = [&](const char* s, size_t k) {
+      while (k > 0 && ok) {
+        if (len == sizeof(ev)) {
+          ok = client.write((const uint8_t*)ev, len) == len;
+          len = 0;
+        }
+        size_t m = k < sizeof(ev) - len ? k : sizeof(ev) - len;
+        memcpy(ev + len, s, m);
+        len += m;
+        s += m;
+        k -= m;
+      }
+    };
+
+    size_t start = 0;
+    for (size_t i = 0; i <= n; i++) {
+      if (i == n && start == n) break;
+      if (i == n || data[i] == '\n') {
+        put("data: ", 6);
+        put(data + start, i - start);
+        put("\n", 1);
+        start = i + 1;
+      }
+    }
+    char idField[24];
+    put(idField, snprintf(idField, sizeof(idField), "id: %u\n\n", (unsigned)id));
+    if (ok && len > 0) ok = client.write((const uint8_t*)ev, len) == len;
+    return ok;
+  }
+
+  SemaphoreHandle_t lock;
+  char ring[LOGSTREAM_SIZE];
+  uint32_t head = 0;
+  WiFiClient clients[LOGSTREAM_CLIENTS];
+  uint32_t seqs[LOGSTREAM_CLIENTS];
+};
+
+#endif // LOGSTREAM_H
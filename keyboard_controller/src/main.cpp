@@ -17,7 +17,6 @@ static const char* WIFI_PASS = "murphalurf18";
 
 // Telnet server for remote logging
 WiFiServer telnetServer(23);
-WiFiClient telnetClient;
 
 // ---- WiFi ----
 static void wifi_connect() {
@@ -69,12 +68,14 @@ static void ota_begin() {
 
     telnetServer.begin();
     telnetServer.setNoDelay(true);
+    Log.serveTelnet(telnetServer);
     Log.println("Telnet server started on port 23");
 }
 
 // ---- Setup ----
 void setup() {
     Serial.begin(115200);
+    logger_begin();
 
     wifi_connect();
 
@@ -95,17 +96,11 @@ void setup() {
 
 // ---- Loop ----
 void loop() {
+    // Telnet clients are taken by the logger's telnet task
     if (WiFi.status() == WL_CONNECTED) {
-        // Accept new telnet client
-        if (telnetServer.hasClient()) {
-            if (telnetClient) telnetClient.stop();
-            telnetClient = telnetServer.available();
-            Log.println("\nTelnet client connected");
-        }
         ArduinoOTA.handle();
         httpserver_loop();
     }
 
-    // Scan keys and send CAN note messages on any change
-    key_scanner_update();
+    // Key scanning and CAN broadcast run in their own tasks (key_scanner.cpp)
 }
@@ -14,6 +14,7 @@ const char SETTINGS_PAGE_HTML[] = R"rawliteral(
         .setting-row { display: flex; align-items: center; margin: 15px 0; gap: 15px; }
         .setting-row label { flex: 0 0 160px; font-weight: bold; color: #555; }
         .setting-row select { flex: 1; padding: 8px; border: 2px solid #ddd; border-radius: 4px; font-size: 14px; }
+        .setting-row input { flex: 1; padding: 8px; border: 2px solid #ddd; border-radius: 4px; font-size: 14px; }
         .info-text { color: #666; font-size: 12px; margin-top: 4px; font-style: italic; margin-left: 175px; }
         .button-group { margin-top: 20px; padding-top: 15px; border-top: 1px solid #ddd; }
         button { background: #4CAF50; color: white; padding: 10px 20px; border: none; border-radius: 4px; cursor: pointer; font-size: 16px; margin: 5px; }
@@ -52,6 +53,22 @@ const char SETTINGS_PAGE_HTML[] = R"rawliteral(
         </div>
     </div>
 
+    <div class='section'>
+        <h2>Key Debounce</h2>
+        <div class='setting-row'>
+            <label for='debouncePress'>Press (&micro;s)</label>
+            <input type='number' id='debouncePress' min='0' max='20000' step='100'>
+        </div>
+        <div class='setting-row'>
+            <label for='debounceRelease'>Release (&micro;s)</label>
+            <input type='number' id='debounceRelease' min='0' max='20000' step='100'>
+        </div>
+        <div class='info-text'>How long a contact must read steadily closed (open) before the key is pressed (released). Shorter glitches are rejected as bounce.</div>
+        <div class='button-group'>
+            <button onclick='saveDebounce()'>Save</button>
+        </div>
+    </div>
+
     <div class='nav'>
         <a href='/'>Home</a>
         <a href='/logs'>Logs</a>
@@ -71,6 +88,8 @@ const char SETTINGS_PAGE_HTML[] = R"rawliteral(
                 const resp = await fetch('/config');
                 const cfg = await resp.json();
                 document.getElementById('hardwareId').value = cfg.hardwareId;
+                document.getElementById('debouncePress').value = cfg.debouncePressUs;
+                document.getElementById('debounceRelease').value = cfg.debounceReleaseUs;
                 showStatus('Settings loaded');
             } catch (e) { showStatus('Failed to load: ' + e, true); }
         }
@@ -85,6 +104,18 @@ const char SETTINGS_PAGE_HTML[] = R"rawliteral(
                 }
             } catch (e) { showStatus('Failed to save: ' + e, true); }
         }
+        async function saveDebounce() {
+            try {
+                const press = document.getElementById('debouncePress').value;
+                const release = document.getElementById('debounceRelease').value;
+                const resp = await fetch('/config/debounce?press_us=' + press + '&release_us=' + release, {method: 'POST'});
+                if (resp.ok) {
+                    showStatus('Saved \u2013 active immediately');
+                } else {
+                    showStatus('Save failed: ' + await resp.text(), true);
+                }
+            } catch (e) { showStatus('Failed to save: ' + e, true); }
+        }
         window.addEventListener('load', loadSettings);
     </script>
 </body></html>
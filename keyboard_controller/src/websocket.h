@@ -0,0 +1,208 @@
+// websocket.h - Small binary WebSocket server on top of the sync WebServer
+//
+// GET /ws with the upgrade headers is answered by accept(), which does the
+// handshake itself and keeps a copy of the client, as LogStream does for
+// its event streams. From then on poll() reads what the browsers send and
+// send() writes to them, both from the task that runs the server.
+//
+// Only binary messages that fit in WEBSOCKET_MESSAGE bytes are delivered.
+// Text messages are ignored and pings answered; a fragmented or larger
+// message closes the connection.
+//
+//   static WebSocketServer ws;
+//   websocket_begin(server);          // Instead of webasset_begin(), before server.begin()
+//   server.on("/ws", HTTP_GET, []() { ws.accept(server); });
+//   ws.poll(onMessage);               // From the task that runs the server
+//   ws.sendAll(data, size);
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+
+#include <Arduino.h>
+#include <WebServer.h>
+#include <mbedtls/base64.h>
+#include <mbedtls/sha1.h>
+#include "webasset.h"
+
+#define WEBSOCKET_CLIENTS 2     // Connections open at once
+#define WEBSOCKET_MESSAGE 256   // Largest message either way, in bytes
+
+// WebServer keeps a single list of request headers to collect, so this
+// asks for webasset's If-None-Match along with the handshake's. Call
+// before server.begin(), in place of webasset_begin().
+static inline void websocket_begin(WebServer& server) {
+  static const char* headers[] = { "If-None-Match", "Upgrade", "Sec-WebSocket-Key" };
+  server.collectHeaders(headers, 3);
+}
+
+class WebSocketServer {
+public:
+  typedef void (*Handler)(int client, const uint8_t* data, size_t size);
+
+  // Handler for GET /ws. Returns the new client's number, or -1 after
+  // answering 400 (not an upgrade) or 503 (all connections in use).
+  int accept(WebServer& server) {
+    String key = server.header("Sec-WebSocket-Key");
+    if (!server.header("Upgrade").equalsIgnoreCase("websocket") || key.length() == 0) {
+      server.send(400, "text/plain", "Expected a WebSocket upgrade");
+      return -1;
+    }
+    int slot = -1;
+    for (int i = 0; i < WEBSOCKET_CLIENTS; i++) {
+      if (!clients[i].connected()) {
+        drop(i);
+        if (slot < 0) slot = i;
+      }
+    }
+    if (slot < 0) {
+      server.send(503, "text/plain", "Too many WebSocket connections open");
+      return -1;
+    }
+
+    // Sec-WebSocket-Accept is base64(SHA-1(key + the RFC 6455 GUID))
+    key += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    uint8_t sha[20];
+    char acceptKey[32];
+    size_t len = 0;
+    mbedtls_sha1((const uint8_t*)key.c_str(), key.length(), sha);
+    mbedtls_base64_encode((uint8_t*)acceptKey, sizeof(acceptKey) - 1, &len, sha, sizeof(sha));
+    acceptKey[len] = 0;
+
+    clients[slot] = server.client();
+    clients[slot].setNoDelay(true);
+    clients[slot].printf("HTTP/1.1 101 Switching Protocols\r\n"
+                         "Upgrade: websocket\r\n"
+                         "Connection: Upgrade\r\n"
+                         "Sec-WebSocket-Accept: %s\r\n"
+                         "\r\n", acceptKey);
+    // Let the server go back to accepting; it would otherwise wait on this
+    // connection for a next request that never comes
+    server.client().stop();
+    return slot;
+  }
+
+  // Read what the browsers have sent and pass each binary message to
+  // handler. Never waits for data. Call often from the task that runs the
+  // server.
+  void poll(Handler handler) {
+    for (int i = 0; i < WEBSOCKET_CLIENTS; i++) {
+      if (!clients[i].connected()) continue;
+      int avail;
+      while (clients[i].connected() && (avail = clients[i].available()) > 0) {
+        size_t room = sizeof(rx[i]) - rxLen[i];
+        int n = clients[i].read(rx[i] + rxLen[i], (size_t)avail < room ? (size_t)avail : room);
+        if (n <= 0) break;
+        rxLen[i] += n;
+        while (clients[i].connected() && frame(i, handler)) {}
+      }
+    }
+  }
+
+  // Send one binary message to a client; false (and the client dropped)
+  // when it cannot be written
+  bool send(int client, const uint8_t* data, size_t size) {
+    if (client < 0 || client >= WEBSOCKET_CLIENTS || !clients[client].connected()) return false;
+    if (!write(client, 0x2, data, size)) {
+      drop(client);
+      return false;
+    }
+    return true;
+  }
+
+  void sendAll(const uint8_t* data, size_t size) {
+    for (int i = 0; i < WEBSOCKET_CLIENTS; i++) {
+      if (clients[i].connected()) send(i, data, size);
+    }
+  }
+
+  // True while any browser is connected
+  bool connected() {
+    for (int i = 0; i < WEBSOCKET_CLIENTS; i++) {
+      if (clients[i].connected()) return true;
+    }
+    return false;
+  }
+
+private:
+  // Handle the frame at the start of rx[i], if it is all there. Returns
+  // true when one was consumed.
+  bool frame(int i, Handler handler) {
+    uint8_t* f = rx[i];
+    size_t have = rxLen[i];
+    if (have < 2) return false;
+    bool fin = f[0] & 0x80;
+    uint8_t opcode = f[0] & 0x0F;
+    size_t len = f[1] & 0x7F;
+    size_t head = 2;
+    if (len == 126) {
+      if (have < 4) return false;
+      len = (f[2] << 8) | f[3];
+      head = 4;
+    } else if (len == 127) {
+      return close(i, 1009);
+    }
+    if (!(f[1] & 0x80)) return close(i, 1002);   // Browsers always mask
+    if (!fin || len > WEBSOCKET_MESSAGE) return close(i, 1009);
+    head += 4;
+    if (have < head + len) return false;
+
+    uint8_t* data = f + head;
+    const uint8_t* mask = f + head - 4;
+    for (size_t k = 0; k < len; k++) data[k] ^= mask[k & 3];
+
+    switch (opcode) {
+      case 0x2:   // Binary
+        handler(i, data, len);
+        break;
+      case 0x8:   // Close; echo it and hang up
+        write(i, 0x8, data, len < 2 ? len : 2);
+        drop(i);
+        return false;
+      case 0x9:   // Ping
+        write(i, 0xA, data, len);
+        break;
+      case 0x1:   // Text
+      case 0xA:   // Pong
+        break;
+      default:
+        return close(i, 1003);
+    }
+    memmove(f, f + head + len, have - head - len);
+    rxLen[i] = have - head - len;
+    return true;
+  }
+
+  bool write(int i, uint8_t opcode, const uint8_t* data, size_t size) {
+    if (size > WEBSOCKET_MESSAGE) return false;
+    uint8_t buf[4 + WEBSOCKET_MESSAGE];
+    size_t head = 2;
+    buf[0] = 0x80 | opcode;
+    if (size < 126) {
+      buf[1] = size;
+    } else {
+      buf[1] = 126;
+      buf[2] = size >> 8;
+      buf[3] = size & 0xFF;
+      head = 4;
+    }
+    memcpy(buf + head, data, size);
+    return clients[i].write(buf, head + size) == head + size;
+  }
+
+  bool close(int i, uint16_t code) {
+    uint8_t status[2] = { (uint8_t)(code >> 8), (uint8_t)(code & 0xFF) };
+    write(i, 0x8, status, sizeof(status));
+    drop(i);
+    return false;
+  }
+
+  void drop(int i) {
+    clients[i].stop();
+    rxLen[i] = 0;
+  }
+
+  WiFiClient clients[WEBSOCKET_CLIENTS];
+  uint8_t rx[WEBSOCKET_CLIENTS][8 + WEBSOCKET_MESSAGE];   // One frame: header, mask and payload
+  size_t rxLen[WEBSOCKET_CLIENTS] = {};
+};
+
+#endif // WEBSOCKET_H
@@ -0,0 +1,64 @@
+// bench_chimes.cpp - Chimes note-path microbenchmarks on the host (see bench_host.h)
+//
+// Build (from utilities/bench, see CMakeLists.txt):
+//   cmake -S . -B build && cmake --build build
+//
+//   build/bench_chimes -o base.txt                # before a change
+//   build/bench_chimes --baseline base.txt        # after; exit 1 on a regression
+#include <Arduino.h>
+#include "sim_fakes.h"
+#include "bench_host.h"
+#include "bench_notepath.h"
+#include "chimes.h"
+#include "midinote.h"
+#include "midiseq.h"
+#include "midiudp.h"
+#include "midireceiver.h"
+#include "noterepeater.h"
+
+// Four chimes struck and released in one MUDP-v1 packet
+static const std::vector<uint8_t> MUDP_PACKET = {
+  0x4D, 0x55, 0x01, 0x08,
+  0x90, 0x45, 0x64,  0x90, 0x49, 0x64,  0x90, 0x4C, 0x64,  0x90, 0x51, 0x64,
+  0x80, 0x45, 0x00,  0x80, 0x49, 0x00,  0x80, 0x4C, 0x00,  0x80, 0x51, 0x00,
+};
+
+// The same eight messages as DIN MIDI bytes
+static const uint8_t UART_BYTES[] = {
+  0x90, 0x45, 0x64,  0x90, 0x49, 0x64,  0x90, 0x4C, 0x64,  0x90, 0x51, 0x64,
+  0x80, 0x45, 0x00,  0x80, 0x49, 0x00,  0x80, 0x4C, 0x00,  0x80, 0x51, 0x00,
+};
+
+// Receive, validate and dispatch one packet
+static void bench_mudp_update(uint32_t iters) {
+  for (uint32_t i = 0; i < iters; i++) {
+    sim_udp_inject(MUDP_PACKET);
+    midiUDP.update();
+  }
+}
+
+// Drain and parse one burst from the UART
+static void bench_uart_update(uint32_t iters) {
+  for (uint32_t i = 0; i < iters; i++) {
+    Serial.simInject(UART_BYTES, sizeof(UART_BYTES));
+    midiReceiver.update();
+  }
+}
+
+static void begin() {
+  chimes_begin();
+  midinote_begin();
+  midiseq_begin();
+  noterepeater_setup();
+  midiUDP.begin();
+  midiReceiver.begin();
+  bench_notepath_begin();
+}
+
+int main(int argc, char** argv) {
+  BenchHostTarget target = { "chimes", {}, begin, bench_notepath_end };
+  target.cases.assign(BENCH_NOTEPATH_CASES, BENCH_NOTEPATH_CASES + BENCH_NOTEPATH_COUNT);
+  target.cases.push_back({ "MIDIoverUDP::update/8msg", bench_mudp_update, 8, (uint16_t)MUDP_PACKET.size() });
+  target.cases.push_back({ "MidiReceiver::update/8msg", bench_uart_update, 8, sizeof(UART_BYTES) });
+  return bench_host_main(argc, argv, target);
+}
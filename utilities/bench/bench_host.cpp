@@ -0,0 +1,108 @@
+// bench_host.cpp - Host driver for the note-path microbenchmarks (see bench_host.h)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include "bench_host.h"
+#include "sim.h"
+
+// Print onto a stdio stream
+class FilePrint : public Print {
+public:
+  explicit FilePrint(FILE* f) : f(f) {}
+  size_t write(uint8_t c) override { return fputc(c, f) == EOF ? 0 : 1; }
+  size_t write(const uint8_t* buffer, size_t size) override { return fwrite(buffer, 1, size, f); }
+private:
+  FILE* f;
+};
+
+// Rows of a saved table: name -> cycles/op (more digits than cycles/msg,
+// same ratio)
+static bool read_table(const char* path, std::map<std::string, float>& out) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    char name[128];
+    unsigned iters;
+    float perOp, perMsg, perByte;
+    if (sscanf(line, "%127s %u %f %f %f", name, &iters, &perOp, &perMsg, &perByte) == 5) {
+      out[name] = perOp;
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+static void usage(const char* prog) {
+  fprintf(stderr, "usage: %s [-o file] [--baseline file [--threshold pct]] [--budget ticks] [--filter text]\n", prog);
+  exit(2);
+}
+
+int bench_host_main(int argc, char** argv, const BenchHostTarget& target) {
+  const char* outPath = nullptr;
+  const char* basePath = nullptr;
+  const char* filter = nullptr;
+  float threshold = 10;
+  uint32_t budget = 30000000;
+
+  for (int i = 1; i < argc; i++) {
+    bool more = i + 1 < argc;
+    if (!strcmp(argv[i], "-o") && more) outPath = argv[++i];
+    else if (!strcmp(argv[i], "--baseline") && more) basePath = argv[++i];
+    else if (!strcmp(argv[i], "--threshold") && more) threshold = (float)atof(argv[++i]);
+    else if (!strcmp(argv[i], "--budget") && more) budget = (uint32_t)strtoul(argv[++i], nullptr, 0);
+    else if (!strcmp(argv[i], "--filter") && more) filter = argv[++i];
+    else usage(argv[0]);
+  }
+
+  std::map<std::string, float> baseline;
+  if (basePath && !read_table(basePath, baseline)) {
+    fprintf(stderr, "cannot read baseline %s\n", basePath);
+    return 2;
+  }
+
+  sim_set_trace(false);
+  target.begin();
+  std::vector<BenchResult> results;
+  for (const BenchCase& c : target.cases) {
+    if (filter && !strstr(c.name, filter)) continue;
+    results.push_back(bench_run(c, budget));
+  }
+  target.end();
+
+  FilePrint out(stdout);
+  printf("%s (host ticks)\n", target.name);
+  bench_print_header(out);
+  for (const BenchResult& r : results) bench_print(out, r);
+
+  if (outPath) {
+    FILE* f = fopen(outPath, "w");
+    if (!f) {
+      fprintf(stderr, "cannot write %s\n", outPath);
+      return 2;
+    }
+    FilePrint file(f);
+    bench_print_header(file);
+    for (const BenchResult& r : results) bench_print(file, r);
+    fclose(f);
+  }
+
+  int regressions = 0;
+  if (basePath) {
+    printf("\nvs %s (threshold %.1f%%)\n", basePath, threshold);
+    for (const BenchResult& r : results) {
+      auto it = baseline.find(r.name);
+      if (it == baseline.end() || it->second <= 0) {
+        printf("%-36s %12s\n", r.name, "new");
+        continue;
+      }
+      float change = (r.cyclesPerOp - it->second) * 100 / it->second;
+      bool worse = change > threshold;
+      if (worse) regressions++;
+      printf("%-36s %+11.1f%%%s\n", r.name, change, worse ? "  REGRESSED" : "");
+    }
+  }
+  return regressions ? 1 : 0;
+}
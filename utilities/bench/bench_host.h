@@ -0,0 +1,32 @@
+// bench_host.h - Host driver for the note-path microbenchmarks
+//
+// The firmware's bench_notepath cases run here on the simulator fakes
+// (../sim) with tracing off, next to host-only cases that need input the
+// target cannot inject (UDP packets, UART bytes).
+// Numbers are host time-stamp counter ticks and include the fakes; use
+// them to compare builds on one machine, not against the target's
+// POST /bench table.
+//
+// Options:
+//   -o <file>              Save the results table
+//   --baseline <file>      Compare with a saved table; exit 1 if any case's
+//                          cycles/op grew by more than the threshold
+//   --threshold <pct>      Allowed growth for --baseline (default 10)
+//   --budget <ticks>       Minimum ticks per timed run (default 30000000)
+//   --filter <text>        Only cases whose name contains text
+#ifndef BENCH_HOST_H
+#define BENCH_HOST_H
+
+#include <vector>
+#include "bench.h"
+
+struct BenchHostTarget {
+  const char* name;
+  std::vector<BenchCase> cases;
+  void (*begin)();   // Before the first case
+  void (*end)();     // After the last case
+};
+
+int bench_host_main(int argc, char** argv, const BenchHostTarget& target);
+
+#endif // BENCH_HOST_H
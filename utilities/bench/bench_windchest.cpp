@@ -0,0 +1,73 @@
+// bench_windchest.cpp - Windchest note-path microbenchmarks on the host (see bench_host.h)
+//
+// Build (from utilities/bench, see CMakeLists.txt):
+//   cmake -S . -B build && cmake --build build
+//
+//   build/bench_windchest -o base.txt             # before a change
+//   build/bench_windchest --baseline base.txt     # after; exit 1 on a regression
+#include <Arduino.h>
+#include <algorithm>
+#include "sim_fakes.h"
+#include "bench_host.h"
+#include "bench_notepath.h"
+#include "pins.h"
+#include "config.h"
+#include "output.h"
+#include "midinote.h"
+#include "midiudp.h"
+#include "midireceiver.h"
+
+// Four notes on and off in one MUDP-v1 packet
+static const std::vector<uint8_t> MUDP_PACKET = {
+  0x4D, 0x55, 0x01, 0x08,
+  0x90, 0x30, 0x64,  0x90, 0x34, 0x64,  0x90, 0x37, 0x64,  0x90, 0x3C, 0x64,
+  0x80, 0x30, 0x00,  0x80, 0x34, 0x00,  0x80, 0x37, 0x00,  0x80, 0x3C, 0x00,
+};
+
+// The same eight messages as DIN MIDI bytes
+static const uint8_t UART_BYTES[] = {
+  0x90, 0x30, 0x64,  0x90, 0x34, 0x64,  0x90, 0x37, 0x64,  0x90, 0x3C, 0x64,
+  0x80, 0x30, 0x00,  0x80, 0x34, 0x00,  0x80, 0x37, 0x00,  0x80, 0x3C, 0x00,
+};
+
+// Receive, validate and dispatch one packet
+static void bench_mudp_update(uint32_t iters) {
+  for (uint32_t i = 0; i < iters; i++) {
+    sim_udp_inject(MUDP_PACKET);
+    midiUDP.update();
+  }
+}
+
+// Drain and parse one burst from the UART
+static void bench_uart_update(uint32_t iters) {
+  for (uint32_t i = 0; i < iters; i++) {
+    Serial2.simInject(UART_BYTES, sizeof(UART_BYTES));
+    midiReceiver.update();
+  }
+}
+
+static BenchHostTarget target = { "windchest", {}, nullptr, nullptr };
+
+// Same order as windchest_controller/src/main.cpp, without the network services
+static void begin() {
+  config_begin();
+  digitalWrite(PIN_CLR_N, HIGH);
+  output_begin();
+  midinote_begin();
+  midiUDP.begin();
+  midiReceiver.begin();
+  clearAll();
+  flushOutput();
+  bench_notepath_begin();
+  // Pick up the chain length bench_notepath_begin() set into the cases
+  std::copy(BENCH_NOTEPATH_CASES, BENCH_NOTEPATH_CASES + BENCH_NOTEPATH_COUNT, target.cases.begin());
+}
+
+int main(int argc, char** argv) {
+  target.begin = begin;
+  target.end = bench_notepath_end;
+  target.cases.assign(BENCH_NOTEPATH_CASES, BENCH_NOTEPATH_CASES + BENCH_NOTEPATH_COUNT);
+  target.cases.push_back({ "MIDIoverUDP::update/8msg", bench_mudp_update, 8, (uint16_t)MUDP_PACKET.size() });
+  target.cases.push_back({ "MidiReceiver::update/8msg", bench_uart_update, 8, sizeof(UART_BYTES) });
+  return bench_host_main(argc, argv, target);
+}
@@ -0,0 +1,58 @@
+import socket
+import struct
+import sys
+
+# Receives the hardwaretest CAN analyzer stream (see hardwaretest/src/cananalyzer.h).
+# Start it with:  curl -X POST "http://<hardwaretest>/can/stream?port=5555"
+# Usage: python can_capture.py [port] [capture.csv]
+
+LISTEN_PORT = int(sys.argv[1]) if len(sys.argv) > 1 else 5555
+CSV_PATH = sys.argv[2] if len(sys.argv) > 2 else None
+
+HEADER = struct.Struct("<2sBBHH")
+FRAME = struct.Struct("<IHBB8s")
+SUMMARY = struct.Struct("<IIHHI")
+SUMMARY_ID = struct.Struct("<HHII")
+
+TYPE_FRAMES = 1
+TYPE_SUMMARY = 2
+
+sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+sock.bind(("", LISTEN_PORT))
+csv = open(CSV_PATH, "w") if CSV_PATH else None
+if csv:
+    csv.write("t_us,id,dlc,flags,data\n")
+
+print(f"Listening on UDP {LISTEN_PORT}")
+expected_seq = None
+lost_packets = 0
+
+while True:
+    pkt, addr = sock.recvfrom(2048)
+    if len(pkt) < HEADER.size:
+        continue
+    magic, ver, ptype, seq, count = HEADER.unpack_from(pkt)
+    if magic != b"CA" or ver != 1:
+        continue
+
+    if expected_seq is not None and seq != expected_seq:
+        lost_packets += (seq - expected_seq) & 0xFFFF
+        print(f"-- {lost_packets} packet(s) lost so far")
+    expected_seq = (seq + 1) & 0xFFFF
+
+    body = pkt[HEADER.size:]
+    if ptype == TYPE_FRAMES:
+        for i in range(count):
+            t_us, can_id, dlc, flags, data = FRAME.unpack_from(body, i * FRAME.size)
+            hexdata = data[:dlc].hex(" ")
+            if csv:
+                csv.write(f"{t_us},0x{can_id:03X},{dlc},{flags},{hexdata}\n")
+            else:
+                print(f"{t_us / 1e6:12.6f}  0x{can_id:03X}  [{dlc}]  {hexdata}")
+    elif ptype == TYPE_SUMMARY:
+        uptime_ms, frames, util, peak, rx_missed = SUMMARY.unpack_from(body)
+        print(f"== {uptime_ms / 1000:.1f}s  frames={frames}  util={util / 100:.2f}%  "
+              f"peak={peak / 100:.2f}%  rx_missed={rx_missed}")
+        for i in range(count):
+            can_id, rate, total, gap_min = SUMMARY_ID.unpack_from(body, SUMMARY.size + i * SUMMARY_ID.size)
+            print(f"   0x{can_id:03X}  {rate:5d}/s  total={total}  min_gap={gap_min}us")
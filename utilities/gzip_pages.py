@@ -0,0 +1,84 @@
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+# Gzips the static web pages into PROGMEM arrays (see src/webasset.h in each
+# firmware). Runs before every PlatformIO build through
+#   extra_scripts = pre:../utilities/gzip_pages.py
+# and writes web_assets.h into the build directory.
+#
+# A page is any raw string literal in src/ that starts with <!DOCTYPE html>:
+#   const char API_DOCS_HTML[] = R"rawliteral(<!DOCTYPE html>...)rawliteral";
+# becomes the WebAsset API_DOCS_HTML_GZ.
+#
+# Standalone, to look at the output or the compressed sizes:
+#   python gzip_pages.py <src dir> <web_assets.h>
+
+PAGE = re.compile(
+    r'const\s+char\s+(\w+)\s*\[\]\s*=\s*R"([^(\s]*)\((.*?)\)\2"', re.DOTALL)
+
+
+def find_pages(src_dir):
+    pages = []
+    for name in sorted(os.listdir(src_dir)):
+        if not name.endswith((".h", ".cpp")):
+            continue
+        with open(os.path.join(src_dir, name), encoding="utf-8", newline="") as f:
+            text = f.read()
+        for m in PAGE.finditer(text):
+            body = m.group(3)
+            if body.lstrip().lower().startswith("<!doctype html"):
+                # The compiler sees source newlines as \n whatever the file uses
+                pages.append((m.group(1), name, body.replace("\r\n", "\n").encode("utf-8")))
+    return pages
+
+
+def render(pages):
+    out = ["// web_assets.h - Generated by utilities/gzip_pages.py; do not edit",
+           "// Edit the pages in src/, they are compressed again on the next build.",
+           "#pragma once",
+           "",
+           '#include "webasset.h"',
+           ""]
+    for symbol, source, html in pages:
+        gz = gzip.compress(html, compresslevel=9, mtime=0)
+        etag = hashlib.sha1(gz).hexdigest()[:16]
+        asset = symbol.upper() + "_GZ"
+        out.append(f"// {source}: {len(html)} bytes, {len(gz)} gzipped")
+        out.append(f"static const uint8_t {asset}_DATA[] PROGMEM = {{")
+        for i in range(0, len(gz), 16):
+            out.append("  " + ",".join(f"0x{b:02x}" for b in gz[i:i + 16]) + ",")
+        out.append("};")
+        out.append(f'static const WebAsset {asset} = {{ {asset}_DATA, sizeof({asset}_DATA), '
+                   f'"\\"{etag}\\"", "text/html" }};')
+        out.append("")
+    return "\n".join(out)
+
+
+def generate(src_dir, header):
+    text = render(find_pages(src_dir))
+    # Leave an unchanged header alone so its includers are not rebuilt
+    if os.path.exists(header):
+        with open(header, encoding="utf-8") as f:
+            if f.read() == text:
+                return
+    os.makedirs(os.path.dirname(header) or ".", exist_ok=True)
+    with open(header, "w", encoding="utf-8") as f:
+        f.write(text)
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO's SCons
+except NameError:
+    env = None
+
+if env is not None:
+    out_dir = os.path.join(env.subst("$BUILD_DIR"), "web_assets")
+    generate(env.subst("$PROJECT_SRC_DIR"), os.path.join(out_dir, "web_assets.h"))
+    env.Append(CPPPATH=[out_dir])
+elif __name__ == "__main__":
+    if len(sys.argv) != 3:
+        sys.exit("usage: python gzip_pages.py <src dir> <web_assets.h>")
+    generate(sys.argv[1], sys.argv[2])
@@ -1,10 +1,11 @@
 import socket
+import time
 import mido
 
 DEST_IP = "192.168.1.182"
 DEST_PORT = 21928
 MUDP_MAGIC = b"MU"
-MUDP_VER = 1
+MUDP_VER = 2  # 1 plays on arrival; 2 is timestamped and played after the receiver's playout delay
 
 sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
 
@@ -13,6 +14,7 @@ PORT_NAME = "REAPER_MUDP_OUT 1"
 
 with mido.open_input(PORT_NAME) as inp:
     batch = []
+    seq = 0
     for msg in inp:
         # Only channel messages (note/cc/etc). Skip sysex for now.
         if msg.type == "sysex":
@@ -32,7 +34,15 @@ with mido.open_input(PORT_NAME) as inp:
             pkt[0:2] = b"MU"
             pkt[2] = MUDP_VER
             pkt[3] = len(batch)
+            if MUDP_VER == 2:
+                # Sequence number and sender clock in microseconds; every
+                # message is due at the packet's time, so offsets are 0
+                us = (time.monotonic_ns() // 1000) & 0xFFFFFFFF
+                pkt += seq.to_bytes(2, "big") + us.to_bytes(4, "big")
+                seq = (seq + 1) & 0xFFFF
             for b in batch:
+                if MUDP_VER == 2:
+                    pkt += b"\x00\x00"
                 pkt += b
             sock.sendto(pkt, (DEST_IP, DEST_PORT))
             batch.clear()
@@ -0,0 +1,274 @@
+// midi2bc.cpp - Host-side converter from Standard MIDI Files to the chimes
+// precompiled event format (see chimes/src/midibc.h).
+//
+// Build (from this directory):
+//   g++ -std=c++17 -O2 -I../chimes/src -o midi2bc midi2bc.cpp ../chimes/src/smfstream.cpp ../chimes/src/midibc.cpp
+//
+// Usage:
+//   midi2bc [--verify] file.mid [file2.mid ...]
+//
+// Each input is written next to itself as file.mbc, which can be uploaded
+// to /files/upload in place of the .mid. With --verify, the file is also
+// decoded by a reference reader below that shares no code with the
+// firmware, and both the firmware's SMF parser and the compiled image are
+// compared with it event by event; any mismatch is reported and the exit
+// code is non-zero.
+
+#include "smfstream.h"
+#include "midibc.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+static bool loadFile(const char* path, std::vector<uint8_t>& out) {
+  FILE* f = fopen(path, "rb");
+  if (!f) return false;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+    out.insert(out.end(), buf, buf + n);
+  }
+  fclose(f);
+  return true;
+}
+
+static bool appendToVector(void* ctx, const uint8_t* data, size_t len) {
+  std::vector<uint8_t>* v = (std::vector<uint8_t>*)ctx;
+  v->insert(v->end(), data, data + len);
+  return true;
+}
+
+// ---------- Reference reader ----------
+// Decodes the whole file at once: every track into a list of events with
+// absolute ticks, one stable sort of all of them by tick (ties keep track
+// order, then file order), then one pass that follows the tempo changes.
+// Deliberately a different method from SmfStream's windowed k-way merge so
+// the two check each other. Like SmfStream it plays format 0 and 1 with
+// ticks per quarter, keeps running status across meta and SysEx events and
+// ends a track at its first malformed event.
+
+struct RefEvent {
+  uint32_t tick;
+  uint16_t track;
+  uint32_t order;   // Position in the track
+  bool tempo;
+  uint32_t usPerQuarter;
+  uint8_t status, data1, data2;
+};
+
+static bool refVarLen(const std::vector<uint8_t>& d, size_t& pos, size_t end, uint32_t& v) {
+  v = 0;
+  for (int i = 0; i < 4; i++) {
+    if (pos >= end) return false;
+    uint8_t b = d[pos++];
+    v = (v << 7) | (b & 0x7F);
+    if (!(b & 0x80)) return true;
+  }
+  return false;
+}
+
+static void refTrack(const std::vector<uint8_t>& d, size_t pos, size_t end, uint16_t track,
+                     std::vector<RefEvent>& out) {
+  uint32_t tick = 0;
+  uint32_t order = 0;
+  uint8_t running = 0;
+  for (;;) {
+    uint32_t delta;
+    if (!refVarLen(d, pos, end, delta) || pos >= end) return;
+    tick += delta;
+    uint8_t status = d[pos];
+    if (status & 0x80) {
+      pos++;
+    } else if (running) {
+      status = running;
+    } else {
+      return;
+    }
+
+    if (status == 0xFF) {
+      uint32_t len;
+      if (pos >= end) return;
+      uint8_t type = d[pos++];
+      if (!refVarLen(d, pos, end, len) || type == 0x2F) return;
+      if (type == 0x51 && len == 3) {
+        if (end - pos < 3) return;
+        RefEvent e = { tick, track, order++, true,
+                       ((uint32_t)d[pos] << 16) | ((uint32_t)d[pos + 1] << 8) | d[pos + 2], 0, 0, 0 };
+        out.push_back(e);
+      }
+      pos += len;
+    } else if (status == 0xF0 || status == 0xF7) {
+      uint32_t len;
+      if (!refVarLen(d, pos, end, len)) return;
+      pos += len;
+    } else if (status >= 0xF0) {
+      return;   // System common or real-time messages have no place in a file
+    } else {
+      running = status;
+      size_t dataBytes = (status & 0xE0) == 0xC0 ? 1 : 2;   // Program change, channel pressure
+      if (end - pos < dataBytes) return;
+      RefEvent e = { tick, track, order++, false, 0, status, d[pos],
+                     (uint8_t)(dataBytes == 2 ? d[pos + 1] : 0) };
+      out.push_back(e);
+      pos += dataBytes;
+    }
+    if (pos > end) return;
+  }
+}
+
+static bool refDecode(const std::vector<uint8_t>& d, std::vector<SmfEvent>& out) {
+  auto be = [&](size_t p, int n) {
+    uint32_t v = 0;
+    for (int i = 0; i < n; i++) v = (v << 8) | d[p + i];
+    return v;
+  };
+  if (d.size() < 14 || memcmp(d.data(), "MThd", 4) != 0) return false;
+  uint32_t format = be(8, 2);
+  uint32_t tracks = be(10, 2);
+  uint32_t division = be(12, 2);
+  if (format > 1 || (division & 0x8000) || division == 0 || tracks == 0) return false;
+  if (tracks > SmfStream::MAX_TRACKS) tracks = SmfStream::MAX_TRACKS;
+
+  std::vector<RefEvent> events;
+  size_t pos = 8 + be(4, 4);
+  uint16_t found = 0;
+  while (found < tracks && pos + 8 <= d.size()) {
+    size_t body = pos + 8;
+    size_t end = std::min<size_t>(body + be(pos + 4, 4), d.size());
+    if (memcmp(&d[pos], "MTrk", 4) == 0) refTrack(d, body, end, found++, events);
+    pos = end;
+  }
+  if (found == 0) return false;
+
+  std::stable_sort(events.begin(), events.end(), [](const RefEvent& a, const RefEvent& b) {
+    if (a.tick != b.tick) return a.tick < b.tick;
+    if (a.track != b.track) return a.track < b.track;
+    return a.order < b.order;
+  });
+
+  // Microseconds at the last tempo change, plus the ticks since at its tempo
+  uint64_t baseUs = 0;
+  uint32_t baseTick = 0;
+  uint32_t usPerQuarter = 500000;
+  for (const RefEvent& e : events) {
+    uint64_t us = baseUs + (uint64_t)(e.tick - baseTick) * usPerQuarter / division;
+    if (e.tempo) {
+      baseUs = us;
+      baseTick = e.tick;
+      if (e.usPerQuarter) usPerQuarter = e.usPerQuarter;
+      continue;
+    }
+    SmfEvent s = { (uint32_t)us, e.status, e.data1, e.data2 };
+    out.push_back(s);
+  }
+  return true;
+}
+
+// Compare a decoder's events with the reference's
+static bool compare(const char* what, MidiEventSource& src, const std::vector<SmfEvent>& ref) {
+  uint32_t index = 0;
+  for (;;) {
+    SmfEvent b;
+    bool has_a = index < ref.size();
+    bool has_b = src.next(b);
+    if (!has_a && !has_b) break;
+    if (has_a != has_b) {
+      printf("  verify: %s has %s events than the reference (%u)\n",
+             what, has_b ? "more" : "fewer", (unsigned)ref.size());
+      return false;
+    }
+    const SmfEvent& a = ref[index];
+    if (a.time_us != b.time_us || a.status != b.status ||
+        a.data1 != b.data1 || a.data2 != b.data2) {
+      printf("  verify: %s event %u differs: %u us %02X %02X %02X, reference %u us %02X %02X %02X\n",
+             what, index, b.time_us, b.status, b.data1, b.data2,
+             a.time_us, a.status, a.data1, a.data2);
+      return false;
+    }
+    index++;
+  }
+  return true;
+}
+
+// Check the firmware's parser and the compiled image against the reference
+static bool verify(const std::vector<uint8_t>& smf, const std::vector<uint8_t>& image) {
+  std::vector<SmfEvent> ref;
+  SmfStream stream;
+  MidiBcReader reader;
+  if (!refDecode(smf, ref)) {
+    printf("  verify: reference reader cannot read the file\n");
+    return false;
+  }
+  if (!stream.open(new SmfMemorySource(smf.data(), smf.size())) ||
+      !reader.open(new SmfMemorySource(image.data(), image.size()))) {
+    printf("  verify: cannot open\n");
+    return false;
+  }
+  if (!compare("parser", stream, ref) || !compare("image", reader, ref)) return false;
+  printf("  verify: %u events match\n", (unsigned)ref.size());
+  return true;
+}
+
+static bool convert(const char* path, bool check) {
+  std::vector<uint8_t> smf;
+  if (!loadFile(path, smf)) {
+    printf("%s: cannot read\n", path);
+    return false;
+  }
+
+  SmfStream stream;
+  if (!stream.open(new SmfMemorySource(smf.data(), smf.size()))) {
+    printf("%s: not a supported MIDI file\n", path);
+    return false;
+  }
+
+  std::vector<uint8_t> image;
+  int32_t count = midibc_compile(stream, stream.getTicksPerQuarter(),
+                                 stream.getTrackCount(), appendToVector, &image);
+  if (count < 0) {
+    printf("%s: compile failed\n", path);
+    return false;
+  }
+
+  std::string out = path;
+  size_t dot = out.find_last_of('.');
+  size_t slash = out.find_last_of("/\\");
+  if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) out.erase(dot);
+  out += ".mbc";
+
+  FILE* f = fopen(out.c_str(), "wb");
+  if (!f || fwrite(image.data(), 1, image.size(), f) != image.size()) {
+    printf("%s: cannot write %s\n", path, out.c_str());
+    if (f) fclose(f);
+    return false;
+  }
+  fclose(f);
+
+  printf("%s: format %u, %u tracks, %d events, %zu -> %zu bytes\n", path,
+         stream.getFormat(), stream.getTrackCount(), (int)count, smf.size(), image.size());
+
+  return !check || verify(smf, image);
+}
+
+int main(int argc, char** argv) {
+  bool check = false;
+  int files = 0;
+  int failures = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--verify") == 0) {
+      check = true;
+      continue;
+    }
+    files++;
+    if (!convert(argv[i], check)) failures++;
+  }
+
+  if (files == 0) {
+    printf("Usage: %s [--verify] file.mid [file2.mid ...]\n", argv[0]);
+    return 2;
+  }
+  return failures ? 1 : 0;
+}
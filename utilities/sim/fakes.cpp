@@ -0,0 +1,911 @@
+// fakes.cpp - Arduino / ESP-IDF calls on the virtual-time kernel (see sim.h)
+//
+// Peripherals are modelled just far enough to give the firmware realistic
+// timing: transfers take their wire time and complete as kernel events, and
+// everything the outside world would see (PWM duty, GPIO outputs, shift
+// register latches, CAN frames, UDP packets) goes into the trace.
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <Preferences.h>
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "driver/gpio.h"
+#include "driver/i2c_master.h"
+#include "driver/mcpwm.h"
+#include "driver/sigmadelta.h"
+#include "driver/spi_master.h"
+#include "driver/twai.h"
+#include "sim.h"
+#include "sim_fakes.h"
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+
+HardwareSerial Serial;
+HardwareSerial Serial2;
+EspClass ESP;
+WiFiClass WiFi;
+
+static uint64_t ticks_to_us(TickType_t ticks) {
+  return ticks == portMAX_DELAY ? SIM_FOREVER : (uint64_t)ticks * 1000;
+}
+
+static uint64_t ms_to_us(int timeout_ms) {
+  return timeout_ms < 0 ? SIM_FOREVER : (uint64_t)timeout_ms * 1000;
+}
+
+static std::string hex(const uint8_t* data, size_t len) {
+  std::string s;
+  char b[4];
+  for (size_t i = 0; i < len; i++) {
+    snprintf(b, sizeof(b), i ? " %02x" : "%02x", data[i]);
+    s += b;
+  }
+  return s;
+}
+
+// Transfers on one bus complete in order, each at its end time. A task
+// waits for them by blocking; the kernel context (setup(), loop()) cannot
+// block, so it runs the transfers in place and moves the clock past them.
+struct SimBus {
+  struct Op {
+    uint64_t end;
+    uint32_t event;
+    SimFn done;
+  };
+  std::deque<Op> ops;
+  uint64_t freeAt = 0;
+
+  void add(uint64_t durationUs, SimFn done) {
+    uint64_t start = std::max(sim_now(), freeAt);
+    freeAt = start + durationUs;
+    Op op = { freeAt, 0, std::move(done) };
+    op.event = sim_at(freeAt, [this]() { complete(); });
+    ops.push_back(std::move(op));
+  }
+
+  void complete() {
+    Op op = std::move(ops.front());
+    ops.pop_front();
+    op.done();
+  }
+
+  bool wait(std::function<bool()> ready, uint64_t timeoutUs) {
+    if (sim_current_task()) return sim_block(ready, timeoutUs);
+    while (!ready() && !ops.empty()) {
+      Op& op = ops.front();
+      sim_cancel(op.event);
+      if (op.end > sim_now()) sim_busy_wait(op.end - sim_now());
+      complete();
+    }
+    return ready();
+  }
+};
+
+// ---------- Arduino core ----------
+
+uint32_t millis() { return (uint32_t)(sim_now() / 1000); }
+uint32_t micros() { return (uint32_t)sim_now(); }
+void delay(uint32_t ms) { sim_block(nullptr, (uint64_t)ms * 1000); }
+void delayMicroseconds(uint32_t us) { sim_block(nullptr, us); }
+
+size_t Print::printf(const char* fmt, ...) {
+  char buf[512];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  if (n < 0) return 0;
+  return write((const uint8_t*)buf, std::min((size_t)n, sizeof(buf) - 1));
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  sim_log_write(&c, 1);
+  return 1;
+}
+
+// Bytes that do not fit are lost, like a UART RX overflow
+size_t HardwareSerial::simInject(const uint8_t* data, size_t len) {
+  size_t n = 0;
+  while (n < len && ((rxHead + 1) & (RX_SIZE - 1)) != rxTail) {
+    rx[rxHead] = data[n++];
+    rxHead = (rxHead + 1) & (RX_SIZE - 1);
+  }
+  return n;
+}
+
+// ---------- GPIO ----------
+// Plain arrays: output_early_disable() in the windchest drives a pin from a
+// static constructor, before any other static here is initialised
+
+#define SIM_PINS 64
+static bool inLow[SIM_PINS];            // Inputs idle high (pull-ups)
+static int8_t outLevel[SIM_PINS];       // 0 = never driven, else level + 1
+static void (*pinIsr[SIM_PINS])(void);
+static int pinIsrMode[SIM_PINS];
+
+static bool valid_pin(int pin) {
+  return pin >= 0 && pin < SIM_PINS;
+}
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (!valid_pin(pin)) return;
+  int8_t level = val ? 2 : 1;
+  if (outLevel[pin] == level) return;
+  outLevel[pin] = level;
+  sim_trace("gpio %d %d", pin, val ? 1 : 0);
+}
+
+int digitalRead(uint8_t pin) {
+  return valid_pin(pin) && inLow[pin] ? LOW : HIGH;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode) {
+  if (!valid_pin(pin)) return;
+  pinIsr[pin] = isr;
+  pinIsrMode[pin] = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+  if (valid_pin(pin)) pinIsr[pin] = nullptr;
+}
+
+void sim_gpio_set_input(int pin, int level) {
+  if (!valid_pin(pin)) sim_fail("gpio %d out of range", pin);
+  bool low = level == 0;
+  if (inLow[pin] == low) return;
+  inLow[pin] = low;
+  int edge = low ? FALLING : RISING;
+  if (pinIsr[pin] && (pinIsrMode[pin] & edge)) pinIsr[pin]();
+}
+
+esp_err_t gpio_set_direction(gpio_num_t, gpio_mode_t) { return ESP_OK; }
+
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level) {
+  digitalWrite((uint8_t)pin, (uint8_t)level);
+  return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t pin) {
+  return digitalRead((uint8_t)pin);
+}
+
+// ---------- PWM ----------
+// Only duty changes are traced
+
+static std::map<std::string, float>& pwm_duty() {
+  static std::map<std::string, float> duty;
+  return duty;
+}
+
+static void trace_pwm(const std::string& name, float duty) {
+  auto it = pwm_duty().find(name);
+  if (it != pwm_duty().end() && it->second == duty) return;
+  pwm_duty()[name] = duty;
+  sim_trace("pwm %s %g", name.c_str(), duty);
+}
+
+bool ledcAttach(uint8_t, uint32_t, uint8_t) { return true; }
+
+bool ledcWrite(uint8_t pin, uint32_t duty) {
+  trace_pwm("ledc" + std::to_string(pin), (float)duty);
+  return true;
+}
+
+esp_err_t mcpwm_gpio_init(mcpwm_unit_t, mcpwm_io_signals_t, int) { return ESP_OK; }
+esp_err_t mcpwm_init(mcpwm_unit_t, mcpwm_timer_t, const mcpwm_config_t*) { return ESP_OK; }
+
+esp_err_t mcpwm_set_duty(mcpwm_unit_t unit, mcpwm_timer_t timer, mcpwm_generator_t gen, float duty) {
+  char name[16];
+  snprintf(name, sizeof(name), "mcpwm%d.%d%c", (int)unit, (int)timer, gen == MCPWM_GEN_A ? 'A' : 'B');
+  trace_pwm(name, duty);
+  return ESP_OK;
+}
+
+esp_err_t sigmadelta_set_duty(sigmadelta_channel_t channel, int8_t duty) {
+  trace_pwm("sd" + std::to_string(channel), duty);
+  return ESP_OK;
+}
+
+// ---------- esp_timer ----------
+// Callbacks run on the kernel context, in place of the esp_timer task
+
+struct esp_timer {
+  esp_timer_create_args_t args;
+  uint32_t event;
+  uint64_t period;
+  bool active;
+};
+
+static void timer_fire(esp_timer_handle_t t) {
+  if (t->period) t->event = sim_at(sim_now() + t->period, [t]() { timer_fire(t); });
+  else t->active = false;
+  t->args.callback(t->args.arg);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out) {
+  esp_timer_handle_t t = new esp_timer();
+  t->args = *args;
+  *out = t;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t timeout_us) {
+  if (t->active) return ESP_ERR_INVALID_STATE;
+  t->active = true;
+  t->period = 0;
+  t->event = sim_at(sim_now() + timeout_us, [t]() { timer_fire(t); });
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t t, uint64_t period_us) {
+  if (t->active) return ESP_ERR_INVALID_STATE;
+  t->active = true;
+  t->period = period_us;
+  t->event = sim_at(sim_now() + period_us, [t]() { timer_fire(t); });
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t t) {
+  if (!t->active) return ESP_ERR_INVALID_STATE;
+  sim_cancel(t->event);
+  t->active = false;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t t) {
+  if (t->active) return ESP_ERR_INVALID_STATE;
+  delete t;
+  return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t t) {
+  return t->active;
+}
+
+int64_t esp_timer_get_time(void) {
+  return (int64_t)sim_now();
+}
+
+// ---------- FreeRTOS ----------
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t,
+                                   void* arg, UBaseType_t prio, TaskHandle_t* out, BaseType_t) {
+  TaskHandle_t t = sim_task_create(fn, arg, name, (int)prio);
+  if (out) *out = t;
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack,
+                       void* arg, UBaseType_t prio, TaskHandle_t* out) {
+  return xTaskCreatePinnedToCore(fn, name, stack, arg, prio, out, 0);
+}
+
+void vTaskDelay(TickType_t ticks) {
+  sim_block(nullptr, ticks_to_us(ticks));
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  if (task && task != sim_current_task()) sim_fail("vTaskDelete of another task is not supported");
+  sim_block([]() { return false; }, SIM_FOREVER);
+}
+
+TickType_t xTaskGetTickCount(void) {
+  return (TickType_t)(sim_now() / 1000);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+  return sim_current_task();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+  SimTask* t = sim_current_task();
+  if (!t) sim_fail("ulTaskNotifyTake outside a task");
+  sim_block([t]() { return t->notify > 0; }, ticks_to_us(ticks));
+  uint32_t value = t->notify;
+  if (value) t->notify = clear ? 0 : value - 1;
+  return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  task->notify++;
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken) {
+  task->notify++;
+  if (woken) *woken = pdTRUE;
+}
+
+struct SimSemaphore {
+  UBaseType_t count;
+  UBaseType_t max;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+  return new SimSemaphore{ 1, 1 };
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+  return new SimSemaphore{ 0, 1 };
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+  if (!sim_block([sem]() { return sem->count > 0; }, ticks_to_us(ticks))) return pdFALSE;
+  sem->count--;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+  if (sem->count >= sem->max) return pdFALSE;
+  sem->count++;
+  return pdTRUE;
+}
+
+struct SimQueue {
+  UBaseType_t length;
+  UBaseType_t itemSize;
+  std::deque<std::vector<uint8_t>> items;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  return new SimQueue{ length, itemSize, {} };
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t ticks) {
+  if (!sim_block([q]() { return q->items.size() < q->length; }, ticks_to_us(ticks))) return pdFALSE;
+  const uint8_t* p = (const uint8_t*)item;
+  q->items.emplace_back(p, p + q->itemSize);
+  return pdTRUE;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void* item, BaseType_t* woken) {
+  if (woken) *woken = pdFALSE;
+  return xQueueSend(q, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void* out, TickType_t ticks) {
+  if (!sim_block([q]() { return !q->items.empty(); }, ticks_to_us(ticks))) return pdFALSE;
+  memcpy(out, q->items.front().data(), q->itemSize);
+  q->items.pop_front();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+  return (UBaseType_t)q->items.size();
+}
+
+// ---------- I2C ----------
+// Each byte is 9 SCL clocks; a transaction reaches the device model when it
+// completes, so a read returns the input state at that moment
+
+struct SimI2cBus {
+  SimBus bus;
+};
+
+struct SimI2cDev {
+  SimI2cBus* bus;
+  uint16_t addr;
+  uint32_t sclHz;
+};
+
+static std::map<uint16_t, SimI2cDevice*>& i2c_devices() {
+  static std::map<uint16_t, SimI2cDevice*> devices;
+  return devices;
+}
+
+void sim_i2c_attach(uint16_t addr, SimI2cDevice* dev) {
+  i2c_devices()[addr] = dev;
+}
+
+static uint64_t i2c_us(uint32_t bits, uint32_t hz) {
+  return ((uint64_t)bits * 1000000 + hz - 1) / hz;
+}
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t*, i2c_master_bus_handle_t* out) {
+  *out = new SimI2cBus();
+  return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus, const i2c_device_config_t* cfg,
+                                    i2c_master_dev_handle_t* out) {
+  *out = new SimI2cDev{ bus, cfg->device_address, cfg->scl_speed_hz ? cfg->scl_speed_hz : 100000 };
+  return ESP_OK;
+}
+
+esp_err_t i2c_master_probe(i2c_master_bus_handle_t bus, uint16_t addr, int timeout_ms) {
+  if (i2c_master_bus_wait_all_done(bus, timeout_ms) != ESP_OK) return ESP_ERR_TIMEOUT;
+  bool done = false;
+  bus->bus.add(i2c_us(9 + 2, 100000), [&done]() { done = true; });
+  bus->bus.wait([&done]() { return done; }, SIM_FOREVER);
+  return i2c_devices().count(addr) ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t dev, const uint8_t* buf, size_t len, int) {
+  std::vector<uint8_t> data(buf, buf + len);   // Copied like the driver's command list
+  uint16_t addr = dev->addr;
+  dev->bus->bus.add(i2c_us(9 * (1 + len) + 2, dev->sclHz), [addr, data]() {
+    auto it = i2c_devices().find(addr);
+    if (it != i2c_devices().end()) it->second->write(data.data(), data.size());
+  });
+  return ESP_OK;
+}
+
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t dev, uint8_t* buf, size_t len, int) {
+  uint16_t addr = dev->addr;
+  dev->bus->bus.add(i2c_us(9 * (1 + len) + 2, dev->sclHz), [addr, buf, len]() {
+    auto it = i2c_devices().find(addr);
+    if (it != i2c_devices().end()) it->second->read(buf, len);
+    else memset(buf, 0xFF, len);
+  });
+  return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t dev, const uint8_t* wbuf, size_t wlen,
+                                      uint8_t* rbuf, size_t rlen, int) {
+  std::vector<uint8_t> data(wbuf, wbuf + wlen);
+  uint16_t addr = dev->addr;
+  dev->bus->bus.add(i2c_us(9 * (2 + wlen + rlen) + 3, dev->sclHz), [addr, data, rbuf, rlen]() {
+    auto it = i2c_devices().find(addr);
+    if (it == i2c_devices().end()) {
+      memset(rbuf, 0xFF, rlen);
+      return;
+    }
+    it->second->write(data.data(), data.size());
+    it->second->read(rbuf, rlen);
+  });
+  return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_wait_all_done(i2c_master_bus_handle_t bus, int timeout_ms) {
+  SimBus* b = &bus->bus;
+  return b->wait([b]() { return b->ops.empty(); }, ms_to_us(timeout_ms)) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+// ---------- MCP23017 ----------
+
+#define MCP_GPINTENA 0x04
+#define MCP_INTFA    0x0E
+#define MCP_INTCAPA  0x10
+#define MCP_GPIOA    0x12
+#define MCP_REGS     0x16
+
+static std::vector<SimMcp23017*>& mcp_chips() {
+  static std::vector<SimMcp23017*> chips;
+  return chips;
+}
+
+SimMcp23017::SimMcp23017(int intPin) : intPin(intPin) {
+  regs[0x00] = regs[0x01] = 0xFF;   // IODIR: all inputs after reset
+  mcp_chips().push_back(this);
+}
+
+// Interrupt-on-change against the previous value (INTCON = 0): the first
+// change on a port sets its INTF bit and captures the port; further changes
+// are not flagged until INTCAP or GPIO of that port is read
+void SimMcp23017::setPin(int pin, int level) {
+  uint16_t bit = (uint16_t)(1u << pin);
+  uint16_t next = level ? (inputs | bit) : (inputs & ~bit);
+  if (next == inputs) return;
+  inputs = next;
+
+  int port = pin / 8;
+  uint8_t portBit = (uint8_t)(1u << (pin % 8));
+  if ((regs[MCP_GPINTENA + port] & portBit) && !regs[MCP_INTFA + port]) {
+    regs[MCP_INTFA + port] = portBit;
+    regs[MCP_INTCAPA + port] = (uint8_t)(inputs >> (8 * port));
+  }
+  updateInt();
+}
+
+uint8_t SimMcp23017::readReg(uint8_t reg) {
+  if (reg == MCP_GPIOA || reg == MCP_GPIOA + 1 || reg == MCP_INTCAPA || reg == MCP_INTCAPA + 1) {
+    int port = reg & 1;
+    uint8_t value = reg >= MCP_GPIOA ? (uint8_t)(inputs >> (8 * port)) : regs[reg];
+    regs[MCP_INTFA + port] = 0;
+    updateInt();
+    return value;
+  }
+  return regs[reg];
+}
+
+void SimMcp23017::write(const uint8_t* data, size_t len) {
+  if (!len) return;
+  pointer = data[0] % MCP_REGS;
+  for (size_t i = 1; i < len; i++) {
+    if (pointer < MCP_INTFA || pointer > MCP_GPIOA + 1) regs[pointer] = data[i];
+    pointer = (pointer + 1) % MCP_REGS;
+  }
+}
+
+void SimMcp23017::read(uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    data[i] = readReg(pointer);
+    pointer = (pointer + 1) % MCP_REGS;
+  }
+}
+
+// Open-drain INT outputs wired together: low while any chip has a flag
+void SimMcp23017::updateInt() {
+  bool low = false;
+  for (SimMcp23017* chip : mcp_chips()) {
+    if (chip->intPin == intPin && (chip->regs[MCP_INTFA] || chip->regs[MCP_INTFA + 1])) low = true;
+  }
+  sim_gpio_set_input(intPin, low ? 0 : 1);
+}
+
+// ---------- SPI ----------
+// A transaction shifts for length / clock; the latch is traced when CS
+// rises at its end
+
+struct SimSpiDev {
+  int clockHz;
+  int queueSize;
+  int inFlight;
+  std::deque<spi_transaction_t*> done;
+};
+
+static SimBus spiBus;
+
+esp_err_t spi_bus_initialize(spi_host_device_t, const spi_bus_config_t*, int) { return ESP_OK; }
+
+esp_err_t spi_bus_add_device(spi_host_device_t, const spi_device_interface_config_t* cfg,
+                             spi_device_handle_t* out) {
+  *out = new SimSpiDev{ cfg->clock_speed_hz, cfg->queue_size, 0, {} };
+  return ESP_OK;
+}
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t dev, spi_transaction_t* t, TickType_t ticks) {
+  if (!spiBus.wait([dev]() { return dev->inFlight + (int)dev->done.size() < dev->queueSize; },
+                   ticks_to_us(ticks))) {
+    return ESP_ERR_TIMEOUT;
+  }
+  std::vector<uint8_t> data((const uint8_t*)t->tx_buffer, (const uint8_t*)t->tx_buffer + (t->length + 7) / 8);
+  uint64_t us = ((uint64_t)t->length * 1000000 + dev->clockHz - 1) / dev->clockHz;
+  dev->inFlight++;
+  spiBus.add(us, [dev, t, data]() {
+    sim_trace("latch %s", hex(data.data(), data.size()).c_str());
+    dev->inFlight--;
+    dev->done.push_back(t);
+  });
+  return ESP_OK;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t dev, spi_transaction_t** t, TickType_t ticks) {
+  if (!spiBus.wait([dev]() { return !dev->done.empty(); }, ticks_to_us(ticks))) return ESP_ERR_TIMEOUT;
+  *t = dev->done.front();
+  dev->done.pop_front();
+  return ESP_OK;
+}
+
+esp_err_t spi_device_transmit(spi_device_handle_t dev, spi_transaction_t* t) {
+  esp_err_t err = spi_device_queue_trans(dev, t, portMAX_DELAY);
+  if (err != ESP_OK) return err;
+  spi_transaction_t* done;
+  return spi_device_get_trans_result(dev, &done, portMAX_DELAY);
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t dev, spi_transaction_t* t) {
+  return spi_device_transmit(dev, t);
+}
+
+// ---------- TWAI ----------
+// One bus shared by our transmitter and injected frames; frames go out in
+// the order they were queued (no arbitration against injected traffic)
+
+static struct {
+  bool installed;
+  bool running;
+  twai_general_config_t general;
+  twai_filter_config_t filter;
+  std::deque<twai_message_t> txQueue;
+  bool txBusy;
+  std::deque<twai_message_t> rxQueue;
+  uint32_t alerts;
+  uint64_t busFreeAt;
+  uint32_t rxMissed;
+} can;
+
+uint32_t sim_twai_frame_us(const twai_message_t& msg) {
+  uint32_t bits = (msg.extd ? 67 : 47) + (msg.rtr ? 0 : 8 * msg.data_length_code);
+  return bits * 2;
+}
+
+static void can_alert(uint32_t alert) {
+  can.alerts |= alert & can.general.alerts_enabled;
+}
+
+static void can_start_tx() {
+  if (can.txBusy || can.txQueue.empty()) return;
+  twai_message_t msg = can.txQueue.front();
+  can.txQueue.pop_front();
+  can.txBusy = true;
+  uint64_t start = std::max(sim_now(), can.busFreeAt);
+  can.busFreeAt = start + sim_twai_frame_us(msg);
+  sim_at(can.busFreeAt, [msg]() {
+    sim_trace("can %03x %d %s", (unsigned)msg.identifier, msg.data_length_code,
+              hex(msg.data, msg.data_length_code).c_str());
+    can.txBusy = false;
+    can_alert(TWAI_ALERT_TX_SUCCESS);
+    if (can.txQueue.empty()) can_alert(TWAI_ALERT_TX_IDLE);
+    can_start_tx();
+  });
+}
+
+// Standard frames only. Single filter: ID, RTR and the first two data
+// bytes. Dual filter: filter 1 takes ID, RTR and data byte 0, filter 2
+// ID and RTR.
+static bool can_accept(const twai_message_t& msg) {
+  uint32_t code = can.filter.acceptance_code;
+  uint32_t care = ~can.filter.acceptance_mask;
+  uint32_t id = msg.identifier & 0x7FF;
+  uint32_t rtr = msg.rtr ? 1 : 0;
+  uint8_t d0 = msg.data_length_code > 0 ? msg.data[0] : 0;
+  uint8_t d1 = msg.data_length_code > 1 ? msg.data[1] : 0;
+  if (can.filter.single_filter) {
+    uint32_t v = (id << 21) | (rtr << 20) | ((uint32_t)d0 << 8) | d1;
+    return ((v ^ code) & care & 0xFFF0FFFF) == 0;
+  }
+  uint32_t v1 = (id << 21) | (rtr << 20) | ((uint32_t)(d0 >> 4) << 16) | (d0 & 0x0F);
+  uint32_t v2 = (id << 5) | (rtr << 4);
+  return ((v1 ^ code) & care & 0xFFFF000F) == 0 || ((v2 ^ code) & care & 0x0000FFF0) == 0;
+}
+
+twai_message_t sim_arg_can(const SimCmd& c, size_t first) {
+  if (first >= c.args.size()) sim_fail("line %d: %s needs a CAN ID", c.line, c.args[0].c_str());
+  char* end = nullptr;
+  twai_message_t msg = {};
+  msg.identifier = (uint32_t)strtoul(c.args[first].c_str(), &end, 16);
+  if (*end || msg.identifier > 0x7FF) sim_fail("line %d: bad CAN ID '%s'", c.line, c.args[first].c_str());
+  std::vector<uint8_t> data = sim_arg_bytes(c, first + 1);
+  if (data.size() > 8) sim_fail("line %d: more than 8 data bytes", c.line);
+  msg.data_length_code = (uint8_t)data.size();
+  memcpy(msg.data, data.data(), data.size());
+  return msg;
+}
+
+void sim_twai_inject(const twai_message_t& msg) {
+  uint64_t start = std::max(sim_now(), can.busFreeAt);
+  can.busFreeAt = start + sim_twai_frame_us(msg);
+  sim_at(can.busFreeAt, [msg]() {
+    if (!can.running || !can_accept(msg)) return;
+    if (can.rxQueue.size() >= can.general.rx_queue_len) {
+      can.rxMissed++;
+      can_alert(TWAI_ALERT_RX_QUEUE_FULL);
+      return;
+    }
+    can.rxQueue.push_back(msg);
+    can_alert(TWAI_ALERT_RX_DATA);
+  });
+}
+
+esp_err_t twai_driver_install(const twai_general_config_t* g, const twai_timing_config_t*,
+                              const twai_filter_config_t* f) {
+  if (can.installed) return ESP_ERR_INVALID_STATE;
+  can.installed = true;
+  can.general = *g;
+  can.filter = *f;
+  return ESP_OK;
+}
+
+esp_err_t twai_driver_uninstall(void) {
+  can.installed = can.running = false;
+  can.txQueue.clear();
+  can.rxQueue.clear();
+  return ESP_OK;
+}
+
+esp_err_t twai_start(void) {
+  if (!can.installed || can.running) return ESP_ERR_INVALID_STATE;
+  can.running = true;
+  return ESP_OK;
+}
+
+esp_err_t twai_stop(void) {
+  if (!can.running) return ESP_ERR_INVALID_STATE;
+  can.running = false;
+  can.txQueue.clear();
+  return ESP_OK;
+}
+
+esp_err_t twai_transmit(const twai_message_t* msg, TickType_t ticks) {
+  if (!can.running) return ESP_ERR_INVALID_STATE;
+  if (!can.txBusy) {
+    can.txQueue.push_back(*msg);
+    can_start_tx();
+    return ESP_OK;
+  }
+  if (can.general.tx_queue_len == 0) return ESP_FAIL;
+  if (!sim_block([]() { return can.txQueue.size() < can.general.tx_queue_len; }, ticks_to_us(ticks))) {
+    return ESP_ERR_TIMEOUT;
+  }
+  can.txQueue.push_back(*msg);
+  can_start_tx();
+  return ESP_OK;
+}
+
+esp_err_t twai_receive(twai_message_t* msg, TickType_t ticks) {
+  if (!can.installed) return ESP_ERR_INVALID_STATE;
+  if (!sim_block([]() { return !can.rxQueue.empty(); }, ticks_to_us(ticks))) return ESP_ERR_TIMEOUT;
+  *msg = can.rxQueue.front();
+  can.rxQueue.pop_front();
+  return ESP_OK;
+}
+
+esp_err_t twai_read_alerts(uint32_t* alerts, TickType_t ticks) {
+  bool got = sim_block([]() { return can.alerts != 0; }, ticks_to_us(ticks));
+  *alerts = can.alerts;
+  can.alerts = 0;
+  return got ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t twai_reconfigure_alerts(uint32_t alerts, uint32_t* prev) {
+  if (prev) *prev = can.general.alerts_enabled;
+  can.general.alerts_enabled = alerts;
+  can.alerts &= alerts;
+  return ESP_OK;
+}
+
+esp_err_t twai_initiate_recovery(void) { return ESP_ERR_INVALID_STATE; }
+
+esp_err_t twai_get_status_info(twai_status_info_t* info) {
+  if (!can.installed) return ESP_ERR_INVALID_STATE;
+  memset(info, 0, sizeof(*info));
+  info->state = can.running ? TWAI_STATE_RUNNING : TWAI_STATE_STOPPED;
+  info->msgs_to_tx = (uint32_t)can.txQueue.size() + (can.txBusy ? 1 : 0);
+  info->msgs_to_rx = (uint32_t)can.rxQueue.size();
+  info->rx_missed_count = can.rxMissed;
+  return ESP_OK;
+}
+
+esp_err_t twai_clear_transmit_queue(void) {
+  can.txQueue.clear();
+  return ESP_OK;
+}
+
+esp_err_t twai_clear_receive_queue(void) {
+  can.rxQueue.clear();
+  return ESP_OK;
+}
+
+// ---------- WiFiUDP ----------
+// One socket: injected datagrams queue up for whoever calls parsePacket()
+
+static std::deque<std::vector<uint8_t>>& udp_inbox() {
+  static std::deque<std::vector<uint8_t>> inbox;
+  return inbox;
+}
+static std::vector<uint8_t> udpPacket;
+static std::vector<uint8_t> udpOut;
+
+void sim_udp_inject(const std::vector<uint8_t>& data) {
+  udp_inbox().push_back(data);
+}
+
+uint8_t WiFiUDP::begin(uint16_t p) {
+  port = p;
+  return 1;
+}
+
+void WiFiUDP::stop() {
+  port = 0;
+}
+
+int WiFiUDP::parsePacket() {
+  if (!port || udp_inbox().empty()) return 0;
+  udpPacket = std::move(udp_inbox().front());
+  udp_inbox().pop_front();
+  pos = 0;
+  havePacket = true;
+  return (int)udpPacket.size();
+}
+
+int WiFiUDP::available() {
+  return havePacket ? (int)(udpPacket.size() - pos) : 0;
+}
+
+int WiFiUDP::read(uint8_t* buf, size_t len) {
+  size_t n = std::min(len, (size_t)available());
+  memcpy(buf, udpPacket.data() + pos, n);
+  pos += n;
+  return (int)n;
+}
+
+int WiFiUDP::read() {
+  if (!available()) return -1;
+  return udpPacket[pos++];
+}
+
+int WiFiUDP::beginPacket(IPAddress, uint16_t) {
+  udpOut.clear();
+  return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t* buf, size_t len) {
+  udpOut.insert(udpOut.end(), buf, buf + len);
+  return len;
+}
+
+int WiFiUDP::endPacket() {
+  sim_trace("udp %s", hex(udpOut.data(), udpOut.size()).c_str());
+  return 1;
+}
+
+// ---------- Preferences ----------
+
+struct PrefValue {
+  int64_t number;
+  std::vector<uint8_t> blob;
+};
+
+static std::map<std::string, std::map<std::string, PrefValue>>& nvs() {
+  static std::map<std::string, std::map<std::string, PrefValue>> store;
+  return store;
+}
+
+void sim_prefs_set(const std::string& ns, const std::string& key, const std::string& value) {
+  PrefValue v = { 0, {} };
+  if (value.compare(0, 4, "hex:") == 0) {
+    for (size_t i = 4; i + 1 < value.size(); i += 2) {
+      v.blob.push_back((uint8_t)strtoul(value.substr(i, 2).c_str(), nullptr, 16));
+    }
+  } else {
+    char* end = nullptr;
+    v.number = strtoll(value.c_str(), &end, 0);
+    if (*end) sim_fail("bad preference value '%s'", value.c_str());
+  }
+  nvs()[ns][key] = v;
+}
+
+bool Preferences::begin(const char* name, bool ro) {
+  ns = name;
+  readOnly = ro;
+  return true;
+}
+
+bool Preferences::isKey(const char* key) {
+  return nvs()[ns].count(key) != 0;
+}
+
+bool Preferences::remove(const char* key) {
+  if (readOnly) return false;
+  return nvs()[ns].erase(key) != 0;
+}
+
+bool Preferences::clear() {
+  if (readOnly) return false;
+  nvs()[ns].clear();
+  return true;
+}
+
+int64_t Preferences::get(const char* key, int64_t def) {
+  auto& keys = nvs()[ns];
+  auto it = keys.find(key);
+  return it == keys.end() ? def : it->second.number;
+}
+
+size_t Preferences::put(const char* key, int64_t v, size_t size) {
+  if (readOnly) return 0;
+  nvs()[ns][key] = PrefValue{ v, {} };
+  return size;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t len) {
+  auto& keys = nvs()[ns];
+  auto it = keys.find(key);
+  if (it == keys.end()) return 0;
+  size_t n = std::min(len, it->second.blob.size());
+  memcpy(buf, it->second.blob.data(), n);
+  return n;
+}
+
+size_t Preferences::putBytes(const char* key, const void* buf, size_t len) {
+  if (readOnly) return 0;
+  const uint8_t* p = (const uint8_t*)buf;
+  nvs()[ns][key] = PrefValue{ 0, std::vector<uint8_t>(p, p + len) };
+  return len;
+}
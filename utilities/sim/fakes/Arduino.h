@@ -0,0 +1,101 @@
+// Arduino.h - Host stand-in for the Arduino-ESP32 core (see ../sim.h)
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <inttypes.h>
+#include <math.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define DMA_ATTR
+#define PROGMEM
+
+#define LOW          0
+#define HIGH         1
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+#define RISING       0x01
+#define FALLING      0x02
+#define CHANGE       0x03
+
+#define ARDUINO_RUNNING_CORE 1
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+#define digitalPinToInterrupt(p) (p)
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+bool ledcAttach(uint8_t pin, uint32_t freq, uint8_t resolution);
+bool ledcWrite(uint8_t pin, uint32_t duty);
+
+template <typename T> static inline T constrain(T x, T lo, T hi) { return x < lo ? lo : (x > hi ? hi : x); }
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+  }
+  size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+  size_t print(const char* s) { return write(s); }
+  size_t print(int v) { return printf("%d", v); }
+  size_t println(const char* s = "") { return write(s) + write("\r\n"); }
+  size_t println(int v) { return print(v) + println(); }
+  virtual void flush() {}
+};
+
+#define SERIAL_8N1 0x800001c
+
+// TX goes to the firmware log; RX bytes come from simInject()
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long, uint32_t = SERIAL_8N1, int8_t = -1, int8_t = -1, bool = false) {}
+  size_t write(uint8_t c) override;
+  using Print::write;
+  int available() { return (int)((rxHead - rxTail) & (RX_SIZE - 1)); }
+  int read() {
+    if (rxHead == rxTail) return -1;
+    uint8_t c = rx[rxTail];
+    rxTail = (rxTail + 1) & (RX_SIZE - 1);
+    return c;
+  }
+  size_t simInject(const uint8_t* data, size_t len);
+
+private:
+  static const uint32_t RX_SIZE = 1024;   // Same as the core's default RX buffer
+  uint8_t rx[RX_SIZE];
+  uint32_t rxHead = 0;
+  uint32_t rxTail = 0;
+};
+extern HardwareSerial Serial;
+extern HardwareSerial Serial2;
+
+class EspClass {
+public:
+  uint64_t getEfuseMac() { return 0x0000A1B2C3D4E5F6ULL; }
+};
+extern EspClass ESP;
+
+#endif // SIM_ARDUINO_H
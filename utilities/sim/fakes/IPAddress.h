@@ -0,0 +1,21 @@
+// IPAddress.h - Host stand-in for the Arduino IPAddress type (see ../sim.h)
+#ifndef SIM_IPADDRESS_H
+#define SIM_IPADDRESS_H
+
+#include <stdint.h>
+
+class IPAddress {
+public:
+  IPAddress() : addr{0, 0, 0, 0} {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : addr{a, b, c, d} {}
+  uint8_t operator[](int i) const { return addr[i]; }
+  bool operator==(const IPAddress& o) const {
+    return addr[0] == o.addr[0] && addr[1] == o.addr[1] && addr[2] == o.addr[2] && addr[3] == o.addr[3];
+  }
+  bool operator!=(const IPAddress& o) const { return !(*this == o); }
+
+private:
+  uint8_t addr[4];
+};
+
+#endif // SIM_IPADDRESS_H
@@ -0,0 +1,39 @@
+// Preferences.h - Host stand-in for NVS-backed Preferences, held in memory (see ../sim.h)
+// Scenario "set <namespace> <key> <value>" lines seed it before setup().
+#ifndef SIM_PREFERENCES_H
+#define SIM_PREFERENCES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+class Preferences {
+public:
+  bool begin(const char* name, bool readOnly = false);
+  void end() {}
+  bool isKey(const char* key);
+  bool remove(const char* key);
+  bool clear();
+
+  int32_t getInt(const char* key, int32_t def = 0) { return (int32_t)get(key, def); }
+  uint32_t getUInt(const char* key, uint32_t def = 0) { return (uint32_t)get(key, def); }
+  uint8_t getUChar(const char* key, uint8_t def = 0) { return (uint8_t)get(key, def); }
+  uint16_t getUShort(const char* key, uint16_t def = 0) { return (uint16_t)get(key, def); }
+  bool getBool(const char* key, bool def = false) { return get(key, def) != 0; }
+  size_t getBytes(const char* key, void* buf, size_t len);
+
+  size_t putInt(const char* key, int32_t v) { return put(key, v, 4); }
+  size_t putUInt(const char* key, uint32_t v) { return put(key, v, 4); }
+  size_t putUChar(const char* key, uint8_t v) { return put(key, v, 1); }
+  size_t putUShort(const char* key, uint16_t v) { return put(key, v, 2); }
+  size_t putBool(const char* key, bool v) { return put(key, v, 1); }
+  size_t putBytes(const char* key, const void* buf, size_t len);
+
+private:
+  int64_t get(const char* key, int64_t def);
+  size_t put(const char* key, int64_t v, size_t size);
+  std::string ns;
+  bool readOnly = false;
+};
+
+#endif // SIM_PREFERENCES_H
@@ -0,0 +1,47 @@
+// WiFi.h - Host stand-in for the Arduino-ESP32 WiFi library (see ../sim.h)
+// The station is always connected; the network itself is scenario input.
+#ifndef SIM_WIFI_H
+#define SIM_WIFI_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+#define WL_IDLE_STATUS   0
+#define WL_CONNECTED     3
+#define WL_DISCONNECTED  6
+#define WIFI_STA         1
+
+class WiFiClient : public Print {
+public:
+  bool connected() { return false; }
+  void stop() {}
+  int available() { return 0; }
+  int read() { return -1; }
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t*, size_t n) override { return n; }
+  using Print::write;
+  void setNoDelay(bool) {}
+  IPAddress remoteIP() { return IPAddress(127, 0, 0, 1); }
+  explicit operator bool() { return false; }
+};
+
+class WiFiServer {
+public:
+  WiFiServer(uint16_t) {}
+  void begin() {}
+  void setNoDelay(bool) {}
+  bool hasClient() { return false; }
+  WiFiClient available() { return WiFiClient(); }
+};
+
+class WiFiClass {
+public:
+  int status() { return WL_CONNECTED; }
+  void mode(int) {}
+  void begin(const char*, const char*) {}
+  IPAddress localIP() { return IPAddress(10, 0, 0, 2); }
+  int RSSI() { return -50; }
+};
+extern WiFiClass WiFi;
+
+#endif // SIM_WIFI_H
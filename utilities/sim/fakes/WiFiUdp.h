@@ -0,0 +1,27 @@
+// WiFiUdp.h - Host stand-in for WiFiUDP; received packets come from the scenario (see ../sim.h)
+#ifndef SIM_WIFIUDP_H
+#define SIM_WIFIUDP_H
+
+#include <WiFi.h>
+
+class WiFiUDP {
+public:
+  uint8_t begin(uint16_t port);
+  void stop();
+  int parsePacket();
+  int available();
+  int read(uint8_t* buf, size_t len);
+  int read();
+  IPAddress remoteIP() { return IPAddress(10, 0, 0, 1); }
+  uint16_t remotePort() { return 5004; }
+  int beginPacket(IPAddress ip, uint16_t port);
+  size_t write(const uint8_t* buf, size_t len);
+  int endPacket();
+
+private:
+  uint16_t port = 0;
+  size_t pos = 0;
+  bool havePacket = false;
+};
+
+#endif // SIM_WIFIUDP_H
@@ -0,0 +1,59 @@
+// i2c_master.h - Host stand-in for the ESP-IDF i2c_master driver (see ../../sim.h)
+//
+// Transactions are queued on the bus and take their bit time at the
+// device's SCL speed; each one touches the device model when it completes,
+// so reads see the input state at that moment.
+#ifndef SIM_DRIVER_I2C_MASTER_H
+#define SIM_DRIVER_I2C_MASTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+typedef int i2c_port_num_t;
+#define I2C_NUM_0 0
+#define I2C_NUM_1 1
+
+typedef enum { I2C_CLK_SRC_DEFAULT = 0 } i2c_clock_source_t;
+typedef enum { I2C_ADDR_BIT_LEN_7 = 0, I2C_ADDR_BIT_LEN_10 = 1 } i2c_addr_bit_len_t;
+
+typedef struct {
+  i2c_port_num_t i2c_port;
+  gpio_num_t sda_io_num;
+  gpio_num_t scl_io_num;
+  i2c_clock_source_t clk_source;
+  uint8_t glitch_ignore_cnt;
+  int intr_priority;
+  size_t trans_queue_depth;
+  struct {
+    uint32_t enable_internal_pullup : 1;
+  } flags;
+} i2c_master_bus_config_t;
+
+typedef struct {
+  i2c_addr_bit_len_t dev_addr_length;
+  uint16_t device_address;
+  uint32_t scl_speed_hz;
+  uint32_t scl_wait_us;
+  struct {
+    uint32_t disable_ack_check : 1;
+  } flags;
+} i2c_device_config_t;
+
+typedef struct SimI2cBus* i2c_master_bus_handle_t;
+typedef struct SimI2cDev* i2c_master_dev_handle_t;
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t* cfg, i2c_master_bus_handle_t* out);
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus, const i2c_device_config_t* cfg,
+                                    i2c_master_dev_handle_t* out);
+esp_err_t i2c_master_probe(i2c_master_bus_handle_t bus, uint16_t addr, int timeout_ms);
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t dev, const uint8_t* buf, size_t len,
+                              int timeout_ms);
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t dev, uint8_t* buf, size_t len, int timeout_ms);
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t dev, const uint8_t* wbuf, size_t wlen,
+                                      uint8_t* rbuf, size_t rlen, int timeout_ms);
+esp_err_t i2c_master_bus_wait_all_done(i2c_master_bus_handle_t bus, int timeout_ms);
+
+#endif // SIM_DRIVER_I2C_MASTER_H
@@ -0,0 +1,32 @@
+// mcpwm.h - Host stand-in for the legacy ESP-IDF MCPWM driver (see ../../sim.h)
+#ifndef SIM_DRIVER_MCPWM_H
+#define SIM_DRIVER_MCPWM_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum { MCPWM_UNIT_0, MCPWM_UNIT_1, MCPWM_UNIT_MAX } mcpwm_unit_t;
+typedef enum { MCPWM_TIMER_0, MCPWM_TIMER_1, MCPWM_TIMER_2, MCPWM_TIMER_MAX } mcpwm_timer_t;
+typedef enum { MCPWM_GEN_A, MCPWM_GEN_B, MCPWM_GEN_MAX } mcpwm_generator_t;
+typedef mcpwm_generator_t mcpwm_operator_t;
+#define MCPWM_OPR_A   MCPWM_GEN_A
+#define MCPWM_OPR_B   MCPWM_GEN_B
+#define MCPWM_OPR_MAX MCPWM_GEN_MAX
+
+typedef enum { MCPWM0A, MCPWM0B, MCPWM1A, MCPWM1B, MCPWM2A, MCPWM2B } mcpwm_io_signals_t;
+typedef enum { MCPWM_DUTY_MODE_0, MCPWM_DUTY_MODE_1 } mcpwm_duty_type_t;
+typedef enum { MCPWM_UP_COUNTER = 1, MCPWM_DOWN_COUNTER, MCPWM_UP_DOWN_COUNTER } mcpwm_counter_type_t;
+
+typedef struct {
+  uint32_t frequency;
+  float cmpr_a;
+  float cmpr_b;
+  mcpwm_duty_type_t duty_mode;
+  mcpwm_counter_type_t counter_mode;
+} mcpwm_config_t;
+
+esp_err_t mcpwm_gpio_init(mcpwm_unit_t unit, mcpwm_io_signals_t signal, int gpio);
+esp_err_t mcpwm_init(mcpwm_unit_t unit, mcpwm_timer_t timer, const mcpwm_config_t* cfg);
+esp_err_t mcpwm_set_duty(mcpwm_unit_t unit, mcpwm_timer_t timer, mcpwm_generator_t gen, float duty);
+
+#endif // SIM_DRIVER_MCPWM_H
@@ -0,0 +1,12 @@
+// sigmadelta.h - Host stand-in for the legacy ESP-IDF sigma-delta driver (see ../../sim.h)
+#ifndef SIM_DRIVER_SIGMADELTA_H
+#define SIM_DRIVER_SIGMADELTA_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef int sigmadelta_channel_t;
+
+esp_err_t sigmadelta_set_duty(sigmadelta_channel_t channel, int8_t duty);
+
+#endif // SIM_DRIVER_SIGMADELTA_H
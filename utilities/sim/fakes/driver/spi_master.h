@@ -0,0 +1,54 @@
+// spi_master.h - Host stand-in for the ESP-IDF SPI master driver (see ../../sim.h)
+//
+// A queued transaction shifts for length / clock_speed_hz; its data is
+// traced as a latch when it completes (CS rising edge).
+#ifndef SIM_DRIVER_SPI_MASTER_H
+#define SIM_DRIVER_SPI_MASTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef enum { SPI1_HOST, SPI2_HOST, SPI3_HOST } spi_host_device_t;
+#define SPI_DMA_DISABLED 0
+#define SPI_DMA_CH_AUTO  3
+
+typedef struct {
+  int mosi_io_num;
+  int miso_io_num;
+  int sclk_io_num;
+  int quadwp_io_num;
+  int quadhd_io_num;
+  int max_transfer_sz;
+  uint32_t flags;
+} spi_bus_config_t;
+
+typedef struct {
+  uint8_t mode;
+  int clock_speed_hz;
+  int spics_io_num;
+  uint32_t flags;
+  int queue_size;
+} spi_device_interface_config_t;
+
+typedef struct {
+  uint32_t flags;
+  size_t length;     // Bits
+  size_t rxlength;
+  void* user;
+  const void* tx_buffer;
+  void* rx_buffer;
+} spi_transaction_t;
+
+typedef struct SimSpiDev* spi_device_handle_t;
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t* cfg, int dma);
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t* cfg,
+                             spi_device_handle_t* out);
+esp_err_t spi_device_queue_trans(spi_device_handle_t dev, spi_transaction_t* t, TickType_t ticks);
+esp_err_t spi_device_get_trans_result(spi_device_handle_t dev, spi_transaction_t** t, TickType_t ticks);
+esp_err_t spi_device_transmit(spi_device_handle_t dev, spi_transaction_t* t);
+esp_err_t spi_device_polling_transmit(spi_device_handle_t dev, spi_transaction_t* t);
+
+#endif // SIM_DRIVER_SPI_MASTER_H
@@ -0,0 +1,26 @@
+// esp_cpu.h - Host stand-in for the ESP-IDF CPU cycle counter (see ../sim.h)
+// Real time, not virtual time: the host's time-stamp counter where there is
+// one, nanoseconds otherwise. Like CCOUNT on the S3 it wraps at 32 bits.
+#ifndef SIM_ESP_CPU_H
+#define SIM_ESP_CPU_H
+
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+static inline esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return (esp_cpu_cycle_count_t)__rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (esp_cpu_cycle_count_t)((uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec);
+#endif
+}
+
+#endif // SIM_ESP_CPU_H
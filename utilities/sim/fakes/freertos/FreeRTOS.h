@@ -0,0 +1,31 @@
+// FreeRTOS.h - Host stand-in for FreeRTOS on the sim kernel (see ../../sim.h)
+#ifndef SIM_FREERTOS_H
+#define SIM_FREERTOS_H
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdPASS  1
+#define pdFAIL  0
+
+#define configTICK_RATE_HZ     1000
+#define configMAX_PRIORITIES   25
+#define portMAX_DELAY          ((TickType_t)0xFFFFFFFFu)
+#define portTICK_PERIOD_MS     1
+#define pdMS_TO_TICKS(ms)      ((TickType_t)(ms))
+
+// Only one context runs at a time, so critical sections need no lock
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+#define portENTER_CRITICAL(m)         ((void)(m))
+#define portEXIT_CRITICAL(m)          ((void)(m))
+#define portENTER_CRITICAL_ISR(m)     ((void)(m))
+#define portEXIT_CRITICAL_ISR(m)      ((void)(m))
+#define portYIELD_FROM_ISR(x)         ((void)(x))
+
+#endif // SIM_FREERTOS_H
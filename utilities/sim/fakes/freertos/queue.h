@@ -0,0 +1,15 @@
+// queue.h - Host stand-in for FreeRTOS queues on the sim kernel (see ../../sim.h)
+#ifndef SIM_FREERTOS_QUEUE_H
+#define SIM_FREERTOS_QUEUE_H
+
+#include "FreeRTOS.h"
+
+typedef struct SimQueue* QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t ticks);
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void* item, BaseType_t* woken);
+BaseType_t xQueueReceive(QueueHandle_t q, void* out, TickType_t ticks);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q);
+
+#endif // SIM_FREERTOS_QUEUE_H
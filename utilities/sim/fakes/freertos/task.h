@@ -0,0 +1,24 @@
+// task.h - Host stand-in for FreeRTOS tasks on the sim kernel (see ../../sim.h)
+#ifndef SIM_FREERTOS_TASK_H
+#define SIM_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+struct SimTask;
+typedef struct SimTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack,
+                                   void* arg, UBaseType_t prio, TaskHandle_t* out, BaseType_t core);
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack,
+                       void* arg, UBaseType_t prio, TaskHandle_t* out);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelete(TaskHandle_t task);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken);
+
+#endif // SIM_FREERTOS_TASK_H
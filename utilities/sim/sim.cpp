@@ -0,0 +1,405 @@
+// sim.cpp - Virtual-time kernel (see sim.h)
+#include "sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+static uint64_t nowUs = 0;
+
+// ---------- Events ----------
+// Keyed by (time, sequence) so equal times fire in scheduling order
+
+struct EventKey {
+  uint64_t t;
+  uint64_t seq;
+  bool operator<(const EventKey& o) const { return t != o.t ? t < o.t : seq < o.seq; }
+};
+
+static std::map<EventKey, std::pair<uint32_t, SimFn>> events;
+static std::unordered_map<uint32_t, EventKey> eventIds;
+static uint64_t eventSeq = 0;
+static uint32_t nextEventId = 1;
+
+uint64_t sim_now() {
+  return nowUs;
+}
+
+void sim_busy_wait(uint64_t us) {
+  nowUs += us;
+}
+
+uint32_t sim_at(uint64_t t_us, SimFn fn) {
+  EventKey k = { t_us < nowUs ? nowUs : t_us, eventSeq++ };
+  uint32_t id = nextEventId++;
+  events[k] = std::make_pair(id, std::move(fn));
+  eventIds[id] = k;
+  return id;
+}
+
+void sim_cancel(uint32_t id) {
+  auto it = eventIds.find(id);
+  if (it == eventIds.end()) return;
+  events.erase(it->second);
+  eventIds.erase(it);
+}
+
+void sim_every(uint64_t period_us, SimFn fn) {
+  // Each firing schedules the next one
+  auto tick = std::make_shared<SimFn>();
+  *tick = [period_us, fn, tick]() {
+    fn();
+    sim_at(nowUs + period_us, *tick);
+  };
+  sim_at(nowUs + period_us, *tick);
+}
+
+// ---------- Tasks ----------
+// Only the context holding the baton runs: either the kernel (running ==
+// nullptr) or exactly one task. Handing it over is the only synchronisation
+// the firmware code ever sees, so no firmware state is touched concurrently.
+
+static std::mutex baton;
+static std::condition_variable kernelCv;
+static SimTask* running = nullptr;
+static std::vector<SimTask*> tasks;
+
+static void task_entry(SimTask* t) {
+  {
+    std::unique_lock<std::mutex> lk(baton);
+    t->cv.wait(lk, [t] { return t->turn; });
+  }
+  t->fn(t->arg);
+
+  // FreeRTOS tasks must not return; treat it as the task deleting itself
+  std::unique_lock<std::mutex> lk(baton);
+  t->dead = true;
+  t->turn = false;
+  running = nullptr;
+  kernelCv.notify_one();
+}
+
+SimTask* sim_task_create(void (*fn)(void*), void* arg, const char* name, int prio) {
+  SimTask* t = new SimTask();
+  t->name = name;
+  t->prio = prio;
+  t->order = (int)tasks.size();
+  t->fn = fn;
+  t->arg = arg;
+  tasks.push_back(t);
+  t->thread = std::thread(task_entry, t);
+  t->thread.detach();
+  return t;
+}
+
+SimTask* sim_current_task() {
+  return running;
+}
+
+static bool runnable(SimTask* t) {
+  if (t->dead) return false;
+  if (!t->started) return true;
+  return t->blocked && ((t->ready && t->ready()) || nowUs >= t->wakeAt);
+}
+
+// Hand the baton to t and wait until it blocks again
+static void run_task(SimTask* t) {
+  std::unique_lock<std::mutex> lk(baton);
+  t->started = true;
+  t->blocked = false;
+  t->turn = true;
+  running = t;
+  t->cv.notify_one();
+  kernelCv.wait(lk, [] { return running == nullptr; });
+}
+
+static void run_ready_tasks() {
+  for (;;) {
+    SimTask* best = nullptr;
+    for (SimTask* t : tasks) {
+      if (!runnable(t)) continue;
+      if (!best || t->prio > best->prio) best = t;
+    }
+    if (!best) return;
+    run_task(best);
+  }
+}
+
+bool sim_block(std::function<bool()> ready, uint64_t timeout_us) {
+  if (ready && ready()) return true;
+  if (timeout_us == 0) return false;
+
+  SimTask* t = running;
+  if (!t) {
+    // Kernel context cannot wait for other contexts; only a pure delay works
+    if (ready) sim_fail("blocking call outside a task would never return");
+    sim_busy_wait(timeout_us);
+    return false;
+  }
+
+  t->ready = ready;
+  t->wakeAt = timeout_us == SIM_FOREVER ? SIM_FOREVER : nowUs + timeout_us;
+  t->blocked = true;
+  {
+    std::unique_lock<std::mutex> lk(baton);
+    t->turn = false;
+    running = nullptr;
+    kernelCv.notify_one();
+    t->cv.wait(lk, [t] { return t->turn; });
+  }
+  t->ready = nullptr;
+  return ready ? ready() : false;
+}
+
+void sim_run_until(uint64_t t_us) {
+  for (;;) {
+    run_ready_tasks();
+
+    uint64_t next = events.empty() ? SIM_FOREVER : events.begin()->first.t;
+    for (SimTask* t : tasks) {
+      if (t->blocked && !t->dead && t->wakeAt < next) next = t->wakeAt;
+    }
+    if (next > t_us) {
+      if (nowUs < t_us) nowUs = t_us;
+      return;
+    }
+    if (next > nowUs) nowUs = next;
+
+    // One event at a time: tasks it wakes run before the next one fires
+    auto it = events.begin();
+    if (it != events.end() && it->first.t <= nowUs) {
+      SimFn fn = std::move(it->second.second);
+      eventIds.erase(it->second.first);
+      events.erase(it);
+      fn();
+    }
+  }
+}
+
+// ---------- Output ----------
+
+// Function-local so static constructors in firmware code can trace safely
+static std::string& trace_text() {
+  static std::string text;
+  return text;
+}
+static bool verbose = false;
+static bool tracing = true;
+
+void sim_set_trace(bool on) {
+  tracing = on;
+}
+
+void sim_trace(const char* fmt, ...) {
+  if (!tracing) return;
+  char line[512];
+  int n = snprintf(line, sizeof(line), "%10llu ", (unsigned long long)nowUs);
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(line + n, sizeof(line) - n, fmt, ap);
+  va_end(ap);
+  trace_text() += line;
+  trace_text() += '\n';
+}
+
+void sim_log_write(const uint8_t* data, size_t len) {
+  if (verbose) fwrite(data, 1, len, stderr);
+}
+
+void sim_fail(const char* fmt, ...) {
+  fflush(stdout);
+  fprintf(stderr, "sim: ");
+  va_list ap;
+  va_start(ap, fmt);
+  vfprintf(stderr, fmt, ap);
+  va_end(ap);
+  fprintf(stderr, "\n");
+  _exit(2);   // Task threads are parked on the baton; do not unwind them
+}
+
+// ---------- Scenarios ----------
+
+uint32_t sim_rand(uint32_t& state) {
+  if (!state) state = 0x9E3779B9u;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+uint64_t sim_parse_time(const std::string& s, int line) {
+  char* end = nullptr;
+  double v = strtod(s.c_str(), &end);
+  if (end == s.c_str() || v < 0) sim_fail("line %d: bad time '%s'", line, s.c_str());
+  std::string unit(end);
+  if (unit == "" || unit == "us") return (uint64_t)v;
+  if (unit == "ms") return (uint64_t)(v * 1000.0 + 0.5);
+  if (unit == "s") return (uint64_t)(v * 1000000.0 + 0.5);
+  sim_fail("line %d: bad time unit '%s'", line, unit.c_str());
+  return 0;
+}
+
+long sim_arg_int(const SimCmd& c, size_t i) {
+  if (i >= c.args.size()) sim_fail("line %d: %s needs more arguments", c.line, c.args[0].c_str());
+  char* end = nullptr;
+  long v = strtol(c.args[i].c_str(), &end, 0);
+  if (*end) sim_fail("line %d: bad number '%s'", c.line, c.args[i].c_str());
+  return v;
+}
+
+// Hex bytes, either separate ("90 3c 64") or run together ("903c64")
+std::vector<uint8_t> sim_arg_bytes(const SimCmd& c, size_t first) {
+  std::string hex;
+  for (size_t i = first; i < c.args.size(); i++) hex += c.args[i];
+  if (hex.size() % 2) sim_fail("line %d: odd number of hex digits", c.line);
+  std::vector<uint8_t> out;
+  for (size_t i = 0; i < hex.size(); i += 2) {
+    char pair[3] = { hex[i], hex[i + 1], 0 };
+    char* end = nullptr;
+    out.push_back((uint8_t)strtoul(pair, &end, 16));
+    if (*end) sim_fail("line %d: bad hex '%s'", c.line, pair);
+  }
+  return out;
+}
+
+static bool read_scenario(const char* path, std::vector<SimCmd>& out) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  char buf[1024];
+  int line = 0;
+  while (fgets(buf, sizeof(buf), f)) {
+    line++;
+    char* hash = strchr(buf, '#');
+    if (hash) *hash = 0;
+
+    SimCmd c;
+    c.line = line;
+    for (char* tok = strtok(buf, " \t\r\n"); tok; tok = strtok(nullptr, " \t\r\n")) {
+      c.args.push_back(tok);
+    }
+    if (c.args.empty()) continue;
+
+    c.timed = (c.args[0][0] >= '0' && c.args[0][0] <= '9');
+    c.t = 0;
+    if (c.timed) {
+      c.t = sim_parse_time(c.args[0], line);
+      c.args.erase(c.args.begin());
+      if (c.args.empty()) sim_fail("line %d: missing command", line);
+    }
+    out.push_back(c);
+  }
+  fclose(f);
+  return true;
+}
+
+// Line-by-line comparison against a golden trace
+static int check_trace(const char* path) {
+  const std::string& traceText = trace_text();
+  FILE* f = fopen(path, "r");
+  if (!f) {
+    fprintf(stderr, "sim: cannot open golden trace %s\n", path);
+    return 1;
+  }
+  std::string golden;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) golden.append(buf, n);
+  fclose(f);
+
+  size_t a = 0, b = 0;
+  int line = 1;
+  while (a < traceText.size() || b < golden.size()) {
+    size_t ea = traceText.find('\n', a);
+    size_t eb = golden.find('\n', b);
+    if (ea == std::string::npos) ea = traceText.size();
+    if (eb == std::string::npos) eb = golden.size();
+    std::string la = traceText.substr(a, ea - a);
+    std::string lb = golden.substr(b, eb - b);
+    if (!lb.empty() && lb.back() == '\r') lb.pop_back();
+    if (la != lb) {
+      fprintf(stderr, "sim: trace differs from %s at line %d\n  expected: %s\n  actual:   %s\n",
+              path, line, b < golden.size() ? lb.c_str() : "<end>",
+              a < traceText.size() ? la.c_str() : "<end>");
+      return 1;
+    }
+    a = ea + 1;
+    b = eb + 1;
+    line++;
+  }
+  fprintf(stderr, "sim: trace matches %s (%d lines)\n", path, line - 1);
+  return 0;
+}
+
+int sim_main(int argc, char** argv, const SimTarget& target) {
+  const char* outPath = nullptr;
+  const char* goldenPath = nullptr;
+  const char* scenarioPath = nullptr;
+  uint64_t loopUs = 100;
+  uint64_t tailUs = 500000;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-o") && i + 1 < argc) outPath = argv[++i];
+    else if (!strcmp(argv[i], "--check") && i + 1 < argc) goldenPath = argv[++i];
+    else if (!strcmp(argv[i], "--loop-us") && i + 1 < argc) loopUs = strtoull(argv[++i], nullptr, 0);
+    else if (!strcmp(argv[i], "--tail-ms") && i + 1 < argc) tailUs = strtoull(argv[++i], nullptr, 0) * 1000;
+    else if (!strcmp(argv[i], "-v")) verbose = true;
+    else if (argv[i][0] != '-' && !scenarioPath) scenarioPath = argv[i];
+    else scenarioPath = nullptr, argc = 0;
+  }
+  if (!scenarioPath || loopUs == 0) {
+    fprintf(stderr, "usage: sim_%s [-o trace] [--check golden] [--loop-us N] [--tail-ms N] [-v] scenario\n",
+            target.name);
+    return 2;
+  }
+
+  std::vector<SimCmd> cmds;
+  if (!read_scenario(scenarioPath, cmds)) {
+    fprintf(stderr, "sim: cannot open %s\n", scenarioPath);
+    return 2;
+  }
+
+  uint64_t last = 0;
+  for (const SimCmd& c : cmds) {
+    if (c.timed) {
+      if (c.t > last) last = c.t;
+      continue;
+    }
+    if (!target.config(c)) sim_fail("line %d: unknown setting '%s'", c.line, c.args[0].c_str());
+  }
+
+  target.setup();
+  sim_trace("ready");
+
+  // Scenario commands are scheduled up front so equal times keep file order
+  for (const SimCmd& c : cmds) {
+    if (!c.timed) continue;
+    sim_at(c.t, [c, &target]() {
+      if (!target.command(c)) sim_fail("line %d: unknown command '%s'", c.line, c.args[0].c_str());
+    });
+  }
+  sim_every(loopUs, target.loop);
+
+  sim_run_until((last > sim_now() ? last : sim_now()) + tailUs);
+  target.report();
+
+  const std::string& traceText = trace_text();
+  int status = 0;
+  if (outPath) {
+    FILE* f = fopen(outPath, "w");
+    if (!f) sim_fail("cannot write %s", outPath);
+    fwrite(traceText.data(), 1, traceText.size(), f);
+    fclose(f);
+  } else if (!goldenPath) {
+    fwrite(traceText.data(), 1, traceText.size(), stdout);
+  }
+  if (goldenPath) status = check_trace(goldenPath);
+
+  fflush(stdout);
+  fflush(stderr);
+  _exit(status);   // Task threads are parked on the baton; do not unwind them
+}
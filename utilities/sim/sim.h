@@ -0,0 +1,136 @@
+// sim.h - Virtual-time kernel for running firmware modules on the host.
+//
+// Everything runs on one virtual microsecond clock that only moves when the
+// kernel advances it, so a scenario replays identically on every run:
+//   - events (esp_timer callbacks, scenario input, peripheral completions,
+//     the loop() tick) fire in (time, order scheduled) order on the kernel
+//     context
+//   - FreeRTOS tasks are real threads, but only one context ever runs at a
+//     time; a task runs until it blocks, and the highest-priority ready task
+//     (oldest first on ties) always runs before the next event fires
+// Firmware code takes zero virtual time; only waits and peripheral
+// transfers move the clock.
+//
+// The fakes in fakes/ map the Arduino / ESP-IDF calls the firmware makes
+// onto this kernel, and each target (sim_chimes.cpp etc.) wires one
+// project's modules to a scenario file. See sim_main() for the options.
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <condition_variable>
+
+#define SIM_FOREVER UINT64_MAX
+
+typedef std::function<void()> SimFn;
+
+// ---------- Clock and events ----------
+
+// Current virtual time in microseconds
+uint64_t sim_now();
+
+// Advance the clock in place; used for busy-waits outside any task
+// (delay() in setup()). Events due in between fire afterwards.
+void sim_busy_wait(uint64_t us);
+
+// Run fn on the kernel context at t_us (never earlier than now).
+// Returns an id for sim_cancel().
+uint32_t sim_at(uint64_t t_us, SimFn fn);
+void sim_cancel(uint32_t id);
+
+// Run fn every period_us, starting one period from now
+void sim_every(uint64_t period_us, SimFn fn);
+
+// Process events and tasks until the clock reaches t_us
+void sim_run_until(uint64_t t_us);
+
+// ---------- Tasks ----------
+
+struct SimTask {
+  const char* name;
+  int prio;
+  int order;                     // Creation order breaks priority ties
+  void (*fn)(void*);
+  void* arg;
+  uint32_t notify = 0;           // FreeRTOS task notification value
+
+  // Kernel bookkeeping
+  std::thread thread;
+  std::condition_variable cv;
+  bool started = false;
+  bool turn = false;
+  bool blocked = false;
+  bool dead = false;
+  std::function<bool()> ready;   // Wake condition while blocked
+  uint64_t wakeAt = SIM_FOREVER; // Timeout while blocked
+};
+
+SimTask* sim_task_create(void (*fn)(void*), void* arg, const char* name, int prio);
+
+// Task running now; nullptr on the kernel context (setup, loop, events)
+SimTask* sim_current_task();
+
+// Block the calling task until ready() holds or timeout_us passes.
+// Returns ready() on wake. Aborts if called outside a task while not ready.
+bool sim_block(std::function<bool()> ready, uint64_t timeout_us);
+
+// ---------- Output ----------
+
+// Append one line to the trace: "<time_us> <text>"
+void sim_trace(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+
+// Turn trace recording off for runs that only measure (utilities/bench)
+void sim_set_trace(bool on);
+
+// Firmware log output (Log.printf), shown with -v
+void sim_log_write(const uint8_t* data, size_t len);
+
+// Stop the run with an error (bad scenario, impossible call)
+void sim_fail(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+
+// ---------- Scenarios ----------
+// One command per line, '#' starts a comment:
+//   <time_us> <command> [args...]   applied at that virtual time
+//   <command> [args...]             configuration, applied before setup()
+// Times may carry a unit suffix: 1500us, 20ms, 2s.
+// Each scenarios/<name>.txt has a golden scenarios/<name>.trace that ctest
+// checks it against (CMakeLists.txt); rewrite the golden with -o only when
+// the behaviour change is intended.
+struct SimCmd {
+  bool timed;
+  uint64_t t;
+  std::vector<std::string> args;  // args[0] is the command
+  int line;
+};
+
+// Numeric argument helpers; fail the run on bad input
+long sim_arg_int(const SimCmd& c, size_t i);
+uint64_t sim_parse_time(const std::string& s, int line);
+std::vector<uint8_t> sim_arg_bytes(const SimCmd& c, size_t first);
+
+// Deterministic PRNG for generated input (xorshift32)
+uint32_t sim_rand(uint32_t& state);
+
+struct SimTarget {
+  const char* name;
+  bool (*config)(const SimCmd& c);   // Untimed line; false = unknown command
+  void (*setup)();
+  void (*loop)();                    // Called every loop period
+  bool (*command)(const SimCmd& c);  // Timed line; false = unknown command
+  void (*report)();                  // Final "stat" lines
+};
+
+// Shared driver:
+//   sim_<target> [options] scenario.txt
+//     -o FILE       write the trace to FILE (default stdout)
+//     --check FILE  compare the trace with a golden FILE; exit 1 on mismatch
+//     --loop-us N   loop() period (default 100)
+//     --tail-ms N   keep running this long after the last command (default 500)
+//     -v            print firmware log output to stderr
+int sim_main(int argc, char** argv, const SimTarget& target);
+
+#endif // SIM_H
@@ -0,0 +1,160 @@
+// sim_chimes.cpp - Chimes note pipeline on the simulator (see sim.h)
+//
+// Runs the real MIDI/UDP receiver, sequencer, note mapping, note repeater
+// and chime driver; the trace shows every PWM duty change.
+//
+// Build and check against the golden traces (from utilities/sim, see CMakeLists.txt):
+//   cmake -S . -B build && cmake --build build && ctest --test-dir build
+//
+// Scenario commands:
+//   set <namespace> <key> <value>    NVS value before setup()
+//   <t> mudp <hex...>                MUDP packet arrives
+//   <t> midi <status> <d1> <d2>      handle_midi_message() (hex bytes)
+//   <t> play <file.mid | hex:...>    midiseq_load_from_buffer() and play
+//   <t> playgen <notes> <step_ms>    Play a generated SMF: <notes> strikes across
+//                                    the chimes, <step_ms> apart
+//   <t> stop                         midiseq_stop()
+//   <t> stall <ms>                   loop() does not run for <ms> (a handler that blocks)
+//   <t> repeat <note> <vel> <period_ms> <count>
+//   <t> timer <0|1>                  midiseq_set_timer_mode()
+#include <Arduino.h>
+#include "sim.h"
+#include "sim_fakes.h"
+#include "chimes.h"
+#include "midinote.h"
+#include "midiseq.h"
+#include "midihandler.h"
+#include "midiudp.h"
+#include "noterepeater.h"
+
+static bool config(const SimCmd& c) {
+  if (c.args[0] == "set" && c.args.size() == 4) {
+    sim_prefs_set(c.args[1], c.args[2], c.args[3]);
+    return true;
+  }
+  return false;
+}
+
+static void setup() {
+  chimes_begin();
+  midinote_begin();
+  midiseq_begin();
+  noterepeater_setup();
+  midiUDP.begin();
+}
+
+static uint64_t stallUntil = 0;
+
+// Same order as chimes/src/main.cpp
+static void loop() {
+  if (sim_now() < stallUntil) return;
+  midiUDP.update();
+  midiseq_loop();
+  noterepeater_loop();
+  chimes_loop();
+}
+
+// The sequencer keeps reading from the buffer while it plays
+static std::vector<uint8_t> smfData;
+
+static void putVarLen(std::vector<uint8_t>& out, uint32_t v) {
+  uint8_t b[5];
+  int n = 0;
+  do {
+    b[n++] = v & 0x7F;
+    v >>= 7;
+  } while (v);
+  while (n > 1) out.push_back(b[--n] | 0x80);
+  out.push_back(b[0]);
+}
+
+// Format 0 at 500 ticks per quarter and the default 120 bpm, so a tick is
+// 1 ms. Each note is released half a step after it is struck.
+static void generateSmf(long notes, long stepMs) {
+  std::vector<uint8_t> track;
+  for (long i = 0; i < notes; i++) {
+    uint8_t note = 68 + i % 21;   // The chimes' range
+    putVarLen(track, i == 0 ? 0 : stepMs - stepMs / 2);
+    track.insert(track.end(), { 0x90, note, 0x64 });
+    putVarLen(track, stepMs / 2);
+    track.insert(track.end(), { 0x80, note, 0x00 });
+  }
+  track.insert(track.end(), { 0x00, 0xFF, 0x2F, 0x00 });
+
+  smfData = { 'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 0, 0, 1, 0x01, 0xF4,
+              'M', 'T', 'r', 'k' };
+  uint32_t len = track.size();
+  for (int shift = 24; shift >= 0; shift -= 8) smfData.push_back((len >> shift) & 0xFF);
+  smfData.insert(smfData.end(), track.begin(), track.end());
+}
+
+static bool command(const SimCmd& c) {
+  const std::string& cmd = c.args[0];
+  if (cmd == "mudp") {
+    sim_udp_inject(sim_arg_bytes(c, 1));
+  } else if (cmd == "midi") {
+    std::vector<uint8_t> b = sim_arg_bytes(c, 1);
+    if (b.size() != 3) sim_fail("line %d: midi needs 3 bytes", c.line);
+    handle_midi_message(b[0], b[1], b[2]);
+  } else if (cmd == "play") {
+    if (c.args.size() != 2) sim_fail("line %d: play needs a file", c.line);
+    midiseq_stop();
+    if (c.args[1].compare(0, 4, "hex:") == 0) {
+      SimCmd h = c;
+      h.args[1] = c.args[1].substr(4);
+      smfData = sim_arg_bytes(h, 1);
+    } else {
+      FILE* f = fopen(c.args[1].c_str(), "rb");
+      if (!f) sim_fail("line %d: cannot open %s", c.line, c.args[1].c_str());
+      smfData.clear();
+      uint8_t buf[4096];
+      size_t n;
+      while ((n = fread(buf, 1, sizeof(buf), f)) > 0) smfData.insert(smfData.end(), buf, buf + n);
+      fclose(f);
+    }
+    if (!midiseq_load_from_buffer(smfData.data(), smfData.size())) {
+      sim_fail("line %d: %s is not a playable MIDI file", c.line, c.args[1].c_str());
+    }
+  } else if (cmd == "playgen") {
+    long notes = sim_arg_int(c, 1);
+    long stepMs = sim_arg_int(c, 2);
+    if (notes < 1 || stepMs < 2) sim_fail("line %d: playgen needs notes >= 1 and step_ms >= 2", c.line);
+    midiseq_stop();
+    generateSmf(notes, stepMs);
+    if (!midiseq_load_from_buffer(smfData.data(), smfData.size())) {
+      sim_fail("line %d: generated MIDI file did not load", c.line);
+    }
+  } else if (cmd == "stop") {
+    midiseq_stop();
+  } else if (cmd == "stall") {
+    stallUntil = sim_now() + (uint64_t)sim_arg_int(c, 1) * 1000;
+  } else if (cmd == "repeat") {
+    start_repeated_note((uint8_t)sim_arg_int(c, 1), (uint8_t)sim_arg_int(c, 2),
+                        (uint32_t)sim_arg_int(c, 3), (uint16_t)sim_arg_int(c, 4));
+  } else if (cmd == "timer") {
+    midiseq_set_timer_mode(sim_arg_int(c, 1) != 0);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static void report() {
+  MidiSeqJitterStats j;
+  midiseq_get_jitter_stats(&j);
+  sim_trace("stat midiseq events=%u mean_us=%llu max_us=%u overflows=%u underruns=%u",
+            (unsigned)j.events, (unsigned long long)(j.events ? j.total_us / j.events : 0),
+            (unsigned)j.max_us, (unsigned)j.overflows, (unsigned)j.underruns);
+  sim_trace("stat mudp packets=%u messages=%u dropped=%u",
+            (unsigned)midiUDP.getPacketsReceived(), (unsigned)midiUDP.getMessagesReceived(),
+            (unsigned)midiUDP.getPacketsDropped());
+  sim_trace("stat mudp2 lost=%u reordered=%u duplicate=%u late=%u overflows=%u queued=%u",
+            (unsigned)midiUDP.getPacketsLost(), (unsigned)midiUDP.getPacketsReordered(),
+            (unsigned)midiUDP.getPacketsDuplicate(), (unsigned)midiUDP.getMessagesLate(),
+            (unsigned)midiUDP.getBufferOverflows(), (unsigned)midiUDP.getMessagesQueued());
+}
+
+int main(int argc, char** argv) {
+  static const SimTarget target = { "chimes", config, setup, loop, command, report };
+  return sim_main(argc, argv, target);
+}
@@ -0,0 +1,80 @@
+// sim_fakes.h - Scenario-side access to the simulated peripherals (see sim.h)
+//
+// The firmware only sees the Arduino / ESP-IDF calls in fakes/; targets use
+// these to feed input into those peripherals and read their state back.
+#ifndef SIM_FAKES_H
+#define SIM_FAKES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "driver/twai.h"
+
+// ---------- GPIO ----------
+
+// Drive an input pin; runs the attached ISR on a matching edge
+void sim_gpio_set_input(int pin, int level);
+
+// ---------- I2C ----------
+
+class SimI2cDevice {
+public:
+  virtual ~SimI2cDevice() {}
+  virtual void write(const uint8_t* data, size_t len) = 0;
+  virtual void read(uint8_t* data, size_t len) = 0;
+};
+
+// Put a device on the bus; unattached addresses NACK
+void sim_i2c_attach(uint16_t addr, SimI2cDevice* dev);
+
+// MCP23017 with BANK=0 register layout and sequential addressing.
+// All MCP23017s share one open-drain INT line on intPin (IOCON.MIRROR set,
+// as the keyboard wires them); it is low while any chip has a flag pending.
+class SimMcp23017 : public SimI2cDevice {
+public:
+  explicit SimMcp23017(int intPin);
+
+  // Drive pin 0-15 (A0-A7, B0-B7) from outside; keys pull to ground
+  void setPin(int pin, int level);
+  int getPin(int pin) const { return (inputs >> pin) & 1; }
+
+  void write(const uint8_t* data, size_t len) override;
+  void read(uint8_t* data, size_t len) override;
+
+private:
+  uint8_t readReg(uint8_t reg);
+  void updateInt();
+
+  int intPin;
+  uint8_t regs[0x16] = {};
+  uint8_t pointer = 0;
+  uint16_t inputs = 0xFFFF;   // Pulled up, nothing pressed
+};
+
+// ---------- CAN ----------
+
+// A frame from another node arriving now; it occupies the bus for its
+// frame time, then goes through the acceptance filter into the RX queue
+void sim_twai_inject(const twai_message_t& msg);
+
+// "<id> <hex...>" scenario arguments from first on, ID in hex as traced
+// ("can 211 8 01 00 ..." is written back as "can 211 01 00 ...")
+struct SimCmd;
+twai_message_t sim_arg_can(const SimCmd& c, size_t first);
+
+// Frame bits on the wire (no stuff bits) and time at 500 kbit/s
+uint32_t sim_twai_frame_us(const twai_message_t& msg);
+
+// ---------- Network ----------
+
+// A UDP datagram arriving on whatever port the firmware listens on
+void sim_udp_inject(const std::vector<uint8_t>& data);
+
+// ---------- NVS ----------
+
+// Seed a Preferences value before setup(); numbers are stored as integers,
+// "hex:0a0b..." as a byte blob
+void sim_prefs_set(const std::string& ns, const std::string& key, const std::string& value);
+
+#endif // SIM_FAKES_H
@@ -0,0 +1,132 @@
+// sim_keyboard.cpp - Keyboard controller on the simulator (see sim.h)
+//
+// Runs the real key scanner and CAN scheduler against modelled MCP23017s on
+// a shared INT line; the trace shows every CAN frame as it leaves the bus.
+//
+// Build and check against the golden traces (from utilities/sim, see CMakeLists.txt):
+//   cmake -S . -B build && cmake --build build && ctest --test-dir build
+//
+// Scenario commands:
+//   chips <addr...>                      MCP23017s on the bus (default 0x20)
+//   set <namespace> <key> <value>        NVS value before setup(), e.g. set organ hw_id 1
+//   <t> key <addr> <pin> <level>         Drive one input (0 = pressed)
+//   <t> bounce <addr> <pin> <level> <n> <period_us>
+//                                        n contact bounces, then settle at level
+//   <t> storm <seed> <keys> <window_ms>  Random bouncy presses and releases
+//   <t> inject <note> <0|1>              key_scanner_inject_note()
+//   <t> can <id> <hex...>                Frame from another node (ID in hex)
+#include <Arduino.h>
+#include <map>
+#include "sim.h"
+#include "sim_fakes.h"
+#include "pins.h"
+#include "key_scanner.h"
+#include "can_bus.h"
+
+static std::map<uint16_t, SimMcp23017*> chips;
+
+static void add_chip(uint16_t addr) {
+  if (chips.count(addr)) return;
+  SimMcp23017* chip = new SimMcp23017(PIN_I2C_INT);
+  chips[addr] = chip;
+  sim_i2c_attach(addr, chip);
+}
+
+static SimMcp23017* chip_at(const SimCmd& c, size_t i) {
+  auto it = chips.find((uint16_t)sim_arg_int(c, i));
+  if (it == chips.end()) sim_fail("line %d: no chip at %s", c.line, c.args[i].c_str());
+  return it->second;
+}
+
+static bool config(const SimCmd& c) {
+  if (c.args[0] == "chips") {
+    for (size_t i = 1; i < c.args.size(); i++) add_chip((uint16_t)sim_arg_int(c, i));
+    return true;
+  }
+  if (c.args[0] == "set" && c.args.size() == 4) {
+    sim_prefs_set(c.args[1], c.args[2], c.args[3]);
+    return true;
+  }
+  return false;
+}
+
+static void setup() {
+  if (chips.empty()) add_chip(0x20);
+  can_bus_begin();
+  key_scanner_begin();
+}
+
+// Everything runs in the key_scan, key_tx and can_alert tasks
+static void loop() {}
+
+// Toggle the contact n times before it settles at level
+static void bounce(SimMcp23017* chip, int pin, int level, int n, uint64_t periodUs) {
+  uint64_t t = sim_now();
+  for (int i = 0; i < n; i++) {
+    int l = (i % 2 == 0) ? level : !level;
+    sim_at(t, [chip, pin, l]() { chip->setPin(pin, l); });
+    t += periodUs;
+  }
+  sim_at(t, [chip, pin, level]() { chip->setPin(pin, level); });
+}
+
+static bool command(const SimCmd& c) {
+  const std::string& cmd = c.args[0];
+  if (cmd == "key") {
+    chip_at(c, 1)->setPin((int)sim_arg_int(c, 2), (int)sim_arg_int(c, 3));
+  } else if (cmd == "bounce") {
+    bounce(chip_at(c, 1), (int)sim_arg_int(c, 2), (int)sim_arg_int(c, 3),
+           (int)sim_arg_int(c, 4), (uint64_t)sim_arg_int(c, 5));
+  } else if (cmd == "storm") {
+    // Each key goes down with 0-5 bounces 80-400 us apart and comes back
+    // up 20-300 ms later the same way
+    uint32_t seed = (uint32_t)sim_arg_int(c, 1);
+    long keys = sim_arg_int(c, 2);
+    uint64_t windowUs = (uint64_t)sim_arg_int(c, 3) * 1000;
+    std::vector<SimMcp23017*> all;
+    for (auto& kv : chips) all.push_back(kv.second);
+    for (long k = 0; k < keys; k++) {
+      SimMcp23017* chip = all[sim_rand(seed) % all.size()];
+      int pin = (int)(sim_rand(seed) % 16);
+      uint64_t down = sim_now() + sim_rand(seed) % (windowUs ? windowUs : 1);
+      uint64_t up = down + 20000 + sim_rand(seed) % 280000;
+      int n1 = (int)(sim_rand(seed) % 6), n2 = (int)(sim_rand(seed) % 6);
+      uint64_t p1 = 80 + sim_rand(seed) % 320, p2 = 80 + sim_rand(seed) % 320;
+      sim_at(down, [=]() { bounce(chip, pin, 0, n1, p1); });
+      sim_at(up, [=]() { bounce(chip, pin, 1, n2, p2); });
+    }
+  } else if (cmd == "inject") {
+    key_scanner_inject_note((uint8_t)sim_arg_int(c, 1), sim_arg_int(c, 2) != 0);
+  } else if (cmd == "can") {
+    sim_twai_inject(sim_arg_can(c, 1));
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static void report() {
+  KeyScannerStats s;
+  key_scanner_get_stats(&s);
+  sim_trace("stat keys chips=%d transitions=%u bounces=%u reads=%u dropped=%u",
+            key_scanner_chip_count(), (unsigned)s.transitions, (unsigned)s.bouncesRejected,
+            (unsigned)s.chipReads, (unsigned)s.eventsDropped);
+  sim_trace("stat frames change=%u keepalive=%u tx_failed=%u",
+            (unsigned)s.changeFrames, (unsigned)s.keepaliveFrames, (unsigned)s.txFailed);
+
+  KeyLatency l;
+  key_scanner_get_latency(&l);
+  sim_trace("stat latency samples=%u p50_us=%u p90_us=%u p99_us=%u max_us=%u",
+            (unsigned)l.samples, (unsigned)l.p50Us, (unsigned)l.p90Us, (unsigned)l.p99Us, (unsigned)l.maxUs);
+
+  CanTxStats t;
+  can_bus_get_stats(&t);
+  sim_trace("stat can queued=%u coalesced=%u dropped=%u echo=%u high_water=%u",
+            (unsigned)t.framesQueued, (unsigned)t.coalesced, (unsigned)t.dropped,
+            (unsigned)t.echoReplies, (unsigned)t.queueHighWater);
+}
+
+int main(int argc, char** argv) {
+  static const SimTarget target = { "keyboard", config, setup, loop, command, report };
+  return sim_main(argc, argv, target);
+}
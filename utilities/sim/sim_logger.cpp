@@ -0,0 +1,34 @@
+// sim_logger.cpp - UnifiedLogger for the simulator; output goes to sim_log_write (-v)
+// Built in place of <project>/src/logger.cpp; logger.h is identical in every project.
+// LOG_DEBUG and friends are formatted at the call, so they land in order with
+// Log.printf; build with -DLOG_LEVEL=0 to see the debug lines.
+#include "logger.h"
+#include "sim.h"
+
+UnifiedLogger Log;
+
+size_t UnifiedLogger::write(uint8_t c) {
+  sim_log_write(&c, 1);
+  return 1;
+}
+
+size_t UnifiedLogger::write(const uint8_t* buffer, size_t size) {
+  sim_log_write(buffer, size);
+  return size;
+}
+
+void UnifiedLogger::serveTelnet(WiFiServer& server) {
+}
+
+uint32_t UnifiedLogger::telnetDropped() {
+  return 0;
+}
+
+void logger_push(const char* fmt, const LogArgs& args) {
+  char line[256];
+  size_t n = logger_format(line, sizeof(line), fmt, args.w, args.n);
+  sim_log_write((const uint8_t*)line, n);
+}
+
+void logger_begin() {
+}
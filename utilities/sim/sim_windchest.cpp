@@ -0,0 +1,98 @@
+// sim_windchest.cpp - Windchest controller on the simulator (see sim.h)
+//
+// Runs the real MIDI/UDP receiver, CAN DIV_STATE receiver, note mapping and
+// shift-register output; the trace shows every latch of the output chain
+// (bytes in shift order, last byte of the chain first) and every CAN frame
+// the windchest sends.
+//
+// Build and check against the golden traces (from utilities/sim, see CMakeLists.txt):
+//   cmake -S . -B build && cmake --build build && ctest --test-dir build
+//
+// Scenario commands:
+//   set <namespace> <key> <value>    NVS value before setup(), e.g. set windchest flush_us 500
+//   <t> mudp <hex...>                MUDP packet arrives
+//   <t> midi <status> <d1> <d2>      handle_midi_message() (hex bytes)
+//   <t> can <id> <hex...>            Frame from a keyboard (ID in hex, as sim_keyboard traces it)
+#include <Arduino.h>
+#include "sim.h"
+#include "sim_fakes.h"
+#include "pins.h"
+#include "config.h"
+#include "output.h"
+#include "midinote.h"
+#include "midihandler.h"
+#include "midiudp.h"
+#include "canreceiver.h"
+
+static bool config(const SimCmd& c) {
+  if (c.args[0] == "set" && c.args.size() == 4) {
+    sim_prefs_set(c.args[1], c.args[2], c.args[3]);
+    return true;
+  }
+  return false;
+}
+
+// Same order as windchest_controller/src/main.cpp, without the network services
+static void setup() {
+  config_begin();
+
+  digitalWrite(PIN_MOSI,  LOW);
+  digitalWrite(PIN_SCK,   LOW);
+  digitalWrite(PIN_LATCH, LOW);
+  digitalWrite(PIN_OE_N,  LOW);
+  digitalWrite(PIN_CLR_N, HIGH);
+
+  output_begin();
+  midinote_begin();
+  midiUDP.begin();
+  canReceiver.begin();
+
+  clearAll();
+  flushOutput();
+}
+
+static void loop() {
+  midiUDP.update();
+  canReceiver.update();
+  output_service();
+}
+
+static bool command(const SimCmd& c) {
+  const std::string& cmd = c.args[0];
+  if (cmd == "mudp") {
+    sim_udp_inject(sim_arg_bytes(c, 1));
+  } else if (cmd == "midi") {
+    std::vector<uint8_t> b = sim_arg_bytes(c, 1);
+    if (b.size() != 3) sim_fail("line %d: midi needs 3 bytes", c.line);
+    handle_midi_message(b[0], b[1], b[2]);
+  } else if (cmd == "can") {
+    sim_twai_inject(sim_arg_can(c, 1));
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static void report() {
+  OutputStats o;
+  output_get_stats(&o);
+  sim_trace("stat output flushes=%u skipped=%u coalesced=%u bytes=%u max_delay_us=%u",
+            (unsigned)o.flushes, (unsigned)o.skipped, (unsigned)o.coalesced,
+            (unsigned)o.bytes_shifted, (unsigned)o.max_delay_us);
+  sim_trace("stat can frames=%u ignored=%u merges=%u timeouts=%u echo=%u live=%d",
+            (unsigned)canReceiver.getFramesReceived(), (unsigned)canReceiver.getFramesIgnored(),
+            (unsigned)canReceiver.getMerges(), (unsigned)canReceiver.getSourcesTimedOut(),
+            (unsigned)canReceiver.getEchoReplies(), canReceiver.getLiveSources());
+  sim_trace("stat mudp packets=%u messages=%u dropped=%u",
+            (unsigned)midiUDP.getPacketsReceived(), (unsigned)midiUDP.getMessagesReceived(),
+            (unsigned)midiUDP.getPacketsDropped());
+  sim_trace("stat mudp2 lost=%u reordered=%u duplicate=%u late=%u overflows=%u queued=%u",
+            (unsigned)midiUDP.getPacketsLost(), (unsigned)midiUDP.getPacketsReordered(),
+            (unsigned)midiUDP.getPacketsDuplicate(), (unsigned)midiUDP.getMessagesLate(),
+            (unsigned)midiUDP.getBufferOverflows(), (unsigned)midiUDP.getMessagesQueued());
+}
+
+int main(int argc, char** argv) {
+  static const SimTarget target = { "windchest", config, setup, loop, command, report };
+  return sim_main(argc, argv, target);
+}
@@ -373,6 +373,17 @@ Response: {
         <div class="example">Example: /note_off?note=60</div>
     </div>
 
+    <div class="endpoint">
+        <span class="method post">POST</span>
+        <span class="path">/mudp/delay</span>
+        <div class="description">Set the MUDP-v2 playout delay: how long after its sender time a timed UDP message is played (docs/MIDIUDP.md). Longer rides out worse WiFi at the cost of latency. Saved to NVS; loss, reordering and late messages are on /status under midiUdp.</div>
+        <div class="params">
+            <strong>Parameters:</strong><br>
+            <span class="param">ms</span> - Delay in milliseconds (0-500, default 30)
+        </div>
+        <div class="example">Example: /mudp/delay?ms=40</div>
+    </div>
+
     <div class="endpoint">
         <span class="method get">GET</span>
         <span class="path">/all_off</span>
@@ -596,8 +607,37 @@ Response: {"success":true,"message":"Playback started"}
     <div class="endpoint">
         <span class="method get">GET</span>
         <span class="path">/logs/poll</span>
-        <div class="description">Poll for new log entries (used by /logs page)</div>
-        <div class="example">Example: /logs/poll</div>
+        <div class="description">New log lines as JSON; pass the returned index as since on the next poll</div>
+        <div class="example">Example: /logs/poll?since=0</div>
+    </div>
+
+    <div class="endpoint">
+        <span class="method get">GET</span>
+        <span class="path">/logs/stream</span>
+        <div class="description">Server-Sent Events stream of the log (used by /logs page): the lines still buffered, then new lines as they are logged. Reconnect with since set to the last event id.</div>
+        <div class="example">Example: curl -N /logs/stream?since=0</div>
+    </div>
+
+    <div class="endpoint">
+        <span class="method post">POST</span>
+        <span class="path">/bench</span>
+        <div class="description">Run the note-path microbenchmarks and return a plain-text table of cycles per call, per MIDI message and per input byte. Outputs are disabled while it runs and restored afterwards; the bench notes show up in the log. Refused with 409 while any output is on, so run it with the organ idle.</div>
+        <div class="params">
+            <strong>Parameters:</strong><br>
+            <span class="param">budget</span> - (optional) CPU cycles per timed run, 10000-240000000 (default 2400000 = 10 ms)
+        </div>
+        <div class="example">Example: /bench?budget=2400000</div>
+    </div>
+
+    <div class="endpoint">
+        <span class="method get">GET</span>
+        <span class="path">/trace</span>
+        <div class="description">Note latency trace as Chrome trace JSON (open in chrome://tracing or ui.perfetto.dev): one mark per pipeline stage (rx, parse, handler, mapping, output, latch) on a track per core, and one span per note from input to actuator edge. Only in builds with -DNOTE_TRACE, which also adds p50/p99/max latency per stage to /status as "trace".</div>
+        <div class="params">
+            <strong>Parameters:</strong><br>
+            <span class="param">clear</span> - (optional) 1 = empty the trace after sending it
+        </div>
+        <div class="example">Example: /trace?clear=1</div>
     </div>
 
     <hr>
@@ -0,0 +1,69 @@
+// bench.h - Cycle-count microbenchmarks for the note path
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <Arduino.h>
+#include "esp_cpu.h"
+
+// One benchmark: fn(iters) performs the operation iters times. msgs and
+// bytes say how many MIDI messages and input bytes one operation handles,
+// so results come out per message and per byte as well as per call.
+//
+// The same cases run on the target (CCOUNT, 240 MHz core cycles) and on
+// the host under utilities/bench (time-stamp counter ticks), so only
+// compare numbers taken on the same machine.
+struct BenchCase {
+  const char* name;
+  void (*fn)(uint32_t iters);
+  uint16_t msgs;
+  uint16_t bytes;
+};
+
+struct BenchResult {
+  const char* name;
+  uint32_t iters;
+  float cyclesPerOp;
+  float cyclesPerMsg;
+  float cyclesPerByte;   // 0 when the case reads no input bytes
+};
+
+#define BENCH_REPEATS 3
+
+// Double the iteration count until one run takes at least budgetCycles,
+// then keep the fastest of BENCH_REPEATS runs at that count
+static inline BenchResult bench_run(const BenchCase& c, uint32_t budgetCycles) {
+  uint32_t iters = 1;
+  uint32_t cycles;
+  for (;;) {
+    uint32_t start = esp_cpu_get_cycle_count();
+    c.fn(iters);
+    cycles = esp_cpu_get_cycle_count() - start;
+    if (cycles >= budgetCycles || iters >= (1u << 24)) break;
+    iters *= 2;
+  }
+  for (int r = 1; r < BENCH_REPEATS; r++) {
+    uint32_t start = esp_cpu_get_cycle_count();
+    c.fn(iters);
+    uint32_t run = esp_cpu_get_cycle_count() - start;
+    if (run < cycles) cycles = run;
+  }
+
+  BenchResult res;
+  res.name = c.name;
+  res.iters = iters;
+  res.cyclesPerOp = (float)cycles / iters;
+  res.cyclesPerMsg = c.msgs ? res.cyclesPerOp / c.msgs : 0;
+  res.cyclesPerByte = c.bytes ? res.cyclesPerOp / c.bytes : 0;
+  return res;
+}
+
+static inline void bench_print_header(Print& out) {
+  out.printf("%-36s %10s %12s %12s %12s\n", "benchmark", "iters", "cycles/op", "cycles/msg", "cycles/byte");
+}
+
+static inline void bench_print(Print& out, const BenchResult& r) {
+  out.printf("%-36s %10u %12.1f %12.1f %12.2f\n",
+             r.name, (unsigned)r.iters, r.cyclesPerOp, r.cyclesPerMsg, r.cyclesPerByte);
+}
+
+#endif // BENCH_H
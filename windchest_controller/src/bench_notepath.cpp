@@ -0,0 +1,106 @@
+#include "bench_notepath.h"
+#include "config.h"
+#include "output.h"
+#include "midihandler.h"
+#include "pins.h"
+
+// Chosen by bench_notepath_begin() so the cases never touch a sounding pipe
+static uint8_t benchNote = 60;
+static int benchOutput = 0;
+static volatile int benchSink;
+
+// Note on then note off on channel 1: channel map lookup, setChannel()
+// and the flush request, without the latch itself
+static void bench_handle_on_off(uint32_t iters) {
+  for (uint32_t i = 0; i < iters; i++) {
+    handle_midi_message(0x90, benchNote, 100);
+    handle_midi_message(0x80, benchNote, 0);
+  }
+}
+
+// The whole channel-1 map, one note at a time
+static void bench_note_to_output(uint32_t iters) {
+  int sum = 0;
+  for (uint32_t i = 0; i < iters; i++) {
+    for (int n = 0; n < 128; n++) sum += config_note_to_output(0, (uint8_t)n);
+  }
+  benchSink = sum;
+}
+
+// Two real shifts per iteration: set one output, latch, clear it, latch
+static void bench_flush_latch(uint32_t iters) {
+  for (uint32_t i = 0; i < iters; i++) {
+    setChannel(benchOutput, true);
+    flushOutput();
+    setChannel(benchOutput, false);
+    flushOutput();
+  }
+  output_wait_idle();
+}
+
+// The shadow compare when nothing changed
+static void bench_flush_unchanged(uint32_t iters) {
+  for (uint32_t i = 0; i < iters; i++) flushOutput();
+}
+
+// bench_notepath_begin() fills in the chain bytes for the latch case
+BenchCase BENCH_NOTEPATH_CASES[] = {
+  { "handle_midi_message/on_off",     bench_handle_on_off,   2, 6 },
+  { "config_note_to_output/128",      bench_note_to_output,  128, 128 },
+  { "flushOutput/latch",              bench_flush_latch,     2, 0 },
+  { "flushOutput/unchanged",          bench_flush_unchanged, 1, 0 },
+};
+#define BENCH_LATCH_CASE 2
+static_assert(sizeof(BENCH_NOTEPATH_CASES) / sizeof(BENCH_NOTEPATH_CASES[0]) == BENCH_NOTEPATH_COUNT,
+              "BENCH_NOTEPATH_COUNT does not match the cases");
+
+bool bench_notepath_idle() {
+  for (int i = 0; i < config_num_outputs(); i++) {
+    if (getChannel(i)) return false;
+  }
+  return true;
+}
+
+void bench_notepath_begin() {
+  // Both latches of a latch case shift the active slice of the chain
+  BENCH_NOTEPATH_CASES[BENCH_LATCH_CASE].bytes = (uint16_t)(2 * ((config_num_outputs() + 7) / 8));
+
+  // Latch anything pending first so the cases start from a settled chain
+  flushOutput();
+  output_wait_idle();
+  digitalWrite(PIN_OE_N, HIGH);   // /OE HIGH = outputs disabled
+
+  benchNote = 60;
+  benchOutput = config_num_outputs() - 1;
+  for (int n = 0; n < 128; n++) {
+    int out = config_note_to_output(0, (uint8_t)n);
+    if (out >= 0 && !getChannel(out)) {
+      benchNote = (uint8_t)n;
+      benchOutput = out;
+      break;
+    }
+  }
+}
+
+void bench_notepath_end() {
+  // Every case leaves outBuf as it found it; shift it so the chain matches
+  // before the outputs come back
+  output_service();
+  flushOutput();
+  output_wait_idle();
+  digitalWrite(PIN_OE_N, LOW);    // /OE LOW = outputs enabled
+}
+
+void bench_notepath_measure(BenchResult* res, uint32_t budgetCycles) {
+  bench_notepath_begin();
+  for (int i = 0; i < BENCH_NOTEPATH_COUNT; i++) {
+    res[i] = bench_run(BENCH_NOTEPATH_CASES[i], budgetCycles);
+  }
+  bench_notepath_end();
+}
+
+void bench_notepath_print(Print& out, const BenchResult* res) {
+  out.printf("outputs: %d, bench note: %d -> output %d\n", config_num_outputs(), benchNote, benchOutput);
+  bench_print_header(out);
+  for (int i = 0; i < BENCH_NOTEPATH_COUNT; i++) bench_print(out, res[i]);
+}
@@ -0,0 +1,28 @@
+// bench_notepath.h - Microbenchmarks for the windchest note path
+#ifndef BENCH_NOTEPATH_H
+#define BENCH_NOTEPATH_H
+
+#include <Arduino.h>
+#include "bench.h"
+
+// Cases that are safe to run on a live windchest: /OE is held HIGH while
+// they run and every output is back where it was afterwards. Disabling
+// /OE silences every pipe, so only run them while bench_notepath_idle().
+#define BENCH_NOTEPATH_COUNT 4
+extern BenchCase BENCH_NOTEPATH_CASES[];
+
+// True when no output is on, i.e. no pipe would be cut off by the bench
+bool bench_notepath_idle();
+
+// Pick an idle mapped note, set the chain length into the latch case and
+// disable the outputs. bench_notepath_end() re-latches the real state and
+// enables them again.
+void bench_notepath_begin();
+void bench_notepath_end();
+
+// Run every case with the given per-run budget into res[BENCH_NOTEPATH_COUNT]
+// (loop task), then print the results table from any task
+void bench_notepath_measure(BenchResult* res, uint32_t budgetCycles);
+void bench_notepath_print(Print& out, const BenchResult* res);
+
+#endif // BENCH_NOTEPATH_H
@@ -0,0 +1,198 @@
+#include "canreceiver.h"
+#include "config.h"
+#include "pins.h"
+#include "logger.h"
+#include "notetrace.h"
+#include "driver/twai.h"
+#include "esp_timer.h"
+
+// Global instance
+CANReceiver canReceiver;
+
+// Guards the table shared between the receive task and update()
+static portMUX_TYPE tableMux = portMUX_INITIALIZER_UNLOCKED;
+
+void CANReceiver::begin() {
+    memset(bitmaps, 0, sizeof(bitmaps));
+    memset(lastSeenMs, 0, sizeof(lastSeenMs));
+    memset(liveSources, 0, sizeof(liveSources));
+    memset(prevClaim, 0, sizeof(prevClaim));
+
+    twai_general_config_t g_config = TWAI_GENERAL_CONFIG_DEFAULT(
+        (gpio_num_t)PIN_CAN_TX,
+        (gpio_num_t)PIN_CAN_RX,
+        TWAI_MODE_NORMAL    // Normal mode so received frames are acknowledged
+    );
+    g_config.tx_queue_len = 4;  // ECHO_REPLY only
+    g_config.rx_queue_len = 32;
+
+    // Dual filter: filter 1 (bits 31-16) accepts DIV_STATE, any ID with bits
+    // 10-8 = 010; filter 2 (bits 15-0) accepts ECHO_REQ exactly
+    twai_filter_config_t f_config = {};
+    f_config.acceptance_code = ((MSG_DIV_STATE << 8) << 21) | (ID_ECHO_REQ << 5);
+    f_config.acceptance_mask = (0xFFu << 21) | (0x1Fu << 16) | 0x1Fu;
+    f_config.single_filter = false;
+
+    node = 0x40 | (uint8_t)(ESP.getEfuseMac() & 0x3F);
+
+    twai_timing_config_t t_config = TWAI_TIMING_CONFIG_500KBITS();
+
+    esp_err_t err = twai_driver_install(&g_config, &t_config, &f_config);
+    if (err != ESP_OK) {
+        Log.printf("CAN: driver install failed (%d)\n", err);
+        return;
+    }
+    err = twai_start();
+    if (err != ESP_OK) {
+        Log.printf("CAN: start failed (%d)\n", err);
+        return;
+    }
+
+    // Core 0 keeps the receive path off the loop() core
+    xTaskCreatePinnedToCore(rxTask, "can_rx", 3072, this, 5, nullptr, 0);
+    running = true;
+    Log.printf("CAN: receiving DIV_STATE at 500 kbit/s (TX=GPIO%d, RX=GPIO%d, node 0x%02X)\n",
+               PIN_CAN_TX, PIN_CAN_RX, node);
+}
+
+void CANReceiver::rxTask(void* arg) {
+    CANReceiver* self = (CANReceiver*)arg;
+    twai_message_t msg;
+    for (;;) {
+        if (twai_receive(&msg, portMAX_DELAY) != ESP_OK) continue;
+        NOTE_MARK(NT_RX, NT_NO_NOTE);
+        if (msg.extd || msg.rtr) {
+            self->framesIgnored++;
+            continue;
+        }
+        if (msg.identifier == ID_ECHO_REQ) {
+            self->answerEcho(msg.data, msg.data_length_code);
+            continue;
+        }
+        self->handleFrame(msg.identifier, msg.data, msg.data_length_code);
+    }
+}
+
+// Reply straight from the receive task (see can-protocol.md, Diagnostics)
+void CANReceiver::answerEcho(const uint8_t* data, uint8_t len) {
+    uint32_t rxUs = (uint32_t)esp_timer_get_time();
+    if (len != 8 || (data[6] != 0xFF && data[6] != node)) return;
+
+    twai_message_t reply = {};
+    reply.identifier = ID_ECHO_REPLY | node;
+    reply.data_length_code = 8;
+    memcpy(reply.data, data, 6);
+    uint32_t held = (uint32_t)esp_timer_get_time() - rxUs;
+    if (held > 0xFFFF) held = 0xFFFF;
+    reply.data[6] = held & 0xFF;
+    reply.data[7] = held >> 8;
+    if (twai_transmit(&reply, 0) == ESP_OK) echoReplies++;
+}
+
+void CANReceiver::handleFrame(uint32_t id, const uint8_t* data, uint8_t len) {
+    if ((id >> 8) != MSG_DIV_STATE || len != 8) {
+        framesIgnored++;
+        return;
+    }
+    uint8_t division = (id >> 4) & 0x0F;
+    uint8_t source = id & 0x0F;
+
+    uint64_t bitmap = 0;
+    for (int i = 7; i >= 0; i--) {
+        bitmap = (bitmap << 8) | data[i];
+    }
+
+    // Every frame is authoritative, so keepalives also re-assert the outputs
+    portENTER_CRITICAL(&tableMux);
+    bitmaps[division][source] = bitmap;
+    lastSeenMs[division][source] = millis();
+    liveSources[division] |= (uint16_t)(1u << source);
+    changed = true;
+    portEXIT_CRITICAL(&tableMux);
+    framesReceived++;
+    NOTE_MARK(NT_PARSE, NT_NO_NOTE);
+}
+
+// Drop sources whose keyboard has stopped sending (called under tableMux)
+void CANReceiver::expireSources(uint32_t now) {
+    for (int d = 0; d < DIVISIONS; d++) {
+        uint16_t live = liveSources[d];
+        while (live) {
+            int s = __builtin_ctz(live);
+            live &= live - 1;
+            if (now - lastSeenMs[d][s] > SOURCE_TIMEOUT_MS) {
+                liveSources[d] &= (uint16_t)~(1u << s);
+                bitmaps[d][s] = 0;
+                sourcesTimedOut++;
+                changed = true;
+            }
+        }
+    }
+}
+
+int CANReceiver::getLiveSources() const {
+    int n = 0;
+    for (int d = 0; d < DIVISIONS; d++) {
+        n += __builtin_popcount(liveSources[d]);
+    }
+    return n;
+}
+
+void CANReceiver::update() {
+    if (!running) return;
+
+    // effective_division = OR(all live sources), taken as one consistent snapshot
+    uint64_t effective[DIVISIONS];
+    uint16_t liveDivisions = 0;
+    portENTER_CRITICAL(&tableMux);
+    expireSources(millis());
+    bool dirty = changed;
+    changed = false;
+    if (dirty) {
+        for (int d = 0; d < DIVISIONS; d++) {
+            uint64_t e = 0;
+            for (int s = 0; s < SOURCES; s++) e |= bitmaps[d][s];
+            effective[d] = e;
+            if (liveSources[d]) liveDivisions |= (uint16_t)(1u << d);
+        }
+    }
+    portEXIT_CRITICAL(&tableMux);
+    if (!dirty) return;
+
+    // Map every live division onto the output bits in one pass over its note map.
+    // claim marks the outputs CAN owns; want holds their new state.
+    const Config& cfg = config_get();
+    int numOutputs = cfg.num_outputs;
+    uint8_t want[MAX_OUTPUT_BYTES] = {};
+    uint8_t claim[MAX_OUTPUT_BYTES] = {};
+    while (liveDivisions) {
+        int d = __builtin_ctz(liveDivisions);
+        liveDivisions &= liveDivisions - 1;
+        if (d >= MIDI_CHANNELS || !cfg.midi[d].enabled) continue;  // Stop off
+
+        const int8_t* map = &cfg.midi[d].note_to_output[BASE_NOTE];
+        uint64_t e = effective[d];
+        for (int n = 0; n < 64; n++) {
+            int out = map[n];
+            if (out < 0 || out >= numOutputs) continue;
+            uint8_t mask = (uint8_t)(1u << (out & 7));
+            claim[out >> 3] |= mask;
+            if ((e >> n) & 1) want[out >> 3] |= mask;
+        }
+    }
+
+    // Outputs claimed last time but not now (source expired, stop drawn off)
+    // are released as well
+    uint8_t mask[MAX_OUTPUT_BYTES];
+    for (int i = 0; i < MAX_OUTPUT_BYTES; i++) {
+        mask[i] = claim[i] | prevClaim[i];
+        prevClaim[i] = claim[i];
+    }
+
+    merges++;
+    NOTE_MARK(NT_MAPPING, NT_NO_NOTE);
+    if (output_merge(want, mask)) {
+        output_request_flush();
+        NOTE_MARK(NT_OUTPUT, NT_NO_NOTE);
+    }
+}
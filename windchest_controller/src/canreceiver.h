@@ -0,0 +1,91 @@
+#ifndef CANRECEIVER_H
+#define CANRECEIVER_H
+
+#include <Arduino.h>
+#include "output.h"
+
+/**
+ * CAN division-state receiver (DIV_STATE, see docs/can-protocol.md)
+ *
+ * Keyboard controllers broadcast the full key state of each (division, source)
+ * pair as a 64-bit bitmap. A TWAI receive task keeps the latest bitmap per
+ * pair; update() ORs the live sources of each division together, ANDs with the
+ * division's stop state (the MIDI channel "enabled" flag in Config) and maps
+ * the result through the channel's note map onto the output bits.
+ *
+ * Outputs reachable from a division with at least one live source are owned
+ * by CAN; all other outputs are left to the MIDI/UDP inputs. A source that
+ * stops sending (no keepalive for SOURCE_TIMEOUT_MS) is dropped, which
+ * releases its notes.
+ *
+ * ECHO_REQ diagnostics are answered from the receive task with this
+ * controller's node number (0x40 + low 6 bits of the MAC).
+ */
+class CANReceiver {
+public:
+    static const uint8_t DIVISIONS = 16;  // 4-bit division field
+    static const uint8_t SOURCES = 16;    // 4-bit source field
+
+    /**
+     * Install the TWAI driver and start the receive task
+     */
+    void begin();
+
+    /**
+     * Apply received state to the outputs
+     * Call from main loop, before output_service()
+     */
+    void update();
+
+    bool isRunning() const { return running; }
+
+    /**
+     * Get statistics
+     */
+    uint32_t getFramesReceived() const { return framesReceived; }
+    uint32_t getFramesIgnored() const { return framesIgnored; }
+    uint32_t getSourcesTimedOut() const { return sourcesTimedOut; }
+    uint32_t getMerges() const { return merges; }
+    uint32_t getEchoReplies() const { return echoReplies; }
+
+    /**
+     * Number of (division, source) pairs currently live
+     */
+    int getLiveSources() const;
+
+private:
+    static void rxTask(void* arg);
+    void handleFrame(uint32_t id, const uint8_t* data, uint8_t len);
+    void expireSources(uint32_t now);
+    void answerEcho(const uint8_t* data, uint8_t len);
+
+    bool running = false;
+    uint8_t node = 0;  // ECHO_REPLY node number
+
+    // Written by the receive task, read by update() under lock
+    uint64_t bitmaps[DIVISIONS][SOURCES];
+    uint32_t lastSeenMs[DIVISIONS][SOURCES];
+    uint16_t liveSources[DIVISIONS];  // Bit s = source s has sent within the timeout
+    bool changed = false;
+
+    // Outputs claimed by the previous merge, released if no longer claimed
+    uint8_t prevClaim[MAX_OUTPUT_BYTES];
+
+    // Statistics
+    uint32_t framesReceived = 0;
+    uint32_t framesIgnored = 0;
+    uint32_t sourcesTimedOut = 0;
+    uint32_t merges = 0;
+    uint32_t echoReplies = 0;
+
+    static const uint32_t SOURCE_TIMEOUT_MS = 1000;  // Four missed keepalives
+    static const uint32_t MSG_DIV_STATE = 0x2;
+    static const uint32_t ID_ECHO_REQ = 0x700;
+    static const uint32_t ID_ECHO_REPLY = 0x780;     // | node
+    static const uint8_t BASE_NOTE = 36;             // MIDI note of bitmap bit 0
+};
+
+// Global instance
+extern CANReceiver canReceiver;
+
+#endif // CANRECEIVER_H
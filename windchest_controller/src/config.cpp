@@ -9,6 +9,7 @@ static Preferences prefs;
 // Only MIDI channel 0 enabled by default.
 static void set_defaults() {
     g_config.num_outputs = 56;  // 7 × 8 bits
+    g_config.flush_window_us = 0;
     for (int ch = 0; ch < MIDI_CHANNELS; ch++) {
         g_config.midi[ch].enabled = (ch == 0);
         for (int n = 0; n < 128; n++) {
@@ -27,6 +28,9 @@ void config_begin() {
     if (prefs.isKey("num_out")) {
         g_config.num_outputs = prefs.getUChar("num_out", 56);
     }
+    if (prefs.isKey("flush_us")) {
+        g_config.flush_window_us = prefs.getUShort("flush_us", 0);
+    }
 
     for (int ch = 0; ch < MIDI_CHANNELS; ch++) {
         char key[12];
@@ -52,6 +56,7 @@ void config_begin() {
 void config_save() {
     prefs.begin("windchest", /*readOnly=*/false);
     prefs.putUChar("num_out", g_config.num_outputs);
+    prefs.putUShort("flush_us", g_config.flush_window_us);
     for (int ch = 0; ch < MIDI_CHANNELS; ch++) {
         char key[12];
         snprintf(key, sizeof(key), "ch%d_en", ch);
@@ -69,6 +74,12 @@ void config_save_num_outputs() {
     prefs.end();
 }
 
+void config_save_flush_window() {
+    prefs.begin("windchest", false);
+    prefs.putUShort("flush_us", g_config.flush_window_us);
+    prefs.end();
+}
+
 void config_save_channel(uint8_t ch) {
     if (ch >= MIDI_CHANNELS) return;
     prefs.begin("windchest", false);
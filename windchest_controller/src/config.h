@@ -16,6 +16,7 @@ struct MidiChannelMap {
 // Full runtime configuration (lives in RAM, backed by NVS)
 struct Config {
     uint8_t        num_outputs;           // how many shift-register bits are active
+    uint16_t       flush_window_us;       // output coalescing window; 0 = once per receive batch
     MidiChannelMap midi[MIDI_CHANNELS];   // per-channel note → output mapping
 };
 
@@ -30,6 +31,9 @@ void config_save();
 /** Persist only num_outputs to NVS. */
 void config_save_num_outputs();
 
+/** Persist only flush_window_us to NVS. */
+void config_save_flush_window();
+
 /** Persist one MIDI channel's config to NVS. */
 void config_save_channel(uint8_t ch);
 
@@ -4,275 +4,227 @@
 #include <WebServer.h>
 #include "output.h"
 #include "midinote.h"
-#include "keyboard.h"
 #include "midiudp.h"
+#include "canreceiver.h"
 #include "midireceiver.h"
 #include "midihandler.h"
 #include "config.h"
-#include "config_page.h"
-#include "play_page.h"
-#include "api_docs.h"
-#include "settings_page.h"
+#include "web_assets.h"
 #include "pins.h"
+#include "bench_notepath.h"
+#include "notetrace.h"
+#include "httpstream.h"
+#include "logstream.h"
 
 static WebServer server(80);
 
-// ---------- Simple Circular Log Buffer ----------
-#define LOG_BUFFER_SIZE 100
-static String logBuffer[LOG_BUFFER_SIZE];
-static int logIndex = 0;
-static int logCount = 0;
-static int logTotalCount = 0; // Monotonically increasing counter
-static bool httpLoggingEnabled = true; // Only enable when logs requested
-static String pendingLogLine = ""; // Accumulator for incomplete lines
+// ---------- Log ring ----------
+// Everything logged, in a fixed-size ring streamed to /logs (logstream.h)
+static LogStream logStream;
 
 void httpserver_log(const uint8_t* buffer, size_t size) {
-  if (!httpLoggingEnabled) return; // Skip all String building if disabled
-  
-  // Build String from buffer, accumulating partial lines
-  for (size_t i = 0; i < size; i++) {
-    char c = buffer[i];
-    if (c == '\n') {
-      if (pendingLogLine.length() > 0) {
-        // Store complete line in buffer
-        logBuffer[logIndex] = pendingLogLine;
-        logIndex = (logIndex + 1) % LOG_BUFFER_SIZE;
-        if (logCount < LOG_BUFFER_SIZE) logCount++;
-        logTotalCount++;
-        pendingLogLine = "";
-      }
-    } else if (c != '\r') {
-      pendingLogLine += c;
-    }
-  }
+  logStream.write(buffer, size);
 }
 
 // Legacy C-string interface (for compatibility)
 void httpserver_log(const char* message) {
-  if (!httpLoggingEnabled) return;
-  
-  logBuffer[logIndex] = String(message);
-  logIndex = (logIndex + 1) % LOG_BUFFER_SIZE;
-  if (logCount < LOG_BUFFER_SIZE) logCount++;
-  logTotalCount++;
-}
-
-String httpserver_get_logs() {
-  String result = "";
-  int start = (logCount < LOG_BUFFER_SIZE) ? 0 : logIndex;
-  for (int i = 0; i < logCount; i++) {
-    int idx = (start + i) % LOG_BUFFER_SIZE;
-    result += logBuffer[idx] + "\n";
-  }
-  return result;
+  logStream.write((const uint8_t*)message, strlen(message));
+  logStream.write((const uint8_t*)"\n", 1);
 }
 
-String httpserver_get_logs_since(int sinceTotal) {
-  String result = "";
-  
-  // If asking for logs before our buffer, or invalid, return all
-  if (sinceTotal < 0) {
-    return httpserver_get_logs();
-  }
-  
-  // Calculate how many new logs since the requested point
-  int newCount = logTotalCount - sinceTotal;
-  
-  // If no new logs, return empty
-  if (newCount <= 0) {
-    return "";
-  }
-  
-  // If asking for more logs than we have buffered, return all
-  if (newCount > logCount) {
-    return httpserver_get_logs();
-  }
-  
-  // Calculate starting position in circular buffer
-  int start = (logIndex - newCount + LOG_BUFFER_SIZE) % LOG_BUFFER_SIZE;
-  for (int i = 0; i < newCount; i++) {
-    int idx = (start + i) % LOG_BUFFER_SIZE;
-    result += logBuffer[idx] + "\n";
-  }
-  return result;
+// ---------- Server task and loop calls ----------
+// The server runs in its own task on core 0, so a slow client never holds
+// up MIDI, UDP and CAN input or the outputs on the loop task. Pages, status
+// and the config reads and saves are handled in the server task. Anything
+// that drives the outputs or changes what the loop reads goes through
+// runOnLoop(): the call is queued, httpserver_loop() runs it on the loop
+// task between updates, and the handler waits for it before answering.
+#define HTTP_TASK_STACK    8192
+#define HTTP_TASK_PRIORITY 1
+#define HTTP_TASK_CORE     0
+#define LOOP_QUEUE_LEN     4
+
+// Arguments and result of one loop call, on the handler's stack
+struct LoopCall {
+  int32_t a, b, c, d;
+  const void* p;
+  bool ok;
+};
+
+struct LoopCmd {
+  void (*fn)(LoopCall& call);
+  LoopCall* call;
+};
+
+static QueueHandle_t loopQueue = nullptr;
+static SemaphoreHandle_t loopDone = nullptr;   // Only the server task waits on it
+
+static bool runOnLoop(void (*fn)(LoopCall& call), LoopCall& call) {
+  LoopCmd cmd = { fn, &call };
+  xQueueSend(loopQueue, &cmd, portMAX_DELAY);
+  xSemaphoreTake(loopDone, portMAX_DELAY);
+  return call.ok;
+}
+
+static bool runOnLoop(void (*fn)(LoopCall& call), int32_t a = 0, int32_t b = 0, int32_t c = 0) {
+  LoopCall call = { a, b, c, 0, nullptr, false };
+  return runOnLoop(fn, call);
 }
 
-int httpserver_get_log_index() {
-  return logTotalCount;
+static void httpTask(void* arg) {
+  for (;;) {
+    server.handleClient();
+    logStream.pump();
+    vTaskDelay(1);
+  }
 }
 
 // Handler for GET /channels
 static void handleChannels() {
-  String html = "<!DOCTYPE html><html><head>";
-  html += "<meta name='viewport' content='width=device-width, initial-scale=1'>";
-  html += "<style>";
-  html += "body { font-family: Arial, sans-serif; margin: 20px; background: #f0f0f0; }";
-  html += "h1 { color: #333; }";
-  html += ".container { max-width: 600px; margin: 0 auto; background: white; padding: 20px; border-radius: 10px; box-shadow: 0 2px 5px rgba(0,0,0,0.1); }";
-  html += ".controls { display: flex; gap: 15px; margin: 15px 0; flex-wrap: wrap; align-items: center; }";
-  html += ".control-group { display: flex; gap: 5px; align-items: center; }";
-  html += ".control-group label { font-weight: bold; }";
-  html += ".control-group input { width: 80px; padding: 5px; font-size: 14px; border: 2px solid #ccc; border-radius: 4px; }";
-  html += ".button-grid { display: grid; grid-template-columns: repeat(auto-fill, minmax(80px, 1fr)); gap: 10px; margin-top: 20px; }";
-  html += "button { padding: 15px; font-size: 16px; border: 2px solid #4CAF50; background: #4CAF50; color: white; border-radius: 5px; cursor: pointer; transition: all 0.3s; }";
-  html += "button:hover { background: #45a049; transform: scale(1.05); }";
-  html += "button:active { transform: scale(0.95); }";
-  html += ".status { margin-top: 15px; padding: 10px; background: #e8f5e9; border-radius: 5px; display: none; }";
-  html += "</style></head><body>";
-  html += "<div class='container'>";
-  html += "<h1>Chime Controller</h1>";
-  html += "<p>Click a button to ring a chime by channel (0-20)</p>";
-  html += "<div class='controls'>";
-  html += "<div class='control-group'>";
-  html += "<label for='kickDuty'>Kick Duty:</label>";
-  html += "<input type='number' id='kickDuty' value='100' min='1' max='100' />";
-  html += "<span>%</span>";
-  html += "</div>";
-  html += "<div class='control-group'>";
-  html += "<label for='kickHold'>Kick Hold:</label>";
-  html += "<input type='number' id='kickHold' value='35' min='0' max='1000' />";
-  html += "<span>ms</span>";
-  html += "</div>";
-  html += "</div>";
-  html += "<div class='button-grid'>";
+  HttpStream out(server, 200, "text/html");
+  out.print("<!DOCTYPE html><html><head>");
+  out.print("<meta name='viewport' content='width=device-width, initial-scale=1'>");
+  out.print("<style>");
+  out.print("body { font-family: Arial, sans-serif; margin: 20px; background: #f0f0f0; }");
+  out.print("h1 { color: #333; }");
+  out.print(".container { max-width: 600px; margin: 0 auto; background: white; padding: 20px; border-radius: 10px; box-shadow: 0 2px 5px rgba(0,0,0,0.1); }");
+  out.print(".controls { display: flex; gap: 15px; margin: 15px 0; flex-wrap: wrap; align-items: center; }");
+  out.print(".control-group { display: flex; gap: 5px; align-items: center; }");
+  out.print(".control-group label { font-weight: bold; }");
+  out.print(".control-group input { width: 80px; padding: 5px; font-size: 14px; border: 2px solid #ccc; border-radius: 4px; }");
+  out.print(".button-grid { display: grid; grid-template-columns: repeat(auto-fill, minmax(80px, 1fr)); gap: 10px; margin-top: 20px; }");
+  out.print("button { padding: 15px; font-size: 16px; border: 2px solid #4CAF50; background: #4CAF50; color: white; border-radius: 5px; cursor: pointer; transition: all 0.3s; }");
+  out.print("button:hover { background: #45a049; transform: scale(1.05); }");
+  out.print("button:active { transform: scale(0.95); }");
+  out.print(".status { margin-top: 15px; padding: 10px; background: #e8f5e9; border-radius: 5px; display: none; }");
+  out.print("</style></head><body>");
+  out.print("<div class='container'>");
+  out.print("<h1>Chime Controller</h1>");
+  out.print("<p>Click a button to ring a chime by channel (0-20)</p>");
+  out.print("<div class='controls'>");
+  out.print("<div class='control-group'>");
+  out.print("<label for='kickDuty'>Kick Duty:</label>");
+  out.print("<input type='number' id='kickDuty' value='100' min='1' max='100' />");
+  out.print("<span>%</span>");
+  out.print("</div>");
+  out.print("<div class='control-group'>");
+  out.print("<label for='kickHold'>Kick Hold:</label>");
+  out.print("<input type='number' id='kickHold' value='35' min='0' max='1000' />");
+  out.print("<span>ms</span>");
+  out.print("</div>");
+  out.print("</div>");
+  out.print("<div class='button-grid'>");
   
   // Create 21 buttons (notes 0-20)
   for (int i = 0; i < 21; i++) {
-    html += "<button onclick='ring(" + String(i) + ")'>Ch " + String(i) + "</button>";
+    out.printf("<button onclick='ring(%d)'>Ch %d</button>", i, i);
   }
   
-  html += "</div>";
-  html += "<div class='status' id='status'></div>";
-  html += "</div>";
+  out.print("</div>");
+  out.print("<div class='status' id='status'></div>");
+  out.print("</div>");
   
   // JavaScript to handle button clicks
-  html += "<script>";
-  html += "function ring(note) {";
-  html += "  const duty = document.getElementById('kickDuty').value;";
-  html += "  const hold = document.getElementById('kickHold').value;";
-  html += "  fetch('/note_on_by_index' + '?note=' + note)";
-  html += "    .then(r => r.text())";
-  html += "    .then(msg => {";
-  html += "      const s = document.getElementById('status');";
-  html += "      s.textContent = msg;";
-  html += "      s.style.display = 'block';";
-  html += "      setTimeout(() => s.style.display = 'none', 2000);";
-  html += "    })";
-  html += "    .catch(e => console.error('Error:', e));";
-  html += "}";
-  html += "</script>";
-  html += "</body></html>";
-  
-  server.send(200, "text/html", html);
+  out.print("<script>");
+  out.print("function ring(note) {");
+  out.print("  const duty = document.getElementById('kickDuty').value;");
+  out.print("  const hold = document.getElementById('kickHold').value;");
+  out.print("  fetch('/note_on_by_index' + '?note=' + note)");
+  out.print("    .then(r => r.text())");
+  out.print("    .then(msg => {");
+  out.print("      const s = document.getElementById('status');");
+  out.print("      s.textContent = msg;");
+  out.print("      s.style.display = 'block';");
+  out.print("      setTimeout(() => s.style.display = 'none', 2000);");
+  out.print("    })");
+  out.print("    .catch(e => console.error('Error:', e));");
+  out.print("}");
+  out.print("</script>");
+  out.print("</body></html>");
 }
 
 // Handler for GET /logs - Log viewer page
 static void handleLogsPage() {
-  httpLoggingEnabled = true; // Enable logging on first access
-  
-  String html = "<!DOCTYPE html><html><head>";
-  html += "<meta name='viewport' content='width=device-width, initial-scale=1'>";
-  html += "<title>Chime Logs</title>";
-  html += "<style>";
-  html += "body { font-family: monospace; margin: 0; padding: 20px; background: #1e1e1e; color: #d4d4d4; }";
-  html += "h1 { color: #4ec9b0; margin-bottom: 10px; }";
-  html += "#log { background: #252526; border: 1px solid #3e3e42; padding: 15px; ";
-  html += "height: 70vh; overflow-y: auto; white-space: pre-wrap; word-wrap: break-word; }";
-  html += ".controls { margin-bottom: 15px; }";
-  html += "button { padding: 8px 16px; background: #0e639c; color: white; border: none; ";
-  html += "border-radius: 4px; cursor: pointer; margin-right: 10px; }";
-  html += "button:hover { background: #1177bb; }";
-  html += ".status { color: #4ec9b0; margin-left: 10px; }";
-  html += "</style></head><body>";
-  html += "<h1>Chime Controller Logs</h1>";
-  html += "<div class='controls'>";
-  html += "<button onclick='clearLog()'>Clear</button>";
-  html += "<button onclick='toggleAutoScroll()' id='scrollBtn'>Auto-scroll: ON</button>";
-  html += "<span class='status' id='status'>Connected</span>";
-  html += "</div>";
-  html += "<div id='log'></div>";
-  html += "<script>";
-  html += "let autoScroll = true;";
-  html += "let lastIndex = -1;";
-  html += "const logDiv = document.getElementById('log');";
-  html += "const statusDiv = document.getElementById('status');";
-  html += "function fetchLogs() {";
-  html += "  fetch('/logs/poll?since=' + lastIndex)";
-  html += "    .then(r => r.json())";
-  html += "    .then(data => {";
-  html += "      if (data.logs) {";
-  html += "        logDiv.textContent += data.logs;";
-  html += "        if (autoScroll) logDiv.scrollTop = logDiv.scrollHeight;";
-  html += "      }";
-  html += "      lastIndex = data.index;";
-  html += "      statusDiv.textContent = 'Connected';";
-  html += "      statusDiv.style.color = '#4ec9b0';";
-  html += "    })";
-  html += "    .catch(() => {";
-  html += "      statusDiv.textContent = 'Error';";
-  html += "      statusDiv.style.color = '#f48771';";
-  html += "    });";
-  html += "}";
-  html += "fetchLogs();";
-  html += "setInterval(fetchLogs, 1000);";
-  html += "function clearLog() { logDiv.textContent = ''; }";
-  html += "function toggleAutoScroll() {";
-  html += "  autoScroll = !autoScroll;";
-  html += "  document.getElementById('scrollBtn').textContent = 'Auto-scroll: ' + (autoScroll ? 'ON' : 'OFF');";
-  html += "}";
-  html += "</script></body></html>";
-  
-  server.send(200, "text/html", html);
+  HttpStream out(server, 200, "text/html");
+  out.print("<!DOCTYPE html><html><head>");
+  out.print("<meta name='viewport' content='width=device-width, initial-scale=1'>");
+  out.print("<title>Chime Logs</title>");
+  out.print("<style>");
+  out.print("body { font-family: monospace; margin: 0; padding: 20px; background: #1e1e1e; color: #d4d4d4; }");
+  out.print("h1 { color: #4ec9b0; margin-bottom: 10px; }");
+  out.print("#log { background: #252526; border: 1px solid #3e3e42; padding: 15px; ");
+  out.print("height: 70vh; overflow-y: auto; white-space: pre-wrap; word-wrap: break-word; }");
+  out.print(".controls { margin-bottom: 15px; }");
+  out.print("button { padding: 8px 16px; background: #0e639c; color: white; border: none; ");
+  out.print("border-radius: 4px; cursor: pointer; margin-right: 10px; }");
+  out.print("button:hover { background: #1177bb; }");
+  out.print(".status { color: #4ec9b0; margin-left: 10px; }");
+  out.print("</style></head><body>");
+  out.print("<h1>Chime Controller Logs</h1>");
+  out.print("<div class='controls'>");
+  out.print("<button onclick='clearLog()'>Clear</button>");
+  out.print("<button onclick='toggleAutoScroll()' id='scrollBtn'>Auto-scroll: ON</button>");
+  out.print("<span class='status' id='status'>Connected</span>");
+  out.print("</div>");
+  out.print("<div id='log'></div>");
+  out.print("<script>");
+  out.print("let autoScroll = true;");
+  out.print("let lastId = -1;");
+  out.print("const logDiv = document.getElementById('log');");
+  out.print("const statusDiv = document.getElementById('status');");
+  out.print("function connect() {");
+  out.print("  const es = new EventSource('/logs/stream?since=' + lastId);");
+  out.print("  es.onopen = () => {");
+  out.print("    statusDiv.textContent = 'Connected';");
+  out.print("    statusDiv.style.color = '#4ec9b0';");
+  out.print("  };");
+  out.print("  es.onmessage = e => {");
+  out.print("    logDiv.textContent += e.data + '\\n';");
+  out.print("    lastId = e.lastEventId;");
+  out.print("    if (autoScroll) logDiv.scrollTop = logDiv.scrollHeight;");
+  out.print("  };");
+  out.print("  es.onerror = () => {");
+  out.print("    es.close();");
+  out.print("    statusDiv.textContent = 'Reconnecting';");
+  out.print("    statusDiv.style.color = '#f48771';");
+  out.print("    setTimeout(connect, 2000);");
+  out.print("  };");
+  out.print("}");
+  out.print("connect();");
+  out.print("function clearLog() { logDiv.textContent = ''; }");
+  out.print("function toggleAutoScroll() {");
+  out.print("  autoScroll = !autoScroll;");
+  out.print("  document.getElementById('scrollBtn').textContent = 'Auto-scroll: ' + (autoScroll ? 'ON' : 'OFF');");
+  out.print("}");
+  out.print("</script></body></html>");
 }
 
 // Handler for GET /logs/poll?since=X - Polling endpoint
 static void handleLogsPoll() {
-  httpLoggingEnabled = true; // Enable logging if not already
-  
-  int sinceIndex = -1;
-  if (server.hasArg("since")) {
-    sinceIndex = server.arg("since").toInt();
-  }
-  
-  String logs = httpserver_get_logs_since(sinceIndex);
-  int currentIndex = httpserver_get_log_index();
-  
-  // Early return for no new logs
-  if (logs.length() == 0) {
-    String json = "{\"index\":" + String(currentIndex) + ",\"logs\":\"\"}";
-    server.send(200, "application/json", json);
-    return;
-  }
-  
-  // Reserve capacity to minimize reallocations (rough estimate: logs.length() * 1.2 + 50)
-  String json;
-  json.reserve(logs.length() + logs.length() / 5 + 50);
-  
-  json = "{\"index\":" + String(currentIndex) + ",\"logs\":\"";
-  
-  // Escape the logs for JSON
-  for (unsigned int i = 0; i < logs.length(); i++) {
-    char c = logs[i];
-    if (c == '"') json += "\\\"";
-    else if (c == '\\') json += "\\\\";
-    else if (c == '\n') json += "\\n";
-    else if (c == '\r') json += "\\r";
-    else if (c == '\t') json += "\\t";
-    else json += c;
-  }
-  json += "\"}";
-  
-  server.send(200, "application/json", json);
+  long since = server.hasArg("since") ? server.arg("since").toInt() : -1;
+  
+  HttpStream out(server, 200, "application/json");
+  out.beginObject();
+  out.beginString("logs");
+  uint32_t index = logStream.writeSince(out, since < 0 ? UINT32_MAX : (uint32_t)since);
+  out.endString();
+  out.kv("index", (unsigned long)index);
+  out.endObject();
+}
+
+// Handler for GET /logs/stream?since=X - Server-Sent Events, stays open
+static void handleLogsStream() {
+  logStream.subscribe(server);
 }
 
 // Handler for GET /keyboard
 // Handler for GET /
 static void handlePlayPage() {
-  server.send_P(200, "text/html", PLAY_PAGE_HTML);
+  webasset_send(server, PLAY_PAGE_HTML_GZ);
 }
 
 static void handleRoot() {
-  server.send(200, "text/html", get_keyboard_html());
+  webasset_send(server, KEYBOARD_HTML_GZ);
 }
 
 // Handler for GET /note_on?note=X&velocity=Y
@@ -296,7 +248,7 @@ static void handleNoteOn() {
   }
   
   // Route through the common MIDI handler so all subsystems (CAN, etc.) are notified.
-  handle_midi_message(0x90, (uint8_t)note, (uint8_t)velocity);
+  runOnLoop([](LoopCall& c) { handle_midi_message(0x90, (uint8_t)c.a, (uint8_t)c.b); }, note, velocity);
   
   String response = "Note On: " + String(note) + " velocity: " + String(velocity);
   server.send(200, "text/plain", response);
@@ -311,8 +263,10 @@ static void handleNoteOnByIndex() {
   
   int note = server.arg("note").toInt();
 
-  setChannel(note, true);
-  flushOutput();
+  runOnLoop([](LoopCall& c) {
+    setChannel(c.a, true);
+    flushOutput();
+  }, note);
   
   String response = "Note On: " + String(note);
   server.send(200, "text/plain", response);
@@ -327,8 +281,10 @@ static void handleNoteOffByIndex() {
   
   int note = server.arg("note").toInt();
 
-  setChannel(note, false);
-  flushOutput();
+  runOnLoop([](LoopCall& c) {
+    setChannel(c.a, false);
+    flushOutput();
+  }, note);
   
   String response = "Note Off: " + String(note);
   server.send(200, "text/plain", response);
@@ -355,7 +311,7 @@ static void handleNoteOff() {
   }
   
   // Route through the common MIDI handler so all subsystems (CAN, etc.) are notified.
-  handle_midi_message(0x80, (uint8_t)note, (uint8_t)velocity);
+  runOnLoop([](LoopCall& c) { handle_midi_message(0x80, (uint8_t)c.a, (uint8_t)c.b); }, note, velocity);
   
   String response = "Note Off: " + String(note) + " velocity: " + String(velocity);
   server.send(200, "text/plain", response);
@@ -363,47 +319,113 @@ static void handleNoteOff() {
 
 // Handle /all_off endpoint - panic button
 void handleAllOff() {
-  all_off();
+  runOnLoop([](LoopCall&) { all_off(); });
   server.send(200, "text/plain", "All notes off");
 }
 
 // Handler for 404 Not Found
 static void handleNotFound() {
-  String message = "Not Found\n\n";
-  message += "URI: " + server.uri() + "\n";
-  message += "Method: " + String((server.method() == HTTP_GET) ? "GET" : "POST") + "\n";
-  server.send(404, "text/plain", message);
+  HttpStream out(server, 404, "text/plain");
+  out.print("Not Found\n\n");
+  out.print("URI: ");
+  out.print(server.uri());
+  out.print("\nMethod: ");
+  out.print((server.method() == HTTP_GET) ? "GET" : "POST");
+  out.print("\n");
 }
 
+#ifdef NOTE_TRACE
+// Handler for GET /trace - note latency marks as Chrome trace JSON
+// (NOTE_TRACE builds only). ?clear=1 empties the rings afterwards.
+static void handleTrace() {
+  server.sendHeader("Content-Disposition", "attachment; filename=\"notetrace.json\"");
+  {
+    HttpStream out(server, 200, "application/json");
+    notetrace_write_json(out);
+  }
+  if (server.hasArg("clear")) notetrace_clear();
+}
+
+// "trace" object for /status: RX-to-stage latency per pipeline stage
+static void writeTraceStats(HttpStream& out) {
+  NoteTraceStats st;
+  notetrace_get_stats(&st);
+  out.beginObject("trace");
+  out.kv("records", st.records);
+  out.kv("chains", st.chains);
+  out.beginObject("latency");
+  for (int s = NT_PARSE; s < NT_STAGES; s++) {
+    const NoteTraceStageStats& l = st.stage[s];
+    out.beginObject(notetrace_stage_name(s));
+    out.kv("samples", l.samples);
+    out.kv("p50Us", l.p50Us, 1);
+    out.kv("p99Us", l.p99Us, 1);
+    out.kv("maxUs", l.maxUs, 1);
+    out.endObject();
+  }
+  out.endObject();
+  out.endObject();
+}
+#endif
+
 // Handler for GET /status - system status including MIDI/UDP
 static void handleStatus() {
-  String json = "{";
-  json += "\"uptime\":" + String(millis()) + ",";
-  json += "\"wifi\":{";
-  json += "\"connected\":" + String(WiFi.status() == WL_CONNECTED ? "true" : "false") + ",";
-  json += "\"ip\":\"" + WiFi.localIP().toString() + "\",";
-  json += "\"rssi\":" + String(WiFi.RSSI());
-  json += "},";
-  json += "\"midiUdp\":{";
-  json += "\"listening\":" + String(midiUDP.isListening() ? "true" : "false") + ",";
-  json += "\"port\":" + String(midiUDP.getPort()) + ",";
-  json += "\"packetsReceived\":" + String(midiUDP.getPacketsReceived()) + ",";
-  json += "\"messagesReceived\":" + String(midiUDP.getMessagesReceived()) + ",";
-  json += "\"packetsDropped\":" + String(midiUDP.getPacketsDropped());
-  json += "}";
-  json += "}";
-  
-  server.send(200, "application/json", json);
+  HttpStream out(server, 200, "application/json");
+  out.beginObject();
+  out.kv("uptime", millis());
+  out.kv("telnetDropped", Log.telnetDropped());
+  out.beginObject("wifi");
+  out.kv("connected", WiFi.status() == WL_CONNECTED);
+  out.kv("ip", WiFi.localIP());
+  out.kv("rssi", WiFi.RSSI());
+  out.endObject();
+  out.beginObject("midiUdp");
+  out.kv("listening", midiUDP.isListening());
+  out.kv("port", midiUDP.getPort());
+  out.kv("packetsReceived", midiUDP.getPacketsReceived());
+  out.kv("messagesReceived", midiUDP.getMessagesReceived());
+  out.kv("packetsDropped", midiUDP.getPacketsDropped());
+  out.kv("packetsLost", midiUDP.getPacketsLost());
+  out.kv("packetsReordered", midiUDP.getPacketsReordered());
+  out.kv("packetsDuplicate", midiUDP.getPacketsDuplicate());
+  out.kv("messagesLate", midiUDP.getMessagesLate());
+  out.kv("bufferOverflows", midiUDP.getBufferOverflows());
+  out.kv("messagesQueued", (int)midiUDP.getMessagesQueued());
+  out.kv("playoutDelayMs", (int)midiUDP.getPlayoutDelayMs());
+  out.endObject();
+  out.beginObject("can");
+  out.kv("running", canReceiver.isRunning());
+  out.kv("liveSources", canReceiver.getLiveSources());
+  out.kv("framesReceived", canReceiver.getFramesReceived());
+  out.kv("framesIgnored", canReceiver.getFramesIgnored());
+  out.kv("sourcesTimedOut", canReceiver.getSourcesTimedOut());
+  out.kv("merges", canReceiver.getMerges());
+  out.kv("echoReplies", canReceiver.getEchoReplies());
+  out.endObject();
+  OutputStats os;
+  output_get_stats(&os);
+  out.beginObject("output");
+  out.kv("flushWindowUs", config_get().flush_window_us);
+  out.kv("flushes", os.flushes);
+  out.kv("flushesSkipped", os.skipped);
+  out.kv("flushesCoalesced", os.coalesced);
+  out.kv("bytesShifted", os.bytes_shifted);
+  out.kv("maxLatchDelayUs", os.max_delay_us);
+  out.endObject();
+#ifdef NOTE_TRACE
+  writeTraceStats(out);
+#endif
+  out.endObject();
 }
 
 // Handler for GET /api
 static void handleAPIDocumentation() {
-  server.send(200, "text/html", API_DOCS_HTML);
+  webasset_send(server, API_DOCS_HTML_GZ);
 }
 
 // Handler for GET /settings
 static void handleSettings() {
-  server.send(200, "text/html", SETTINGS_PAGE_HTML);
+  webasset_send(server, SETTINGS_PAGE_HTML_GZ);
 }
 
 // Handler for GET /midi/diag - MIDI receiver diagnostic JSON
@@ -423,28 +445,31 @@ static void handleMidiDiag() {
     pinDiag = "transitions seen - circuit is producing signal";
   }
 
-  String json = "{";
-  json += "\"gpio\":{";
-  json += "\"pin\":" + String(PIN_MIDI_RX) + ",";
-  json += "\"lastState\":" + String(midiReceiver.lastPinState) + ",";
-  json += "\"seenHigh\":" + String(midiReceiver.pinSeenHigh ? "true" : "false") + ",";
-  json += "\"seenLow\":" + String(midiReceiver.pinSeenLow ? "true" : "false") + ",";
-  json += "\"diagnosis\":\"" + String(pinDiag) + "\"";
-  json += "},";
-  json += "\"uart\":{";
-  json += "\"bytesReceived\":" + String(midiReceiver.bytesReceived) + ",";
-  json += "\"lastByte\":\"0x" + String(midiReceiver.lastByte, HEX) + "\",";
-  json += "\"messagesHandled\":" + String(midiReceiver.messagesHandled);
-  json += "},";
-  json += "\"hint\":\"If bytesReceived=0: check wiring/power/circuit. ";
-  json += "If bytes>0 but messagesHandled=0: likely signal inversion - ";
-  json += "flip MIDI_RX_INVERT in midireceiver.cpp and re-flash.\"";
-  json += "}";
-  server.send(200, "application/json", json);
+  HttpStream out(server, 200, "application/json");
+  out.beginObject();
+  out.beginObject("gpio");
+  out.kv("pin", PIN_MIDI_RX);
+  out.kv("lastState", midiReceiver.lastPinState);
+  out.kv("seenHigh", midiReceiver.pinSeenHigh);
+  out.kv("seenLow", midiReceiver.pinSeenLow);
+  out.kv("diagnosis", pinDiag);
+  out.endObject();
+  out.beginObject("uart");
+  out.kv("bytesReceived", midiReceiver.bytesReceived);
+  out.beginString("lastByte");
+  out.printf("0x%x", midiReceiver.lastByte);
+  out.endString();
+  out.kv("messagesHandled", midiReceiver.messagesHandled);
+  out.endObject();
+  out.kv("hint", "If bytesReceived=0: check wiring/power/circuit. "
+                 "If bytes>0 but messagesHandled=0: likely signal inversion - "
+                 "flip MIDI_RX_INVERT in midireceiver.cpp and re-flash.");
+  out.endObject();
 }
 
 // Handler for GET /midi/wiggle
-// Samples GPIO17 at ~10µs intervals for 500ms (blocks the web server briefly).
+// Samples GPIO17 at ~10µs intervals for 500ms (blocks the web server briefly,
+// not the loop).
 // Hit this endpoint WHILE holding down notes on your MIDI keyboard.
 // It will tell you definitively whether any signal transitions are reaching the pin.
 static void handleMidiWiggle() {
@@ -478,52 +503,75 @@ static void handleMidiWiggle() {
     verdict = "Transitions detected - signal is reaching GPIO17. UART should receive bytes.";
   }
 
-  String json = "{";
-  json += "\"pin\":" + String(PIN_MIDI_RX) + ",";
-  json += "\"durationMs\":500,";
-  json += "\"transitions\":" + String(transitions) + ",";
-  json += "\"highSamples\":" + String(highCount) + ",";
-  json += "\"lowSamples\":" + String(lowCount) + ",";
-  json += "\"verdict\":\"" + String(verdict) + "\"";
-  json += "}";
-  server.send(200, "application/json", json);
+  HttpStream out(server, 200, "application/json");
+  out.beginObject();
+  out.kv("pin", PIN_MIDI_RX);
+  out.kv("durationMs", 500);
+  out.kv("transitions", transitions);
+  out.kv("highSamples", highCount);
+  out.kv("lowSamples", lowCount);
+  out.kv("verdict", verdict);
+  out.endObject();
+}
+
+// Handler for POST /bench - note-path microbenchmarks (see bench_notepath.h)
+// Optional budget=<cycles> per timed run (default 10 ms at 240 MHz). The
+// cases run on the loop task with the outputs disabled, so it is refused
+// (409) while any output is on; the table is written from this task
+// afterwards.
+static void handleBench() {
+  uint32_t budget = 2400000;
+  if (server.hasArg("budget")) {
+    long b = server.arg("budget").toInt();
+    if (b < 10000 || b > 240000000) {
+      server.send(400, "text/plain", "budget must be 10000-240000000 cycles");
+      return;
+    }
+    budget = (uint32_t)b;
+  }
+  BenchResult res[BENCH_NOTEPATH_COUNT];
+  LoopCall call = { (int32_t)budget, 0, 0, 0, res, false };
+  bool ran = runOnLoop([](LoopCall& c) {
+    c.ok = bench_notepath_idle();
+    if (c.ok) bench_notepath_measure((BenchResult*)c.p, (uint32_t)c.a);
+  }, call);
+  if (!ran) {
+    server.send(409, "text/plain", "outputs are on; run the bench with the organ idle");
+    return;
+  }
+  
+  HttpStream out(server, 200, "text/plain");
+  bench_notepath_print(out, res);
 }
 
 // ---- Config page & API ------------------------------------------------
 
 static void handleConfigPage() {
-  server.send(200, "text/html", CONFIG_PAGE_HTML);
+  webasset_send(server, CONFIG_PAGE_HTML_GZ);
 }
 
-// GET /config/get  — returns full config as JSON (streamed to avoid large heap allocation)
+// GET /config/get  — returns full config as JSON, streamed in chunks
+// The config only changes on the loop task (below), and the loop is the only
+// other reader, so the server task reads and saves it directly.
 static void handleConfigGet() {
   Config& cfg = config_get();
-  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-  server.send(200, "application/json", "");
-
-  char buf[8];
-  server.sendContent("{\"num_outputs\":");
-  snprintf(buf, sizeof(buf), "%u", cfg.num_outputs);
-  server.sendContent(buf);
-  server.sendContent(",\"channels\":[");
-
+  HttpStream out(server, 200, "application/json");
+  out.beginObject();
+  out.kv("num_outputs", cfg.num_outputs);
+  out.kv("flush_window_us", cfg.flush_window_us);
+  out.beginArray("channels");
   for (int ch = 0; ch < MIDI_CHANNELS; ch++) {
-    if (ch > 0) server.sendContent(",");
-    server.sendContent("{\"enabled\":");
-    server.sendContent(cfg.midi[ch].enabled ? "true" : "false");
-    server.sendContent(",\"map\":[");
-    // Build this channel's map as one stack buffer to minimise sendContent calls
-    char mapBuf[640];  // worst-case: 128 values of "-1," = 128*3+1 = 385 bytes; 640 is safe
-    int pos = 0;
+    out.beginObject();
+    out.kv("enabled", cfg.midi[ch].enabled);
+    out.beginArray("map");
     for (int n = 0; n < 128; n++) {
-      if (n > 0) mapBuf[pos++] = ',';
-      pos += snprintf(mapBuf + pos, sizeof(mapBuf) - pos, "%d",
-                      (int)cfg.midi[ch].note_to_output[n]);
+      out.value(cfg.midi[ch].note_to_output[n]);
     }
-    server.sendContent(mapBuf, pos);
-    server.sendContent("]}");
+    out.endArray();
+    out.endObject();
   }
-  server.sendContent("]}");
+  out.endArray();
+  out.endObject();
 }
 
 // POST /config/num_outputs  body: value=56
@@ -537,11 +585,43 @@ static void handleConfigNumOutputs() {
     server.send(400, "text/plain", "value must be 1-128");
     return;
   }
-  config_get().num_outputs = (uint8_t)val;
+  runOnLoop([](LoopCall& c) { config_get().num_outputs = (uint8_t)c.a; }, val);
   config_save_num_outputs();
   server.send(200, "text/plain", "Saved: num_outputs=" + String(val));
 }
 
+// POST /config/flush_window  body: value=N  (microseconds, 0 = once per receive batch)
+static void handleConfigFlushWindow() {
+  if (!server.hasArg("value")) {
+    server.send(400, "text/plain", "Missing value");
+    return;
+  }
+  int val = server.arg("value").toInt();
+  if (val < 0 || val > 10000) {
+    server.send(400, "text/plain", "value must be 0-10000");
+    return;
+  }
+  runOnLoop([](LoopCall& c) { config_get().flush_window_us = (uint16_t)c.a; }, val);
+  config_save_flush_window();
+  server.send(200, "text/plain", "Saved: flush_window_us=" + String(val));
+}
+
+// POST /mudp/delay  body: ms=N  (MUDP-v2 playout delay, milliseconds)
+static void handleMudpDelay() {
+  if (!server.hasArg("ms")) {
+    server.send(400, "text/plain", "Missing ms");
+    return;
+  }
+  int ms = server.arg("ms").toInt();
+  if (ms < 0 || ms > MIDIoverUDP::MAX_PLAYOUT_DELAY_MS) {
+    server.send(400, "text/plain", "ms must be 0-" + String(MIDIoverUDP::MAX_PLAYOUT_DELAY_MS));
+    return;
+  }
+  runOnLoop([](LoopCall& c) { midiUDP.setPlayoutDelayMs((uint16_t)c.a); }, ms);
+  midiUDP.savePlayoutDelay();
+  server.send(200, "text/plain", "Saved: playout_delay_ms=" + String(ms));
+}
+
 // POST /config/channel  body: ch=0&enabled=1&map=0,1,2,-1,...
 static void handleConfigChannel() {
   if (!server.hasArg("ch") || !server.hasArg("map")) {
@@ -553,19 +633,26 @@ static void handleConfigChannel() {
     server.send(400, "text/plain", "ch must be 0-15");
     return;
   }
-  Config& cfg = config_get();
-  cfg.midi[ch].enabled = server.hasArg("enabled") && server.arg("enabled") == "1";
+  bool enabled = server.hasArg("enabled") && server.arg("enabled") == "1";
 
-  // Parse comma-separated map (128 values)
+  // Parse comma-separated map (128 values); notes left out keep their output
+  int8_t map[128];
+  memcpy(map, config_get().midi[ch].note_to_output, sizeof(map));
   String mapStr = server.arg("map");
   int note = 0, start = 0;
   for (int i = 0; i <= (int)mapStr.length() && note < 128; i++) {
     if (i == (int)mapStr.length() || mapStr[i] == ',') {
-      cfg.midi[ch].note_to_output[note++] = (int8_t)mapStr.substring(start, i).toInt();
+      map[note++] = (int8_t)mapStr.substring(start, i).toInt();
       start = i + 1;
     }
   }
 
+  LoopCall call = { ch, enabled, 0, 0, map, false };
+  runOnLoop([](LoopCall& c) {
+    Config& cfg = config_get();
+    cfg.midi[c.a].enabled = c.b != 0;
+    memcpy(cfg.midi[c.a].note_to_output, c.p, sizeof(cfg.midi[c.a].note_to_output));
+  }, call);
   config_save_channel((uint8_t)ch);
   server.send(200, "text/plain", "Saved channel " + String(ch));
 }
@@ -573,6 +660,9 @@ static void handleConfigChannel() {
 extern "C" {
 
 void httpserver_begin() {
+  loopQueue = xQueueCreate(LOOP_QUEUE_LEN, sizeof(LoopCmd));
+  loopDone = xSemaphoreCreateBinary();
+  
   // Register route handlers
   server.on("/", HTTP_GET, handleRoot);
   server.on("/play", HTTP_GET, handlePlayPage);
@@ -582,6 +672,7 @@ void httpserver_begin() {
   server.on("/channels", HTTP_GET, handleChannels);
   server.on("/logs", HTTP_GET, handleLogsPage);
   server.on("/logs/poll", HTTP_GET, handleLogsPoll);
+  server.on("/logs/stream", HTTP_GET, handleLogsStream);
   server.on("/note_on_by_index", HTTP_GET, handleNoteOnByIndex);
   server.on("/note_off_by_index", HTTP_GET, handleNoteOffByIndex);
   server.on("/note_on", HTTP_GET, handleNoteOn);
@@ -593,6 +684,12 @@ void httpserver_begin() {
   server.on("/config/get",            HTTP_GET,  handleConfigGet);
   server.on("/config/num_outputs",    HTTP_POST, handleConfigNumOutputs);
   server.on("/config/channel",        HTTP_POST, handleConfigChannel);
+  server.on("/config/flush_window",   HTTP_POST, handleConfigFlushWindow);
+  server.on("/mudp/delay",            HTTP_POST, handleMudpDelay);
+  server.on("/bench",                 HTTP_POST, handleBench);
+#ifdef NOTE_TRACE
+  server.on("/trace",                 HTTP_GET,  handleTrace);
+#endif
   
   // For parameterized routes, we'll handle them in onNotFound
   // and check the path prefix there
@@ -601,12 +698,19 @@ void httpserver_begin() {
   });
   
   // Start server
+  webasset_begin(server);
   server.begin();
+  xTaskCreatePinnedToCore(httpTask, "http", HTTP_TASK_STACK, nullptr, HTTP_TASK_PRIORITY, nullptr, HTTP_TASK_CORE);
   // Serial.println("HTTP server started on port 80");
 }
 
 void httpserver_loop() {
-  server.handleClient();
+  if (!loopQueue) return;   // Server never started
+  LoopCmd cmd;
+  while (xQueueReceive(loopQueue, &cmd, 0) == pdTRUE) {
+    cmd.fn(*cmd.call);
+    xSemaphoreGive(loopDone);
+  }
 }
 
 } // extern "C"
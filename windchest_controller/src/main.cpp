@@ -9,6 +9,7 @@
 #include "midinote.h"
 #include "midireceiver.h"
 #include "midiudp.h"
+#include "canreceiver.h"
 #include "config.h"
 
 // ---- WiFi creds ----
@@ -20,7 +21,6 @@ static const char* WIFI_PASS = "murphalurf18";
 
 // Telnet server for remote logging
 WiFiServer telnetServer(23);
-WiFiClient telnetClient;
 
 // // Custom print that outputs to both Serial and Telnet
 // class DualOutput : public Print {
@@ -98,6 +98,7 @@ static void ota_begin() {
 // ---------- Setup / loop ----------
 void setup() {
   Serial.begin(115200);
+  logger_begin();
 
   wifi_connect();
   
@@ -129,6 +130,7 @@ void setup() {
   midinote_begin();
   midiReceiver.begin();
   midiUDP.begin();  // Start MIDI/UDP receiver on port 21928
+  canReceiver.begin();  // DIV_STATE bitmaps from the keyboard controllers
 
   clearAll();
   flushOutput();
@@ -136,27 +138,21 @@ void setup() {
   // Start telnet server
   telnetServer.begin();
   telnetServer.setNoDelay(true);
+  Log.serveTelnet(telnetServer);
 }
 
 void loop() {
   midiReceiver.update();
   midiUDP.update();
+  canReceiver.update();
+  output_service();  // One latch for everything received above
 
+  // Telnet clients are taken by the logger's telnet task
   if (WiFi.status() == WL_CONNECTED) {
-    // Check for new telnet clients
-    if (telnetServer.hasClient()) {
-      // Disconnect old client if exists
-      if (telnetClient) {
-        telnetClient.stop();
-      }
-      telnetClient = telnetServer.available();
-      Log.println("\nTelnet client connected");
-    }
-    
     // Handle OTA
     ArduinoOTA.handle();
-    
-    // Handle HTTP requests
-    httpserver_loop();
   }
+  
+  // Run the output calls queued by HTTP handlers
+  httpserver_loop();
 }
@@ -1,12 +1,14 @@
 #include "midihandler.h"
 #include "midinote.h"
 #include "logger.h"
+#include "notetrace.h"
 
 extern "C" {
 
 void handle_midi_message(uint8_t status, uint8_t data1, uint8_t data2) {
     uint8_t type    = status & 0xF0;
     uint8_t channel = status & 0x0F;
+    NOTE_MARK(NT_HANDLER, (type & 0xE0) == 0x80 ? data1 : NT_NO_NOTE);
 
     switch (type) {
         case 0x80:  // Note Off
@@ -23,7 +25,7 @@ void handle_midi_message(uint8_t status, uint8_t data1, uint8_t data2) {
         case 0xB0:  // Control Change
             if (data1 == 123) {
                 all_off();  // CC 123 = All Notes Off
-                Log.printf("ALL OFF\n"); // DEBUG: log every byte
+                LOG_INFO("ALL OFF\n");
             }
             break;
 
@@ -4,6 +4,7 @@
 #include "config.h"
 #include "output.h"
 #include "logger.h"
+#include "notetrace.h"
 
 extern "C" {
 
@@ -16,9 +17,11 @@ void note_on(uint8_t midi_ch, uint8_t midi_note, uint8_t velocity) {
   if (!config_channel_enabled(midi_ch)) return;
   int out = config_note_to_output(midi_ch, midi_note);
   if (out < 0) return;
-  Log.printf("Note On:  ch%u note%u -> out%d\n", midi_ch, midi_note, out);
+  NOTE_MARK(NT_MAPPING, midi_note);
+  LOG_DEBUG("Note On:  ch%u note%u -> out%d\n", midi_ch, midi_note, out);
   setChannel(out, true);
-  flushOutput();
+  output_request_flush();
+  NOTE_MARK(NT_OUTPUT, midi_note);
 }
 
 void note_off(uint8_t midi_ch, uint8_t midi_note, uint8_t velocity) {
@@ -26,9 +29,11 @@ void note_off(uint8_t midi_ch, uint8_t midi_note, uint8_t velocity) {
   if (!config_channel_enabled(midi_ch)) return;
   int out = config_note_to_output(midi_ch, midi_note);
   if (out < 0) return;
-  Log.printf("Note Off: ch%u note%u -> out%d\n", midi_ch, midi_note, out);
+  NOTE_MARK(NT_MAPPING, midi_note);
+  LOG_DEBUG("Note Off: ch%u note%u -> out%d\n", midi_ch, midi_note, out);
   setChannel(out, false);
-  flushOutput();
+  output_request_flush();
+  NOTE_MARK(NT_OUTPUT, midi_note);
 }
 
 void all_off() {
@@ -2,6 +2,7 @@
 #include "logger.h"
 #include "midihandler.h"
 #include "pins.h"
+#include "notetrace.h"
 
 // MIDI uses UART at 31250 baud, 8-N-1
 #define MIDI_BAUD_RATE 31250
@@ -58,6 +59,7 @@ void MidiReceiver::update() {
         reset();
     }
     // Process all available MIDI bytes
+    if (Serial2.available()) NOTE_MARK(NT_RX, NT_NO_NOTE);
     while (Serial2.available()) {
         uint8_t byte = Serial2.read();
         lastByteTime = millis();
@@ -216,6 +218,7 @@ void MidiReceiver::handleMessage() {
     
     // Delegate to common MIDI handler
     messagesHandled++;
+    NOTE_MARK(NT_PARSE, (status & 0xE0) == 0x80 ? data1 : NT_NO_NOTE);
     handle_midi_message(status, data1, data2);
 }
 
@@ -1,8 +1,10 @@
 #include "midiudp.h"
 #include "midihandler.h"
 #include "logger.h"
+#include "notetrace.h"
 #include <WiFi.h>
 #include <WiFiUdp.h>
+#include <Preferences.h>
 
 // Global instance
 MIDIoverUDP midiUDP;
@@ -10,12 +12,27 @@ MIDIoverUDP midiUDP;
 // UDP socket
 static WiFiUDP udp;
 
+static const char* NVS_NAMESPACE = "midiudp";
+
 void MIDIoverUDP::begin(uint16_t port) {
     this->port = port;
     this->listening = false;
     this->packetsReceived = 0;
     this->messagesReceived = 0;
     this->packetsDropped = 0;
+    this->packetsLost = 0;
+    this->packetsReordered = 0;
+    this->packetsDuplicate = 0;
+    this->messagesLate = 0;
+    this->bufferOverflows = 0;
+    this->v2Started = false;
+    this->queued = 0;
+    
+    Preferences prefs;
+    prefs.begin(NVS_NAMESPACE, true);
+    playoutDelayMs = prefs.getUShort("delay_ms", DEFAULT_PLAYOUT_DELAY_MS);
+    prefs.end();
+    if (playoutDelayMs > MAX_PLAYOUT_DELAY_MS) playoutDelayMs = DEFAULT_PLAYOUT_DELAY_MS;
     
     // Only start listening if WiFi is connected
     if (WiFi.status() == WL_CONNECTED) {
@@ -31,6 +48,9 @@ void MIDIoverUDP::begin(uint16_t port) {
 }
 
 void MIDIoverUDP::update() {
+    // Play the v2 messages that are due, whether they came by UDP or /ws
+    releaseDue();
+    
     // If not listening but WiFi is now connected, try to start
     if (!listening && WiFi.status() == WL_CONNECTED) {
         if (udp.begin(port)) {
@@ -58,32 +78,38 @@ void MIDIoverUDP::update() {
         // Read packet
         int bytesRead = udp.read(buffer, len);
         if (bytesRead > 0) {
+            NOTE_MARK(NT_RX, NT_NO_NOTE);
             handlePacket(buffer, bytesRead);
         }
     }
 }
 
-void MIDIoverUDP::handlePacket(uint8_t* data, size_t length) {
-    Log.printf("MIDI/UDP: Received packet of %d bytes\r\n", length);
+void MIDIoverUDP::receive(const uint8_t* data, size_t length) {
+    NOTE_MARK(NT_RX, NT_NO_NOTE);
+    handlePacket(data, length);
+}
+
+void MIDIoverUDP::handlePacket(const uint8_t* data, size_t length) {
+    LOG_DEBUG("MIDI/UDP: Received packet of %u bytes\r\n", (unsigned)length);
     // Validate minimum packet size
     if (length < MIN_PACKET_SIZE) {
         packetsDropped++;
-        Log.printf("MIDI/UDP: Packet too small (%d bytes)\n", length);
+        LOG_WARN("MIDI/UDP: Packet too small (%u bytes)\n", (unsigned)length);
         return;
     }
     
     // Validate magic bytes
     if (data[0] != MAGIC_M || data[1] != MAGIC_U) {
         packetsDropped++;
-        Log.printf("MIDI/UDP: Invalid magic bytes: 0x%02X 0x%02X\n", data[0], data[1]);
+        LOG_WARN("MIDI/UDP: Invalid magic bytes: 0x%02X 0x%02X\n", data[0], data[1]);
         return;
     }
     
     // Check version
     uint8_t version = data[2];
-    if (version != VERSION) {
+    if (version != VERSION && version != VERSION_2) {
         packetsDropped++;
-        Log.printf("MIDI/UDP: Unsupported version: %d\n", version);
+        LOG_WARN("MIDI/UDP: Unsupported version: %d\n", version);
         return;
     }
     
@@ -91,19 +117,57 @@ void MIDIoverUDP::handlePacket(uint8_t* data, size_t length) {
     uint8_t count = data[3];
     if (count == 0) {
         packetsDropped++;
-        Log.println("MIDI/UDP: Empty packet (count=0)");
+        LOG_WARN("MIDI/UDP: Empty packet (count=0)\n");
         return;
     }
     
+    // v2: sequence number and sender time, then a time offset per message
+    bool timed = version == VERSION_2;
+    uint32_t due = 0;
+    size_t header = MIN_PACKET_SIZE;
+    if (timed) {
+        if (length < V2_HEADER_SIZE) {
+            packetsDropped++;
+            LOG_WARN("MIDI/UDP: Truncated v2 header (%u bytes)\n", (unsigned)length);
+            return;
+        }
+        uint16_t seq = (data[4] << 8) | data[5];
+        uint32_t sent = ((uint32_t)data[6] << 24) | ((uint32_t)data[7] << 16) | (data[8] << 8) | data[9];
+        uint32_t now = micros();
+        bool restart = !v2Started || now - lastV2Us > RESTART_IDLE_US ||
+                       (uint16_t)(seq - highSeq + RESTART_SEQ_JUMP) > 2 * RESTART_SEQ_JUMP;
+        v2Started = true;
+        lastV2Us = now;
+        if (!trackSequence(seq, restart)) {
+            packetsDuplicate++;
+            LOG_DEBUG("MIDI/UDP: Duplicate packet %u\n", (unsigned)seq);
+            return;
+        }
+        due = playoutTime(sent, now, restart);
+        header = V2_HEADER_SIZE;
+    }
+    
     // Parse messages
-    uint8_t* p = data + 4;
-    size_t remaining = length - 4;
+    const uint8_t* p = data + header;
+    size_t remaining = length - header;
     
     for (int i = 0; i < count; i++) {
+        uint32_t offset = 0;
+        if (timed) {
+            if (remaining < 2) {
+                packetsDropped++;
+                LOG_WARN("MIDI/UDP: Truncated packet at message %d\n", i);
+                return;
+            }
+            offset = (p[0] << 8) | p[1];
+            p += 2;
+            remaining -= 2;
+        }
+        
         // Need at least status + data1
         if (remaining < 2) {
             packetsDropped++;
-            Log.printf("MIDI/UDP: Truncated packet at message %d\n", i);
+            LOG_WARN("MIDI/UDP: Truncated packet at message %d\n", i);
             return;
         }
         
@@ -113,7 +177,7 @@ void MIDIoverUDP::handlePacket(uint8_t* data, size_t length) {
         // Validate status byte (must be 0x80-0xEF)
         if (status < 0x80 || status > 0xEF) {
             packetsDropped++;
-            Log.printf("MIDI/UDP: Invalid status byte: 0x%02X\n", status);
+            LOG_WARN("MIDI/UDP: Invalid status byte: 0x%02X\n", status);
             return;
         }
         
@@ -127,7 +191,7 @@ void MIDIoverUDP::handlePacket(uint8_t* data, size_t length) {
         if (type != 0xC0 && type != 0xD0) {  // Not Program Change or Channel Pressure
             if (remaining < 1) {
                 packetsDropped++;
-                Log.printf("MIDI/UDP: Truncated packet (missing data2) at message %d\n", i);
+                LOG_WARN("MIDI/UDP: Truncated packet (missing data2) at message %d\n", i);
                 return;
             }
             d2 = *p++;
@@ -135,13 +199,113 @@ void MIDIoverUDP::handlePacket(uint8_t* data, size_t length) {
         }
         
         // Handle the MIDI message
-        handleMIDIMessage(status, d1, d2);
+        NOTE_MARK(NT_PARSE, (type & 0xE0) == 0x80 ? d1 : NT_NO_NOTE);
+        if (timed) {
+            schedule(due + offset, status, d1, d2);
+        } else {
+            handleMIDIMessage(status, d1, d2);
+        }
         messagesReceived++;
     }
     
     packetsReceived++;
 }
 
+// Count a v2 packet's sequence number against the ones already seen.
+// Returns false for a duplicate.
+bool MIDIoverUDP::trackSequence(uint16_t seq, bool restart) {
+    if (restart) {
+        highSeq = seq;
+        seqSeen = 1;
+        return true;
+    }
+    int16_t ahead = (int16_t)(seq - highSeq);
+    if (ahead > 0) {
+        // The ones skipped are lost unless they turn up late
+        packetsLost += ahead - 1;
+        seqSeen = ahead < 32 ? (seqSeen << ahead) | 1 : 1;
+        highSeq = seq;
+        return true;
+    }
+    uint16_t behind = -ahead;
+    if (behind < 32) {
+        if (seqSeen & (1UL << behind)) return false;
+        seqSeen |= 1UL << behind;
+        if (packetsLost > 0) packetsLost--;
+    }
+    packetsReordered++;
+    return true;
+}
+
+// Local time to play a v2 packet sent at sender time sent. The sender's
+// clock is mapped to ours by the quickest recent packet, which took the
+// shortest path; the playout delay then covers the packets that were
+// slower. The mapping is refreshed every CLOCK_WINDOW_US so it follows
+// the two clocks drifting apart.
+uint32_t MIDIoverUDP::playoutTime(uint32_t sent, uint32_t now, bool restart) {
+    uint32_t d = now - sent;
+    if (restart) {
+        clockBase = d;
+        windowMin = d;
+        windowStart = now;
+    }
+    if ((int32_t)(d - clockBase) < 0) clockBase = d;
+    if ((int32_t)(d - windowMin) < 0) windowMin = d;
+    if (now - windowStart >= CLOCK_WINDOW_US) {
+        clockBase = windowMin;
+        windowMin = d;
+        windowStart = now;
+    }
+    return sent + clockBase + (uint32_t)playoutDelayMs * 1000;
+}
+
+// Queue a message for its playout time, or play it now if that has passed
+void MIDIoverUDP::schedule(uint32_t due, uint8_t status, uint8_t data1, uint8_t data2) {
+    int32_t wait = (int32_t)(due - micros());
+    if (wait <= 0) {
+        if (wait < 0) messagesLate++;
+        handleMIDIMessage(status, data1, data2);
+        return;
+    }
+    if (queued == QUEUE_LEN) {
+        // Full: play the earliest now rather than lose a note
+        bufferOverflows++;
+        handleMIDIMessage(queue[0].status, queue[0].data1, queue[0].data2);
+        memmove(queue, queue + 1, --queued * sizeof(Scheduled));
+    }
+    // After any due at the same time, so they keep their order
+    uint8_t i = queued;
+    while (i > 0 && (int32_t)(queue[i - 1].due - due) > 0) i--;
+    memmove(queue + i + 1, queue + i, (queued - i) * sizeof(Scheduled));
+    queue[i] = { due, status, data1, data2 };
+    queued++;
+}
+
+void MIDIoverUDP::releaseDue() {
+    if (queued == 0) return;
+    uint32_t now = micros();
+    uint8_t n = 0;
+    while (n < queued && (int32_t)(now - queue[n].due) >= 0) {
+        handleMIDIMessage(queue[n].status, queue[n].data1, queue[n].data2);
+        n++;
+    }
+    if (n > 0) {
+        queued -= n;
+        memmove(queue, queue + n, queued * sizeof(Scheduled));
+    }
+}
+
+void MIDIoverUDP::setPlayoutDelayMs(uint16_t ms) {
+    playoutDelayMs = ms > MAX_PLAYOUT_DELAY_MS ? MAX_PLAYOUT_DELAY_MS : ms;
+}
+
+void MIDIoverUDP::savePlayoutDelay() {
+    Preferences prefs;
+    prefs.begin(NVS_NAMESPACE, false);
+    prefs.putUShort("delay_ms", playoutDelayMs);
+    prefs.end();
+}
+
 void MIDIoverUDP::handleMIDIMessage(uint8_t status, uint8_t data1, uint8_t data2) {
     // Delegate to common MIDI handler
     handle_midi_message(status, data1, data2);
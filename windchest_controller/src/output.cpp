@@ -1,12 +1,46 @@
 #include <Arduino.h>
 #include <driver/gpio.h>   // ESP-IDF GPIO — available before Arduino init
+#include <driver/spi_master.h>
 #include "output.h"
 #include "config.h"
 #include "pins.h"
 #include "logger.h"
+#include "notetrace.h"
 
 static uint8_t outBuf[MAX_OUTPUT_BYTES];  // always 16 bytes; only the active slice is shifted out
 
+// Double buffer: outBuf is the wanted state, shadowBuf is what the chain
+// currently holds. A flush is skipped when they already match.
+static uint8_t shadowBuf[MAX_OUTPUT_BYTES];
+static int shadowBytes = 0;          // Active bytes when shadowBuf was latched; 0 = unknown
+static bool dirty = true;            // outBuf changed since the last latch
+static OutputStats stats = {};
+
+// ---------- SPI output path ----------
+// The chain is driven by SPI2 with DMA. PIN_LATCH is the device's CS line:
+// it goes LOW for the transaction and back HIGH when the last bit is out,
+// and that rising edge is the 74HC595 RCLK latch. SCK/MOSI are not the
+// SPI2 IOMUX pins on the S3, so they are routed through the GPIO matrix,
+// which still allows well over the clock used here.
+#define OUTPUT_SPI_HOST SPI2_HOST
+#define OUTPUT_SPI_HZ   (8 * 1000 * 1000)
+
+static spi_device_handle_t spiDev = nullptr;
+static bool spiBusy = false;  // A transaction is queued and not yet reaped
+static int txSlot = 0;
+static spi_transaction_t spiTrans[2];
+DMA_ATTR static uint8_t spiTx[2][MAX_OUTPUT_BYTES];  // Double-buffered so the next flush can be built while one shifts
+
+static bool flushPending = false;
+static uint32_t flushRequestedAt = 0;  // micros() of the first request in the pending batch
+
+#ifdef NOTE_TRACE
+// CS has just gone HIGH: the 74HC595s latched (SPI ISR)
+static void IRAM_ATTR onLatched(spi_transaction_t*) {
+  NOTE_MARK_ISR(NT_LATCH, NT_NO_NOTE);
+}
+#endif
+
 // Runs as early as possible — before setup() — using ESP-IDF GPIO directly.
 // Drives /OE HIGH (outputs disabled) so the 74HC595 indeterminate storage state
 // never drives the load while the rest of the firmware initializes.
@@ -34,9 +68,37 @@ void output_begin() {
   delayMicroseconds(1);
   digitalWrite(PIN_CLR_N, HIGH);  // release — normal operation
 
+  // Hand SCK/MOSI/LATCH to the SPI peripheral. Fall back to bit-banging
+  // if the bus cannot be brought up.
+  spi_bus_config_t bus = {};
+  bus.mosi_io_num = PIN_MOSI;
+  bus.miso_io_num = -1;
+  bus.sclk_io_num = PIN_SCK;
+  bus.quadwp_io_num = -1;
+  bus.quadhd_io_num = -1;
+  bus.max_transfer_sz = MAX_OUTPUT_BYTES;
+
+  spi_device_interface_config_t dev = {};
+  dev.mode = 0;                       // 74HC595 samples SER on the SRCLK rising edge
+  dev.clock_speed_hz = OUTPUT_SPI_HZ;
+  dev.spics_io_num = PIN_LATCH;       // CS rising edge = RCLK latch
+  dev.queue_size = 2;
+#ifdef NOTE_TRACE
+  dev.post_cb = onLatched;
+#endif
+
+  if (spi_bus_initialize(OUTPUT_SPI_HOST, &bus, SPI_DMA_CH_AUTO) == ESP_OK &&
+      spi_bus_add_device(OUTPUT_SPI_HOST, &dev, &spiDev) == ESP_OK) {
+    Log.printf("Output: SPI/DMA at %d MHz\n", OUTPUT_SPI_HZ / 1000000);
+  } else {
+    spiDev = nullptr;
+    Log.println("Output: SPI init failed, using bit-banged shift");
+  }
+
   // Clock all-zero data into shift registers, then latch to storage registers.
   clearAll();
   flushOutput();
+  output_wait_idle();
 
   // NOW enable outputs — storage registers are guaranteed all-zero.
   digitalWrite(PIN_OE_N, LOW);    // /OE LOW = outputs enabled
@@ -60,29 +122,136 @@ void shiftOutBytes(const uint8_t *buf, int len) {
   digitalWrite(PIN_LATCH, HIGH);
 }
 
-void flushOutput() {
+// Wait for the previous SPI transaction so its buffer can be reused
+static void reapTransaction() {
+  if (!spiBusy) return;
+  spi_transaction_t* done;
+  spi_device_get_trans_result(spiDev, &done, portMAX_DELAY);
+  spiBusy = false;
+}
+
+void output_wait_idle() {
+  if (spiDev) reapTransaction();
+}
+
+static void doFlush(bool force) {
   int activeBytes = (config_num_outputs() + 7) / 8;
-  shiftOutBytes(outBuf, activeBytes);
+
+  if (flushPending) {
+    uint32_t delay = micros() - flushRequestedAt;
+    if (delay > stats.max_delay_us) stats.max_delay_us = delay;
+    flushPending = false;
+  }
+
+  // Skip the shift when the chain already holds this state
+  if (!force && shadowBytes == activeBytes &&
+      (!dirty || memcmp(outBuf, shadowBuf, activeBytes) == 0)) {
+    dirty = false;
+    stats.skipped++;
+    return;
+  }
+
+  memcpy(shadowBuf, outBuf, activeBytes);
+  shadowBytes = activeBytes;
+  dirty = false;
+  stats.flushes++;
+  stats.bytes_shifted += activeBytes;
+
+  if (!spiDev) {
+    shiftOutBytes(outBuf, activeBytes);
+    NOTE_MARK(NT_LATCH, NT_NO_NOTE);
+    return;
+  }
+
+  // The last byte of the chain goes out first (same order as shiftOutBytes)
+  uint8_t* tx = spiTx[txSlot];
+  for (int i = 0; i < activeBytes; ++i) {
+    tx[i] = outBuf[activeBytes - 1 - i];
+  }
+
+  reapTransaction();
+
+  spi_transaction_t& t = spiTrans[txSlot];
+  memset(&t, 0, sizeof(t));
+  t.length = activeBytes * 8;
+  t.tx_buffer = tx;
+  if (spi_device_queue_trans(spiDev, &t, portMAX_DELAY) == ESP_OK) {
+    spiBusy = true;
+    txSlot ^= 1;
+  }
+}
+
+void flushOutput() {
+  doFlush(false);
+}
+
+void output_request_flush() {
+  if (flushPending) {
+    stats.coalesced++;
+    return;
+  }
+  flushPending = true;
+  flushRequestedAt = micros();
+}
+
+void output_service() {
+  if (!flushPending) return;
+  // Window 0 latches once per receive batch; otherwise hold the latch until
+  // the window since the first request has passed
+  uint32_t window = config_get().flush_window_us;
+  if (window == 0 || micros() - flushRequestedAt >= window) {
+    doFlush(false);
+  }
+}
+
+void output_get_stats(OutputStats* out) {
+  if (out) *out = stats;
 }
 
 void clearAll() {
   memset(outBuf, 0x00, MAX_OUTPUT_BYTES);
+  dirty = true;
 }
 
 void setAll(bool v) {
   memset(outBuf, v ? 0xFF : 0x00, MAX_OUTPUT_BYTES);
+  dirty = true;
 }
 
 void stopAllNotes() {
   clearAll();
-  flushOutput();
+  doFlush(true);  // Always shift: all-off must not trust the shadow copy
+}
+
+bool output_merge(const uint8_t* bits, const uint8_t* mask) {
+  bool changed = false;
+  for (int i = 0; i < MAX_OUTPUT_BYTES; i += 8) {
+    uint64_t o, b, m;
+    memcpy(&o, outBuf + i, 8);
+    memcpy(&b, bits + i, 8);
+    memcpy(&m, mask + i, 8);
+    uint64_t n = (o & ~m) | (b & m);
+    if (n != o) {
+      memcpy(outBuf + i, &n, 8);
+      changed = true;
+    }
+  }
+  if (changed) dirty = true;
+  return changed;
 }
 
 void setChannel(int idx, bool v) {
   if (idx < 0 || idx >= config_num_outputs()) return;
-  Log.printf("setChannel(%d, %d)\n", idx, v ? 1 : 0);
   int byteIndex = idx / 8;
-  int bitIndex  = idx % 8;
-  if (v) outBuf[byteIndex] |=  (1 << bitIndex);
-  else   outBuf[byteIndex] &= ~(1 << bitIndex);
-}
\ No newline at end of file
+  uint8_t mask  = 1 << (idx % 8);
+  uint8_t b = v ? (outBuf[byteIndex] | mask) : (outBuf[byteIndex] & ~mask);
+  if (b == outBuf[byteIndex]) return;  // No change - nothing to flush
+  LOG_DEBUG("setChannel(%d, %d)\n", idx, v ? 1 : 0);
+  outBuf[byteIndex] = b;
+  dirty = true;
+}
+
+bool getChannel(int idx) {
+  if (idx < 0 || idx >= config_num_outputs()) return false;
+  return (outBuf[idx / 8] >> (idx % 8)) & 1;
+}
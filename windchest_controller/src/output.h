@@ -15,18 +15,49 @@
 extern "C" {
 #endif
 
+// Shift outBuf into the chain and latch it now (skipped if the chain
+// already holds the same bits)
 void flushOutput();
 
+// Mark outBuf as changed; the chain is updated by output_service() once the
+// configured flush window (config flush_window_us) has passed, or at the end
+// of the current receive batch when the window is 0
+void output_request_flush();
+
+// Perform a requested flush if it is due (call after each batch of input processing)
+void output_service();
+
+// Block until the last queued SPI transfer has finished
+void output_wait_idle();
+
 void clearAll();
   
 void setAll(bool v);
   
 void setChannel(int idx, bool v);
 
+// Wanted state of one output (outBuf, not necessarily latched yet)
+bool getChannel(int idx);
+
 void stopAllNotes();
 
+// Replace the outBuf bits selected by mask with the same bits of bits
+// (both MAX_OUTPUT_BYTES long, same layout as outBuf). Returns true if
+// outBuf changed; the caller requests the flush.
+bool output_merge(const uint8_t* bits, const uint8_t* mask);
+
 void output_begin();
 
+typedef struct {
+  uint32_t flushes;        // Shifts actually performed
+  uint32_t skipped;        // Flushes avoided because the chain already matched
+  uint32_t coalesced;      // Flush requests merged into an already pending one
+  uint32_t bytes_shifted;  // Total bytes clocked into the chain
+  uint32_t max_delay_us;   // Longest wait from first request to latch
+} OutputStats;
+
+void output_get_stats(OutputStats* out);
+
 #ifdef __cplusplus
 }
 #endif
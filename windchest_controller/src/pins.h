@@ -12,4 +12,8 @@ const int PIN_LATCH  = 14;  // LATCH   - GPIO14, physical pin 20
 // MIDI serial input (UART2)
 const int PIN_MIDI_RX = 17; // GPIO17, physical pin 10
 
+// CAN transceiver (TWAI), same wiring as the keyboard controllers
+const int PIN_CAN_TX  = 2;  // GPIO2
+const int PIN_CAN_RX  = 1;  // GPIO1
+
 #endif
\ No newline at end of file